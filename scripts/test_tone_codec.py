@@ -0,0 +1,215 @@
+#!/usr/bin/env python3
+"""Round trip of the firmware payload codecs through the receiver decoders.
+
+Builds shell_with_tone/src/tone/tone_codec.c for the host against a few
+stand-in Zephyr headers, encodes test vectors with it over ctypes and
+decodes the payloads with tone_udp_rx.py, both with and without numpy.
+
+Run with: python3 scripts/test_tone_codec.py
+"""
+
+from __future__ import annotations
+
+import ctypes
+import math
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+from pathlib import Path
+from unittest import mock
+
+SCRIPTS_DIR = Path(__file__).resolve().parent
+CODEC_SOURCE = SCRIPTS_DIR.parent / "shell_with_tone" / "src" / "tone" / "tone_codec.c"
+sys.path.insert(0, str(SCRIPTS_DIR))
+
+import tone_udp_rx as rx  # noqa: E402
+
+MAX_CHANNELS = 8
+MAX_SAMPLES_PER_PACKET = 2048
+
+# Just enough of the Zephyr headers tone_codec.c and tone_stream.h include
+SHIM_HEADERS = {
+    "zephyr/kernel.h": "#include <stdbool.h>\n#include <stdint.h>\n",
+    "zephyr/net/socket.h": "#include <netinet/in.h>\n#include <sys/socket.h>\n",
+    "zephyr/shell/shell.h": "struct shell;\n",
+    "zephyr/sys/util.h": """
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define CLAMP(val, low, high) (((val) <= (low)) ? (low) : MIN(val, high))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define BIT_MASK(n) ((1UL << (n)) - 1UL)
+#define BUILD_ASSERT(cond, msg) _Static_assert(cond, msg)
+""",
+    "zephyr/sys/byteorder.h": """
+#include <stdint.h>
+static inline void sys_put_le16(uint16_t val, uint8_t dst[2])
+{
+	dst[0] = (uint8_t)val;
+	dst[1] = (uint8_t)(val >> 8);
+}
+static inline void sys_put_be16(uint16_t val, uint8_t dst[2])
+{
+	dst[0] = (uint8_t)(val >> 8);
+	dst[1] = (uint8_t)val;
+}
+""",
+}
+
+
+class AdpcmState(ctypes.Structure):
+    _fields_ = [("predictor", ctypes.c_int16), ("step_index", ctypes.c_uint8)]
+
+
+def build_codec(workdir: Path) -> ctypes.CDLL:
+    """Compile tone_codec.c into a shared library under workdir and load it."""
+    for name, text in SHIM_HEADERS.items():
+        path = workdir / name
+        path.parent.mkdir(parents=True, exist_ok=True)
+        path.write_text(text)
+
+    library = workdir / "libtone_codec.so"
+    subprocess.run(
+        [
+            os.environ.get("CC", "cc"),
+            "-std=gnu11",
+            "-Wall",
+            "-Werror",
+            "-O2",
+            "-shared",
+            "-fPIC",
+            f"-I{workdir}",
+            f"-DCONFIG_TONE_MAX_SAMPLES_PER_PACKET={MAX_SAMPLES_PER_PACKET}",
+            f"-DCONFIG_TONE_MAX_CHANNELS={MAX_CHANNELS}",
+            "-DCONFIG_TONE_STREAM_MAX_BURST=8",
+            "-DCONFIG_TONE_MAX_STREAMS=1",
+            "-o",
+            str(library),
+            str(CODEC_SOURCE),
+        ],
+        check=True,
+    )
+
+    codec = ctypes.CDLL(str(library))
+    codec.tone_codec_encode.restype = ctypes.c_int
+    codec.tone_codec_encode.argtypes = [
+        ctypes.c_int,
+        ctypes.POINTER(AdpcmState),
+        ctypes.POINTER(ctypes.c_int16),
+        ctypes.c_uint32,
+        ctypes.c_uint32,
+        ctypes.POINTER(ctypes.c_uint8),
+        ctypes.c_size_t,
+    ]
+    return codec
+
+
+def interleave(*channels: list[int]) -> list[int]:
+    return [sample for frame in zip(*channels) for sample in frame]
+
+
+def sine(frames: int, period: int, amplitude: int = 32767, phase: float = 0.0) -> list[int]:
+    return [round(amplitude * math.sin(2 * math.pi * n / period + phase)) for n in range(frames)]
+
+
+def full_scale_steps(frames: int, run: int) -> list[int]:
+    """Square wave between both rails, run frames per level."""
+    return [32767 if (n // run) & 1 else -32768 for n in range(frames)]
+
+
+# name -> (interleaved samples, channels)
+VECTORS = {
+    "silence": ([0] * 480, 1),
+    "silence_stereo": ([0] * 960, 2),
+    "lsb_square": ([(n // 8) & 1 for n in range(441)], 1),
+    "single_frame": ([-1234, 4321], 2),
+    "full_scale_steps": (full_scale_steps(480, 48), 1),
+    "full_scale_alternating": (full_scale_steps(256, 1), 1),
+    "full_scale_steps_stereo": (interleave(full_scale_steps(240, 20), full_scale_steps(240, 7)), 2),
+    "sine_1k": (sine(441, 44), 1),
+    "sine_quad": (interleave(*(sine(240, 48, 20000, ch * math.pi / 2) for ch in range(4))), 4),
+}
+
+
+@unittest.skipIf(shutil.which(os.environ.get("CC", "cc")) is None, "no host C compiler")
+class ToneCodecRoundTrip(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls._workdir = tempfile.TemporaryDirectory()
+        cls.codec = build_codec(Path(cls._workdir.name))
+
+    @classmethod
+    def tearDownClass(cls):
+        cls._workdir.cleanup()
+
+    def encode(self, codec: int, samples: list[int], channels: int, states=None) -> bytes:
+        frames = len(samples) // channels
+        pcm = (ctypes.c_int16 * len(samples))(*samples)
+        capacity = 16 * len(samples) + 64  # full-scale Rice quotients run long
+        out = (ctypes.c_uint8 * capacity)()
+        if states is None:
+            states = (AdpcmState * channels)()
+        ret = self.codec.tone_codec_encode(codec, states, pcm, frames, channels, out, capacity)
+        self.assertGreater(ret, 0, f"tone_codec_encode returned {ret}")
+        return bytes(out[:ret])
+
+    def decode(self, codec: int, payload: bytes, channels: int) -> list[int]:
+        """Decode with the pure Python path, checking numpy agrees when installed."""
+        fmt = rx.StreamFormat(channels, 16)
+        with mock.patch.object(rx, "np", None):
+            pcm = rx.decode_payload(codec, payload, fmt)
+        if rx.np is not None:
+            self.assertEqual(rx.decode_payload(codec, payload, fmt), pcm, "numpy decoder differs")
+        return list(struct.unpack(f"<{len(pcm) // 2}h", pcm))
+
+    def test_rice_is_lossless(self):
+        for name, (samples, channels) in VECTORS.items():
+            with self.subTest(name):
+                payload = self.encode(rx.CODEC_RICE, samples, channels)
+                self.assertEqual(self.decode(rx.CODEC_RICE, payload, channels), samples)
+
+    def test_rice_k0_blocks(self):
+        for name in ("silence", "silence_stereo", "lsb_square", "single_frame"):
+            with self.subTest(name):
+                samples, channels = VECTORS[name]
+                payload = self.encode(rx.CODEC_RICE, samples, channels)
+                self.assertEqual(payload[2], 0, "expected a k=0 block")
+                self.assertEqual(self.decode(rx.CODEC_RICE, payload, channels), samples)
+
+    def test_adpcm_tracks_encoder(self):
+        for name, (samples, channels) in VECTORS.items():
+            with self.subTest(name):
+                states = (AdpcmState * channels)()
+                payload = self.encode(rx.CODEC_IMA_ADPCM, samples, channels, states)
+                decoded = self.decode(rx.CODEC_IMA_ADPCM, payload, channels)
+                self.assertEqual(len(decoded), len(samples))
+                # The decoder must land exactly where the encoder's prediction did
+                self.assertEqual(decoded[-channels:], [state.predictor for state in states])
+
+    def test_adpcm_silence_and_sine(self):
+        samples, channels = VECTORS["silence_stereo"]
+        payload = self.encode(rx.CODEC_IMA_ADPCM, samples, channels)
+        self.assertEqual(self.decode(rx.CODEC_IMA_ADPCM, payload, channels), samples)
+
+        samples, channels = VECTORS["sine_1k"]
+        states = (AdpcmState * channels)()
+        for _ in range(2):
+            # The second block starts from the step index the first one adapted to
+            decoded = self.decode(rx.CODEC_IMA_ADPCM, self.encode(rx.CODEC_IMA_ADPCM, samples, channels, states), 1)
+        error = max(abs(a - b) for a, b in zip(decoded, samples))
+        self.assertLess(error, 2048)
+
+    def test_truncated_blocks_are_rejected(self):
+        for codec in (rx.CODEC_IMA_ADPCM, rx.CODEC_RICE):
+            samples, channels = VECTORS["full_scale_steps"]
+            payload = self.encode(codec, samples, channels)
+            with self.subTest(rx.CODEC_NAMES[codec]), mock.patch.object(rx, "np", None):
+                with self.assertRaises(ValueError):
+                    rx.decode_payload(codec, payload[: len(payload) // 2], rx.StreamFormat(channels, 16))
+
+
+if __name__ == "__main__":
+    unittest.main()
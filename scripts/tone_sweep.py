@@ -0,0 +1,471 @@
+#!/usr/bin/env python3
+"""Wi-Fi audio tone performance sweep.
+
+Drives the nRF7002 DK shell over its UART console through a matrix of tone
+and Wi-Fi power-save settings. Each point runs tone_udp_rx.py in stats-only
+mode for a fixed time and combines its totals with the device 'tone stats'
+counters, so CSV and JSON reports from two firmware builds diff line by line.
+
+With --receivers N, --fanout compares N-way unicast, one stream per receiver
+from the multi-stream engine, against one multicast stream all N receivers
+join, by device CPU per delivered packet and estimated airtime.
+"""
+
+from __future__ import annotations
+
+import argparse
+import collections
+import csv
+import datetime
+import itertools
+import json
+import logging
+import platform
+import re
+import subprocess
+import sys
+import tempfile
+import time
+from pathlib import Path
+
+try:
+    import serial  # type: ignore
+except ImportError:  # pragma: no cover - optional dependency
+    serial = None
+
+from tone_udp_rx import HEADER_EXT_LEN, HEADER_LEN, discover_local_ips
+
+LOGGER = logging.getLogger("tone_sweep")
+RX_SCRIPT = Path(__file__).with_name("tone_udp_rx.py")
+DEFAULT_PROMPT = "uart:~$ "
+SHELL_TIMEOUT_S = 5.0
+SHELL_QUIET_S = 0.05  # silence after the prompt that ends a reply
+RX_STARTUP_S = 1.0  # receiver bind time before the stream starts
+RX_DRAIN_S = 1.0  # receiver keeps listening after the stream stops
+ANSI_ESCAPE = re.compile(r"\x1b\[[0-9;?]*[A-Za-z]")
+SHELL_ERROR_COLOR = "\x1b[1;31m"
+FAILURE_TEXT = re.compile(r"\b(?:failed|usage|invalid)\b", re.IGNORECASE)
+FANOUT_MODES = ("unicast", "multicast")
+DEFAULT_MULTICAST_GROUP = "239.255.50.5"
+
+# 802.11 airtime model for the fan-out estimate: channel access (DIFS plus the
+# mean CWmin backoff) and OFDM preamble ahead of every frame, SIFS plus ACK
+# after unicast frames only; frames carry a QoS MAC header, LLC/SNAP and FCS
+AIR_ACCESS_US = 34.0 + 7.5 * 9.0
+AIR_PREAMBLE_US = 20.0
+AIR_ACK_US = 16.0 + 44.0
+AIR_MAC_BYTES = 26 + 8 + 4
+UDP_HEADER_BYTES = 8
+IP_HEADER_BYTES = {False: 20, True: 40}
+
+# 'tone stats' lines and the report columns their numbers go to
+DEVICE_STATS = (
+    (r"Packets sent: (\d+)", ("dev_packets_sent",)),
+    (r"Packet rate: ([\d.]+)/s achieved, ([\d.]+)/s configured", ("dev_rate_achieved", "dev_rate_configured")),
+    (r"Send errors: ENOMEM (\d+), EAGAIN (\d+), other (\d+)", ("dev_enomem", "dev_eagain", "dev_send_other")),
+    (r"Synthesis alloc failures: (\d+), TX underruns: (\d+)", ("dev_alloc_failures", "dev_tx_underruns")),
+    (r"Late wakeups: (\d+) of (\d+) \(max lateness (\d+) us\)", ("dev_late_wakeups", "dev_wakeups", "dev_max_lateness_us")),
+    (r"Pacing error: min (-?\d+) avg (-?\d+) max (-?\d+) us", ("dev_pacing_min_us", "dev_pacing_avg_us", "dev_pacing_max_us")),
+    (r"Max send duration: (\d+) us", ("dev_max_send_us",)),
+    (r"codec fallbacks (\d+)", ("dev_codec_fallbacks",)),
+    (r"Synthesis: avg (\d+) max (\d+) us over (\d+) packets", ("dev_synth_avg_us", "dev_synth_max_us", "dev_packets_built")),
+    (r"Adaptive packets: (\d+) ms, (\d+) changes", ("dev_adapt_packet_ms", "dev_adaptations")),
+    (r"TWT hold: avg (\d+) max (\d+) us over (\d+) packets", ("dev_twt_hold_avg_us", "dev_twt_hold_max_us", "dev_twt_packets")),
+    (r"FEC: (\d+) parity packets, ([\d.]+)% of payload bytes", ("dev_fec_packets", "dev_fec_overhead_pct")),
+    *(
+        (
+            rf"AC {ac}: (\d+) sends, send avg (\d+) us, p99 <= (\d+) us, max (\d+) us",
+            (f"dev_{ac}_sends", f"dev_{ac}_send_avg_us", f"dev_{ac}_send_p99_us", f"dev_{ac}_send_max_us"),
+        )
+        for ac in ("be", "bk", "vi", "vo")
+    ),
+)
+WIFI_STATUS = (
+    (r"RSSI:\s*(-?\d+)", ("wifi_rssi",)),
+    (r"Channel:\s*(\d+)", ("wifi_channel",)),
+    (r"Link Mode:\s*(\S+)", ("wifi_link_mode",)),
+    (r"Current PHY TX rate \(Mbps\)\s*:\s*([\d.]+)", ("wifi_phy_rate_mbps",)),
+)
+
+ShellReply = collections.namedtuple("ShellReply", "text failed")
+SweepPoint = collections.namedtuple("SweepPoint", "packet_ms rate channels ps twt fanout")
+
+
+def comma_list(kind):
+    def parse(text: str):
+        try:
+            return [kind(item) for item in text.split(",") if item]
+        except ValueError as exc:
+            raise argparse.ArgumentTypeError(str(exc)) from exc
+
+    return parse
+
+
+def twt_setting(text: str):
+    """'off' or '<wake_us>/<interval_us>' for 'wifi twt quick_setup'."""
+    if text == "off":
+        return None
+    wake, _, interval = text.partition("/")
+    try:
+        return int(wake), int(interval)
+    except ValueError as exc:
+        raise ValueError(f"TWT setting {text!r} is not 'off' or <wake_us>/<interval_us>") from exc
+
+
+def build_parser() -> argparse.ArgumentParser:
+    parser = argparse.ArgumentParser(
+        description="Sweep tone stream and Wi-Fi power-save settings over the DK shell and report receiver statistics",
+    )
+    parser.add_argument("--serial", help="Serial port of the DK shell, e.g. /dev/ttyACM1 or COM5")
+    parser.add_argument("--baud", type=int, default=115_200, help="Shell UART baud rate")
+    parser.add_argument("--prompt", default=DEFAULT_PROMPT, help="Shell prompt that ends each reply")
+    parser.add_argument("--host-ip", help="Address the device streams to (default: first local interface)")
+    parser.add_argument("--listen-port", type=int, default=50005, help="Receiver UDP port")
+    parser.add_argument("--packet-ms", type=comma_list(int), default=[10], help="Packet durations, e.g. 10,5,2")
+    parser.add_argument("--rates", type=comma_list(int), default=[44_100], help="Sample rates, e.g. 44100,48000")
+    parser.add_argument("--channels", type=comma_list(int), default=[1], help="Channel counts, e.g. 1,2")
+    parser.add_argument("--ps", type=comma_list(str), default=["off"], help="Wi-Fi power save settings: off,on")
+    parser.add_argument(
+        "--twt",
+        type=comma_list(twt_setting),
+        default=[None],
+        help="TWT settings: off or <wake_us>/<interval_us>, e.g. off,8000/50000",
+    )
+    parser.add_argument(
+        "--fanout",
+        type=comma_list(str),
+        default=["unicast"],
+        help="Distribution to --receivers: unicast (one stream each), multicast (one stream they all join), e.g. unicast,multicast",
+    )
+    parser.add_argument("--receivers", type=int, default=1, help="Receivers per point, on --listen-port and up for unicast")
+    parser.add_argument("--multicast-group", default=DEFAULT_MULTICAST_GROUP, help="IPv4 or IPv6 group for --fanout multicast")
+    parser.add_argument(
+        "--multicast-rate-mbps",
+        type=float,
+        default=6.0,
+        help="Rate the AP relays multicast at for the airtime estimate (its lowest basic rate unless configured)",
+    )
+    parser.add_argument(
+        "--phy-rate-mbps",
+        type=float,
+        help="Unicast PHY rate for the airtime estimate (default: the 'wifi status' TX rate)",
+    )
+    parser.add_argument("--tone-config", default="", help="Extra 'tone config' arguments for every point, e.g. 'codec=rice'")
+    parser.add_argument("--duration", type=float, default=20.0, help="Streaming time per point in seconds")
+    parser.add_argument(
+        "--rx-arg",
+        action="append",
+        default=[],
+        help="Extra tone_udp_rx.py argument, repeatable, e.g. --rx-arg=--adaptive-jitter",
+    )
+    parser.add_argument("--label", default="", help="Build label recorded in the report, e.g. a git describe")
+    parser.add_argument("--output", type=Path, help="Report path without suffix (default: tone_sweep_<time>)")
+    parser.add_argument("--dry-run", action="store_true", help="Log the shell commands without a device or receiver")
+    parser.add_argument("--log-level", default="INFO", help="Logging level")
+    return parser
+
+
+class DeviceShell:
+    """Command/reply access to the Zephyr shell on the DK's UART console."""
+
+    def __init__(self, port: str, baudrate: int, prompt: str):
+        self._serial = serial.Serial(port, baudrate, timeout=0.05)
+        self._prompt = prompt
+        self.command("")  # sync to a fresh prompt
+
+    def close(self):
+        self._serial.close()
+
+    def command(self, line: str, timeout: float = SHELL_TIMEOUT_S) -> ShellReply:
+        self._serial.reset_input_buffer()
+        self._serial.write(line.encode("ascii") + b"\n")
+        raw = bytearray()
+        deadline = time.monotonic() + timeout
+        prompt_seen = None
+        while time.monotonic() < deadline:
+            chunk = self._serial.read(self._serial.in_waiting or 1)
+            now = time.monotonic()
+            if chunk:
+                raw += chunk
+                prompt_seen = now if ANSI_ESCAPE.sub("", raw.decode("utf-8", "replace")).endswith(self._prompt) else None
+            elif prompt_seen is not None and now - prompt_seen >= SHELL_QUIET_S:
+                break
+        else:
+            LOGGER.warning("No prompt after %r within %.1f s", line, timeout)
+
+        text = raw.decode("utf-8", "replace")
+        failed = SHELL_ERROR_COLOR in text
+        lines = [part.strip() for part in ANSI_ESCAPE.sub("", text).replace("\r", "").split("\n")]
+        lines = [part for part in lines if part and part != self._prompt.strip()]
+        if lines and lines[0].endswith(line):
+            lines.pop(0)  # echo of the command itself
+        text = "\n".join(lines)
+        return ShellReply(text, failed or bool(FAILURE_TEXT.search(text)))
+
+
+class DryRunShell:
+    def command(self, line: str, timeout: float = SHELL_TIMEOUT_S) -> ShellReply:
+        LOGGER.info("shell> %s", line)
+        return ShellReply("", False)
+
+    def close(self):
+        pass
+
+
+def parse_counters(text: str, patterns) -> dict:
+    result = {}
+    for pattern, names in patterns:
+        match = re.search(pattern, text)
+        if match:
+            for name, value in zip(names, match.groups()):
+                try:
+                    result[name] = float(value) if "." in value else int(value)
+                except ValueError:
+                    result[name] = value
+    return result
+
+
+def frame_airtime_us(datagram_bytes: float, rate_mbps: float, ipv6: bool, acked: bool) -> float:
+    """Medium time of one tone datagram sent as a single 802.11 frame."""
+    frame_bytes = datagram_bytes + UDP_HEADER_BYTES + IP_HEADER_BYTES[ipv6] + AIR_MAC_BYTES
+    return AIR_ACCESS_US + AIR_PREAMBLE_US + frame_bytes * 8.0 / rate_mbps + (AIR_ACK_US if acked else 0.0)
+
+
+def fanout_summary(args, point: SweepPoint, row: dict, streams: list[dict], receivers: list[dict], ipv6: bool) -> dict:
+    """Device CPU per delivered packet and airtime of one fan-out point.
+
+    CPU is the synthesis plus send time the device reports per packet, so it
+    covers the tone workqueue but not the Wi-Fi driver below the IP stack.
+    Unicast costs one uplink frame per receiver; a multicast frame goes up to
+    the AP once and is relayed unacknowledged at the multicast rate.
+    """
+    packets = sum(stats.get("dev_packets_sent", 0) for stats in streams)
+    cpu_us = sum(
+        stats.get("dev_packets_built", 0) * stats.get("dev_synth_avg_us", 0)
+        + sum(stats.get(f"dev_{ac}_sends", 0) * stats.get(f"dev_{ac}_send_avg_us", 0) for ac in ("be", "bk", "vi", "vo"))
+        for stats in streams
+    )
+    copies = len(receivers) if point.fanout == "multicast" else 1
+    result = {
+        "fanout_streams": len(streams),
+        "fanout_receivers": len(receivers),
+        "dev_packets_total": packets,
+        "dev_cpu_us_per_packet": cpu_us / packets if packets else 0.0,
+        "dev_cpu_us_per_delivery": cpu_us / (packets * copies) if packets else 0.0,
+        "rx_loss_pct_max": max((rx.get("loss_pct", 0.0) for rx in receivers), default=0.0),
+        "rx_jitter_ms_max": max((rx.get("jitter_ms", 0.0) for rx in receivers), default=0.0),
+    }
+
+    phy_rate = args.phy_rate_mbps or row.get("wifi_phy_rate_mbps")
+    received = sum(rx.get("received", 0) for rx in receivers)
+    if not phy_rate or not received:
+        return result
+    datagram = sum(rx.get("payload_bytes", 0) for rx in receivers) / received + HEADER_LEN + HEADER_EXT_LEN
+    air_us = frame_airtime_us(datagram, phy_rate, ipv6, acked=True)
+    if point.fanout == "multicast":
+        air_us += frame_airtime_us(datagram, args.multicast_rate_mbps, ipv6, acked=False)
+    packet_rate = sum(stats.get("dev_rate_achieved", 0.0) for stats in streams)
+    result["air_us_per_packet"] = air_us
+    result["airtime_pct"] = packet_rate * air_us / 1e4
+    return result
+
+
+def run_point(args, shell, host_ip: str, point: SweepPoint) -> dict:
+    """Configure one matrix point, stream it and return its report row."""
+    row = point._asdict()
+    row["twt"] = "off" if point.twt is None else "{}/{}".format(*point.twt)
+
+    def check(line: str) -> ShellReply:
+        reply = shell.command(line)
+        if reply.failed:
+            raise RuntimeError(f"'{line}' failed: {reply.text or 'shell error'}")
+        return reply
+
+    # (target, port) per device stream and the port and group of every receiver
+    if point.fanout == "multicast":
+        targets = [(args.multicast_group, args.listen_port)]
+        listeners = [(args.listen_port, args.multicast_group)] * args.receivers
+    else:
+        targets = [(host_ip, args.listen_port + i) for i in range(args.receivers)]
+        listeners = [(port, None) for _, port in targets]
+    ipv6 = ":" in targets[0][0]
+
+    twt_active = False
+    rx_procs: list[subprocess.Popen] = []
+    try:
+        shell.command("tone stop")
+        for stream in range(len(targets)):
+            check(f"tone config id={stream} rate={point.rate} packet={point.packet_ms} ch={point.channels} {args.tone_config}".strip())
+        check(f"wifi ps {point.ps}")
+        if point.twt is not None:
+            check("wifi twt quick_setup {} {}".format(*point.twt))
+            twt_active = True
+        row.update(parse_counters(shell.command("wifi status").text, WIFI_STATUS))
+
+        if args.dry_run:
+            for stream, (target, port) in enumerate(targets):
+                check(f"tone start {stream} {target} {port}")
+                check(f"tone stats {stream}")
+            check("tone stop")
+            row["status"] = "dry-run"
+            return row
+
+        with tempfile.TemporaryDirectory() as tmp:
+            rx_duration = RX_STARTUP_S + args.duration + RX_DRAIN_S
+            summary_paths = [Path(tmp) / f"rx{index}.json" for index in range(len(listeners))]
+            for (port, group), summary_path in zip(listeners, summary_paths):
+                command = [
+                    sys.executable,
+                    str(RX_SCRIPT),
+                    "--no-audio",
+                    "--listen-port",
+                    str(port),
+                    "--sample-rate",
+                    str(point.rate),
+                    "--duration",
+                    str(rx_duration),
+                    "--summary-json",
+                    str(summary_path),
+                    "--log-level",
+                    "WARNING",
+                    *(["--multicast", group] if group else []),
+                    *args.rx_arg,
+                ]
+                rx_procs.append(subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, text=True))
+            time.sleep(RX_STARTUP_S)
+            for stream in range(len(targets)):
+                check(f"tone stats {stream} reset")
+            for stream, (target, port) in enumerate(targets):
+                check(f"tone start {stream} {target} {port}")
+            time.sleep(args.duration)
+            streams = [parse_counters(check(f"tone stats {stream}").text, DEVICE_STATS) for stream in range(len(targets))]
+            check("tone stop")
+            receivers = []
+            for rx, summary_path in zip(rx_procs, summary_paths):
+                _, rx_log = rx.communicate(timeout=rx_duration + 10.0)
+                if rx.returncode != 0 or not summary_path.exists():
+                    raise RuntimeError(f"receiver exited with {rx.returncode}: {rx_log.strip()[-500:]}")
+                receivers.append(json.loads(summary_path.read_text()))
+            row.update(streams[0])
+            row.update({f"rx_{key}": value for key, value in receivers[0].items()})
+            if len(receivers) > 1 or point.fanout != "unicast":
+                row.update(fanout_summary(args, point, row, streams, receivers, ipv6))
+        row["status"] = "ok"
+    except (RuntimeError, OSError, subprocess.TimeoutExpired) as exc:
+        LOGGER.error("Point %s: %s", row, exc)
+        row["status"] = f"error: {exc}"
+        shell.command("tone stop")
+    finally:
+        for rx in rx_procs:
+            if rx.poll() is None:
+                rx.kill()
+                rx.wait()
+        if twt_active:
+            shell.command("wifi twt teardown_all")
+    return row
+
+
+def write_reports(output: Path, meta: dict, rows: list[dict]):
+    """Rewrite both reports so an interrupted sweep keeps its finished points."""
+    rows = [{key: round(value, 3) if isinstance(value, float) else value for key, value in row.items()} for row in rows]
+    columns = list(dict.fromkeys(key for row in rows for key in row))
+    with output.with_suffix(".csv").open("w", newline="") as csv_file:
+        writer = csv.DictWriter(csv_file, fieldnames=columns)
+        writer.writeheader()
+        writer.writerows(rows)
+    output.with_suffix(".json").write_text(json.dumps({"meta": meta, "results": rows}, indent=2) + "\n")
+
+
+def main() -> int:
+    parser = build_parser()
+    args = parser.parse_args()
+
+    logging.basicConfig(level=getattr(logging, args.log_level.upper(), logging.INFO), format="%(asctime)s %(levelname)s %(message)s")
+
+    if not args.dry_run:
+        if serial is None:
+            LOGGER.error("pyserial is required to reach the device shell (pip install pyserial)")
+            return 1
+        if not args.serial:
+            LOGGER.error("--serial is required unless --dry-run is given")
+            return 1
+    if args.duration <= 0:
+        LOGGER.error("Duration must be positive")
+        return 1
+    bad_ps = [value for value in args.ps if value not in ("on", "off")]
+    if bad_ps:
+        LOGGER.error("Power save settings must be on or off, not %s", ", ".join(bad_ps))
+        return 1
+    bad_fanout = [value for value in args.fanout if value not in FANOUT_MODES]
+    if bad_fanout:
+        LOGGER.error("Fan-out modes must be %s, not %s", " or ".join(FANOUT_MODES), ", ".join(bad_fanout))
+        return 1
+    if args.receivers < 1:
+        LOGGER.error("At least one receiver is needed")
+        return 1
+
+    host_ip = args.host_ip
+    if not host_ip:
+        local_ips = discover_local_ips()
+        if not local_ips:
+            LOGGER.error("No local address found; pass --host-ip")
+            return 1
+        host_ip = local_ips[0]
+
+    started = datetime.datetime.now().astimezone()
+    output = args.output or Path(f"tone_sweep_{started:%Y%m%d_%H%M%S}")
+    points = [
+        SweepPoint(*values)
+        for values in itertools.product(args.packet_ms, args.rates, args.channels, args.ps, args.twt, args.fanout)
+    ]
+    LOGGER.info("Sweeping %d points of %.0f s to %s:%d", len(points), args.duration, host_ip, args.listen_port)
+
+    shell = DryRunShell() if args.dry_run else DeviceShell(args.serial, args.baud, args.prompt)
+    meta = {
+        "label": args.label,
+        "firmware": shell.command("kernel version").text,
+        "started": started.isoformat(timespec="seconds"),
+        "host": platform.platform(),
+        "duration_s": args.duration,
+        "tone_config": args.tone_config,
+        "rx_args": args.rx_arg,
+        "receivers": args.receivers,
+        "multicast_group": args.multicast_group if "multicast" in args.fanout else None,
+    }
+    rows: list[dict] = []
+    try:
+        for index, point in enumerate(points, 1):
+            LOGGER.info("Point %d/%d: %s", index, len(points), point)
+            row = run_point(args, shell, host_ip, point)
+            rows.append(row)
+            write_reports(output, meta, rows)
+            if row["status"] == "ok":
+                LOGGER.info(
+                    "  %.1f kbps, loss %.2f%%, jitter %.2f ms, device ENOMEM %s, TX underruns %s",
+                    row.get("rx_throughput_kbps", 0.0),
+                    row.get("rx_loss_pct", 0.0),
+                    row.get("rx_jitter_ms", 0.0),
+                    row.get("dev_enomem", "?"),
+                    row.get("dev_tx_underruns", "?"),
+                )
+                if "fanout_receivers" in row:
+                    LOGGER.info(
+                        "  %s to %d receivers: %.1f us device CPU per delivered packet, airtime %s",
+                        point.fanout,
+                        row["fanout_receivers"],
+                        row["dev_cpu_us_per_delivery"],
+                        f"{row['airtime_pct']:.1f}%" if "airtime_pct" in row else "unknown (pass --phy-rate-mbps)",
+                    )
+    except KeyboardInterrupt:
+        LOGGER.info("Sweep interrupted after %d of %d points", len(rows), len(points))
+        shell.command("tone stop")
+    finally:
+        shell.close()
+
+    if rows:
+        LOGGER.info("Reports: %s, %s", output.with_suffix(".csv"), output.with_suffix(".json"))
+    return 0 if rows and all(row["status"] in ("ok", "dry-run") for row in rows) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,9 +7,18 @@ absorb jitter, plays back the PCM stream, and reports statistics.
 """
 
 import argparse
+import array
+import bisect
 import collections
+import ctypes
+import errno
+import functools
+import ipaddress
+import json
 import logging
+import os
 import queue
+import select
 import signal
 import socket
 import struct
@@ -36,28 +45,589 @@ except ImportError:  # standard library; safety net
 LOGGER = logging.getLogger("tone_udp_rx")
 HEADER_FMT = ">III"
 HEADER_LEN = struct.calcsize(HEADER_FMT)
+# Optional extension after the base header: magic, version, length, channels, bits, codec, adaptation epoch
+HEADER_EXT_FMT = ">HBBBBBB"
+HEADER_EXT_LEN = struct.calcsize(HEADER_EXT_FMT)
+HEADER_EXT_MAGIC = 0x5445
+# Versions 1 and 2 predate the codec and epoch bytes, which they sent as zero
+HEADER_EXT_VERSIONS = (1, 2, 3)
+# Parity packets carry instead: magic, version, length, packets covered, their sequence stride, XOR of their lengths
+FEC_EXT_FMT = ">HBBBBH"
+FEC_EXT_LEN = struct.calcsize(FEC_EXT_FMT)
+FEC_EXT_MAGIC = 0x5446
+FEC_EXT_VERSION = 1
+FEC_WINDOW_PACKETS = 1024  # sequence numbers a parity group may wait for its packets
+TIMESTAMP_OFFSET = 8  # parity covers the datagram with this 32-bit field zeroed
+# Link reports carry: magic, version, length, stream id, reserved, sampling period (ms)
+LINK_EXT_FMT = ">HBBBBH"
+LINK_EXT_LEN = struct.calcsize(LINK_EXT_FMT)
+LINK_EXT_MAGIC = 0x544C
+LINK_EXT_VERSION = 2
+# Uptime, first and end sequence, TX packets, TX rate (100 kbit/s), TX errors, overruns, missed beacons, RSSI, flags
+LINK_REPORT_FMT = ">IIIIIHHHbB"
+LINK_REPORT_LEN = struct.calcsize(LINK_REPORT_FMT)
+LINK_CONNECTED = 0x01
+LINK_WINDOW_PACKETS = 65_536  # arrivals remembered to count the packets of a report
+CODEC_PCM = 0
+CODEC_IMA_ADPCM = 1
+CODEC_RICE = 2
+CODEC_NAMES = {CODEC_PCM: "pcm", CODEC_IMA_ADPCM: "adpcm", CODEC_RICE: "rice"}
+# Encoded payloads open with: frame count, codec parameter (Rice k), reserved
+CODEC_BLOCK_HDR_FMT = ">HBB"
+CODEC_BLOCK_HDR_LEN = struct.calcsize(CODEC_BLOCK_HDR_FMT)
+ADPCM_CHANNEL_HDR_LEN = 4  # predictor (s16 LE), step index, reserved
+ADPCM_STEPS = (
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60,
+    66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371,
+    408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707,
+    1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132,
+    7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767,
+)
+ADPCM_INDEX_ADJUST = (-1, -1, -1, -1, 2, 4, 6, 8) * 2
 DEFAULT_SAMPLE_RATE = 44_100
 DEFAULT_CHANNELS = 1
-INT16_BYTES = 2
+SAMPLE_DTYPES = {16: "int16", 24: "int24", 32: "int32"}
+MAX_PACKET_BYTES = 65_535
+DEFAULT_BATCH = 32
+HIGH_RATE_RCVBUF_BYTES = 4 * 1024 * 1024
+SOCKADDR_LEN = 28  # sockaddr_in6, which also holds a sockaddr_in
+JITTER_GAIN = 1 / 16  # RFC 3550 interarrival jitter smoothing
+JITTER_DEVIATIONS = 4  # playout delay covers this many jitter estimates
+JITTER_WINDOW_PACKETS = 64  # arrivals between playout delay corrections
+JITTER_MAX_CHUNKS = 4096
+JITTER_RESYNC_S = 5.0
+TIMESYNC_FMT = ">HBBIQQQ"
+TIMESYNC_LEN = struct.calcsize(TIMESYNC_FMT)
+TIMESYNC_MAGIC = 0x5453
+TIMESYNC_VERSION = 1
+TIMESYNC_REQUEST = 0
+TIMESYNC_RESPONSE = 1
+TIMESYNC_DEFAULT_PORT = 50006
+TIMESYNC_WINDOW = 64  # exchanges kept for the offset and drift fit
+TIMESYNC_BEST = 16  # lowest-delay exchanges the fit uses
+LATENCY_PERCENTILES = (50, 95, 99)
+RAW_TONE_LLC_SNAP = bytes((0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00, 0x88, 0xB5))  # EtherType 0x88B5
+RADIOTAP_FLAGS_FCS = 0x10  # frames end in a 4-byte FCS
+ETH_P_ALL = 0x0003
+CLOCK_PLAYOUT_BLOCK_MS = 10
 
 
-class Stats:
+class StreamFormat(collections.namedtuple("StreamFormat", "channels bits")):
+    @property
+    def sample_bytes(self) -> int:
+        return self.bits // 8
+
+    @property
+    def bytes_per_frame(self) -> int:
+        return self.sample_bytes * self.channels
+
+
+Packet = collections.namedtuple("Packet", "seq sample_counter timestamp_us format codec adapt_epoch payload")
+
+
+def parse_packet(packet: bytes, default_format: StreamFormat):
+    """Split a datagram into a Packet.
+
+    Packets without the versioned header extension carry the legacy layout,
+    interpreted with the command line channel count and 16-bit PCM. The
+    format describes the decoded samples; the codec applies to this packet
+    only, as the firmware sends packets that do not compress as PCM. The
+    adaptation epoch changes whenever adaptive sizing changes the packet size.
+    Returns None for packets that cannot be decoded.
+    """
+    if len(packet) <= HEADER_LEN:
+        return None
+
+    seq, sample_counter, timestamp_us = struct.unpack_from(HEADER_FMT, packet)
+    fmt = default_format
+    codec = CODEC_PCM
+    adapt_epoch = 0
+    offset = HEADER_LEN
+
+    if len(packet) >= HEADER_LEN + HEADER_EXT_LEN:
+        magic, version, ext_len, channels, bits, ext_codec, ext_epoch = struct.unpack_from(
+            HEADER_EXT_FMT, packet, HEADER_LEN
+        )
+        if (
+            magic == HEADER_EXT_MAGIC
+            and version in HEADER_EXT_VERSIONS
+            and ext_len >= HEADER_EXT_LEN
+            and channels > 0
+            and bits in SAMPLE_DTYPES
+        ):
+            fmt = StreamFormat(channels, bits)
+            codec = ext_codec
+            adapt_epoch = ext_epoch
+            offset += ext_len
+
+    payload = packet[offset:]
+    if not payload:
+        return None
+    if codec == CODEC_PCM:
+        if len(payload) % fmt.bytes_per_frame:
+            return None
+    elif codec not in CODEC_NAMES or fmt.bits != 16 or len(payload) <= CODEC_BLOCK_HDR_LEN:
+        return None
+
+    return Packet(seq, sample_counter, timestamp_us, fmt, codec, adapt_epoch, payload)
+
+
+def xor_into(parity: bytes, datagrams) -> bytes:
+    """XOR datagrams, none longer than parity, into a copy of it."""
+    if np is not None:
+        acc = np.frombuffer(parity, dtype=np.uint8).copy()
+        for datagram in datagrams:
+            acc[: len(datagram)] ^= np.frombuffer(datagram, dtype=np.uint8)
+        return acc.tobytes()
+    # Little-endian integers zero-pad at the top, matching the padding of the parity
+    acc = int.from_bytes(parity, "little")
+    for datagram in datagrams:
+        acc ^= int.from_bytes(datagram, "little")
+    return acc.to_bytes(len(parity), "little")
+
+
+class FecDecoder:
+    """Rebuild lost packets from the XOR parity packets of 'tone config fec=<K>'.
+
+    Each parity packet covers K data packets, stride sequence numbers apart,
+    and is the XOR of those datagrams with their timestamp zeroed. Once all
+    but one of a group are in, the missing one is rebuilt; groups still
+    short when their first packet falls FEC_WINDOW_PACKETS behind the newest
+    count their missing packets as unrecoverable.
+    """
+
     def __init__(self):
+        self._data: dict[int, bytes] = {}
+        self._order: collections.deque[int] = collections.deque()
+        self._rebuilt: set[int] = set()
+        self._groups: dict[tuple[int, int], tuple[list[int], int, bytes]] = {}
+        self._newest = None
+        self.parity_packets = 0
+        self.recovered = 0
+        self.unrecoverable = 0
+        self.malformed = 0
+
+    @property
+    def active(self) -> bool:
+        return self.parity_packets > 0
+
+    @staticmethod
+    def is_parity(packet) -> bool:
+        if len(packet) < HEADER_LEN + FEC_EXT_LEN:
+            return False
+        magic, version = struct.unpack_from(">HB", packet, HEADER_LEN)
+        return magic == FEC_EXT_MAGIC and version == FEC_EXT_VERSION
+
+    def _age(self, seq: int) -> int:
+        return (self._newest - seq) & 0xFFFFFFFF
+
+    def _advance(self, seq: int):
+        if self._newest is None or 0 < (seq - self._newest) & 0xFFFFFFFF < 0x80000000:
+            self._newest = seq
+        for key, (members, _, _) in list(self._groups.items()):
+            if FEC_WINDOW_PACKETS <= self._age(members[0]) < 0x80000000:
+                self.unrecoverable += sum(1 for m in members if m not in self._data)
+                del self._groups[key]
+        while self._order and self._age(self._order[0]) >= FEC_WINDOW_PACKETS:
+            old = self._order.popleft()
+            self._data.pop(old, None)
+            self._rebuilt.discard(old)
+
+    def _store(self, seq: int, datagram: bytes):
+        if seq not in self._data:
+            self._order.append(seq)
+        self._data[seq] = datagram
+
+    def _resolve(self, key) -> list[bytes]:
+        members, length_xor, parity = self._groups[key]
+        missing = [m for m in members if m not in self._data]
+        if len(missing) > 1:
+            return []
+        del self._groups[key]
+        if not missing:
+            return []
+
+        present = [self._data[m] for m in members if m != missing[0]]
+        length = length_xor
+        for datagram in present:
+            length ^= len(datagram)
+        if any(len(d) > len(parity) for d in present) or not HEADER_LEN < length <= len(parity):
+            self.malformed += 1
+            return []
+        rebuilt = xor_into(parity, present)[:length]
+        if struct.unpack_from(">I", rebuilt)[0] != missing[0]:
+            self.malformed += 1
+            return []
+
+        self._store(missing[0], rebuilt)
+        self._rebuilt.add(missing[0])
+        self.recovered += 1
+        return [rebuilt]
+
+    def add_data(self, packet):
+        """Keep a data datagram; return the packets it completes, or None if it was already rebuilt."""
+        if len(packet) < HEADER_LEN:
+            return []
+        seq = struct.unpack_from(">I", packet)[0]
+        if seq in self._rebuilt:
+            return None
+        datagram = bytearray(packet)
+        datagram[TIMESTAMP_OFFSET : TIMESTAMP_OFFSET + 4] = bytes(4)
+        self._store(seq, bytes(datagram))
+        self._advance(seq)
+        rebuilt = []
+        for key, (members, _, _) in list(self._groups.items()):
+            if seq in members:
+                rebuilt += self._resolve(key)
+        return rebuilt
+
+    def add_parity(self, packet) -> list[bytes]:
+        """Queue a parity group; return the packet it rebuilds, if any."""
+        base = struct.unpack_from(">I", packet)[0]
+        _, _, ext_len, group, stride, length_xor = struct.unpack_from(FEC_EXT_FMT, packet, HEADER_LEN)
+        self.parity_packets += 1
+        if group == 0 or stride == 0 or ext_len < FEC_EXT_LEN:
+            self.malformed += 1
+            return []
+        members = [(base + i * stride) & 0xFFFFFFFF for i in range(group)]
+        key = (base, stride)
+        self._groups[key] = (members, length_xor, bytes(packet[HEADER_LEN + ext_len :]))
+        self._advance(members[-1])
+        return self._resolve(key) if key in self._groups else []
+
+    def summary(self) -> dict:
+        return {
+            "fec_parity": self.parity_packets,
+            "fec_recovered": self.recovered,
+            "fec_unrecoverable": self.unrecoverable,
+        }
+
+
+class LinkLog:
+    """Log the link reports of 'tone config link=on' next to what arrived here.
+
+    Each report describes the Wi-Fi link over one device sampling period and
+    the data packets sent in it, [first_seq, end_seq). Arrivals are only
+    tracked from the first report on, so that one is logged without the
+    receiver side.
+    """
+
+    def __init__(self):
+        self._seen: set[int] = set()
+        self._order: collections.deque[int] = collections.deque()
+        self.reports = 0
+        self.malformed = 0
+        self.lost = 0
+        self.tx_errors = 0
+        self.tx_overruns = 0
+        self.beacons_missed = 0
+        self.rssi_min = None
+        self.rssi_last = None
+        self.phy_rate_last_mbps = None
+
+    @property
+    def active(self) -> bool:
+        return self.reports > 0
+
+    @staticmethod
+    def is_report(packet) -> bool:
+        if len(packet) < HEADER_LEN + LINK_EXT_LEN:
+            return False
+        magic, version = struct.unpack_from(">HB", packet, HEADER_LEN)
+        return magic == LINK_EXT_MAGIC and version == LINK_EXT_VERSION
+
+    def add_data(self, packet):
+        if not self.active or len(packet) < HEADER_LEN:
+            return
+        seq = struct.unpack_from(">I", packet)[0]
+        if seq in self._seen:
+            return
+        self._seen.add(seq)
+        self._order.append(seq)
+        if len(self._order) > LINK_WINDOW_PACKETS:
+            self._seen.discard(self._order.popleft())
+
+    def add_report(self, packet, stats: Stats):
+        _, _, ext_len, stream_id, _, period_ms = struct.unpack_from(LINK_EXT_FMT, packet, HEADER_LEN)
+        if ext_len < LINK_EXT_LEN or len(packet) < HEADER_LEN + ext_len + LINK_REPORT_LEN:
+            self.malformed += 1
+            return
+        uptime_ms, first, end, tx_packets, phy_rate_kbps, tx_errors, overruns, beacons, rssi, flags = struct.unpack_from(
+            LINK_REPORT_FMT, packet, HEADER_LEN + ext_len
+        )
+        sent = (end - first) & 0xFFFFFFFF
+        lost = None
+        if self.active and sent <= LINK_WINDOW_PACKETS:
+            lost = sum(1 for i in range(sent) if (first + i) & 0xFFFFFFFF not in self._seen)
+            self.lost += lost
+        self.reports += 1
+        self.tx_errors += tx_errors
+        self.tx_overruns += overruns
+        self.beacons_missed += beacons
+        connected = bool(flags & LINK_CONNECTED)
+        if connected:
+            self.rssi_min = rssi if self.rssi_min is None else min(self.rssi_min, rssi)
+            self.rssi_last = rssi
+            self.phy_rate_last_mbps = phy_rate_kbps / 1000.0
+
+        log = LOGGER.warning if lost or tx_errors or overruns or beacons or not connected else LOGGER.info
+        log(
+            "Link stream=%d uptime=%d ms period=%d ms seq=%s: %s rssi=%d dBm phy_rate=%.1f Mbps tx=%d tx_err=%d "
+            "overruns=%d beacon_miss=%d | received=%s lost=%s jitter=%.2f ms",
+            stream_id,
+            uptime_ms,
+            period_ms,
+            "%d-%d" % (first, (end - 1) & 0xFFFFFFFF) if sent else "none",
+            "connected" if connected else "disconnected",
+            rssi,
+            phy_rate_kbps / 1000.0,
+            tx_packets,
+            tx_errors,
+            overruns,
+            beacons,
+            "-" if lost is None else sent - lost,
+            "-" if lost is None else lost,
+            stats.jitter_s * 1000.0,
+        )
+
+    def summary(self) -> dict:
+        return {
+            "link_reports": self.reports,
+            "link_rx_lost": self.lost,
+            "link_tx_errors": self.tx_errors,
+            "link_tx_overruns": self.tx_overruns,
+            "link_beacons_missed": self.beacons_missed,
+            "link_rssi_min": self.rssi_min,
+            "link_rssi_last": self.rssi_last,
+            "link_phy_rate_mbps": self.phy_rate_last_mbps,
+        }
+
+
+@functools.lru_cache(maxsize=None)
+def adpcm_tables():
+    """Predictor delta and next step index for every (step index, code) pair."""
+    steps = np.array(ADPCM_STEPS, dtype=np.int32)[:, None]
+    codes = np.arange(16)[None, :]
+    delta = (
+        (steps >> 3)
+        + np.where(codes & 4, steps, 0)
+        + np.where(codes & 2, steps >> 1, 0)
+        + np.where(codes & 1, steps >> 2, 0)
+    )
+    delta = np.where(codes & 8, -delta, delta)
+    next_index = np.clip(np.arange(len(ADPCM_STEPS))[:, None] + np.array(ADPCM_INDEX_ADJUST), 0, len(ADPCM_STEPS) - 1)
+    return delta, next_index.tolist()
+
+
+def decode_ima_adpcm(body: memoryview, frames: int, channels: int):
+    """Decode one IMA-ADPCM block into a (frames, channels) int16 array.
+
+    Only the step index recursion is serial, and it is a pure table walk over
+    the codes. Predictor deltas are then gathered for all samples at once and
+    integrated with a cumulative sum; the exact clamping recursion is only
+    replayed for a channel whose sum leaves the 16-bit range.
+    """
+    count = frames * channels
+    hdr_len = channels * ADPCM_CHANNEL_HDR_LEN
+    if len(body) < hdr_len + (count + 1) // 2:
+        raise ValueError("truncated ADPCM block")
+
+    hdr = np.frombuffer(body, dtype=[("predictor", "<i2"), ("index", "u1"), ("reserved", "u1")], count=channels)
+    if np.any(hdr["index"] >= len(ADPCM_STEPS)):
+        raise ValueError("ADPCM step index out of range")
+
+    packed = np.frombuffer(body, dtype=np.uint8, count=(count + 1) // 2, offset=hdr_len)
+    codes = np.empty(packed.size * 2, dtype=np.uint8)
+    codes[0::2] = packed & 0x0F
+    codes[1::2] = packed >> 4
+    codes = codes[:count].reshape(frames, channels)
+
+    delta, next_index = adpcm_tables()
+    index = np.empty((frames, channels), dtype=np.intp)
+    for ch in range(channels):
+        cur = int(hdr["index"][ch])
+        walk = []
+        for code in codes[:, ch].tolist():
+            walk.append(cur)
+            cur = next_index[cur][code]
+        index[:, ch] = walk
+
+    samples = hdr["predictor"].astype(np.int64) + np.cumsum(delta[index, codes], axis=0)
+    for ch in np.flatnonzero((samples.min(axis=0) < -32768) | (samples.max(axis=0) > 32767)):
+        pred = int(hdr["predictor"][ch])
+        for f, step_delta in enumerate(delta[index[:, ch], codes[:, ch]].tolist()):
+            pred = min(max(pred + step_delta, -32768), 32767)
+            samples[f, ch] = pred
+
+    return samples.astype(np.int16)
+
+
+def decode_rice(body: memoryview, frames: int, channels: int, k: int):
+    """Decode one delta+Rice block into a (frames, channels) int16 array.
+
+    Remainders are fixed width and the unary quotients end at each zero bit,
+    so both sections unpack without walking the codes one by one.
+    """
+    count = (frames - 1) * channels
+    first_len = channels * 2
+    rem_len = (count * k + 7) // 8
+    if k > 17 or len(body) < first_len + rem_len:
+        raise ValueError("truncated Rice block")
+
+    first = np.frombuffer(body, dtype="<i2", count=channels)
+    if k:
+        rem_bits = np.unpackbits(np.frombuffer(body, dtype=np.uint8, count=rem_len, offset=first_len))
+        weights = np.left_shift(1, np.arange(k - 1, -1, -1, dtype=np.int64))
+        rem = rem_bits[: count * k].reshape(count, k).astype(np.int64) @ weights
+    else:
+        rem = np.zeros(count, dtype=np.int64)
+
+    unary = np.unpackbits(np.frombuffer(body, dtype=np.uint8, offset=first_len + rem_len))
+    ends = np.flatnonzero(unary == 0)[:count]
+    if ends.size < count:
+        raise ValueError("truncated Rice block")
+    quotient = np.diff(ends, prepend=-1) - 1
+
+    zigzag = (quotient.astype(np.int64) << k) | rem
+    deltas = (zigzag >> 1) ^ -(zigzag & 1)
+
+    samples = np.empty((frames, channels), dtype=np.int64)
+    samples[0] = first
+    samples[1:] = deltas.reshape(frames - 1, channels)
+    samples = np.cumsum(samples, axis=0)
+    if samples.size and (samples.min() < -32768 or samples.max() > 32767):
+        raise ValueError("Rice block decodes out of range")
+
+    return samples.astype(np.int16)
+
+
+def decode_ima_adpcm_py(body: memoryview, frames: int, channels: int) -> list[int]:
+    """Decode one IMA-ADPCM block into interleaved samples without numpy."""
+    count = frames * channels
+    hdr_len = channels * ADPCM_CHANNEL_HDR_LEN
+    if len(body) < hdr_len + (count + 1) // 2:
+        raise ValueError("truncated ADPCM block")
+
+    pred = [struct.unpack_from("<h", body, ch * ADPCM_CHANNEL_HDR_LEN)[0] for ch in range(channels)]
+    index = [body[ch * ADPCM_CHANNEL_HDR_LEN + 2] for ch in range(channels)]
+    if any(i >= len(ADPCM_STEPS) for i in index):
+        raise ValueError("ADPCM step index out of range")
+
+    samples = []
+    for i in range(count):
+        ch = i % channels
+        code = (body[hdr_len + i // 2] >> 4) if i & 1 else (body[hdr_len + i // 2] & 0x0F)
+        step = ADPCM_STEPS[index[ch]]
+        delta = (step >> 3) + (code & 4 and step) + (code & 2 and step >> 1) + (code & 1 and step >> 2)
+        pred[ch] = min(max(pred[ch] + (-delta if code & 8 else delta), -32768), 32767)
+        index[ch] = min(max(index[ch] + ADPCM_INDEX_ADJUST[code], 0), len(ADPCM_STEPS) - 1)
+        samples.append(pred[ch])
+    return samples
+
+
+def decode_rice_py(body: memoryview, frames: int, channels: int, k: int) -> list[int]:
+    """Decode one delta+Rice block into interleaved samples without numpy."""
+    count = (frames - 1) * channels
+    first_len = channels * 2
+    rem_len = (count * k + 7) // 8
+    if k > 17 or len(body) < first_len + rem_len:
+        raise ValueError("truncated Rice block")
+
+    samples = list(struct.unpack_from(f"<{channels}h", body))
+    rem = int.from_bytes(body[first_len : first_len + rem_len], "big")
+    rem_bits = rem_len * 8
+    unary = "".join(f"{byte:08b}" for byte in body[first_len + rem_len :])
+    pos = 0
+    for i in range(count):
+        end = unary.find("0", pos)
+        if end < 0:
+            raise ValueError("truncated Rice block")
+        zigzag = ((end - pos) << k) | ((rem >> (rem_bits - (i + 1) * k)) & ((1 << k) - 1))
+        pos = end + 1
+        sample = samples[i] + ((zigzag >> 1) ^ -(zigzag & 1))
+        if not -32768 <= sample <= 32767:
+            raise ValueError("Rice block decodes out of range")
+        samples.append(sample)
+    return samples
+
+
+def decode_payload(codec: int, payload: bytes, fmt: StreamFormat) -> bytes:
+    """Return the PCM carried by a payload, decoding it when compressed."""
+    if codec == CODEC_PCM:
+        return payload
+
+    frames, param, _ = struct.unpack_from(CODEC_BLOCK_HDR_FMT, payload)
+    if frames == 0:
+        raise ValueError("empty codec block")
+    body = memoryview(payload)[CODEC_BLOCK_HDR_LEN:]
+
+    if np is None:
+        if codec == CODEC_IMA_ADPCM:
+            pcm = array.array("h", decode_ima_adpcm_py(body, frames, fmt.channels))
+        else:
+            pcm = array.array("h", decode_rice_py(body, frames, fmt.channels, param))
+        if sys.byteorder == "big":
+            pcm.byteswap()
+        return pcm.tobytes()
+
+    if codec == CODEC_IMA_ADPCM:
+        pcm = decode_ima_adpcm(body, frames, fmt.channels)
+    else:
+        pcm = decode_rice(body, frames, fmt.channels, param)
+
+    return pcm.astype("<i2", copy=False).tobytes()
+
+
+class Stats:
+    def __init__(self, sample_rate: int):
+        self.sample_rate = sample_rate
         self.start_time = time.monotonic()
         self.last_report = self.start_time
         self.total_received = 0
         self.received_since_last_report = 0
         self.lost_packets = 0
+        self.reordered_packets = 0
+        self.recovered_packets = 0
         self.last_seq = None
         self.total_bytes = 0
+        self.total_pcm_bytes = 0
+        self.decode_s = 0.0
+        self.decoded_packets = 0
         self.intervals = collections.deque(maxlen=1000)
+        self.jitter_s = 0.0
+        self._prev_arrival = None
+        self._prev_counter = 0
+        self.first_arrival = None
 
-    def update(self, seq: int, payload_len: int):
+    def update(
+        self, seq: int, payload_len: int, pcm_len: int, decode_s: float, sample_counter: int, recovered: bool = False
+    ):
+        """Count a packet; rebuilt packets fill their gap without feeding the arrival jitter."""
         now = time.monotonic()
+        if recovered:
+            self.recovered_packets += 1
+        elif self._prev_arrival is not None:
+            # RFC 3550 interarrival jitter against the media clock of the sample counter
+            frames = ((sample_counter - self._prev_counter + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+            delta = abs((now - self._prev_arrival) - frames / self.sample_rate)
+            if delta < JITTER_RESYNC_S:  # larger steps are stream restarts
+                self.jitter_s += (delta - self.jitter_s) * JITTER_GAIN
+        else:
+            self.first_arrival = now
+        if not recovered:
+            self._prev_arrival = now
+            self._prev_counter = sample_counter
         if self.last_seq is not None:
             expected = (self.last_seq + 1) & 0xFFFFFFFF
-            if seq != expected:
-                gap = (seq - expected) & 0xFFFFFFFF
+            gap = (seq - expected) & 0xFFFFFFFF
+            if gap >= 0x80000000:
+                # Behind the newest sequence: a reordered or rebuilt packet already counted as lost
+                if not recovered:
+                    self.reordered_packets += 1
+                self.lost_packets = max(self.lost_packets - 1, 0)
+                seq = self.last_seq
+            elif gap:
                 self.lost_packets += gap
                 LOGGER.warning("Sequence gap: expected %d got %d (lost %d)", expected, seq, gap)
             self.intervals.append(now)
@@ -65,26 +635,55 @@ class Stats:
         self.total_received += 1
         self.received_since_last_report += 1
         self.total_bytes += payload_len
+        self.total_pcm_bytes += pcm_len
+        if decode_s:
+            self.decode_s += decode_s
+            self.decoded_packets += 1
 
     def report_needed(self, period_s: float) -> bool:
         return time.monotonic() - self.last_report >= period_s
 
+    def summary(self) -> dict:
+        """Totals since start, as reported at the end of a run."""
+        elapsed = time.monotonic() - self.start_time
+        expected = self.total_received + self.lost_packets
+        active = self._prev_arrival - self.first_arrival if self.first_arrival is not None else 0.0
+        return {
+            "elapsed_s": round(elapsed, 3),
+            "active_s": round(active, 3),
+            "payload_bytes": self.total_bytes,
+            "throughput_kbps": (self.total_bytes * 8 / active) / 1000 if active > 0 else 0.0,
+            "received": self.total_received,
+            "lost": self.lost_packets,
+            "reordered": self.reordered_packets,
+            "recovered": self.recovered_packets,
+            "loss_pct": 100.0 * self.lost_packets / expected if expected else 0.0,
+            "bitrate_kbps": (self.total_bytes * 8 / elapsed) / 1000 if elapsed > 0 else 0.0,
+            "payload_pct": 100.0 * self.total_bytes / self.total_pcm_bytes if self.total_pcm_bytes else 0.0,
+            "decode_us": 1e6 * self.decode_s / self.decoded_packets if self.decoded_packets else 0.0,
+            "packet_rate": self.total_received / elapsed if elapsed > 0 else 0.0,
+            "jitter_ms": self.jitter_s * 1000.0,
+        }
+
     def report(self, jitter_buffer_samples: int, sample_rate: int):
-        now = time.monotonic()
-        elapsed = now - self.start_time
-        bitrate_kbps = (self.total_bytes * 8 / elapsed) / 1000 if elapsed > 0 else 0.0
-        packet_rate = self.total_received / elapsed if elapsed > 0 else 0.0
+        totals = self.summary()
         LOGGER.info(
-            "Stats: received=%d total_received=%d lost=%d bitrate=%.1f kbps packet_rate=%.1f/s buffer=%.1f ms",
+            "Stats: received=%d total_received=%d lost=%d reordered=%d recovered=%d bitrate=%.1f kbps (%.1f%% of PCM) "
+            "decode=%.1f us/pkt packet_rate=%.1f/s jitter=%.2f ms buffer=%.1f ms",
             self.received_since_last_report,
             self.total_received,
             self.lost_packets,
-            bitrate_kbps,
-            packet_rate,
+            self.reordered_packets,
+            self.recovered_packets,
+            totals["bitrate_kbps"],
+            totals["payload_pct"],
+            totals["decode_us"],
+            totals["packet_rate"],
+            totals["jitter_ms"],
             jitter_buffer_samples / sample_rate * 1000.0,
         )
         self.received_since_last_report = 0  # Reset counter for next report period
-        self.last_report = now
+        self.last_report = time.monotonic()
 
 
 def discover_local_ips() -> list[str]:
@@ -112,17 +711,312 @@ def discover_local_ips() -> list[str]:
     return non_loopback or sorted_ips
 
 
+class _IoVec(ctypes.Structure):
+    _fields_ = [("iov_base", ctypes.c_void_p), ("iov_len", ctypes.c_size_t)]
+
+
+class _MsgHdr(ctypes.Structure):
+    _fields_ = [
+        ("msg_name", ctypes.c_void_p),
+        ("msg_namelen", ctypes.c_uint32),
+        ("msg_iov", ctypes.POINTER(_IoVec)),
+        ("msg_iovlen", ctypes.c_size_t),
+        ("msg_control", ctypes.c_void_p),
+        ("msg_controllen", ctypes.c_size_t),
+        ("msg_flags", ctypes.c_int),
+    ]
+
+
+class _MMsgHdr(ctypes.Structure):
+    _fields_ = [("msg_hdr", _MsgHdr), ("msg_len", ctypes.c_uint)]
+
+
+def _load_recvmmsg():
+    """Return libc's recvmmsg() through ctypes, or None where it is unavailable."""
+    if not sys.platform.startswith("linux"):
+        return None
+    try:
+        libc = ctypes.CDLL(None, use_errno=True)
+        recvmmsg = libc.recvmmsg
+    except (OSError, AttributeError):
+        return None
+    recvmmsg.restype = ctypes.c_int
+    recvmmsg.argtypes = [ctypes.c_int, ctypes.POINTER(_MMsgHdr), ctypes.c_uint, ctypes.c_int, ctypes.c_void_p]
+    return recvmmsg
+
+
+class BatchReceiver:
+    """Read datagrams in batches into one preallocated slab.
+
+    On Linux a single recvmmsg() call fills up to batch slots; elsewhere the
+    non-blocking socket is drained with recvfrom_into() until it would block.
+    datagram(i) returns a memoryview into the slab that stays valid until the next
+    receive(), so no buffer is allocated per packet.
+    """
+
+    def __init__(self, sock: socket.socket, batch: int, slot_bytes: int = MAX_PACKET_BYTES):
+        sock.setblocking(False)
+        self._sock = sock
+        self._batch = batch
+        self._slot_bytes = slot_bytes
+        self._slab = bytearray(batch * slot_bytes)
+        view = memoryview(self._slab)
+        self._slots = [view[i * slot_bytes : (i + 1) * slot_bytes] for i in range(batch)]
+        self._lengths = [0] * batch
+        self._sources = [None] * batch
+        self.truncated = 0
+        self._recvmmsg = _load_recvmmsg()
+        if self._recvmmsg is not None:
+            base = ctypes.addressof((ctypes.c_char * len(self._slab)).from_buffer(self._slab))
+            self._iov = (_IoVec * batch)()
+            self._msgs = (_MMsgHdr * batch)()
+            self._names = ctypes.create_string_buffer(SOCKADDR_LEN * batch)
+            names = ctypes.addressof(self._names)
+            for i in range(batch):
+                self._iov[i].iov_base = base + i * slot_bytes
+                self._iov[i].iov_len = slot_bytes
+                self._msgs[i].msg_hdr.msg_iov = ctypes.pointer(self._iov[i])
+                self._msgs[i].msg_hdr.msg_iovlen = 1
+                self._msgs[i].msg_hdr.msg_name = names + i * SOCKADDR_LEN
+                self._msgs[i].msg_hdr.msg_namelen = SOCKADDR_LEN
+
+    @property
+    def method(self) -> str:
+        return "recvmmsg" if self._recvmmsg is not None else "recvfrom_into"
+
+    def receive(self, timeout_s: float) -> int:
+        """Wait up to timeout_s for traffic and return the number of datagrams read."""
+        readable, _, _ = select.select([self._sock], [], [], timeout_s)
+        if not readable:
+            return 0
+        if self._recvmmsg is not None:
+            return self._receive_mmsg()
+        return self._receive_loop()
+
+    def _receive_mmsg(self) -> int:
+        count = self._recvmmsg(self._sock.fileno(), self._msgs, self._batch, socket.MSG_DONTWAIT, None)
+        if count < 0:
+            err = ctypes.get_errno()
+            if err in (errno.EAGAIN, errno.EWOULDBLOCK, errno.EINTR):
+                return 0
+            raise OSError(err, os.strerror(err))
+        for i in range(count):
+            msg = self._msgs[i]
+            if msg.msg_hdr.msg_flags & socket.MSG_TRUNC:
+                self.truncated += 1
+                self._lengths[i] = 0
+            else:
+                self._lengths[i] = msg.msg_len
+            msg.msg_hdr.msg_flags = 0
+            msg.msg_hdr.msg_namelen = SOCKADDR_LEN
+        return count
+
+    def _receive_loop(self) -> int:
+        count = 0
+        while count < self._batch:
+            try:
+                self._lengths[count], self._sources[count] = self._sock.recvfrom_into(self._slots[count])
+            except (BlockingIOError, InterruptedError):
+                break
+            count += 1
+        return count
+
+    def datagram(self, index: int) -> memoryview:
+        return self._slots[index][: self._lengths[index]]
+
+    def source(self, index: int):
+        """Return the (ip, port) a datagram came from."""
+        if self._recvmmsg is None:
+            return self._sources[index]
+        raw = self._names.raw[index * SOCKADDR_LEN : (index + 1) * SOCKADDR_LEN]
+        port = struct.unpack_from(">H", raw, 2)[0]
+        if struct.unpack_from("=H", raw)[0] == socket.AF_INET6:
+            return socket.inet_ntop(socket.AF_INET6, raw[8:24]), port
+        return socket.inet_ntoa(raw[4:8]), port
+
+
+def unmap_ipv4(ip: str) -> str:
+    """Return the IPv4 address behind an IPv4-mapped IPv6 source, else ip."""
+    return ip[7:] if ip.startswith("::ffff:") and "." in ip else ip
+
+
+def raw_tone_datagram(frame: bytes):
+    """Return (datagram, (transmitter, 0)) of a raw tone frame seen in monitor mode, else None.
+
+    The frame opens with a radiotap header, followed by an unprotected
+    802.11 data frame whose LLC/SNAP header carries the tone EtherType.
+    """
+    if len(frame) < 8 or frame[0] != 0:
+        return None
+    radiotap_len = struct.unpack_from("<H", frame, 2)[0]
+    present = struct.unpack_from("<I", frame, 4)[0]
+    fields = 8
+    word = present
+    while word & 0x80000000 and fields + 4 <= radiotap_len:
+        word = struct.unpack_from("<I", frame, fields)[0]
+        fields += 4
+    has_fcs = False
+    if present & 0x2:
+        # Flags follow the 8-byte aligned TSFT when that is present
+        offset = ((fields + 7) & ~7) + 8 if present & 0x1 else fields
+        if offset < radiotap_len:
+            has_fcs = bool(frame[offset] & RADIOTAP_FLAGS_FCS)
+
+    mpdu = memoryview(frame)[radiotap_len : len(frame) - 4 if has_fcs else len(frame)]
+    if len(mpdu) < 24:
+        return None
+    frame_control = struct.unpack_from("<H", mpdu)[0]
+    if (frame_control >> 2) & 0x3 != 2 or frame_control & 0x4000:
+        return None  # not data, or protected
+    header_len = 24
+    if frame_control & 0x0300 == 0x0300:
+        header_len += 6  # four-address frame
+    if (frame_control >> 4) & 0x8:
+        header_len += 2  # QoS control
+        if frame_control & 0x8000:
+            header_len += 4  # HT control
+    llc_end = header_len + len(RAW_TONE_LLC_SNAP)
+    if len(mpdu) < llc_end or mpdu[header_len:llc_end] != RAW_TONE_LLC_SNAP:
+        return None
+    transmitter = ":".join(f"{b:02x}" for b in mpdu[10:16])
+    return bytes(mpdu[llc_end:]), (transmitter, 0)
+
+
+def open_monitor_socket(interface: str) -> socket.socket:
+    """Capture every frame on a monitor-mode interface (Linux only)."""
+    sock = socket.socket(socket.AF_PACKET, socket.SOCK_RAW, socket.htons(ETH_P_ALL))
+    sock.bind((interface, 0))
+    return sock
+
+
+def open_socket(port: int, group: str | None, interface: str | None, ipv6: bool) -> socket.socket:
+    """Bind the stream port, joining group through IGMP or MLD when one is given.
+
+    The port is bound with address reuse on the wildcard address, so several
+    receivers on one host each get a copy of a multicast stream. An IPv6
+    socket also takes IPv4 traffic as IPv4-mapped addresses.
+    """
+    family = socket.AF_INET6 if ipv6 or (group is not None and ":" in group) else socket.AF_INET
+    sock = socket.socket(family, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if hasattr(socket, "SO_REUSEPORT"):
+        try:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        except OSError:
+            pass
+    if family == socket.AF_INET6:
+        try:
+            sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_V6ONLY, 0)
+        except (AttributeError, OSError):
+            pass
+        sock.bind(("::", port))
+    else:
+        sock.bind(("0.0.0.0", port))
+
+    if group is None:
+        return sock
+    if family == socket.AF_INET6:
+        if not interface:
+            ifindex = 0
+        elif interface.isdigit():
+            ifindex = int(interface)
+        else:
+            ifindex = socket.if_nametoindex(interface)
+        mreq = socket.inet_pton(socket.AF_INET6, group) + struct.pack("@I", ifindex)
+        sock.setsockopt(socket.IPPROTO_IPV6, socket.IPV6_JOIN_GROUP, mreq)
+        LOGGER.info("Joined IPv6 group %s through MLD on interface %s", group, interface or "default")
+    else:
+        mreq = socket.inet_aton(group) + socket.inet_aton(interface or "0.0.0.0")
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_ADD_MEMBERSHIP, mreq)
+        LOGGER.info("Joined IPv4 group %s through IGMP on %s", group, interface or "the default interface")
+    return sock
+
+
 def build_parser() -> argparse.ArgumentParser:
     parser = argparse.ArgumentParser(description="Receive and play UDP sine tone stream")
     parser.add_argument("--listen-port", type=int, default=50005, help="UDP port to bind")
+    parser.add_argument("--multicast", metavar="GROUP", help="Join this IPv4 (IGMP) or IPv6 (MLD) multicast group")
+    parser.add_argument(
+        "--multicast-if",
+        metavar="IF",
+        help="Interface for --multicast: local IPv4 address for IPv4 groups, name or index for IPv6 groups",
+    )
+    parser.add_argument("--ipv6", action="store_true", help="Listen on IPv6 as well as IPv4 for unicast streams")
+    parser.add_argument(
+        "--monitor",
+        metavar="IFACE",
+        help="Capture raw 802.11 tone frames (tone config transport=raw) on this Linux monitor-mode interface",
+    )
     parser.add_argument("--sample-rate", type=int, default=DEFAULT_SAMPLE_RATE, help="Expected sample rate")
-    parser.add_argument("--channels", type=int, default=DEFAULT_CHANNELS, help="Channel count (mono=1)")
-    parser.add_argument("--jitter-buffer-ms", type=float, default=60.0, help="Jitter buffer depth in ms")
+    parser.add_argument(
+        "--channels",
+        type=int,
+        default=DEFAULT_CHANNELS,
+        help="Channel count for packets without a format header extension (mono=1)",
+    )
+    parser.add_argument(
+        "--jitter-buffer-ms",
+        type=float,
+        default=60.0,
+        help="Jitter buffer depth in ms (initial playout delay with --adaptive-jitter)",
+    )
+    parser.add_argument(
+        "--adaptive-jitter",
+        action="store_true",
+        help="Reorder packets by sample counter, conceal losses and adapt the playout delay to measured jitter",
+    )
+    parser.add_argument("--jitter-min-ms", type=float, default=2.0, help="Lower playout delay bound for --adaptive-jitter")
+    parser.add_argument("--jitter-max-ms", type=float, default=500.0, help="Upper playout delay bound for --adaptive-jitter")
     parser.add_argument("--device", type=int, help="Sound device index for playback")
     parser.add_argument("--log-level", default="INFO", help="Logging level")
     parser.add_argument("--log-file", type=Path, help="Optional log file path")
     parser.add_argument("--save-wav", type=Path, help="Optional WAV output path")
     parser.add_argument("--no-audio", action="store_true", help="Disable audio playback (stats only)")
+    parser.add_argument(
+        "--clock-playout",
+        action="store_true",
+        help="Without audio output, drain the --adaptive-jitter or --high-rate buffer on the host clock",
+    )
+    parser.add_argument("--duration", type=float, default=0.0, help="Stop after this many seconds (0 runs until stopped)")
+    parser.add_argument("--summary-json", type=Path, help="Write run totals to this JSON file on exit")
+    parser.add_argument(
+        "--high-rate",
+        action="store_true",
+        help="Batch-receive datagrams into a preallocated ring buffer for short packets (requires numpy)",
+    )
+    parser.add_argument(
+        "--batch",
+        type=int,
+        default=DEFAULT_BATCH,
+        help="Datagrams read per system call in --high-rate mode",
+    )
+    parser.add_argument(
+        "--timesync",
+        action="store_true",
+        help="Probe the device time-sync port to estimate clock offset and report one-way latency",
+    )
+    parser.add_argument("--timesync-port", type=int, default=TIMESYNC_DEFAULT_PORT, help="Device time-sync UDP port")
+    parser.add_argument("--timesync-interval-ms", type=float, default=250.0, help="Time-sync probe interval")
+    parser.add_argument(
+        "--device-ip",
+        help="Device IPv4 address for --timesync (default: source of the first packet when it is IPv4)",
+    )
+    parser.add_argument(
+        "--analyze",
+        action="store_true",
+        help="FFT the received audio and report THD+N and tone levels (requires numpy)",
+    )
+    parser.add_argument("--fft-size", type=int, default=16384, help="Frames per --analyze block, a power of two")
+    parser.add_argument("--analyze-channel", type=int, default=0, help="Channel --analyze looks at")
+    parser.add_argument(
+        "--tones",
+        type=parse_tone_list,
+        default=[],
+        metavar="HZ[:PCT],...",
+        help="Tones --analyze measures, with their expected amplitude in %% of full scale for the loss "
+        "(default: the strongest component)",
+    )
+    parser.add_argument("--spectrum-csv", type=Path, help="Write the averaged --analyze spectrum here on exit")
     return parser
 
 
@@ -131,10 +1025,12 @@ class PlaybackStats:
         self._lock = threading.Lock()
         self._underflows = 0
         self._max_depth = 0
+        self.total_underflows = 0
 
     def record_underflow(self):
         with self._lock:
             self._underflows += 1
+            self.total_underflows += 1
 
     def observe_depth(self, depth: int):
         with self._lock:
@@ -158,12 +1054,12 @@ def audio_thread(
     stop_event: threading.Event,
     bytes_per_frame: int,
     playback_stats: PlaybackStats,
+    dtype: str = "int16",
 ):
     if sd is None:
         LOGGER.error("sounddevice module not available; cannot play audio")
         return
 
-    dtype = "int16"
     blocksize = 0  # let sounddevice decide
     pending = bytearray()
 
@@ -196,6 +1092,661 @@ def audio_thread(
     LOGGER.info("Audio playback stopped")
 
 
+class PcmRing:
+    """Single-producer, single-consumer ring of interleaved PCM bytes.
+
+    The receive loop writes payloads with at most two slice copies and the
+    audio callback copies straight into the device buffer, so steady-state
+    playback allocates no buffers. The write and read counters only grow and
+    each is advanced by one side only, which keeps the ring lock-free.
+    """
+
+    def __init__(self, capacity_bytes: int):
+        self._size = capacity_bytes
+        self._buf = np.zeros(capacity_bytes, dtype=np.uint8)
+        self._written = 0
+        self._read = 0
+        self.overflows = 0
+        self.underflows = 0
+        self.max_depth = 0
+
+    @property
+    def capacity(self) -> int:
+        return self._size
+
+    def depth(self) -> int:
+        return self._written - self._read
+
+    def write(self, data) -> bool:
+        """Append data, or drop it whole and count an overflow when it does not fit."""
+        src = np.frombuffer(data, dtype=np.uint8)
+        length = len(src)
+        if length > self._size - self.depth():
+            self.overflows += 1
+            return False
+        start = self._written % self._size
+        first = min(length, self._size - start)
+        self._buf[start : start + first] = src[:first]
+        self._buf[: length - first] = src[first:]
+        self._written += length
+        return True
+
+    def fill_silence(self, length: int):
+        length = min(length, self._size - self.depth())
+        start = self._written % self._size
+        first = min(length, self._size - start)
+        self._buf[start : start + first] = 0
+        self._buf[: length - first] = 0
+        self._written += length
+
+    def read_into(self, out):
+        """Fill the writable buffer out, padding with silence on underflow."""
+        dst = np.frombuffer(out, dtype=np.uint8)
+        wanted = len(dst)
+        depth = self.depth()
+        if depth > self.max_depth:
+            self.max_depth = depth
+        length = min(wanted, depth)
+        start = self._read % self._size
+        first = min(length, self._size - start)
+        dst[:first] = self._buf[start : start + first]
+        dst[first:length] = self._buf[: length - first]
+        if length < wanted:
+            dst[length:] = 0
+            self.underflows += 1
+        self._read += length
+
+    def snapshot(self):
+        """Return overflows, underflows and the peak depth, resetting the peak."""
+        max_depth, self.max_depth = self.max_depth, 0
+        return self.overflows, self.underflows, max_depth
+
+
+def ring_audio_thread(
+    ring: PcmRing,
+    sample_rate: int,
+    channels: int,
+    device: int | None,
+    stop_event: threading.Event,
+    dtype: str = "int16",
+):
+    if sd is None:
+        LOGGER.error("sounddevice module not available; cannot play audio")
+        return
+
+    def callback(outdata, frames, time_info, status):  # pragma: no cover - realtime callback
+        ring.read_into(outdata)
+
+    with sd.RawOutputStream(
+        samplerate=sample_rate,
+        blocksize=0,
+        device=device,
+        channels=channels,
+        dtype=dtype,
+        callback=callback,
+    ):
+        LOGGER.info("Audio playback started (ring of %d bytes)", ring.capacity)
+        while not stop_event.is_set():
+            time.sleep(0.1)
+    LOGGER.info("Audio playback stopped")
+
+
+class JitterBuffer:
+    """Reordering playout buffer keyed on the packet sample counter.
+
+    Packets are stored by the position of their first frame and played out
+    at a cursor that advances with the audio device. Gaps are concealed by
+    repeating up to one packet of the last audio, then silence; packets that
+    arrive after their frames were played count as late. The target playout
+    delay is one packet plus JITTER_DEVIATIONS times the RFC 3550 interarrival
+    jitter estimate, plus a margin that grows on late packets and decays
+    after a clean window. Every JITTER_WINDOW_PACKETS arrivals half the
+    distance between the smallest observed headroom and the target is
+    corrected by skipping or holding frames. A jump of the counter by more than JITTER_RESYNC_S restarts
+    playout, as happens when the stream is restarted.
+    """
+
+    def __init__(self, sample_rate: int, bytes_per_frame: int, initial_ms: float, min_ms: float, max_ms: float):
+        self._lock = threading.Lock()
+        self._rate = sample_rate
+        self._bpf = bytes_per_frame
+        self._min_frames = int(sample_rate * min_ms / 1000.0)
+        self._max_frames = int(sample_rate * max_ms / 1000.0)
+        self._target = min(max(int(sample_rate * initial_ms / 1000.0), self._min_frames), self._max_frames)
+        self._starts: list[int] = []
+        self._chunks: dict[int, bytes] = {}
+        self._cursor = None
+        self._last_counter = 0
+        self._last_ext = 0
+        self._highest_end = 0
+        self._packet_frames = 0
+        self._prev_transit = None
+        self._jitter_s = 0.0
+        self._margin = 0
+        self._window_count = 0
+        self._window_min = None
+        self._window_late = False
+        self._adjust = 0
+        self._last_chunk = b""
+        self._conceal_pos = 0
+        self.late = 0
+        self.duplicates = 0
+        self.resyncs = 0
+        self.concealed_frames = 0
+        self.skipped_frames = 0
+        self.held_frames = 0
+
+    def _extend(self, counter: int) -> int:
+        """Unwrap the 32-bit sample counter around the previous packet."""
+        delta = ((counter - self._last_counter + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+        self._last_counter = counter
+        return self._last_ext + delta
+
+    def _reset(self, start: int):
+        self._starts.clear()
+        self._chunks.clear()
+        self._cursor = start - self._target
+        self._highest_end = start
+        self._prev_transit = None
+        self._window_count = 0
+        self._window_min = None
+        self._adjust = 0
+        self._last_chunk = b""
+
+    def insert(self, sample_counter: int, pcm):
+        """Queue a packet; return seconds until its first frame plays, or None if dropped."""
+        arrival = time.monotonic()
+        frames = len(pcm) // self._bpf
+        with self._lock:
+            if self._cursor is None:
+                self._last_counter = sample_counter
+                self._last_ext = sample_counter
+                self._reset(sample_counter)
+            start = self._extend(sample_counter)
+            self._last_ext = start
+            if start + frames < self._cursor - self._max_frames or start > self._cursor + JITTER_RESYNC_S * self._rate:
+                self.resyncs += 1
+                self._reset(start)
+            end = start + frames
+
+            if end <= self._cursor:
+                self.late += 1
+                self._window_late = True
+                self._margin = min(self._margin + max(frames, 1), self._max_frames)
+                return None
+            if start in self._chunks:
+                self.duplicates += 1
+                return None
+            if len(self._starts) >= JITTER_MAX_CHUNKS:
+                return None
+
+            bisect.insort(self._starts, start)
+            self._chunks[start] = bytes(pcm)
+            self._packet_frames = frames
+            self._highest_end = max(self._highest_end, end)
+
+            transit = arrival - start / self._rate
+            if self._prev_transit is not None:
+                self._jitter_s += (abs(transit - self._prev_transit) - self._jitter_s) * JITTER_GAIN
+            self._prev_transit = transit
+            self._update_target(end - self._cursor)
+            return max(start - self._cursor, 0) / self._rate
+
+    def _update_target(self, headroom: int):
+        if self._window_min is None or headroom < self._window_min:
+            self._window_min = headroom
+        self._window_count += 1
+        if self._window_count < JITTER_WINDOW_PACKETS:
+            return
+
+        if not self._window_late:
+            self._margin //= 2
+        wanted = self._packet_frames + int(JITTER_DEVIATIONS * self._jitter_s * self._rate) + self._margin
+        self._target = min(max(wanted, self._min_frames), self._max_frames)
+        # Headroom just after arrival is the delay this window actually needed
+        self._adjust = (self._window_min - self._target) // 2
+        if -(self._packet_frames // 2) <= self._adjust <= self._packet_frames:
+            self._adjust = 0
+        self._window_count = 0
+        self._window_min = None
+        self._window_late = False
+
+    def _conceal(self, dst: memoryview, offset: int, length: int):
+        repeat = self._last_chunk
+        limit = len(repeat)
+        while length:
+            if self._conceal_pos >= limit:
+                dst[offset : offset + length] = bytes(length)
+                return
+            step = min(length, limit - self._conceal_pos)
+            dst[offset : offset + step] = repeat[self._conceal_pos : self._conceal_pos + step]
+            self._conceal_pos += step
+            offset += step
+            length -= step
+
+    def read_into(self, out):
+        """Fill out with the frames at the playout cursor and advance it."""
+        dst = memoryview(out).cast("B")
+        wanted = len(dst) // self._bpf
+        offset = 0
+        with self._lock:
+            if self._cursor is None:
+                dst[:] = bytes(len(dst))
+                return
+
+            if self._adjust > 0:
+                self._cursor += self._adjust
+                self.skipped_frames += self._adjust
+                self._adjust = 0
+            elif self._adjust < 0:
+                hold = min(-self._adjust, wanted)
+                self._conceal(dst, 0, hold * self._bpf)
+                self.held_frames += hold
+                self._adjust += hold
+                offset = hold
+
+            while offset < wanted:
+                pos = self._cursor
+                idx = bisect.bisect_right(self._starts, pos) - 1
+                if idx >= 0:
+                    start = self._starts[idx]
+                    chunk = self._chunks[start]
+                    chunk_frames = len(chunk) // self._bpf
+                    if pos < start + chunk_frames:
+                        count = min(wanted - offset, start + chunk_frames - pos)
+                        src = (pos - start) * self._bpf
+                        dst[offset * self._bpf : (offset + count) * self._bpf] = chunk[
+                            src : src + count * self._bpf
+                        ]
+                        self._last_chunk = chunk
+                        self._conceal_pos = 0
+                        self._cursor += count
+                        offset += count
+                        continue
+                nxt = self._starts[idx + 1] if idx + 1 < len(self._starts) else None
+                count = wanted - offset if nxt is None else min(wanted - offset, nxt - pos)
+                self._conceal(dst, offset * self._bpf, count * self._bpf)
+                if self._last_chunk:
+                    self.concealed_frames += count
+                self._cursor += count
+                offset += count
+
+            while self._starts:
+                start = self._starts[0]
+                if start + len(self._chunks[start]) // self._bpf > self._cursor:
+                    break
+                del self._chunks[start]
+                self._starts.pop(0)
+
+    def snapshot(self):
+        """Return current delay, target and jitter (ms) plus the loss counters."""
+        with self._lock:
+            delay = 0 if self._cursor is None else max(self._highest_end - self._cursor, 0)
+            scale = 1000.0 / self._rate
+            return (
+                delay * scale,
+                self._target * scale,
+                self._jitter_s * 1000.0,
+                self.late,
+                self.concealed_frames * scale,
+                self.skipped_frames * scale,
+                self.held_frames * scale,
+                self.resyncs,
+            )
+
+
+def host_us() -> int:
+    """Receiver clock for packet arrivals and time-sync probes."""
+    return time.monotonic_ns() // 1000
+
+
+class TimeSync:
+    """Estimate the device clock from NTP-style probes to its time-sync port.
+
+    Each exchange yields an offset ((t2 - t1) + (t3 - t4)) / 2 and a round
+    trip (t4 - t1) - (t3 - t2). Queueing only ever adds delay, so a least
+    squares line through the lowest-delay exchanges of the recent window
+    gives offset and drift; half the best round trip bounds its error.
+    """
+
+    def __init__(self, device: tuple[str, int], interval_s: float):
+        self._device = device
+        self._interval_s = interval_s
+        self._lock = threading.Lock()
+        self._samples = collections.deque(maxlen=TIMESYNC_WINDOW)
+        self._fit = None
+        self._seq = 0
+        self.sent = 0
+        self.answered = 0
+        self._sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self._sock.settimeout(interval_s)
+
+    def run(self, stop_event: threading.Event):
+        LOGGER.info("Time sync probing %s:%d every %.0f ms", *self._device, self._interval_s * 1000.0)
+        next_probe = 0.0
+        while not stop_event.is_set():
+            now = time.monotonic()
+            if now >= next_probe:
+                self._seq = (self._seq + 1) & 0xFFFFFFFF
+                probe = struct.pack(TIMESYNC_FMT, TIMESYNC_MAGIC, TIMESYNC_VERSION, TIMESYNC_REQUEST, self._seq, host_us(), 0, 0)
+                try:
+                    self._sock.sendto(probe, self._device)
+                    self.sent += 1
+                except OSError as exc:
+                    LOGGER.debug("Time-sync probe failed: %s", exc)
+                next_probe = now + self._interval_s
+            try:
+                reply = self._sock.recv(TIMESYNC_LEN + 1)
+            except socket.timeout:
+                continue
+            except OSError:
+                time.sleep(self._interval_s)
+                continue
+            t4 = host_us()
+            if len(reply) != TIMESYNC_LEN:
+                continue
+            magic, version, kind, _, t1, t2, t3 = struct.unpack(TIMESYNC_FMT, reply)
+            if magic != TIMESYNC_MAGIC or version != TIMESYNC_VERSION or kind != TIMESYNC_RESPONSE:
+                continue
+            self.answered += 1
+            self._add((t1 + t4) / 2, ((t2 - t1) + (t3 - t4)) / 2, (t4 - t1) - (t3 - t2))
+        self._sock.close()
+
+    def _add(self, host_mid: float, offset: float, delay: float):
+        with self._lock:
+            self._samples.append((host_mid, offset, delay))
+            best = sorted(self._samples, key=lambda sample: sample[2])[:TIMESYNC_BEST]
+            ref = best[0][0]
+            mean_t = sum(t - ref for t, _, _ in best) / len(best)
+            mean_o = sum(o for _, o, _ in best) / len(best)
+            var_t = sum((t - ref - mean_t) ** 2 for t, _, _ in best)
+            drift = 0.0
+            if len(best) >= 2 and var_t > 0:
+                drift = sum((t - ref - mean_t) * (o - mean_o) for t, o, _ in best) / var_t
+            self._fit = (ref + mean_t, mean_o, drift, best[0][2])
+
+    def estimate(self):
+        """Return (offset us at now, drift ppm, best round trip us), or None before the first reply."""
+        with self._lock:
+            if self._fit is None:
+                return None
+            t0, offset, drift, rtt = self._fit
+        return offset + drift * (host_us() - t0), drift * 1e6, rtt
+
+    def latency_us(self, device_ts32: int, arrival_us: int):
+        """One-way latency of a packet stamped with the 32-bit device timestamp."""
+        with self._lock:
+            if self._fit is None:
+                return None
+            t0, offset, drift, _ = self._fit
+        device_arrival = arrival_us + offset + drift * (arrival_us - t0)
+        # Unwrap the stamp to the device time nearest the estimated arrival
+        return -((((device_ts32 - int(device_arrival)) + 0x80000000) & 0xFFFFFFFF) - 0x80000000)
+
+
+def percentiles(samples: list[float]) -> list[float]:
+    ordered = sorted(samples)
+    last = len(ordered) - 1
+    return [ordered[min(last, round(p / 100 * last))] for p in LATENCY_PERCENTILES] + [ordered[-1]]
+
+
+class LatencyStats:
+    """Per stats period samples of network, buffer and end-to-end latency in ms."""
+
+    def __init__(self):
+        self.network: list[float] = []
+        self.buffer: list[float] = []
+        self.total: list[float] = []
+        self._run: dict[str, list[float]] = {"network": [], "buffer": [], "total": []}
+
+    def add(self, network_ms: float | None, buffer_ms: float | None):
+        if network_ms is not None:
+            self.network.append(network_ms)
+        if buffer_ms is not None:
+            self.buffer.append(buffer_ms)
+        if network_ms is not None and buffer_ms is not None:
+            self.total.append(network_ms + buffer_ms)
+
+    def report(self, timesync: TimeSync | None):
+        parts = []
+        if timesync is not None:
+            estimate = timesync.estimate()
+            if estimate is None:
+                parts.append(f"no time-sync replies ({timesync.sent} probes sent)")
+            else:
+                offset_us, drift_ppm, rtt_us = estimate
+                parts.append(f"offset={offset_us / 1000.0:+.3f} ms drift={drift_ppm:+.2f} ppm rtt={rtt_us / 1000.0:.2f} ms")
+        names = "/".join(f"p{p}" for p in LATENCY_PERCENTILES) + "/max"
+        for label, samples in (("network", self.network), ("buffer", self.buffer), ("total", self.total)):
+            if samples:
+                parts.append(f"{label} {names}=" + "/".join(f"{value:.2f}" for value in percentiles(samples)) + " ms")
+            self._run[label].extend(samples)
+            samples.clear()
+        if parts:
+            LOGGER.info("Latency: %s", " ".join(parts))
+
+    def summary(self) -> dict:
+        """Percentiles over every period reported so far, keyed like network_p50_ms."""
+        result = {}
+        names = [f"p{p}" for p in LATENCY_PERCENTILES] + ["max"]
+        for label, samples in self._run.items():
+            if samples:
+                for name, value in zip(names, percentiles(samples)):
+                    result[f"{label}_{name}_ms"] = value
+        return result
+
+
+def parse_tone_list(text: str) -> list[tuple[float, float | None]]:
+    """Parse --tones: <Hz>[:<pct>],... with pct the expected amplitude in percent of full scale."""
+    tones = []
+    for item in text.split(","):
+        freq, _, pct = item.partition(":")
+        try:
+            tones.append((float(freq), float(pct) if pct else None))
+        except ValueError:
+            raise argparse.ArgumentTypeError(f"tone {item!r} is not <Hz>[:<pct>]") from None
+        if tones[-1][0] <= 0 or (tones[-1][1] is not None and not 0 < tones[-1][1] <= 100):
+            raise argparse.ArgumentTypeError(f"tone {item!r} is out of range")
+    return tones
+
+
+def pcm_channel(pcm: bytes, fmt: StreamFormat, channel: int):
+    """One channel of interleaved PCM as floats, 1.0 being full scale."""
+    if fmt.bits == 24:
+        raw = np.frombuffer(pcm, dtype=np.uint8).reshape(-1, 3).astype(np.int32)
+        samples = raw[:, 0] | (raw[:, 1] << 8) | (raw[:, 2] << 16)
+        samples = (samples ^ 0x800000) - 0x800000
+    else:
+        samples = np.frombuffer(pcm, dtype="<i2" if fmt.bits == 16 else "<i4")
+    return samples.reshape(-1, fmt.channels)[:, channel] / float(1 << (fmt.bits - 1))
+
+
+class SpectrumAnalyzer:
+    """Power spectrum averaged over contiguous --fft-size blocks, with THD+N and per-tone levels.
+
+    A gap in the sample counter discards the block being filled, so lost
+    packets never splice discontinuities into the analysis.
+    """
+
+    # 4-term Blackman-Harris: -92 dB sidelobes, main lobe 4 bins either side
+    WINDOW = (0.35875, 0.48829, 0.14128, 0.01168)
+    LOBE_BINS = 5
+
+    def __init__(self, sample_rate: int, fft_size: int, channel: int, tones: list[tuple[float, float | None]]):
+        self.sample_rate = sample_rate
+        self.fft_size = fft_size
+        self.channel = channel
+        self.tones = tones
+        phase = 2 * np.pi * np.arange(fft_size) / fft_size
+        a0, a1, a2, a3 = self.WINDOW
+        self._window = a0 - a1 * np.cos(phase) + a2 * np.cos(2 * phase) - a3 * np.cos(3 * phase)
+        self._window_power = float(np.sum(self._window**2))
+        self._pending: list = []
+        self._pending_frames = 0
+        self._next_counter: int | None = None
+        self._power = np.zeros(fft_size // 2 + 1)
+        self.blocks = 0
+        self.discontinuities = 0
+
+    def add(self, sample_counter: int, pcm: bytes, fmt: StreamFormat):
+        if self.channel >= fmt.channels:
+            return
+        if self._next_counter is not None and sample_counter != self._next_counter:
+            self.discontinuities += 1
+            self._pending.clear()
+            self._pending_frames = 0
+        samples = pcm_channel(pcm, fmt, self.channel)
+        self._next_counter = (sample_counter + len(samples)) & 0xFFFFFFFF
+        self._pending.append(samples)
+        self._pending_frames += len(samples)
+        if self._pending_frames < self.fft_size:
+            return
+        pending = np.concatenate(self._pending)
+        blocks = len(pending) // self.fft_size
+        for block in pending[: blocks * self.fft_size].reshape(blocks, self.fft_size):
+            self._power += np.abs(np.fft.rfft(block * self._window)) ** 2
+        self.blocks += blocks
+        rest = pending[blocks * self.fft_size :]
+        self._pending = [rest]
+        self._pending_frames = len(rest)
+
+    def _amplitude(self, power) -> float:
+        """Peak amplitude of a sine holding this much one-sided spectral power."""
+        return float(np.sqrt(4.0 * power / (self.fft_size * self._window_power)))
+
+    def _lobe(self, power, freq_hz: float) -> tuple[int, int]:
+        """Bins around the strongest one within a main lobe of freq_hz."""
+        center = int(round(freq_hz * self.fft_size / self.sample_rate))
+        lo = max(center - self.LOBE_BINS, self.LOBE_BINS + 1)
+        hi = min(center + self.LOBE_BINS + 1, len(power))
+        if lo >= hi:
+            return lo, lo
+        peak = lo + int(np.argmax(power[lo:hi]))
+        return max(peak - self.LOBE_BINS, self.LOBE_BINS + 1), min(peak + self.LOBE_BINS + 1, len(power))
+
+    def spectrum(self):
+        """Bin frequencies and averaged levels in dBFS (0 dBFS being a full-scale sine)."""
+        power = self._power / max(self.blocks, 1)
+        freqs = np.arange(len(power)) * self.sample_rate / self.fft_size
+        levels = 20 * np.log10(np.maximum(np.sqrt(4.0 * power / (self.fft_size * self._window_power)), 1e-12))
+        return freqs, levels
+
+    def result(self) -> dict | None:
+        """THD+N against all tones and each tone's level; None before the first block."""
+        if not self.blocks:
+            return None
+        power = self._power / self.blocks
+        tones = self.tones
+        if not tones:
+            # The strongest component, excluding DC, is the fundamental
+            peak = self.LOBE_BINS + 1 + int(np.argmax(power[self.LOBE_BINS + 1 :]))
+            tones = [(peak * self.sample_rate / self.fft_size, None)]
+
+        residual = power.copy()
+        residual[: self.LOBE_BINS + 1] = 0.0
+        measured = []
+        tone_power = 0.0
+        for freq_hz, expected_pct in tones:
+            lo, hi = self._lobe(power, freq_hz)
+            lobe = float(np.sum(power[lo:hi]))
+            residual[lo:hi] = 0.0
+            tone_power += lobe
+            if lobe > 0:
+                peak_hz = float(np.sum(np.arange(lo, hi) * power[lo:hi]) / lobe) * self.sample_rate / self.fft_size
+            else:
+                peak_hz = freq_hz
+            level_db = 20 * np.log10(max(self._amplitude(lobe), 1e-12))
+            entry = {"freq_hz": round(peak_hz, 2), "level_dbfs": round(float(level_db), 2)}
+            if expected_pct is not None:
+                entry["loss_db"] = round(float(20 * np.log10(expected_pct / 100.0) - level_db), 2)
+            measured.append(entry)
+
+        noise = float(np.sum(residual))
+        ratio = np.sqrt(noise / tone_power) if tone_power > 0 else float("inf")
+        return {
+            "analysis_blocks": self.blocks,
+            "analysis_discontinuities": self.discontinuities,
+            "thdn_db": round(float(20 * np.log10(max(ratio, 1e-12))), 2),
+            "thdn_pct": round(float(ratio * 100.0), 5),
+            "analysis_tones": measured,
+        }
+
+    def report(self):
+        result = self.result()
+        if result is None:
+            LOGGER.info(
+                "Analysis: waiting for %d contiguous frames (%d discontinuities)", self.fft_size, self.discontinuities
+            )
+            return
+        LOGGER.info(
+            "Analysis blocks=%d THD+N=%.2f dB (%.4f%%) discontinuities=%d",
+            result["analysis_blocks"],
+            result["thdn_db"],
+            result["thdn_pct"],
+            result["analysis_discontinuities"],
+        )
+        for tone in result["analysis_tones"]:
+            loss = f" loss={tone['loss_db']:+.2f} dB" if "loss_db" in tone else ""
+            LOGGER.info("  Tone %.1f Hz level=%.2f dBFS%s", tone["freq_hz"], tone["level_dbfs"], loss)
+
+    def write_csv(self, path: Path):
+        freqs, levels = self.spectrum()
+        with path.open("w") as out:
+            out.write("freq_hz,level_dbfs\n")
+            for freq, level in zip(freqs, levels):
+                out.write(f"{freq:.2f},{level:.2f}\n")
+
+
+def clock_playout_thread(read_into, sample_rate: int, bytes_per_frame: int, stop_event: threading.Event):
+    """Drain a playout buffer on the host clock, standing in for an audio device.
+
+    Keeps underflow, late and concealment counts meaningful in stats-only runs.
+    """
+    frames = max(1, sample_rate * CLOCK_PLAYOUT_BLOCK_MS // 1000)
+    block = bytearray(frames * bytes_per_frame)
+    period_s = frames / sample_rate
+    deadline = time.monotonic()
+    LOGGER.info("Clocked playout started (%d frame blocks, no audio device)", frames)
+    while not stop_event.is_set():
+        read_into(block)
+        deadline += period_s
+        delay = deadline - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+        elif delay < -1.0:
+            deadline = time.monotonic()  # host stalled; do not burst to catch up
+    LOGGER.info("Clocked playout stopped")
+
+
+def jitter_audio_thread(
+    jitter: JitterBuffer,
+    sample_rate: int,
+    channels: int,
+    device: int | None,
+    stop_event: threading.Event,
+    dtype: str = "int16",
+):
+    if sd is None:
+        LOGGER.error("sounddevice module not available; cannot play audio")
+        return
+
+    def callback(outdata, frames, time_info, status):  # pragma: no cover - realtime callback
+        jitter.read_into(outdata)
+
+    with sd.RawOutputStream(
+        samplerate=sample_rate,
+        blocksize=0,
+        device=device,
+        channels=channels,
+        dtype=dtype,
+        callback=callback,
+    ):
+        LOGGER.info("Audio playback started (adaptive jitter buffer)")
+        while not stop_event.is_set():
+            time.sleep(0.1)
+    LOGGER.info("Audio playback stopped")
+
+
 def main() -> int:
     parser = build_parser()
     args = parser.parse_args()
@@ -222,151 +1773,442 @@ def main() -> int:
     if jitter_buffer_samples <= 0:
         LOGGER.error("Jitter buffer must result in at least one sample")
         return 1
+    if args.adaptive_jitter and not 0 < args.jitter_min_ms <= args.jitter_max_ms:
+        LOGGER.error("Jitter buffer bounds must satisfy 0 < --jitter-min-ms <= --jitter-max-ms")
+        return 1
+    if args.clock_playout and not (args.adaptive_jitter or args.high_rate):
+        LOGGER.error("--clock-playout needs --adaptive-jitter or --high-rate")
+        return 1
+    if args.duration < 0:
+        LOGGER.error("Duration must not be negative")
+        return 1
+    if args.multicast is not None:
+        try:
+            is_multicast = ipaddress.ip_address(args.multicast).is_multicast
+        except ValueError:
+            is_multicast = False
+        if not is_multicast:
+            LOGGER.error("--multicast needs an IPv4 or IPv6 multicast group, not %s", args.multicast)
+            return 1
 
-    bytes_per_frame = INT16_BYTES * args.channels
-    target_buffer_bytes = jitter_buffer_samples * bytes_per_frame
-    zero_chunk = b"\x00" * (bytes_per_frame * 256) if bytes_per_frame > 0 else b""
+    if args.monitor is not None and (args.high_rate or args.timesync or args.multicast is not None):
+        LOGGER.error("--monitor cannot be combined with --high-rate, --timesync or --multicast")
+        return 1
+    if (args.tones or args.spectrum_csv) and not args.analyze:
+        LOGGER.error("--tones and --spectrum-csv need --analyze")
+        return 1
+    if args.analyze:
+        if np is None:
+            LOGGER.error("numpy is required for --analyze")
+            return 1
+        if args.fft_size < 1024 or args.fft_size & (args.fft_size - 1):
+            LOGGER.error("--fft-size must be a power of two of at least 1024")
+            return 1
+        if args.analyze_channel < 0:
+            LOGGER.error("--analyze-channel must not be negative")
+            return 1
 
-    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
-    if hasattr(socket, "SO_REUSEPORT"):
-        try:
-            sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
-        except OSError:
-            pass
-    sock.bind(("0.0.0.0", args.listen_port))
+    try:
+        if args.monitor is not None:
+            sock = open_monitor_socket(args.monitor)
+        else:
+            sock = open_socket(args.listen_port, args.multicast, args.multicast_if, args.ipv6)
+    except (AttributeError, OSError) as exc:
+        LOGGER.error("Cannot open the receive socket: %s", exc)
+        return 1
     sock.settimeout(1.0)
 
-    bound_ip, bound_port = sock.getsockname()
-    LOGGER.info("Listening on %s:%d", bound_ip, bound_port)
+    if args.monitor is not None:
+        LOGGER.info("Capturing raw tone frames on %s", args.monitor)
+        LOGGER.info("nRF7002DK tone commands: tone config transport=raw, then tone start")
+    else:
+        bound_ip, bound_port = sock.getsockname()[:2]
+        LOGGER.info("Listening on %s:%d", bound_ip, bound_port)
 
-    if bound_ip == "0.0.0.0":
-        local_ips = discover_local_ips()
-        if local_ips:
-            endpoints = ", ".join(f"{ip}:{bound_port}" for ip in local_ips)
-            LOGGER.info("Reachable on local interfaces: %s", endpoints)
-            LOGGER.info("nRF7002DK tone start command: tone start %s %d", local_ips[0], bound_port)
+        if args.multicast is not None:
+            LOGGER.info("nRF7002DK tone start command: tone start %s %d", args.multicast, bound_port)
+        elif bound_ip in ("0.0.0.0", "::"):
+            local_ips = discover_local_ips()
+            if local_ips:
+                endpoints = ", ".join(f"{ip}:{bound_port}" for ip in local_ips)
+                LOGGER.info("Reachable on local interfaces: %s", endpoints)
+                LOGGER.info("nRF7002DK tone start command: tone start %s %d", local_ips[0], bound_port)
+            else:
+                LOGGER.info("Reachable on all interfaces; local IP discovery unavailable")
+                LOGGER.info("nRF7002DK tone start command: tone start <receiver_ip> %d", bound_port)
         else:
-            LOGGER.info("Reachable on all interfaces; local IP discovery unavailable")
-            LOGGER.info("nRF7002DK tone start command: tone start <receiver_ip> %d", bound_port)
-    else:
-        LOGGER.info("Reachable on %s:%d", bound_ip, bound_port)
-        LOGGER.info("nRF7002DK tone start command: tone start %s %d", bound_ip, bound_port)
+            LOGGER.info("Reachable on %s:%d", bound_ip, bound_port)
+            LOGGER.info("nRF7002DK tone start command: tone start %s %d", bound_ip, bound_port)
 
-    # Remind user about port configuration when using default
-    if args.listen_port == 50005:
-        LOGGER.info("Using default port 50005. To use a different port, specify --listen-port <port_number>")
+        # Remind user about port configuration when using default
+        if args.listen_port == 50005:
+            LOGGER.info("Using default port 50005. To use a different port, specify --listen-port <port_number>")
 
     LOGGER.info("Use Ctrl+Z to exit the receiver cleanly")
 
-    playback_queue: queue.Queue[bytes] | None
+    playback_queue: queue.Queue[bytes] | None = None
     playback_stats = None
+    ring: PcmRing | None = None
+    jitter: JitterBuffer | None = None
+    timesync: TimeSync | None = None
     stop_event = threading.Event()
     audio_thread_obj = None
-
+    timesync_thread = None
     wav_writer = None
-    if args.save_wav:
-        if wave is None:
-            LOGGER.error("wave module not available; cannot save WAV")
+    stream_format: StreamFormat | None = None
+    packet_shape = None
+    default_format = StreamFormat(args.channels, 16)
+
+    if args.save_wav and wave is None:
+        LOGGER.error("wave module not available; cannot save WAV")
+        return 1
+    if args.no_audio:
+        LOGGER.info("Audio playback disabled (--no-audio)")
+    elif sd is None:
+        LOGGER.warning("sounddevice not installed; running without audio output")
+
+    receiver = None
+    if args.high_rate:
+        if np is None:
+            LOGGER.error("numpy is required for --high-rate")
+            return 1
+        if args.batch <= 0:
+            LOGGER.error("Batch size must be positive")
             return 1
-        wav_writer = wave.open(str(args.save_wav), "wb")
-        wav_writer.setnchannels(args.channels)
-        wav_writer.setsampwidth(INT16_BYTES)
-        wav_writer.setframerate(args.sample_rate)
+        try:
+            sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, HIGH_RATE_RCVBUF_BYTES)
+        except OSError:
+            pass
+        receiver = BatchReceiver(sock, args.batch)
+        LOGGER.info(
+            "High-rate receive: %s, %d datagrams per call, socket buffer %d bytes",
+            receiver.method,
+            args.batch,
+            sock.getsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF),
+        )
+
+    def open_outputs(fmt: StreamFormat):
+        """Open WAV and playback once the first packet reveals the stream format."""
+        nonlocal playback_queue, playback_stats, ring, jitter, audio_thread_obj, wav_writer
 
-    if not args.no_audio and sd is not None:
+        LOGGER.info("Stream format: %d channel(s), %d-bit", fmt.channels, fmt.bits)
+
+        if args.save_wav:
+            wav_writer = wave.open(str(args.save_wav), "wb")
+            wav_writer.setnchannels(fmt.channels)
+            wav_writer.setsampwidth(fmt.sample_bytes)
+            wav_writer.setframerate(args.sample_rate)
+
+        use_clock = args.no_audio or sd is None
+        if use_clock and not args.clock_playout:
+            return
+
+        if args.adaptive_jitter:
+            jitter = JitterBuffer(
+                args.sample_rate,
+                fmt.bytes_per_frame,
+                args.jitter_buffer_ms,
+                args.jitter_min_ms,
+                args.jitter_max_ms,
+            )
+            if use_clock:
+                target = clock_playout_thread
+                thread_args = (jitter.read_into, args.sample_rate, fmt.bytes_per_frame, stop_event)
+            else:
+                target = jitter_audio_thread
+                thread_args = (jitter, args.sample_rate, fmt.channels, args.device, stop_event, SAMPLE_DTYPES[fmt.bits])
+            audio_thread_obj = threading.Thread(target=target, args=thread_args, daemon=True)
+            audio_thread_obj.start()
+            return
+
+        target_buffer_bytes = jitter_buffer_samples * fmt.bytes_per_frame
+        if receiver is not None:
+            # Room for the jitter buffer plus a second of bursts, in whole frames
+            ring = PcmRing(target_buffer_bytes + args.sample_rate * fmt.bytes_per_frame)
+            ring.fill_silence(target_buffer_bytes)
+            if use_clock:
+                target = clock_playout_thread
+                thread_args = (ring.read_into, args.sample_rate, fmt.bytes_per_frame, stop_event)
+            else:
+                target = ring_audio_thread
+                thread_args = (ring, args.sample_rate, fmt.channels, args.device, stop_event, SAMPLE_DTYPES[fmt.bits])
+            audio_thread_obj = threading.Thread(target=target, args=thread_args, daemon=True)
+            audio_thread_obj.start()
+            return
+
+        zero_chunk_len = fmt.bytes_per_frame * 256
         playback_queue = queue.Queue(maxsize=64)
         playback_stats = PlaybackStats()
-        if target_buffer_bytes > 0 and zero_chunk:
-            buffered_bytes = 0
-            while buffered_bytes < target_buffer_bytes:
-                chunk_len = min(len(zero_chunk), target_buffer_bytes - buffered_bytes)
-                playback_queue.put(b"\x00" * chunk_len)
-                buffered_bytes += chunk_len
+        buffered_bytes = 0
+        while buffered_bytes < target_buffer_bytes:
+            chunk_len = min(zero_chunk_len, target_buffer_bytes - buffered_bytes)
+            playback_queue.put(b"\x00" * chunk_len)
+            buffered_bytes += chunk_len
         audio_thread_obj = threading.Thread(
             target=audio_thread,
             args=(
                 playback_queue,
                 args.sample_rate,
-                args.channels,
+                fmt.channels,
                 args.device,
                 stop_event,
-                bytes_per_frame,
+                fmt.bytes_per_frame,
                 playback_stats,
+                SAMPLE_DTYPES[fmt.bits],
             ),
             daemon=True,
         )
         audio_thread_obj.start()
-    elif args.no_audio:
-        LOGGER.info("Audio playback disabled (--no-audio)")
-        playback_queue = None
-    else:
-        LOGGER.warning("sounddevice not installed; running without audio output")
 
-    stats = Stats()
-    bytes_per_sample = INT16_BYTES * args.channels
-    buffered_bytes = target_buffer_bytes
+    def start_timesync(device_ip: str):
+        nonlocal timesync, timesync_thread, timesync_pending
 
-    try:
-        while True:
+        timesync_pending = False
+        device_ip = unmap_ipv4(device_ip)
+        if ":" in device_ip:
+            LOGGER.warning("Device time sync answers on IPv4 only; pass --device-ip <ipv4> for IPv6 streams")
+            return
+        timesync = TimeSync((device_ip, args.timesync_port), args.timesync_interval_ms / 1000.0)
+        timesync_thread = threading.Thread(target=timesync.run, args=(stop_event,), daemon=True)
+        timesync_thread.start()
+
+    timesync_pending = args.timesync
+    if args.timesync and args.device_ip:
+        start_timesync(args.device_ip)
+
+    stats = Stats(args.sample_rate)
+    latency = LatencyStats()
+    fec = FecDecoder()
+    link = LinkLog()
+    analyzer = (
+        SpectrumAnalyzer(args.sample_rate, args.fft_size, args.analyze_channel, args.tones) if args.analyze else None
+    )
+
+    def play_packet(packet, addr, arrival_us: int, recovered: bool = False):
+        """Decode one datagram and hand its PCM to the WAV writer and playback.
+
+        Rebuilt packets come in behind later ones, so only the jitter buffer,
+        which orders by sample counter, plays them.
+        """
+        nonlocal stream_format, packet_shape
+
+        if timesync_pending and addr is not None:
+            start_timesync(addr[0])
+
+        parsed = parse_packet(packet, default_format)
+        if parsed is None:
+            LOGGER.warning("Received malformed packet (%d bytes) from %s", len(packet), addr or "batch")
+            return
+
+        seq, fmt, codec, payload = parsed.seq, parsed.format, parsed.codec, parsed.payload
+        if stream_format is None:
+            stream_format = fmt
+            open_outputs(fmt)
+        elif fmt != stream_format:
+            LOGGER.warning(
+                "Stream format changed to %d ch %d-bit; dropping packet (restart receiver)",
+                fmt.channels,
+                fmt.bits,
+            )
+            return
+
+        decode_s = 0.0
+        if codec != CODEC_PCM:
+            decode_start = time.perf_counter()
             try:
-                packet, addr = sock.recvfrom(HEADER_LEN + bytes_per_sample * 2048)
-            except socket.timeout:
-                if stats.report_needed(5.0):
-                    stats.report(jitter_buffer_samples, args.sample_rate)
-                continue
+                pcm = decode_payload(codec, payload, fmt)
+            except (ValueError, struct.error) as exc:
+                LOGGER.warning("Dropping undecodable %s packet seq=%d: %s", CODEC_NAMES[codec], seq, exc)
+                return
+            decode_s = time.perf_counter() - decode_start
+        else:
+            pcm = payload
+        stats.update(seq, len(payload), len(pcm), decode_s, parsed.sample_counter, recovered)
+        if recovered and jitter is None:
+            return
 
-            if len(packet) <= HEADER_LEN:
-                LOGGER.warning("Received undersized packet (%d bytes) from %s", len(packet), addr)
-                continue
+        frames = len(pcm) // fmt.bytes_per_frame
+        if (frames, parsed.adapt_epoch) != packet_shape:
+            if packet_shape is not None:
+                LOGGER.info(
+                    "Packet size now %d frames (%.1f ms), adaptation epoch %d, sample counter %d",
+                    frames,
+                    frames * 1000.0 / args.sample_rate,
+                    parsed.adapt_epoch,
+                    parsed.sample_counter,
+                )
+            packet_shape = (frames, parsed.adapt_epoch)
 
-            header = packet[:HEADER_LEN]
-            payload = packet[HEADER_LEN:]
-            seq, sample_counter, timestamp_us = struct.unpack(HEADER_FMT, header)
-            stats.update(seq, len(payload))
+        if wav_writer is not None and not recovered:
+            wav_writer.writeframes(pcm)
+        if analyzer is not None and not recovered:
+            analyzer.add(parsed.sample_counter, pcm, fmt)
 
-            if wav_writer is not None:
-                wav_writer.writeframes(payload)
+        buffer_ms = None
+        if jitter is not None:
+            wait_s = jitter.insert(parsed.sample_counter, pcm)
+            if wait_s is not None:
+                buffer_ms = wait_s * 1000.0
+        elif ring is not None:
+            buffer_ms = ring.depth() * 1000.0 / (fmt.bytes_per_frame * args.sample_rate)
+            ring.write(pcm)
+        elif playback_queue is not None:
+            try:
+                playback_queue.put(pcm, timeout=0.05)
+            except queue.Full:
+                LOGGER.warning("Playback queue full; dropping audio chunk")
 
-            if playback_queue is not None:
-                try:
-                    playback_queue.put(payload, timeout=0.05)
-                    buffered_bytes = min(buffered_bytes + len(payload), target_buffer_bytes)
-                except queue.Full:
-                    LOGGER.warning("Playback queue full; dropping audio chunk")
+        if recovered:
+            return
+        network_us = timesync.latency_us(parsed.timestamp_us, arrival_us) if timesync is not None else None
+        latency.add(None if network_us is None else network_us / 1000.0, buffer_ms)
+
+    def handle_packet(packet, addr, arrival_us: int):
+        """Pass one datagram through the FEC decoder, then play it and any packet it rebuilt."""
+        if link.is_report(packet):
+            link.add_report(packet, stats)
+            return
+        if fec.is_parity(packet):
+            rebuilt = fec.add_parity(packet)
+        else:
+            link.add_data(packet)
+            rebuilt = fec.add_data(packet)
+            if rebuilt is None:
+                return  # already rebuilt from parity
+            play_packet(packet, addr, arrival_us)
+        for datagram in rebuilt:
+            play_packet(datagram, None, arrival_us, recovered=True)
+
+    def report():
+        stats.report(jitter_buffer_samples, args.sample_rate)
+        latency.report(timesync)
+        if analyzer is not None:
+            analyzer.report()
+        if fec.active:
+            LOGGER.info(
+                "FEC parity=%d recovered=%d unrecoverable=%d malformed=%d",
+                fec.parity_packets,
+                fec.recovered,
+                fec.unrecoverable,
+                fec.malformed,
+            )
+        if jitter is not None:
+            delay_ms, target_ms, jitter_ms, late, concealed_ms, skipped_ms, held_ms, resyncs = jitter.snapshot()
+            LOGGER.info(
+                "Jitter buffer delay=%.1f ms target=%.1f ms jitter=%.2f ms late=%d concealed=%.1f ms "
+                "skipped=%.1f ms held=%.1f ms resyncs=%d",
+                delay_ms,
+                target_ms,
+                jitter_ms,
+                late,
+                concealed_ms,
+                skipped_ms,
+                held_ms,
+                resyncs,
+            )
+        elif ring is not None:
+            overflows, underflows, max_depth = ring.snapshot()
+            bytes_per_ms = stream_format.bytes_per_frame * args.sample_rate / 1000.0
+            log = LOGGER.warning if underflows or overflows or receiver.truncated else LOGGER.info
+            log(
+                "Playback ring depth=%.1f/%.1f ms max_depth=%.1f ms overflows=%d underflows=%d truncated=%d",
+                ring.depth() / bytes_per_ms,
+                ring.capacity / bytes_per_ms,
+                max_depth / bytes_per_ms,
+                overflows,
+                underflows,
+                receiver.truncated,
+            )
+        elif playback_queue is not None and playback_stats is not None:
+            underflows, max_depth = playback_stats.snapshot()
+            depth = playback_queue.qsize()
+            if underflows:
+                LOGGER.warning(
+                    "Playback queue depth=%d/%d underflows=%d max_depth=%d",
+                    depth,
+                    playback_queue.maxsize,
+                    underflows,
+                    max_depth,
+                )
+            else:
+                LOGGER.info(
+                    "Playback queue depth=%d/%d max_depth=%d",
+                    depth,
+                    playback_queue.maxsize,
+                    max_depth,
+                )
+
+    def summary() -> dict:
+        """Run totals for --summary-json."""
+        result = stats.summary()
+        result.update(latency.summary())
+        if fec.active:
+            result.update(fec.summary())
+        if link.active:
+            result.update(link.summary())
+        analysis = analyzer.result() if analyzer is not None else None
+        if analysis is not None:
+            result.update(analysis)
+        if stream_format is not None:
+            result.update(channels=stream_format.channels, bits=stream_format.bits)
+        if jitter is not None:
+            delay_ms, target_ms, jitter_ms, late, concealed_ms, skipped_ms, held_ms, resyncs = jitter.snapshot()
+            result.update(
+                playout_delay_ms=delay_ms,
+                playout_jitter_ms=jitter_ms,
+                late=late,
+                concealed_ms=concealed_ms,
+                skipped_ms=skipped_ms,
+                held_ms=held_ms,
+                resyncs=resyncs,
+            )
+        elif ring is not None:
+            overflows, underflows, _ = ring.snapshot()
+            result.update(overflows=overflows, underflows=underflows, truncated=receiver.truncated)
+        elif playback_stats is not None:
+            result.update(underflows=playback_stats.total_underflows)
+        if timesync is not None:
+            estimate = timesync.estimate()
+            if estimate is not None:
+                result.update(clock_offset_us=estimate[0], clock_drift_ppm=estimate[1], timesync_rtt_us=estimate[2])
+        return result
 
-                if buffered_bytes >= target_buffer_bytes:
-                    buffered_bytes = target_buffer_bytes
+    deadline = time.monotonic() + args.duration if args.duration else None
+    try:
+        while deadline is None or time.monotonic() < deadline:
+            if receiver is not None:
+                count = receiver.receive(1.0)
+                arrival_us = host_us()
+                for i in range(count):
+                    handle_packet(receiver.datagram(i), receiver.source(i) if i == 0 else None, arrival_us)
+            else:
+                try:
+                    packet, addr = sock.recvfrom(MAX_PACKET_BYTES)
+                except socket.timeout:
+                    packet = None
+                if packet is not None and args.monitor is not None:
+                    packet, addr = raw_tone_datagram(packet) or (None, None)
+                if packet is not None:
+                    handle_packet(packet, addr, host_us())
 
             if stats.report_needed(5.0):
-                stats.report(jitter_buffer_samples, args.sample_rate)
-                if playback_queue is not None and playback_stats is not None:
-                    underflows, max_depth = playback_stats.snapshot()
-                    depth = playback_queue.qsize()
-                    if underflows:
-                        LOGGER.warning(
-                            "Playback queue depth=%d/%d underflows=%d max_depth=%d",
-                            depth,
-                            playback_queue.maxsize,
-                            underflows,
-                            max_depth,
-                        )
-                    else:
-                        LOGGER.info(
-                            "Playback queue depth=%d/%d max_depth=%d",
-                            depth,
-                            playback_queue.maxsize,
-                            max_depth,
-                        )
+                report()
     except KeyboardInterrupt:
         LOGGER.info("Stopping receiver")
     finally:
         stop_event.set()
         if audio_thread_obj:
             audio_thread_obj.join(timeout=2.0)
+        if timesync_thread:
+            timesync_thread.join(timeout=2.0)
         if wav_writer is not None:
             wav_writer.close()
+        if args.spectrum_csv and analyzer is not None:
+            analyzer.write_csv(args.spectrum_csv)
         sock.close()
+        if args.summary_json:
+            report()
+            args.summary_json.write_text(json.dumps(summary(), indent=2) + "\n")
 
     return 0
 
@@ -4,14 +4,21 @@
 Generates a continuous PCM sine tone and transmits it over UDP with the
 wifi_audio_tone_test packet format so the receiver or firmware can validate
 transport quality.
+
+Hybrid or timerfd pacing, sendmmsg() batches and several staggered streams
+turn it into a load generator with microsecond-level send times; its own
+send lateness and interval jitter are reported with the stream.
 """
 
 import argparse
+import ctypes
 import logging
 import math
+import os
 import socket
 import struct
 import sys
+import threading
 import time
 
 LOGGER = logging.getLogger("tone_udp_tx")
@@ -20,6 +27,12 @@ DEFAULT_PACKET_MS = 10
 HEADER_FMT = ">III"  # sequence, cumulative samples, timestamp (us)
 HEADER_LEN = struct.calcsize(HEADER_FMT)
 INT16_MAX = 2 ** 15 - 1
+ECHO_TIMEOUT_S = 2.0  # reflections not back by then count as lost
+ECHO_PERCENTILES = (50, 95, 99)
+PACING_MODES = ("sleep", "hybrid", "timerfd")
+DEFAULT_SPIN_US = 200.0  # busy-wait ahead of each deadline in hybrid and timerfd pacing
+SEND_PERCENTILES = (50, 99)
+JITTER_GAIN = 1 / 16  # RFC 3550 smoothing of the send interval error
 
 
 def build_parser() -> argparse.ArgumentParser:
@@ -44,10 +57,337 @@ def build_parser() -> argparse.ArgumentParser:
         default=DEFAULT_PACKET_MS,
         help="Packet duration in milliseconds",
     )
+    parser.add_argument(
+        "--echo",
+        action="store_true",
+        help="Expect packets back from 'tone echo <port>' and report round-trip time and loss",
+    )
+    parser.add_argument(
+        "--pacing",
+        choices=PACING_MODES,
+        default="sleep",
+        help="sleep: time.sleep() to each deadline; hybrid: sleep, then busy-wait the last "
+        "--spin-us; timerfd: absolute CLOCK_MONOTONIC timer, then busy-wait (Linux, Python 3.13+)",
+    )
+    parser.add_argument(
+        "--spin-us",
+        type=float,
+        default=DEFAULT_SPIN_US,
+        help="Busy-wait window before each deadline in hybrid and timerfd pacing",
+    )
+    parser.add_argument(
+        "--batch",
+        type=int,
+        default=1,
+        help="Packets sent per wakeup, with one sendmmsg() call where available",
+    )
+    parser.add_argument(
+        "--streams",
+        type=int,
+        default=1,
+        help="Independent streams, stream N sent to --port + N with deadlines staggered evenly",
+    )
+    parser.add_argument(
+        "--freq-step", type=float, default=0.0, help="Tone frequency added per stream in Hz"
+    )
+    parser.add_argument(
+        "--report-s", type=float, default=5.0, help="Send and echo statistics period in seconds"
+    )
     parser.add_argument("--log-level", default="INFO", help="Logging level")
     return parser
 
 
+def percentile(ordered: list[float], pct: float) -> float:
+    return ordered[min(len(ordered) - 1, round(pct / 100 * (len(ordered) - 1)))]
+
+
+class EchoStats:
+    """Match reflections from 'tone echo' to their send times by sequence number.
+
+    The device replaces the header timestamp with its arrival time, which
+    gives the RFC 3550 interarrival jitter of the forward path alone; the
+    unknown clock offset cancels out.
+    """
+
+    def __init__(self):
+        self._lock = threading.Lock()
+        self._in_flight: dict[int, int] = {}
+        self._rtts_us: list[float] = []
+        self._prev_transit = None
+        self.forward_jitter_us = 0.0
+        self.sent = 0
+        self.returned = 0
+        self.lost = 0
+        self.late = 0
+        self.period_sent = 0
+        self.period_returned = 0
+
+    def on_send(self, seq: int, send_ns: int):
+        with self._lock:
+            self._in_flight[seq] = send_ns
+            self.sent += 1
+            self.period_sent += 1
+
+    def on_reply(self, seq: int, device_arrival_us: int, receive_ns: int):
+        with self._lock:
+            send_ns = self._in_flight.pop(seq, None)
+            if send_ns is None:
+                self.late += 1
+                return
+            self.returned += 1
+            self.period_returned += 1
+            self._rtts_us.append((receive_ns - send_ns) / 1000.0)
+            transit = (device_arrival_us - send_ns // 1000) & 0xFFFFFFFF
+            if self._prev_transit is not None:
+                delta = ((transit - self._prev_transit + 0x80000000) & 0xFFFFFFFF) - 0x80000000
+                self.forward_jitter_us += (abs(delta) - self.forward_jitter_us) / 16
+            self._prev_transit = transit
+
+    def report(self, now_ns: int):
+        with self._lock:
+            expired = [seq for seq, sent_ns in self._in_flight.items() if now_ns - sent_ns > ECHO_TIMEOUT_S * 1e9]
+            for seq in expired:
+                del self._in_flight[seq]
+            self.lost += len(expired)
+            rtts = sorted(self._rtts_us)
+            self._rtts_us.clear()
+            period_sent, period_returned = self.period_sent, self.period_returned
+            self.period_sent = self.period_returned = 0
+            totals = (self.sent, self.returned, self.lost, self.late, len(self._in_flight))
+
+        sent, returned, lost, late, in_flight = totals
+        resolved = returned + lost
+        loss_pct = 100.0 * lost / resolved if resolved else 0.0
+        if rtts:
+            rtt = "rtt min/avg/{}/max={:.2f}/{:.2f}/{}/{:.2f} ms".format(
+                "/".join(f"p{p}" for p in ECHO_PERCENTILES),
+                rtts[0] / 1000.0,
+                sum(rtts) / len(rtts) / 1000.0,
+                "/".join(f"{percentile(rtts, p) / 1000.0:.2f}" for p in ECHO_PERCENTILES),
+                rtts[-1] / 1000.0,
+            )
+        else:
+            rtt = "no replies"
+        LOGGER.info(
+            "Echo: sent=%d returned=%d (period %d/%d) lost=%d (%.2f%%) late=%d in_flight=%d %s forward_jitter=%.3f ms",
+            sent,
+            returned,
+            period_returned,
+            period_sent,
+            lost,
+            loss_pct,
+            late,
+            in_flight,
+            rtt,
+            self.forward_jitter_us / 1000.0,
+        )
+
+
+def echo_receiver(sock: socket.socket, stats: EchoStats, stop_event: threading.Event):
+    while not stop_event.is_set():
+        try:
+            packet = sock.recv(65_535)
+        except socket.timeout:
+            continue
+        except OSError as exc:
+            LOGGER.debug("Echo receive failed: %s", exc)
+            time.sleep(0.1)
+            continue
+        receive_ns = time.perf_counter_ns()
+        if len(packet) < HEADER_LEN:
+            continue
+        seq, _, device_arrival_us = struct.unpack_from(HEADER_FMT, packet)
+        stats.on_reply(seq, device_arrival_us, receive_ns)
+
+
+class SendStats:
+    """Own pacing quality of one stream: how late each send started.
+
+    Lateness is measured from the deadline to the moment the packet is
+    handed to the kernel; the interval jitter is the RFC 3550 smoothed
+    deviation of consecutive send intervals from the nominal one.
+    """
+
+    def __init__(self, interval_ns: int):
+        self._interval_ns = interval_ns
+        self._lateness_us: list[float] = []
+        self._prev_send_ns = None
+        self.interval_jitter_us = 0.0
+        self.packets = 0
+        self.short_sends = 0
+        self.period_packets = 0
+        self.period_start_ns = time.monotonic_ns()
+
+    def on_send(self, deadline_ns: int, send_ns: int, packets: int):
+        self._lateness_us.append((send_ns - deadline_ns) / 1000.0)
+        if self._prev_send_ns is not None:
+            error_us = abs(send_ns - self._prev_send_ns - self._interval_ns) / 1000.0
+            self.interval_jitter_us += (error_us - self.interval_jitter_us) * JITTER_GAIN
+        self._prev_send_ns = send_ns
+        self.packets += packets
+        self.period_packets += packets
+
+    def report(self, label: str, now_ns: int):
+        lateness = sorted(self._lateness_us)
+        self._lateness_us.clear()
+        elapsed_s = (now_ns - self.period_start_ns) / 1e9
+        rate = self.period_packets / elapsed_s if elapsed_s > 0 else 0.0
+        self.period_packets = 0
+        self.period_start_ns = now_ns
+        if lateness:
+            late = "lateness min/avg/{}/max={:.1f}/{:.1f}/{}/{:.1f} us".format(
+                "/".join(f"p{p}" for p in SEND_PERCENTILES),
+                lateness[0],
+                sum(lateness) / len(lateness),
+                "/".join(f"{percentile(lateness, p):.1f}" for p in SEND_PERCENTILES),
+                lateness[-1],
+            )
+        else:
+            late = "no sends"
+        LOGGER.info(
+            "Send %s: packets=%d rate=%.1f/s short=%d %s interval_jitter=%.1f us",
+            label,
+            self.packets,
+            rate,
+            self.short_sends,
+            late,
+            self.interval_jitter_us,
+        )
+
+
+class _IoVec(ctypes.Structure):
+    _fields_ = [("iov_base", ctypes.c_void_p), ("iov_len", ctypes.c_size_t)]
+
+
+class _MsgHdr(ctypes.Structure):
+    _fields_ = [
+        ("msg_name", ctypes.c_void_p),
+        ("msg_namelen", ctypes.c_uint32),
+        ("msg_iov", ctypes.POINTER(_IoVec)),
+        ("msg_iovlen", ctypes.c_size_t),
+        ("msg_control", ctypes.c_void_p),
+        ("msg_controllen", ctypes.c_size_t),
+        ("msg_flags", ctypes.c_int),
+    ]
+
+
+class _MMsgHdr(ctypes.Structure):
+    _fields_ = [("msg_hdr", _MsgHdr), ("msg_len", ctypes.c_uint)]
+
+
+def load_sendmmsg():
+    """libc sendmmsg(), or None where the platform has no such call."""
+    if not sys.platform.startswith("linux"):
+        return None
+    try:
+        func = ctypes.CDLL(None, use_errno=True).sendmmsg
+    except (AttributeError, OSError):
+        return None
+    func.argtypes = [ctypes.c_int, ctypes.POINTER(_MMsgHdr), ctypes.c_uint, ctypes.c_int]
+    func.restype = ctypes.c_int
+    return func
+
+
+class Pacer:
+    """Waits for absolute CLOCK_MONOTONIC deadlines in nanoseconds.
+
+    A plain sleep wakes late by the scheduler's timer slack; hybrid and
+    timerfd pacing wake up --spin-us early and busy-wait the rest, trading
+    one core for microsecond-level send times.
+    """
+
+    def __init__(self, mode: str, spin_us: float):
+        self._mode = mode
+        self._spin_ns = int(spin_us * 1000) if mode != "sleep" else 0
+        self._timer_fd = None
+        if mode == "timerfd":
+            self._timer_fd = os.timerfd_create(time.CLOCK_MONOTONIC)
+
+    def wait_until(self, deadline_ns: int):
+        wake_ns = deadline_ns - self._spin_ns
+        now_ns = time.monotonic_ns()
+        if wake_ns > now_ns:
+            if self._timer_fd is not None:
+                os.timerfd_settime_ns(self._timer_fd, flags=os.TFD_TIMER_ABSTIME, initial=wake_ns)
+                os.read(self._timer_fd, 8)
+            else:
+                time.sleep((wake_ns - now_ns) / 1e9)
+        while self._spin_ns and time.monotonic_ns() < deadline_ns:
+            pass
+
+    def close(self):
+        if self._timer_fd is not None:
+            os.close(self._timer_fd)
+            self._timer_fd = None
+
+
+class ToneStream:
+    """One destination with its socket, sequence state and preallocated packets.
+
+    Each of the --batch packets keeps its own buffer with the payload copied
+    in once; per send only the header is packed into it in place.
+    """
+
+    def __init__(self, index: int, dest: tuple[str, int], payload: bytes, samples_per_packet: int,
+                 batch: int, interval_ns: int, sendmmsg):
+        self.index = index
+        self.dest = dest
+        self.samples_per_packet = samples_per_packet
+        self.seq = 0
+        self.sample_counter = 0
+        self.stats = SendStats(interval_ns * batch)
+        self.echo_stats = None
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, max(len(payload) * 4 * batch, 65536))
+        self.packet_len = HEADER_LEN + len(payload)
+        self.buffers = [bytearray(self.packet_len) for _ in range(batch)]
+        for buf in self.buffers:
+            buf[HEADER_LEN:] = payload
+        self._sendmmsg = sendmmsg
+        self._views = None
+        self._iovs = None
+        self._msgs = None
+        if sendmmsg is not None and batch > 1:
+            # Connected, so the messages carry no address
+            self.sock.connect(dest)
+            self._views = [(ctypes.c_char * self.packet_len).from_buffer(buf) for buf in self.buffers]
+            self._iovs = (_IoVec * batch)()
+            self._msgs = (_MMsgHdr * batch)()
+            for i, view in enumerate(self._views):
+                self._iovs[i].iov_base = ctypes.addressof(view)
+                self._iovs[i].iov_len = self.packet_len
+                self._msgs[i].msg_hdr.msg_iov = ctypes.pointer(self._iovs[i])
+                self._msgs[i].msg_hdr.msg_iovlen = 1
+
+    def send_batch(self, timestamp_us: int) -> int:
+        """Send every buffer in order; returns how many went out whole."""
+        for buf in self.buffers:
+            struct.pack_into(HEADER_FMT, buf, 0, self.seq, self.sample_counter, timestamp_us)
+            if self.echo_stats is not None:
+                self.echo_stats.on_send(self.seq, time.perf_counter_ns())
+            self.seq = (self.seq + 1) & 0xFFFFFFFF
+            self.sample_counter = (self.sample_counter + self.samples_per_packet) & 0xFFFFFFFF
+
+        if self._msgs is not None:
+            sent = self._sendmmsg(self.sock.fileno(), self._msgs, len(self.buffers), 0)
+            if sent < 0:
+                err = ctypes.get_errno()
+                raise OSError(err, os.strerror(err))
+            return sent
+
+        whole = 0
+        for buf in self.buffers:
+            if self.sock.sendto(buf, self.dest) == self.packet_len:
+                whole += 1
+        return whole
+
+    def close(self):
+        self._msgs = None
+        self._iovs = None
+        self._views = None
+        self.sock.close()
+
+
 def generate_sine_packet(samples_per_packet: int, freq_hz: float, amplitude: float, sample_rate: int) -> bytes:
     """Generate one PCM packet worth of samples as signed 16-bit little-endian."""
     step = 2.0 * math.pi * freq_hz / sample_rate
@@ -75,51 +415,117 @@ def main() -> int:
         LOGGER.error("Computed samples per packet <= 0. Check sample rate / packet duration")
         return 1
 
-    pcm_payload = generate_sine_packet(samples_per_packet, args.freq, amplitude, args.sample_rate)
-    payload_len = len(pcm_payload)
-    LOGGER.info(
-        "Starting tone stream: dest=%s:%d freq=%.1fHz amp=%.1f sample_rate=%d packet_ms=%.1f payload=%d bytes",
-        args.ip,
-        args.port,
-        args.freq,
-        args.amplitude,
-        args.sample_rate,
-        args.packet_ms,
-        payload_len,
-    )
-    
+    if args.batch < 1 or args.streams < 1:
+        LOGGER.error("Batch and stream counts must be at least 1")
+        return 1
+    if args.pacing == "timerfd" and not hasattr(os, "timerfd_create"):
+        LOGGER.error("timerfd pacing needs Linux and Python 3.13+; use --pacing hybrid")
+        return 1
+
+    interval_ns = int(args.packet_ms * 1_000_000)
+    period_ns = interval_ns * args.batch
+    sendmmsg = load_sendmmsg() if args.batch > 1 else None
+    if args.batch > 1 and sendmmsg is None:
+        LOGGER.info("sendmmsg() unavailable, batches go out one sendto() per packet")
+
+    streams = []
+    for index in range(args.streams):
+        freq = args.freq + index * args.freq_step
+        pcm_payload = generate_sine_packet(samples_per_packet, freq, amplitude, args.sample_rate)
+        dest = (args.ip, args.port + index)
+        streams.append(
+            ToneStream(index, dest, pcm_payload, samples_per_packet, args.batch, interval_ns, sendmmsg)
+        )
+        LOGGER.info(
+            "Starting tone stream %d: dest=%s:%d freq=%.1fHz amp=%.1f sample_rate=%d packet_ms=%.1f "
+            "payload=%d bytes",
+            index,
+            dest[0],
+            dest[1],
+            freq,
+            args.amplitude,
+            args.sample_rate,
+            args.packet_ms,
+            len(pcm_payload),
+        )
+    if args.pacing != "sleep" or args.batch > 1:
+        LOGGER.info(
+            "Pacing: %s, %d packet(s) per wakeup every %.3f ms%s",
+            args.pacing,
+            args.batch,
+            period_ns / 1e6,
+            f", busy-wait {args.spin_us:.0f} us" if args.pacing != "sleep" else "",
+        )
+
     # Remind user about port configuration when using default
     if args.port == 50005:
         LOGGER.info("Using default port 50005. To use a different port, specify --port <port_number>")
 
-    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    sock.setsockopt(socket.SOL_SOCKET, socket.SO_SNDBUF, max(payload_len * 4, 65536))
-    dest = (args.ip, args.port)
+    stop_event = threading.Event()
+    echo_threads = []
+    if args.echo:
+        for stream in streams:
+            if stream.sock.getsockname()[1] == 0:
+                stream.sock.bind(("0.0.0.0", 0))
+            stream.sock.settimeout(0.5)
+            stream.echo_stats = EchoStats()
+            thread = threading.Thread(
+                target=echo_receiver, args=(stream.sock, stream.echo_stats, stop_event), daemon=True
+            )
+            thread.start()
+            echo_threads.append(thread)
+            LOGGER.info(
+                "Echo mode: stream %d expects reflections on local port %d",
+                stream.index,
+                stream.sock.getsockname()[1],
+            )
+
+    pacer = Pacer(args.pacing, args.spin_us)
+    start_ns = time.monotonic_ns()
+    # Streams share the period, each offset by an equal slice of it
+    deadlines = [start_ns + period_ns * index // len(streams) for index in range(len(streams))]
+    report_ns = int(args.report_s * 1e9)
+    next_report = start_ns + report_ns
 
-    seq = 0
-    sample_counter = 0
-    interval_s = args.packet_ms / 1000.0
-    next_send = time.perf_counter()
-    start_time_ns = time.time_ns()  # Store start time for relative timestamp calculation
+    def report(now_ns: int):
+        for stream in streams:
+            stream.stats.report(str(stream.index), now_ns)
+            if stream.echo_stats is not None:
+                stream.echo_stats.report(time.perf_counter_ns())
 
     try:
         while True:
-            now = time.perf_counter()
-            if now < next_send:
-                time.sleep(next_send - now)
+            index = min(range(len(streams)), key=deadlines.__getitem__)
+            stream = streams[index]
+            deadline = deadlines[index]
+            pacer.wait_until(deadline)
+            send_ns = time.monotonic_ns()
             # Use relative timestamp in microseconds to fit in 32-bit unsigned int
-            timestamp_us = int((time.time_ns() - start_time_ns) // 1000) & 0xFFFFFFFF
-            header = struct.pack(HEADER_FMT, seq, sample_counter, timestamp_us)
-            sent = sock.sendto(header + pcm_payload, dest)
-            if sent != HEADER_LEN + payload_len:
-                LOGGER.warning("Short send: %d bytes", sent)
-            seq = (seq + 1) & 0xFFFFFFFF
-            sample_counter = (sample_counter + samples_per_packet) & 0xFFFFFFFF
-            next_send += interval_s
+            timestamp_us = ((send_ns - start_ns) // 1000) & 0xFFFFFFFF
+            try:
+                whole = stream.send_batch(timestamp_us)
+            except OSError as exc:
+                # A connected socket reports ICMP errors of earlier datagrams here
+                LOGGER.debug("Stream %d send failed: %s", index, exc)
+                whole = 0
+            if whole != args.batch:
+                stream.stats.short_sends += args.batch - whole
+                LOGGER.warning("Stream %d: %d of %d packets sent whole", index, whole, args.batch)
+            stream.stats.on_send(deadline, send_ns, whole)
+            deadlines[index] = deadline + period_ns
+            if send_ns >= next_report:
+                report(send_ns)
+                next_report += report_ns
     except KeyboardInterrupt:
         LOGGER.info("Stopping tone stream")
     finally:
-        sock.close()
+        stop_event.set()
+        for thread in echo_threads:
+            thread.join(timeout=1.0)
+        report(time.monotonic_ns())
+        pacer.close()
+        for stream in streams:
+            stream.close()
     return 0
 
 
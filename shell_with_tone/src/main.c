@@ -26,7 +26,7 @@
 #if IS_ENABLED(CONFIG_TONE_SHELL)
 static uint8_t get_amp_and_print(const char *label)
 {
-	uint8_t amp = tone_stream_get_current_amplitude();
+	uint8_t amp = tone_stream_get_current_amplitude(TONE_DEFAULT_STREAM_ID);
 	printk("%s %u%%\n", label, amp);
 	return amp;
 }
@@ -38,16 +38,16 @@ static uint8_t get_amp_and_print(const char *label)
 static void button_handler(uint32_t button_state, uint32_t has_changed)
 {
 	if (has_changed & DK_BTN1_MSK && (button_state & DK_BTN1_MSK)) {
-		if (tone_stream_adjust_amplitude(-AMP_STEP_PERCENT) == 0) {
+		if (tone_stream_adjust_amplitude(TONE_DEFAULT_STREAM_ID, -AMP_STEP_PERCENT) == 0) {
 			printk("Tone amplitude decreased to %u%%\n",
-			       tone_stream_get_current_amplitude());
+			       tone_stream_get_current_amplitude(TONE_DEFAULT_STREAM_ID));
 		}
 	}
 
 	if (has_changed & DK_BTN2_MSK && (button_state & DK_BTN2_MSK)) {
-		if (tone_stream_adjust_amplitude(AMP_STEP_PERCENT) == 0) {
+		if (tone_stream_adjust_amplitude(TONE_DEFAULT_STREAM_ID, AMP_STEP_PERCENT) == 0) {
 			printk("Tone amplitude increased to %u%%\n",
-			       tone_stream_get_current_amplitude());
+			       tone_stream_get_current_amplitude(TONE_DEFAULT_STREAM_ID));
 		}
 	}
 }
@@ -0,0 +1,279 @@
+/*
+ * Wi-Fi Audio Tone Test - payload codecs
+ */
+
+#include "tone_codec.h"
+
+#include <errno.h>
+#include <stdbool.h>
+
+#include <zephyr/sys/byteorder.h>
+
+BUILD_ASSERT(TONE_MAX_SAMPLES_PER_PACKET <= UINT16_MAX, "Frame count must fit the block header");
+
+#define ADPCM_STEP_INDEX_MAX 88
+
+static const int16_t adpcm_step_table[ADPCM_STEP_INDEX_MAX + 1] = {
+	7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+	25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+	88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+	307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+	1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+	3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t adpcm_index_table[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+/* Quantize one sample against the running prediction, returning the 4-bit code */
+static uint8_t adpcm_encode_sample(struct tone_adpcm_state *state, int16_t sample)
+{
+	int32_t step = adpcm_step_table[state->step_index];
+	int32_t diff = (int32_t)sample - state->predictor;
+	int32_t vpdiff = step >> 3;
+	uint8_t code = 0U;
+
+	if (diff < 0) {
+		code = 8U;
+		diff = -diff;
+	}
+
+	/* Successive approximation, mirroring the decoder's reconstruction */
+	if (diff >= step) {
+		code |= 4U;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 2U;
+		diff -= step;
+		vpdiff += step;
+	}
+	step >>= 1;
+	if (diff >= step) {
+		code |= 1U;
+		vpdiff += step;
+	}
+
+	int32_t predictor = state->predictor + ((code & 8U) ? -vpdiff : vpdiff);
+
+	state->predictor = (int16_t)CLAMP(predictor, INT16_MIN, INT16_MAX);
+	state->step_index = (uint8_t)CLAMP((int)state->step_index + adpcm_index_table[code], 0,
+					   ADPCM_STEP_INDEX_MAX);
+
+	return code;
+}
+
+/*
+ * Channel headers hold the state the packet starts from, followed by one
+ * nibble per sample in wire order, low nibble first. As in the Microsoft
+ * IMA block layout the prediction restarts from each block's first sample,
+ * so quantization error never carries across packets.
+ */
+static size_t adpcm_encode(struct tone_adpcm_state *state, const int16_t *pcm, uint32_t frames,
+			   uint32_t channels, uint8_t *out)
+{
+	const uint32_t count = frames * channels;
+	uint8_t *codes = out + channels * TONE_CODEC_ADPCM_CHANNEL_HDR_LEN;
+	uint32_t ch = 0U;
+
+	for (uint32_t i = 0; i < channels; i++) {
+		uint8_t *hdr = out + i * TONE_CODEC_ADPCM_CHANNEL_HDR_LEN;
+
+		state[i].predictor = pcm[i];
+		sys_put_le16((uint16_t)state[i].predictor, hdr);
+		hdr[2] = state[i].step_index;
+		hdr[3] = 0U;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint8_t code = adpcm_encode_sample(&state[ch], pcm[i]);
+
+		if (i & 1U) {
+			codes[i >> 1] |= code << 4;
+		} else {
+			codes[i >> 1] = code;
+		}
+
+		if (++ch == channels) {
+			ch = 0U;
+		}
+	}
+
+	return (codes - out) + DIV_ROUND_UP(count, 2U);
+}
+
+/* MSB-first bit packer over a bounded buffer */
+struct bit_writer {
+	uint8_t *buf;
+	size_t len;
+	size_t pos;
+	uint32_t acc;
+	uint32_t bits;
+};
+
+/* Append the low n bits of value, n <= 24 */
+static bool bw_put(struct bit_writer *bw, uint32_t value, uint32_t n)
+{
+	bw->acc = (bw->acc << n) | (value & BIT_MASK(n));
+	bw->bits += n;
+
+	while (bw->bits >= 8U) {
+		if (bw->pos >= bw->len) {
+			return false;
+		}
+		bw->bits -= 8U;
+		bw->buf[bw->pos++] = (uint8_t)(bw->acc >> bw->bits);
+	}
+
+	return true;
+}
+
+/* Pad the last partial byte with ones or zeros */
+static bool bw_flush(struct bit_writer *bw, bool ones)
+{
+	uint32_t pad = (8U - bw->bits) & 7U;
+
+	return bw_put(bw, ones ? BIT_MASK(pad) : 0U, pad);
+}
+
+/* q one bits closed by a zero bit */
+static bool bw_put_unary(struct bit_writer *bw, uint32_t q)
+{
+	while (q > 23U) {
+		if (!bw_put(bw, BIT_MASK(24), 24U)) {
+			return false;
+		}
+		q -= 24U;
+	}
+
+	return bw_put(bw, BIT_MASK(q) << 1, q + 1U);
+}
+
+static inline uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/*
+ * Lossless delta+Rice: the first frame as raw little-endian samples, then
+ * each sample's zigzagged difference from the same channel one frame back.
+ * The Rice remainders of all differences (k bits each, MSB first) precede
+ * all unary quotients, so a decoder splits both sections without walking
+ * the codes one by one.
+ */
+static int rice_encode(const int16_t *pcm, uint32_t frames, uint32_t channels, uint8_t *out,
+		       size_t out_len, uint8_t *k_out)
+{
+	const uint32_t total = frames * channels;
+	const uint32_t count = total - channels;
+	uint64_t sum = 0U;
+	uint32_t k = 0U;
+
+	for (uint32_t i = channels; i < total; i++) {
+		sum += zigzag((int32_t)pcm[i] - pcm[i - channels]);
+	}
+
+	/* k = floor(log2(mean)) bounds the quotients to about two bits per code */
+	if (count > 0U && sum >= count) {
+		k = 31U - (uint32_t)__builtin_clz((uint32_t)(sum / count));
+	}
+
+	const size_t first_len = channels * sizeof(int16_t);
+	const size_t rem_len = DIV_ROUND_UP((size_t)count * k, 8U);
+
+	if (first_len + rem_len > out_len) {
+		return -ENOSPC;
+	}
+
+	for (uint32_t ch = 0; ch < channels; ch++) {
+		sys_put_le16((uint16_t)pcm[ch], out + ch * sizeof(int16_t));
+	}
+
+	struct bit_writer rem = {
+		.buf = out + first_len,
+		.len = rem_len,
+	};
+	struct bit_writer unary = {
+		.buf = out + first_len + rem_len,
+		.len = out_len - first_len - rem_len,
+	};
+
+	for (uint32_t i = channels; i < total; i++) {
+		uint32_t u = zigzag((int32_t)pcm[i] - pcm[i - channels]);
+
+		(void)bw_put(&rem, u, k);
+		if (!bw_put_unary(&unary, u >> k)) {
+			return -ENOSPC;
+		}
+	}
+
+	(void)bw_flush(&rem, false);
+	if (!bw_flush(&unary, true)) {
+		return -ENOSPC;
+	}
+
+	*k_out = (uint8_t)k;
+	return (int)(first_len + rem_len + unary.pos);
+}
+
+size_t tone_codec_max_len(enum tone_codec codec, uint32_t frames, uint32_t channels)
+{
+	const size_t pcm_len = (size_t)frames * channels * sizeof(int16_t);
+
+	switch (codec) {
+	case TONE_CODEC_IMA_ADPCM:
+		return TONE_CODEC_BLOCK_HDR_LEN + channels * TONE_CODEC_ADPCM_CHANNEL_HDR_LEN +
+		       DIV_ROUND_UP(frames * channels, 2U);
+	case TONE_CODEC_RICE:
+	default:
+		return pcm_len;
+	}
+}
+
+int tone_codec_encode(enum tone_codec codec, struct tone_adpcm_state *adpcm, const int16_t *pcm,
+		      uint32_t frames, uint32_t channels, uint8_t *out, size_t out_len)
+{
+	size_t len;
+	uint8_t param = 0U;
+
+	if (frames == 0U || frames > UINT16_MAX || channels == 0U) {
+		return -EINVAL;
+	}
+
+	if (out_len < TONE_CODEC_BLOCK_HDR_LEN) {
+		return -ENOSPC;
+	}
+
+	uint8_t *body = out + TONE_CODEC_BLOCK_HDR_LEN;
+	const size_t body_len = out_len - TONE_CODEC_BLOCK_HDR_LEN;
+
+	switch (codec) {
+	case TONE_CODEC_IMA_ADPCM:
+		if (tone_codec_max_len(codec, frames, channels) > out_len) {
+			return -ENOSPC;
+		}
+		len = adpcm_encode(adpcm, pcm, frames, channels, body);
+		break;
+	case TONE_CODEC_RICE: {
+		int ret = rice_encode(pcm, frames, channels, body, body_len, &param);
+
+		if (ret < 0) {
+			return ret;
+		}
+		len = (size_t)ret;
+		break;
+	}
+	default:
+		return -EINVAL;
+	}
+
+	sys_put_be16((uint16_t)frames, out);
+	out[2] = param;
+	out[3] = 0U;
+
+	return (int)(TONE_CODEC_BLOCK_HDR_LEN + len);
+}
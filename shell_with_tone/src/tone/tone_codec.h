@@ -0,0 +1,59 @@
+/*
+ * Wi-Fi Audio Tone Test - payload codecs
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/sys/util.h>
+
+#include "tone_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Every encoded payload opens with a block header: frame count (big-endian
+ * u16), one codec parameter byte and one reserved byte. Each packet decodes
+ * on its own, so a lost packet never corrupts the ones after it.
+ */
+#define TONE_CODEC_BLOCK_HDR_LEN 4U
+
+/* IMA-ADPCM channel header: predictor (little-endian s16), step index, reserved */
+#define TONE_CODEC_ADPCM_CHANNEL_HDR_LEN 4U
+
+/* Largest payload tone_codec_encode() produces for any packet the engine allows */
+#define TONE_CODEC_MAX_PAYLOAD_BYTES                                                           \
+	MAX(TONE_MAX_SAMPLES_PER_PACKET * sizeof(int16_t),                                     \
+	    TONE_CODEC_BLOCK_HDR_LEN + TONE_MAX_CHANNELS * TONE_CODEC_ADPCM_CHANNEL_HDR_LEN +   \
+		    DIV_ROUND_UP(TONE_MAX_SAMPLES_PER_PACKET, 2U))
+
+/* IMA-ADPCM encoder state of one channel, carried from packet to packet */
+struct tone_adpcm_state {
+	int16_t predictor;
+	uint8_t step_index;
+};
+
+/*
+ * Upper bound of the payload encoding frames interleaved 16-bit frames. For
+ * delta+Rice this is the PCM size: a packet that does not compress below it
+ * is refused and should be sent as PCM.
+ */
+size_t tone_codec_max_len(enum tone_codec codec, uint32_t frames, uint32_t channels);
+
+/*
+ * Encode frames interleaved 16-bit frames into out. adpcm holds one state per
+ * channel and is only used by TONE_CODEC_IMA_ADPCM.
+ *
+ * Returns the payload length, -ENOSPC when it exceeds out_len or -EINVAL for
+ * an unknown codec.
+ */
+int tone_codec_encode(enum tone_codec codec, struct tone_adpcm_state *adpcm, const int16_t *pcm,
+		      uint32_t frames, uint32_t channels, uint8_t *out, size_t out_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,268 @@
+/*
+ * Wi-Fi Audio Tone Test - 'tone echo' reflector
+ */
+
+#include "tone_stream.h"
+#include "tone_stream_internal.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_DECLARE(tone_stream, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* One unfragmented datagram at a 1500 byte MTU; longer ones are truncated */
+#define ECHO_MAX_BYTES  1472U
+/* Polled with a timeout so a stop is noticed while nothing arrives */
+#define ECHO_POLL_MS    100
+#define ECHO_BACKOFF_MS 100
+
+K_THREAD_STACK_DEFINE(tone_echo_stack, CONFIG_TONE_STREAM_ECHO_STACK_SIZE);
+static struct k_thread tone_echo_thread;
+static K_SEM_DEFINE(tone_echo_start_sem, 0, 1);
+static K_SEM_DEFINE(tone_echo_stopped_sem, 0, 1);
+/* Serializes start and stop */
+static K_MUTEX_DEFINE(tone_echo_lock);
+
+static struct {
+	int fd;
+	atomic_t running;
+	bool thread_started;
+	uint16_t port;
+	/* Only touched from the echo thread */
+	bool have_seq;
+	uint32_t last_seq;
+	uint64_t turnaround_sum_us;
+	struct k_spinlock stats_lock;
+	struct tone_echo_stats stats;
+} echo = {
+	.fd = -1,
+};
+
+static void echo_count(uint32_t *counter)
+{
+	k_spinlock_key_t key = k_spin_lock(&echo.stats_lock);
+
+	(*counter)++;
+
+	k_spin_unlock(&echo.stats_lock, key);
+}
+
+/* Caller holds echo.stats_lock */
+static void echo_track_seq_locked(uint32_t seq)
+{
+	if (echo.have_seq) {
+		int32_t gap = (int32_t)(seq - echo.last_seq - 1U);
+
+		if (gap < 0) {
+			/* Behind the newest sequence: a late packet already counted as lost */
+			echo.stats.reordered++;
+			if (echo.stats.forward_lost > 0U) {
+				echo.stats.forward_lost--;
+			}
+			return;
+		}
+		echo.stats.forward_lost += (uint32_t)gap;
+	}
+
+	echo.have_seq = true;
+	echo.last_seq = seq;
+}
+
+/*
+ * Reflect one datagram with the tone header timestamp replaced by the
+ * arrival time on the stream time base; the sender keeps its own send times.
+ */
+static int echo_reflect(uint8_t *buf, size_t len, const struct sockaddr *peer,
+			socklen_t peer_len, uint64_t arrival_us)
+{
+	if (len < sizeof(struct tone_packet_header)) {
+		return -EMSGSIZE;
+	}
+
+	sys_put_be32((uint32_t)(arrival_us & 0xFFFFFFFFU),
+		     buf + offsetof(struct tone_packet_header, timestamp_us));
+
+	k_spinlock_key_t key = k_spin_lock(&echo.stats_lock);
+
+	echo_track_seq_locked(sys_get_be32(buf + offsetof(struct tone_packet_header, seq)));
+	k_spin_unlock(&echo.stats_lock, key);
+
+	if (sendto(echo.fd, buf, len, 0, peer, peer_len) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+static void echo_serve(void)
+{
+	static uint8_t buf[ECHO_MAX_BYTES];
+	struct pollfd pfd = {
+		.fd = echo.fd,
+		.events = POLLIN,
+	};
+
+	while (atomic_get(&echo.running)) {
+		struct sockaddr_in peer;
+		socklen_t peer_len = sizeof(peer);
+		int ret = poll(&pfd, 1, ECHO_POLL_MS);
+		ssize_t len = (ret > 0) ? recvfrom(echo.fd, buf, sizeof(buf), 0,
+						   (struct sockaddr *)&peer, &peer_len)
+					: 0;
+		uint64_t arrival_us = tone_stream_micros();
+
+		if (ret < 0 || len < 0) {
+			LOG_DBG("Echo receive failed: %d", errno);
+			k_sleep(K_MSEC(ECHO_BACKOFF_MS));
+			continue;
+		}
+
+		if (ret == 0) {
+			continue;
+		}
+
+		echo_count(&echo.stats.received);
+
+		ret = echo_reflect(buf, (size_t)len, (struct sockaddr *)&peer, peer_len,
+				   arrival_us);
+		uint32_t turnaround_us = (uint32_t)(tone_stream_micros() - arrival_us);
+		k_spinlock_key_t key = k_spin_lock(&echo.stats_lock);
+
+		if (ret == 0) {
+			echo.stats.reflected++;
+			echo.turnaround_sum_us += turnaround_us;
+			echo.stats.turnaround_max_us =
+				MAX(echo.stats.turnaround_max_us, turnaround_us);
+		} else if (ret == -EMSGSIZE) {
+			echo.stats.malformed++;
+		} else {
+			echo.stats.dropped++;
+		}
+
+		k_spin_unlock(&echo.stats_lock, key);
+	}
+}
+
+/* Serves one bound socket per 'tone echo <port>' until the stop */
+static void tone_echo_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	for (;;) {
+		k_sem_take(&tone_echo_start_sem, K_FOREVER);
+		echo_serve();
+		close(echo.fd);
+		echo.fd = -1;
+		k_sem_give(&tone_echo_stopped_sem);
+	}
+}
+
+int tone_stream_echo_start(uint16_t port)
+{
+	struct sockaddr_in local = {
+		.sin_family = AF_INET,
+		.sin_port = htons(port),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	int ret = 0;
+
+	if (port == 0U) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&tone_echo_lock, K_FOREVER);
+
+	if (atomic_get(&echo.running)) {
+		k_mutex_unlock(&tone_echo_lock);
+		return -EALREADY;
+	}
+
+	int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd < 0) {
+		ret = -errno;
+		LOG_ERR("Echo socket() failed: %d", ret);
+		goto out;
+	}
+
+	if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+		ret = -errno;
+		LOG_ERR("Echo bind() failed: %d", ret);
+		close(fd);
+		goto out;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&echo.stats_lock);
+
+	memset(&echo.stats, 0, sizeof(echo.stats));
+	echo.turnaround_sum_us = 0U;
+	echo.have_seq = false;
+	k_spin_unlock(&echo.stats_lock, key);
+
+	echo.fd = fd;
+	echo.port = port;
+	atomic_set(&echo.running, 1);
+
+	if (!echo.thread_started) {
+		k_thread_create(&tone_echo_thread, tone_echo_stack,
+				K_THREAD_STACK_SIZEOF(tone_echo_stack), tone_echo_thread_fn, NULL,
+				NULL, NULL, K_PRIO_PREEMPT(CONFIG_TONE_STREAM_ECHO_PRIORITY), 0,
+				K_NO_WAIT);
+		if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+			k_thread_name_set(&tone_echo_thread, "tone_echo");
+		}
+		echo.thread_started = true;
+	}
+
+	k_sem_give(&tone_echo_start_sem);
+	LOG_INF("Echo reflector on UDP port %u", port);
+
+out:
+	k_mutex_unlock(&tone_echo_lock);
+	return ret;
+}
+
+int tone_stream_echo_stop(void)
+{
+	k_mutex_lock(&tone_echo_lock, K_FOREVER);
+
+	if (!atomic_cas(&echo.running, 1, 0)) {
+		k_mutex_unlock(&tone_echo_lock);
+		return -EALREADY;
+	}
+
+	/* The socket is closed once the thread notices, so the port is free for a restart */
+	k_sem_take(&tone_echo_stopped_sem, K_FOREVER);
+
+	k_mutex_unlock(&tone_echo_lock);
+
+	LOG_INF("Echo reflector stopped");
+	return 0;
+}
+
+int tone_stream_echo_get_stats(struct tone_echo_stats *out)
+{
+	if (!out) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&echo.stats_lock);
+
+	*out = echo.stats;
+	out->turnaround_avg_us =
+		(out->reflected > 0U) ? (uint32_t)(echo.turnaround_sum_us / out->reflected) : 0U;
+
+	k_spin_unlock(&echo.stats_lock, key);
+
+	out->active = atomic_get(&echo.running) != 0;
+	out->port = echo.port;
+
+	return 0;
+}
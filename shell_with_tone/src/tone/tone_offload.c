@@ -0,0 +1,273 @@
+/*
+ * Wi-Fi Audio Tone Test - network core synthesis endpoint
+ */
+
+#include "tone_stream.h"
+#include "tone_stream_internal.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/ipc/ipc_service.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+
+LOG_MODULE_DECLARE(tone_stream, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* Blocks held for the tone workqueue; more are released unsent */
+#define OFFLOAD_QUEUE_BLOCKS (2U * TONE_OFFLOAD_MAX_STREAMS)
+
+/* Left for the pipeline to start up before a measurement window opens */
+#define OFFLOAD_BENCH_SETTLE_MS 1000U
+
+/* A block still in its IPC shared memory buffer, held until it is sent */
+struct tone_offload_rx {
+	const struct tone_offload_block *block;
+	size_t len;
+};
+
+K_MSGQ_DEFINE(tone_offload_msgq, sizeof(struct tone_offload_rx), OFFLOAD_QUEUE_BLOCKS, 4);
+
+/*
+ * Endpoint to the tone_netcore image. The IPC receive callback only holds
+ * each block's buffer and queues it; the tone workqueue sends it from
+ * there, so a slow socket never stalls the IPC backend.
+ */
+static struct {
+	struct ipc_ept ept;
+	struct k_work work;
+	/* Set by a HELLO of the matching protocol version */
+	atomic_t ready;
+	uint16_t max_block_bytes;
+	uint8_t max_streams;
+} offload;
+
+static void offload_hello(const struct tone_offload_hello *hello, size_t len)
+{
+	if (len < sizeof(*hello) || hello->version != TONE_OFFLOAD_VERSION) {
+		LOG_ERR("Network core tone image speaks protocol %u, need %u",
+			(len < sizeof(*hello)) ? 0U : hello->version, TONE_OFFLOAD_VERSION);
+		atomic_set(&offload.ready, 0);
+		return;
+	}
+
+	offload.max_block_bytes = hello->max_block_bytes;
+	offload.max_streams = MIN(hello->max_streams, TONE_MAX_STREAMS);
+	atomic_set(&offload.ready, 1);
+
+	LOG_INF("Network core tone synthesis ready: %u streams, %u byte blocks",
+		offload.max_streams, offload.max_block_bytes);
+}
+
+static void offload_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	struct tone_offload_rx rx;
+
+	while (k_msgq_get(&tone_offload_msgq, &rx, K_NO_WAIT) == 0) {
+		tone_stream_offload_serve(rx.block, rx.len);
+		(void)ipc_service_release_rx_buffer(&offload.ept, (void *)rx.block);
+	}
+}
+
+/*
+ * A block that cannot be held or queued is released unsent; the sequence
+ * gap it leaves counts it as an underrun.
+ */
+static void offload_queue(const struct tone_offload_block *block, size_t len)
+{
+	const struct tone_offload_rx rx = {
+		.block = block,
+		.len = len,
+	};
+
+	if (ipc_service_hold_rx_buffer(&offload.ept, (void *)block) < 0) {
+		return;
+	}
+
+	if (k_msgq_put(&tone_offload_msgq, &rx, K_NO_WAIT) != 0) {
+		(void)ipc_service_release_rx_buffer(&offload.ept, (void *)block);
+		return;
+	}
+
+	tone_stream_work_submit(&offload.work);
+}
+
+static void offload_received(const void *data, size_t len, void *priv)
+{
+	ARG_UNUSED(priv);
+
+	const struct tone_offload_hdr *hdr = data;
+
+	if (len < sizeof(*hdr)) {
+		return;
+	}
+
+	if (hdr->type == TONE_OFFLOAD_MSG_BLOCK && len >= sizeof(struct tone_offload_block)) {
+		offload_queue(data, len);
+	} else if (hdr->type == TONE_OFFLOAD_MSG_HELLO) {
+		offload_hello(data, len);
+	}
+}
+
+void tone_offload_init(void)
+{
+	static const struct ipc_ept_cfg cfg = {
+		.name = TONE_OFFLOAD_EPT_NAME,
+		.cb = {
+			.received = offload_received,
+		},
+	};
+	const struct device *ipc = DEVICE_DT_GET(DT_NODELABEL(ipc0));
+	int ret;
+
+	k_work_init(&offload.work, offload_work_handler);
+
+	ret = ipc_service_open_instance(ipc);
+
+	if (ret < 0 && ret != -EALREADY) {
+		LOG_ERR("Network core IPC not opened: %d", ret);
+		return;
+	}
+
+	ret = ipc_service_register_endpoint(ipc, &offload.ept, &cfg);
+	if (ret < 0) {
+		LOG_ERR("Network core tone endpoint not registered: %d", ret);
+	}
+}
+
+int tone_offload_limits(uint8_t *max_streams, uint16_t *max_block_bytes)
+{
+	if (!atomic_get(&offload.ready)) {
+		return -ENODEV;
+	}
+
+	*max_streams = offload.max_streams;
+	*max_block_bytes = offload.max_block_bytes;
+
+	return 0;
+}
+
+int tone_offload_send(const void *msg, size_t len)
+{
+	int ret = ipc_service_send(&offload.ept, msg, len);
+
+	return (ret < 0) ? ret : 0;
+}
+
+struct offload_bench_result {
+	/* Busy share of the application core in 0.1 %, UINT32_MAX when not measured */
+	uint32_t load_permille;
+	struct tone_stream_stats stats;
+};
+
+static int offload_bench_run(uint8_t id, bool offloaded, uint32_t seconds,
+			     struct offload_bench_result *out)
+{
+	int ret = tone_stream_set_offload(id, offloaded);
+
+	if (ret == 0) {
+		ret = tone_stream_start(id, NULL);
+	}
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_msleep(OFFLOAD_BENCH_SETTLE_MS);
+
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	k_thread_runtime_stats_t before, after;
+
+	(void)k_thread_runtime_stats_all_get(&before);
+#endif
+	(void)tone_stream_reset_stats(id);
+
+	k_sleep(K_SECONDS(seconds));
+
+	(void)tone_stream_get_stats(id, &out->stats);
+#if defined(CONFIG_SCHED_THREAD_USAGE_ALL)
+	(void)k_thread_runtime_stats_all_get(&after);
+
+	uint64_t cycles = after.execution_cycles - before.execution_cycles;
+	uint64_t busy = after.total_cycles - before.total_cycles;
+
+	out->load_permille = (cycles > 0U) ? (uint32_t)(busy * 1000U / cycles) : 0U;
+#else
+	out->load_permille = UINT32_MAX;
+#endif
+
+	return tone_stream_stop(id, NULL);
+}
+
+static void offload_bench_print(const struct shell *shell, const char *mode,
+				const struct offload_bench_result *result)
+{
+	const struct tone_stream_stats *stats = &result->stats;
+	char load[12];
+
+	if (result->load_permille == UINT32_MAX) {
+		strcpy(load, "n/a");
+	} else {
+		snprintk(load, sizeof(load), "%u.%u%%", result->load_permille / 10U,
+			 result->load_permille % 10U);
+	}
+
+	shell_print(shell, "%-9s %8s %7u %9u %7d %7d %7d %6u %8u %8u", mode, load,
+		    stats->packets_sent, stats->tx_underruns, stats->pacing_err_min_us,
+		    stats->pacing_err_avg_us, stats->pacing_err_max_us, stats->late_wakeups,
+		    stats->max_lateness_us, stats->max_send_us);
+}
+
+/*
+ * Stream 0 with its current settings, first synthesized and paced by the
+ * application core, then by the network core, each for seconds after the
+ * pipeline settled. No other stream may run, so the load is the stream's.
+ */
+int tone_stream_bench_offload(const struct shell *shell, uint32_t seconds)
+{
+	const uint8_t id = TONE_DEFAULT_STREAM_ID;
+	struct offload_bench_result local, remote;
+	struct tone_stream_settings settings;
+	int ret;
+
+	if (!shell || seconds == 0U) {
+		return -EINVAL;
+	}
+
+	for (uint8_t i = 0; i < TONE_MAX_STREAMS; i++) {
+		if (tone_stream_is_active(i)) {
+			return -EBUSY;
+		}
+	}
+
+	(void)tone_stream_get_settings(id, &settings);
+
+	shell_print(shell, "Stream %u: %u Hz, %u ms packets, %u s per run after %u ms settling", id,
+		    settings.sample_rate_hz, settings.packet_duration_ms, seconds,
+		    OFFLOAD_BENCH_SETTLE_MS);
+
+	ret = offload_bench_run(id, false, seconds, &local);
+	if (ret == 0) {
+		ret = offload_bench_run(id, true, seconds, &remote);
+	}
+
+	/* Leave the stream as it was configured */
+	(void)tone_stream_set_offload(id, settings.offload != 0U);
+	if (ret < 0) {
+		return ret;
+	}
+
+	shell_print(shell, "Pacing error, lateness and send time in us");
+	shell_print(shell, "Synthesis App load    Sent Underruns Err min Err avg Err max   Late "
+			   "Max late Max send");
+	offload_bench_print(shell, "app core", &local);
+	offload_bench_print(shell, "net core", &remote);
+	shell_print(shell, "Network core pacing error includes the IPC latency; its underruns "
+			   "are blocks skipped for want of an IPC buffer");
+
+	return 0;
+}
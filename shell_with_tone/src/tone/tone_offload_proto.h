@@ -0,0 +1,89 @@
+/*
+ * Wi-Fi Audio Tone Test - application/network core synthesis protocol
+ *
+ * Shared by the application image and the tone_netcore image. Messages
+ * travel over one ipc_service endpoint; both cores are little-endian, so
+ * fields are in native byte order.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TONE_OFFLOAD_EPT_NAME "tone"
+#define TONE_OFFLOAD_VERSION  1U
+
+/* Streams the network core synthesizes at once */
+#define TONE_OFFLOAD_MAX_STREAMS  4U
+#define TONE_OFFLOAD_MAX_CHANNELS 8U
+/*
+ * Largest PCM block; with the message header it has to fit one IPC
+ * buffer, which both images size through the zephyr,buffer-size property.
+ */
+#define TONE_OFFLOAD_MAX_BLOCK_BYTES 1920U
+
+enum tone_offload_msg_type {
+	/* Network core to application core, once the endpoint is bound */
+	TONE_OFFLOAD_MSG_HELLO,
+	/* Application core to network core: (re)start at sample 0 */
+	TONE_OFFLOAD_MSG_START,
+	/* Application core to network core: new parameters from the next block */
+	TONE_OFFLOAD_MSG_UPDATE,
+	TONE_OFFLOAD_MSG_STOP,
+	/* Network core to application core: one packet's PCM, at its deadline */
+	TONE_OFFLOAD_MSG_BLOCK,
+};
+
+struct tone_offload_hdr {
+	uint8_t type;
+	uint8_t stream_id;
+	uint16_t reserved;
+} __packed;
+
+struct tone_offload_hello {
+	struct tone_offload_hdr hdr;
+	uint16_t version;
+	uint16_t max_block_bytes;
+	uint8_t max_streams;
+	uint8_t reserved[3];
+} __packed;
+
+/* START and UPDATE; the PCM layout matches the application's sine synthesis */
+struct tone_offload_params {
+	struct tone_offload_hdr hdr;
+	uint32_t sample_rate_hz;
+	/* Frames per block, i.e. samples per channel */
+	uint32_t frames;
+	uint16_t frequency_hz;
+	uint8_t amplitude_pct;
+	uint8_t channels;
+	/* Channel n leads channel 0 by n * channel_phase_deg */
+	uint16_t channel_phase_deg;
+	/* Bytes per sample: 2, 3 (packed) or 4, little-endian, left-justified */
+	uint8_t sample_bytes;
+	uint8_t reserved;
+} __packed;
+
+struct tone_offload_stop {
+	struct tone_offload_hdr hdr;
+} __packed;
+
+struct tone_offload_block {
+	struct tone_offload_hdr hdr;
+	/* Block number and frames before it since START, both wrapping */
+	uint32_t seq;
+	uint32_t sample_count;
+	uint32_t sample_rate_hz;
+	uint16_t frames;
+	uint8_t channels;
+	uint8_t sample_bytes;
+	uint8_t pcm[];
+} __packed;
+
+#ifdef __cplusplus
+}
+#endif
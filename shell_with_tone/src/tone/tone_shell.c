@@ -4,11 +4,13 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/init.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/net/net_if.h>
+#include <zephyr/net/net_ip.h>
 #include <zephyr/net/wifi_mgmt.h>
 #include <zephyr/shell/shell.h>
 
@@ -16,10 +18,42 @@
 
 LOG_MODULE_REGISTER(tone_shell, CONFIG_LOG_DEFAULT_LEVEL);
 
+static int parse_stream_id(const struct shell *shell, const char *arg, uint8_t *id)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+
+	if (*end != '\0' || value < 0 || value >= TONE_MAX_STREAMS) {
+		shell_error(shell, "Invalid stream id: %s (0-%u)", arg, TONE_MAX_STREAMS - 1U);
+		return -EINVAL;
+	}
+
+	*id = (uint8_t)value;
+	return 0;
+}
+
+static bool offloaded(uint8_t id)
+{
+	struct tone_stream_settings settings;
+
+	return tone_stream_get_settings(id, &settings) == 0 && settings.offload != 0U;
+}
+
 static int cmd_tone_start(const struct shell *shell, size_t argc, char **argv)
 {
+	uint8_t id = TONE_DEFAULT_STREAM_ID;
 	int ret = 0;
 
+	/* tone start [<id>] [<ip> <port>] */
+	if (argc == 2 || argc == 4) {
+		ret = parse_stream_id(shell, argv[1], &id);
+		if (ret) {
+			return ret;
+		}
+		argv++;
+		argc--;
+	}
+
 	/* If IP and port are provided, set the target first */
 	if (argc == 3) {
 		char *end;
@@ -29,24 +63,37 @@ static int cmd_tone_start(const struct shell *shell, size_t argc, char **argv)
 			return -EINVAL;
 		}
 
-		ret = tone_stream_set_target(argv[1], (uint16_t)port);
-		if (ret) {
-			shell_error(shell, "Invalid IPv4 address or port");
+		ret = tone_stream_set_target(id, argv[1], (uint16_t)port);
+		if (ret == -EAFNOSUPPORT) {
+			shell_error(shell, "IPv6 destinations need CONFIG_NET_IPV6");
+			return ret;
+		} else if (ret) {
+			shell_error(shell, "Invalid IP address or port");
 			return ret;
 		}
-		shell_print(shell, "Tone target set to %s:%ld", argv[1], port);
+		shell_print(shell, "Tone stream %u target set to %s:%ld", id, argv[1], port);
 	} else if (argc != 1) {
-		shell_error(shell, "Usage: tone start [<ipv4> <port>]");
+		shell_error(shell, "Usage: tone start [<id>] [<ip> <port>]");
 		return -EINVAL;
 	}
 
-	ret = tone_stream_start(shell);
+	ret = tone_stream_start(id, shell);
 	if (ret == -EALREADY) {
-		shell_warn(shell, "Tone already streaming");
+		shell_warn(shell, "Tone stream %u already streaming", id);
 	} else if (ret == -ENOTCONN) {
-		shell_error(shell, "Destination not set. Use 'tone start <ip> <port>'");
+		shell_error(shell, "Destination not set. Use 'tone start [<id>] <ip> <port>'");
+	} else if (ret == -ENODATA) {
+		shell_error(shell,
+			    "Raw TX not configured. Use 'raw_tx configure' and 'raw_tx mode 1'");
 	} else if (ret == -ERANGE) {
 		shell_error(shell, "Packet configuration invalid. Adjust tone config");
+	} else if (ret == -ENOMEM) {
+		shell_error(shell, "No free PCM ring. Stop another stream first");
+	} else if (ret == -ENODEV) {
+		shell_error(shell, "Network core tone image not running. Set offload=off");
+	} else if (ret == -ENOTSUP && offloaded(id)) {
+		shell_error(shell, "Network core synthesis takes sine PCM, burst=1, no FEC, "
+				   "adaptive sizing, TWT or link reports");
 	} else if (ret) {
 		shell_error(shell, "Failed to start tone: %d", ret);
 	}
@@ -55,34 +102,497 @@ static int cmd_tone_start(const struct shell *shell, size_t argc, char **argv)
 }
 
 static int cmd_tone_stop(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t id;
+
+	if (argc == 1) {
+		tone_stream_stop_all(shell);
+		return 0;
+	} else if (argc != 2) {
+		shell_error(shell, "Usage: tone stop [<id>]");
+		return -EINVAL;
+	}
+
+	int ret = parse_stream_id(shell, argv[1], &id);
+	if (ret) {
+		return ret;
+	}
+
+	return tone_stream_stop(id, shell);
+}
+
+static int cmd_tone_save(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t id = TONE_DEFAULT_STREAM_ID;
+	bool autostart = false;
+	size_t arg = 1;
+
+	if (arg < argc && strcmp(argv[arg], "auto") != 0) {
+		int ret = parse_stream_id(shell, argv[arg], &id);
+		if (ret) {
+			return ret;
+		}
+		arg++;
+	}
+
+	if (arg < argc && strcmp(argv[arg], "auto") == 0) {
+		autostart = true;
+		arg++;
+	}
+
+	if (arg != argc) {
+		shell_error(shell, "Usage: tone save [<id>] [auto]");
+		return -EINVAL;
+	}
+
+	int ret = tone_stream_save(id, autostart);
+
+	if (ret == -ENOTSUP && autostart) {
+		shell_error(shell, "Auto-start needs CONFIG_TONE_STREAM_AUTOSTART");
+	} else if (ret == -ENOTSUP) {
+		shell_error(shell, "Saving needs CONFIG_TONE_STREAM_PERSIST");
+	} else if (ret == -ENOTCONN) {
+		shell_error(shell, "Destination not set. Use 'tone start [<id>] <ip> <port>'");
+	} else if (ret) {
+		shell_error(shell, "Failed to save tone stream %u: %d", id, ret);
+	} else {
+		shell_print(shell, "Tone stream %u settings saved%s", id,
+			    autostart ? ", auto-start on DHCP lease" : "");
+	}
+
+	return ret;
+}
+
+static int cmd_tone_erase(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t id = TONE_DEFAULT_STREAM_ID;
+
+	if (argc > 2) {
+		shell_error(shell, "Usage: tone erase [<id>]");
+		return -EINVAL;
+	}
+
+	if (argc == 2) {
+		int ret = parse_stream_id(shell, argv[1], &id);
+		if (ret) {
+			return ret;
+		}
+	}
+
+	int ret = tone_stream_erase(id);
+
+	if (ret == -ENOTSUP) {
+		shell_error(shell, "Saving needs CONFIG_TONE_STREAM_PERSIST");
+	} else if (ret) {
+		shell_error(shell, "Failed to erase tone stream %u: %d", id, ret);
+	} else {
+		shell_print(shell, "Tone stream %u stored settings erased", id);
+	}
+
+	return ret;
+}
+
+static int cmd_tone_status(const struct shell *shell, size_t argc, char **argv)
 {
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-	tone_stream_stop(shell);
+	tone_stream_status(shell);
 	return 0;
 }
 
-static int cmd_tone_status(const struct shell *shell, size_t argc, char **argv)
+static void print_histogram(const struct shell *shell, const char *title, const uint32_t *hist)
+{
+	shell_print(shell, "  %s:", title);
+	for (uint32_t i = 0; i < TONE_STATS_HIST_BUCKETS; i++) {
+		if (hist[i] == 0U) {
+			continue;
+		}
+
+		uint32_t low = (i == 0U) ? 0U : BIT(i);
+
+		if (i == TONE_STATS_HIST_BUCKETS - 1U) {
+			shell_print(shell, "    >= %6u us: %u", low, hist[i]);
+		} else {
+			shell_print(shell, "    %6u-%6u us: %u", low, BIT(i + 1U) - 1U, hist[i]);
+		}
+	}
+}
+
+static int cmd_tone_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	uint8_t id = TONE_DEFAULT_STREAM_ID;
+	int ret;
+
+	/* tone stats [<id>] [reset] */
+	if (argc >= 2 && strcmp(argv[1], "reset") != 0) {
+		ret = parse_stream_id(shell, argv[1], &id);
+		if (ret) {
+			return ret;
+		}
+		argv++;
+		argc--;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+		(void)tone_stream_reset_stats(id);
+		shell_print(shell, "Tone stream %u stats reset", id);
+		return 0;
+	} else if (argc != 1) {
+		shell_error(shell, "Usage: tone stats [<id>] [reset]");
+		return -EINVAL;
+	}
+
+	struct tone_stream_stats stats;
+
+	ret = tone_stream_get_stats(id, &stats);
+	if (ret) {
+		shell_error(shell, "Failed to read stats: %d", ret);
+		return ret;
+	}
+
+	shell_print(shell, "Tone stream %u stats over %llu ms:", id, stats.elapsed_us / 1000U);
+	shell_print(shell, "  Packets sent: %u", stats.packets_sent);
+	shell_print(shell, "  Packet rate: %u.%03u/s achieved, %u.%03u/s configured",
+		    stats.achieved_mpps / 1000U, stats.achieved_mpps % 1000U,
+		    stats.configured_mpps / 1000U, stats.configured_mpps % 1000U);
+	shell_print(shell, "  Send errors: ENOMEM %u, EAGAIN %u, other %u (consecutive %u)",
+		    stats.send_err_nomem, stats.send_err_again, stats.send_err_other,
+		    stats.consecutive_send_failures);
+	shell_print(shell, "  Synthesis alloc failures: %u, TX underruns: %u",
+		    stats.synth_alloc_failures, stats.tx_underruns);
+	shell_print(shell, "  Late wakeups: %u of %u (max lateness %u us)", stats.late_wakeups,
+		    stats.wakeups, stats.max_lateness_us);
+	if (stats.pacing_err_count > 0U) {
+		shell_print(shell, "  Pacing error: min %d avg %d max %d us",
+			    stats.pacing_err_min_us, stats.pacing_err_avg_us,
+			    stats.pacing_err_max_us);
+	}
+	shell_print(shell, "  Max send duration: %u us", stats.max_send_us);
+
+	uint32_t payload_permille =
+		(stats.pcm_bytes > 0U) ? (uint32_t)((stats.payload_bytes * 1000U) / stats.pcm_bytes)
+				       : 0U;
+
+	shell_print(shell, "  Payload: %llu of %llu PCM bytes (%u.%u%%), codec fallbacks %u",
+		    stats.payload_bytes, stats.pcm_bytes, payload_permille / 10U,
+		    payload_permille % 10U, stats.codec_fallbacks);
+	shell_print(shell, "  Synthesis: avg %u max %u us over %u packets", stats.synth_avg_us,
+		    stats.max_synth_us, stats.packets_built);
+	if (stats.adapt_packet_ms != 0U) {
+		shell_print(shell, "  Adaptive packets: %u ms, %u changes", stats.adapt_packet_ms,
+			    stats.adaptations);
+	}
+	if (stats.twt_packets != 0U) {
+		shell_print(shell, "  TWT hold: avg %u max %u us over %u packets",
+			    stats.twt_hold_avg_us, stats.twt_hold_max_us, stats.twt_packets);
+	}
+	if (stats.fec_packets != 0U) {
+		uint32_t fec_permille =
+			(stats.payload_bytes > 0U)
+				? (uint32_t)((stats.fec_bytes * 1000U) / stats.payload_bytes)
+				: 0U;
+
+		shell_print(shell, "  FEC: %u parity packets, %u.%u%% of payload bytes",
+			    stats.fec_packets, fec_permille / 10U, fec_permille % 10U);
+	}
+	if (stats.link_packets != 0U) {
+		shell_print(shell, "  Link reports: %u", stats.link_packets);
+	}
+	for (int q = 0; q < TONE_QOS_COUNT; q++) {
+		const struct tone_ac_stats *ac = &stats.ac[q];
+
+		if (ac->sends == 0U) {
+			continue;
+		}
+
+		shell_print(shell, "  AC %s: %u sends, send avg %u us, p99 <= %u us, max %u us",
+			    tone_stream_qos_name(q), ac->sends, ac->avg_us, ac->p99_us, ac->max_us);
+	}
+	print_histogram(shell, "Send duration", stats.send_hist);
+	print_histogram(shell, "Deadline lateness", stats.lateness_hist);
+
+	return 0;
+}
+
+/* tone bench offload [<s>]: application core against network core synthesis */
+static int cmd_tone_bench_offload(const struct shell *shell, size_t argc, char **argv)
+{
+	long seconds = 10;
+
+	if (argc > 3) {
+		shell_error(shell, "Usage: tone bench offload [<seconds>]");
+		return -EINVAL;
+	} else if (argc == 3) {
+		char *end;
+
+		seconds = strtol(argv[2], &end, 10);
+		if (*end != '\0' || seconds <= 0 || seconds > 300) {
+			shell_error(shell, "Run length 1-300 s");
+			return -EINVAL;
+		}
+	}
+
+	int ret = tone_stream_bench_offload(shell, (uint32_t)seconds);
+
+	if (ret == -EBUSY) {
+		shell_error(shell, "Stop all streams before benchmarking");
+	} else if (ret == -ENOTSUP) {
+		shell_error(shell, "Offload benchmark needs CONFIG_TONE_STREAM_OFFLOAD and stream 0 "
+				   "settings the network core can synthesize");
+	} else if (ret == -ENODEV) {
+		shell_error(shell, "Network core tone image not running");
+	} else if (ret == -ENOTCONN) {
+		shell_error(shell, "Set a destination for stream 0 first");
+	} else if (ret) {
+		shell_error(shell, "Benchmark failed: %d", ret);
+	}
+
+	return ret;
+}
+
+static int cmd_tone_bench(const struct shell *shell, size_t argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "offload") == 0) {
+		return cmd_tone_bench_offload(shell, argc, argv);
+	} else if (argc != 1) {
+		shell_error(shell, "Usage: tone bench [offload [<seconds>]]");
+		return -EINVAL;
+	}
+
+	int ret = tone_stream_bench(shell);
+
+	if (ret == -EBUSY) {
+		shell_error(shell, "Stop all streams before benchmarking");
+	} else if (ret == -ENOTSUP) {
+		shell_error(shell, "Benchmark needs CONFIG_TONE_STREAM_BENCH and a DWT cycle counter");
+	} else if (ret) {
+		shell_error(shell, "Benchmark failed: %d", ret);
+	}
+
+	return ret;
+}
+
+static int cmd_tone_mem(const struct shell *shell, size_t argc, char **argv)
 {
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
 
-	tone_stream_status(shell);
+	return tone_stream_mem(shell);
+}
+
+static int cmd_tone_link(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	int ret = tone_stream_link(shell);
+
+	if (ret == -ENOTSUP) {
+		shell_error(shell, "Link telemetry needs CONFIG_TONE_STREAM_LINK");
+	}
+
+	return ret;
+}
+
+static int cmd_tone_echo(const struct shell *shell, size_t argc, char **argv)
+{
+	int ret;
+
+	/* tone echo [<port>|stop] */
+	if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+		ret = tone_stream_echo_stop();
+		if (ret == -EALREADY) {
+			shell_warn(shell, "Echo not running");
+		} else if (ret == -ENOTSUP) {
+			shell_error(shell, "Echo needs CONFIG_TONE_STREAM_ECHO");
+		} else if (ret == 0) {
+			shell_print(shell, "Echo stopped");
+		}
+		return ret;
+	} else if (argc == 2) {
+		char *end;
+		long port = strtol(argv[1], &end, 10);
+
+		if (*end != '\0' || port <= 0 || port > UINT16_MAX) {
+			shell_error(shell, "Invalid port: %s", argv[1]);
+			return -EINVAL;
+		}
+
+		ret = tone_stream_echo_start((uint16_t)port);
+		if (ret == -EALREADY) {
+			shell_warn(shell, "Echo already running. Use 'tone echo stop' first");
+		} else if (ret == -ENOTSUP) {
+			shell_error(shell, "Echo needs CONFIG_TONE_STREAM_ECHO");
+		} else if (ret) {
+			shell_error(shell, "Failed to start echo: %d", ret);
+		} else {
+			shell_print(shell, "Echoing tone datagrams on UDP port %ld", port);
+		}
+		return ret;
+	} else if (argc != 1) {
+		shell_error(shell, "Usage: tone echo [<port>|stop]");
+		return -EINVAL;
+	}
+
+	struct tone_echo_stats stats;
+
+	ret = tone_stream_echo_get_stats(&stats);
+	if (ret) {
+		shell_error(shell, "Failed to read echo stats: %d", ret);
+		return ret;
+	}
+
+	shell_print(shell, "Echo: %s, UDP port %u", stats.active ? "running" : "stopped",
+		    stats.port);
+	shell_print(shell, "  Received: %u, reflected %u, dropped %u, malformed %u",
+		    stats.received, stats.reflected, stats.dropped, stats.malformed);
+	shell_print(shell, "  Forward path: %u lost, %u reordered", stats.forward_lost,
+		    stats.reordered);
+	shell_print(shell, "  Turnaround: avg %u max %u us", stats.turnaround_avg_us,
+		    stats.turnaround_max_us);
+
 	return 0;
 }
 
+static int parse_sample_format(long bits, enum tone_sample_format *format)
+{
+	for (int f = 0; f < TONE_SAMPLE_FORMAT_COUNT; f++) {
+		if (tone_stream_sample_bits(f) == bits) {
+			*format = f;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int parse_codec(const char *name, enum tone_codec *codec)
+{
+	for (int c = 0; c < TONE_CODEC_COUNT; c++) {
+		if (strcmp(tone_stream_codec_name(c), name) == 0) {
+			*codec = c;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int parse_transport(const char *name, enum tone_transport *transport)
+{
+	for (int t = 0; t < TONE_TRANSPORT_COUNT; t++) {
+		if (strcmp(tone_stream_transport_name(t), name) == 0) {
+			*transport = t;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static int parse_waveform(const char *name, enum tone_waveform *waveform)
+{
+	for (int w = 0; w < TONE_WAVE_COUNT; w++) {
+		if (strcmp(tone_stream_waveform_name(w), name) == 0) {
+			*waveform = w;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+/* <Hz>[:<pct>][,<Hz>[:<pct>]...], each amplitude 100% unless given */
+static int parse_tones(const char *value, uint8_t *count, uint16_t *freq_hz, uint8_t *pct)
+{
+	const char *p = value;
+
+	*count = 0U;
+	while (*p != '\0') {
+		char *end;
+		unsigned long hz = strtoul(p, &end, 10);
+		unsigned long amp = 100U;
+
+		if (end == p || hz == 0U || hz > UINT16_MAX || *count == TONE_MAX_TONES) {
+			return -EINVAL;
+		}
+
+		if (*end == ':') {
+			p = end + 1;
+			amp = strtoul(p, &end, 10);
+			if (end == p || amp > 100U) {
+				return -EINVAL;
+			}
+		}
+
+		if (*end != ',' && *end != '\0') {
+			return -EINVAL;
+		}
+
+		freq_hz[*count] = (uint16_t)hz;
+		pct[*count] = (uint8_t)amp;
+		(*count)++;
+		p = (*end == ',') ? end + 1 : end;
+	}
+
+	return (*count > 0U) ? 0 : -EINVAL;
+}
+
+static int parse_qos(const char *name, enum tone_qos *qos)
+{
+	for (int q = 0; q < TONE_QOS_COUNT; q++) {
+		if (strcmp(tone_stream_qos_name(q), name) == 0) {
+			*qos = q;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
 static int cmd_tone_config(const struct shell *shell, size_t argc, char **argv)
 {
 	if (argc < 2) {
-		shell_print(shell, "Params: freq=<Hz> amp=<0-100> rate=<Hz> packet=<ms>");
+		shell_print(shell,
+			    "Params: id=<0-%u> freq=<Hz> amp=<0-100> rate=<Hz> packet=<ms> "
+			    "burst=<1-%u> ch=<1-%u> bits=<16|24|32> phase=<0-359> "
+			    "codec=<pcm|adpcm|rice> pmin=<ms> pmax=<ms> twt=<on|off> qos=<be|bk|vi|vo> "
+			    "link=<on|off> offload=<on|off> fec=<0-%u> fecdepth=<1-%u> "
+			    "transport=<udp|raw> da=<mac> "
+			    "wave=<sine|sweep|logsweep|multi|square|triangle|pink> fend=<Hz> "
+			    "sweep=<ms> tones=<Hz>[:<pct>],...",
+			    TONE_MAX_STREAMS - 1U, TONE_MAX_BURST_PACKETS, TONE_MAX_CHANNELS,
+			    TONE_FEC_MAX_GROUP, TONE_FEC_MAX_DEPTH);
 		return 0;
 	}
 
-	uint16_t freq = TONE_DEFAULT_FREQUENCY_HZ;
-	uint8_t amp = TONE_DEFAULT_AMPLITUDE_PCT;
-	uint32_t rate = TONE_DEFAULT_SAMPLE_RATE_HZ;
-	uint16_t packet = TONE_DEFAULT_PACKET_DURATION_MS;
+	uint8_t id = TONE_DEFAULT_STREAM_ID;
+	/* Keys left out fall back to their defaults; the destination is kept */
+	struct tone_stream_settings config = {
+		.sample_rate_hz = TONE_DEFAULT_SAMPLE_RATE_HZ,
+		.packet_duration_ms = TONE_DEFAULT_PACKET_DURATION_MS,
+		.frequency_hz = TONE_DEFAULT_FREQUENCY_HZ,
+		.amplitude_pct = TONE_DEFAULT_AMPLITUDE_PCT,
+		.burst_packets = TONE_DEFAULT_BURST_PACKETS,
+		.channels = TONE_DEFAULT_CHANNELS,
+		.sample_format = TONE_DEFAULT_SAMPLE_FORMAT,
+		.channel_phase_deg = TONE_DEFAULT_CHANNEL_PHASE_DEG,
+		.codec = TONE_DEFAULT_CODEC,
+		.qos = TONE_DEFAULT_QOS,
+		.fec_group = TONE_DEFAULT_FEC_GROUP,
+		.fec_depth = TONE_DEFAULT_FEC_DEPTH,
+		.transport = TONE_DEFAULT_TRANSPORT,
+		.dest_mac = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+		.waveform = TONE_DEFAULT_WAVEFORM,
+		.sweep_end_hz = TONE_DEFAULT_SWEEP_END_HZ,
+		.sweep_ms = TONE_DEFAULT_SWEEP_MS,
+	};
+	enum tone_sample_format format;
+	enum tone_codec codec;
+	enum tone_qos qos;
+	enum tone_transport transport;
+	enum tone_waveform waveform;
 
 	for (size_t i = 1; i < argc; i++) {
 		char *pair = argv[i];
@@ -97,52 +607,279 @@ static int cmd_tone_config(const struct shell *shell, size_t argc, char **argv)
 		const char *value = eq + 1;
 
 		long parsed = strtol(value, NULL, 10);
-		if (strcmp(key, "freq") == 0) {
+		if (strcmp(key, "id") == 0) {
+			if (parse_stream_id(shell, value, &id)) {
+				return -EINVAL;
+			}
+		} else if (strcmp(key, "freq") == 0) {
 			if (parsed <= 0 || parsed > 20000) {
 				shell_error(shell, "Frequency out of range");
 				return -EINVAL;
 			}
-			freq = (uint16_t)parsed;
+			config.frequency_hz = (uint16_t)parsed;
 		} else if (strcmp(key, "amp") == 0) {
 			if (parsed < 0 || parsed > 100) {
 				shell_error(shell, "Amplitude 0-100");
 				return -EINVAL;
 			}
-			amp = (uint8_t)parsed;
+			config.amplitude_pct = (uint8_t)parsed;
 		} else if (strcmp(key, "rate") == 0) {
 			if (parsed <= 0 || parsed > 192000) {
 				shell_error(shell, "Sample rate out of range");
 				return -EINVAL;
 			}
-			rate = (uint32_t)parsed;
+			config.sample_rate_hz = (uint32_t)parsed;
 		} else if (strcmp(key, "packet") == 0) {
 			if (parsed <= 0 || parsed > 1000) {
 				shell_error(shell, "Packet duration out of range");
 				return -EINVAL;
 			}
-			packet = (uint16_t)parsed;
+			config.packet_duration_ms = (uint16_t)parsed;
+		} else if (strcmp(key, "burst") == 0) {
+			if (parsed <= 0 || parsed > TONE_MAX_BURST_PACKETS) {
+				shell_error(shell, "Burst 1-%u packets", TONE_MAX_BURST_PACKETS);
+				return -EINVAL;
+			}
+			config.burst_packets = (uint8_t)parsed;
+		} else if (strcmp(key, "ch") == 0) {
+			if (parsed <= 0 || parsed > TONE_MAX_CHANNELS) {
+				shell_error(shell, "Channels 1-%u", TONE_MAX_CHANNELS);
+				return -EINVAL;
+			}
+			config.channels = (uint8_t)parsed;
+		} else if (strcmp(key, "bits") == 0) {
+			if (parse_sample_format(parsed, &format)) {
+				shell_error(shell, "Sample bits 16, 24 or 32");
+				return -EINVAL;
+			}
+			config.sample_format = format;
+		} else if (strcmp(key, "phase") == 0) {
+			if (parsed < 0 || parsed >= 360) {
+				shell_error(shell, "Channel phase step 0-359 degrees");
+				return -EINVAL;
+			}
+			config.channel_phase_deg = (uint16_t)parsed;
+		} else if (strcmp(key, "codec") == 0) {
+			if (parse_codec(value, &codec)) {
+				shell_error(shell, "Codec pcm, adpcm or rice");
+				return -EINVAL;
+			}
+			config.codec = codec;
+		} else if (strcmp(key, "pmin") == 0) {
+			if (parsed <= 0 || parsed > 1000) {
+				shell_error(shell, "Adaptive packet bound out of range");
+				return -EINVAL;
+			}
+			config.adapt_min_ms = (uint16_t)parsed;
+		} else if (strcmp(key, "pmax") == 0) {
+			if (parsed <= 0 || parsed > 1000) {
+				shell_error(shell, "Adaptive packet bound out of range");
+				return -EINVAL;
+			}
+			config.adapt_max_ms = (uint16_t)parsed;
+		} else if (strcmp(key, "twt") == 0) {
+			if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) {
+				shell_error(shell, "TWT alignment on or off");
+				return -EINVAL;
+			}
+			config.twt_align = (strcmp(value, "on") == 0) ? 1U : 0U;
+		} else if (strcmp(key, "link") == 0) {
+			if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) {
+				shell_error(shell, "Link reports on or off");
+				return -EINVAL;
+			}
+			config.link_report = (strcmp(value, "on") == 0) ? 1U : 0U;
+		} else if (strcmp(key, "offload") == 0) {
+			if (strcmp(value, "on") != 0 && strcmp(value, "off") != 0) {
+				shell_error(shell, "Network core synthesis on or off");
+				return -EINVAL;
+			}
+			config.offload = (strcmp(value, "on") == 0) ? 1U : 0U;
+		} else if (strcmp(key, "qos") == 0) {
+			if (parse_qos(value, &qos)) {
+				shell_error(shell, "QoS be, bk, vi or vo");
+				return -EINVAL;
+			}
+			config.qos = qos;
+		} else if (strcmp(key, "fec") == 0) {
+			if (parsed < 0 || parsed > TONE_FEC_MAX_GROUP) {
+				shell_error(shell, "FEC group 0-%u packets", TONE_FEC_MAX_GROUP);
+				return -EINVAL;
+			}
+			config.fec_group = (uint8_t)parsed;
+		} else if (strcmp(key, "fecdepth") == 0) {
+			if (parsed <= 0 || parsed > TONE_FEC_MAX_DEPTH) {
+				shell_error(shell, "FEC depth 1-%u", TONE_FEC_MAX_DEPTH);
+				return -EINVAL;
+			}
+			config.fec_depth = (uint8_t)parsed;
+		} else if (strcmp(key, "transport") == 0) {
+			if (parse_transport(value, &transport)) {
+				shell_error(shell, "Transport udp or raw");
+				return -EINVAL;
+			}
+			config.transport = transport;
+		} else if (strcmp(key, "wave") == 0) {
+			if (parse_waveform(value, &waveform)) {
+				shell_error(shell,
+					    "Waveform sine, sweep, logsweep, multi, square, triangle or pink");
+				return -EINVAL;
+			}
+			config.waveform = waveform;
+		} else if (strcmp(key, "fend") == 0) {
+			if (parsed <= 0 || parsed > 20000) {
+				shell_error(shell, "Sweep end frequency out of range");
+				return -EINVAL;
+			}
+			config.sweep_end_hz = (uint16_t)parsed;
+		} else if (strcmp(key, "sweep") == 0) {
+			if (parsed <= 0 || parsed > 3600000) {
+				shell_error(shell, "Sweep duration 1-3600000 ms");
+				return -EINVAL;
+			}
+			config.sweep_ms = (uint32_t)parsed;
+		} else if (strcmp(key, "tones") == 0) {
+			if (parse_tones(value, &config.tone_count, config.tone_hz,
+					config.tone_pct)) {
+				shell_error(shell, "Up to %u tones as <Hz>[:<pct>],...", TONE_MAX_TONES);
+				return -EINVAL;
+			}
+		} else if (strcmp(key, "da") == 0) {
+			if (strlen(value) != 17 ||
+			    net_bytes_from_str(config.dest_mac, sizeof(config.dest_mac),
+					       value) < 0) {
+				shell_error(shell, "Receiver address as xx:xx:xx:xx:xx:xx");
+				return -EINVAL;
+			}
 		} else {
 			shell_error(shell, "Unknown key: %s", key);
 			return -EINVAL;
 		}
 	}
 
-	int ret = tone_stream_set_params(freq, amp, rate, packet);
-	if (ret) {
+	if ((config.adapt_min_ms == 0U) != (config.adapt_max_ms == 0U) ||
+	    config.adapt_min_ms > config.adapt_max_ms) {
+		shell_error(shell, "Adaptive packets need pmin <= pmax, both in ms");
+		return -EINVAL;
+	}
+
+	if (config.twt_align && !IS_ENABLED(CONFIG_TONE_STREAM_TWT)) {
+		shell_error(shell, "twt=on needs CONFIG_TONE_STREAM_TWT");
+		return -ENOTSUP;
+	}
+
+	if (config.link_report && !IS_ENABLED(CONFIG_TONE_STREAM_LINK)) {
+		shell_error(shell, "link=on needs CONFIG_TONE_STREAM_LINK");
+		return -ENOTSUP;
+	}
+
+	if (config.offload && !IS_ENABLED(CONFIG_TONE_STREAM_OFFLOAD)) {
+		shell_error(shell, "offload=on needs CONFIG_TONE_STREAM_OFFLOAD");
+		return -ENOTSUP;
+	}
+
+	if (config.fec_group != 0U && !IS_ENABLED(CONFIG_TONE_STREAM_FEC)) {
+		shell_error(shell, "fec needs CONFIG_TONE_STREAM_FEC");
+		return -ENOTSUP;
+	}
+
+	if (config.transport == TONE_TRANSPORT_RAW && !IS_ENABLED(CONFIG_TONE_STREAM_RAW_TX)) {
+		shell_error(shell, "transport=raw needs CONFIG_TONE_STREAM_RAW_TX");
+		return -ENOTSUP;
+	}
+
+	if (config.waveform != TONE_WAVE_SINE && !IS_ENABLED(CONFIG_TONE_STREAM_WAVEFORMS)) {
+		shell_error(shell, "wave=%s needs CONFIG_TONE_STREAM_WAVEFORMS",
+			    tone_stream_waveform_name(config.waveform));
+		return -ENOTSUP;
+	}
+
+	if (config.waveform == TONE_WAVE_MULTITONE && config.tone_count == 0U) {
+		shell_error(shell, "wave=multi needs tones=<Hz>[:<pct>],...");
+		return -EINVAL;
+	}
+
+	int ret = tone_stream_set_config(id, &config);
+
+	if (ret == -ERANGE && config.transport == TONE_TRANSPORT_RAW) {
+		shell_error(shell, "Out of range: tone above Nyquist, packet over %u samples or "
+				   "frame over CONFIG_NRF70_TX_MAX_DATA_SIZE",
+			    TONE_MAX_SAMPLES_PER_PACKET);
+	} else if (ret == -ERANGE && config.fec_group != 0U) {
+		shell_error(shell, "Out of range: tone above Nyquist, packet over %u samples or "
+				   "datagram over CONFIG_TONE_STREAM_FEC_MAX_BYTES",
+			    TONE_MAX_SAMPLES_PER_PACKET);
+	} else if (ret == -ERANGE) {
+		shell_error(shell, "Out of range: tone above Nyquist or packet over %u samples",
+			    TONE_MAX_SAMPLES_PER_PACKET);
+	} else if (ret == -ENOTSUP) {
+		shell_error(shell, "Codec %s needs bits=16 and CONFIG_TONE_STREAM_CODEC",
+			    tone_stream_codec_name(config.codec));
+	} else if (ret) {
 		shell_error(shell, "Failed to apply params: %d", ret);
 	} else {
-		shell_print(shell, "Tone params set: %u Hz, %u%%, %u Hz sample, %u ms packet", freq,
-			    amp, rate, packet);
+		shell_print(shell,
+			    "Tone stream %u params set: %u Hz, %u%%, %u Hz sample, %u ms packet, "
+			    "burst %u, %u ch %u-bit %s, QoS %s",
+			    id, config.frequency_hz, config.amplitude_pct, config.sample_rate_hz,
+			    config.packet_duration_ms, config.burst_packets, config.channels,
+			    tone_stream_sample_bits(config.sample_format),
+			    tone_stream_codec_name(config.codec), tone_stream_qos_name(config.qos));
+		if (config.adapt_max_ms != 0U) {
+			shell_print(shell, "Adaptive packet duration %u-%u ms", config.adapt_min_ms,
+				    config.adapt_max_ms);
+		}
+		if (config.twt_align) {
+			shell_print(shell, "Bursts aligned to TWT service periods");
+		}
+		if (config.link_report) {
+			shell_print(shell, "Link telemetry reported in-band");
+		}
+		if (config.offload) {
+			shell_print(shell, "Network core synthesis from next start");
+		}
+		if (config.fec_group != 0U) {
+			shell_print(shell, "FEC: 1 parity per %u packets, depth %u",
+				    config.fec_group, config.fec_depth);
+		}
+		if (config.waveform == TONE_WAVE_SWEEP_LIN ||
+		    config.waveform == TONE_WAVE_SWEEP_LOG) {
+			shell_print(shell, "Waveform %s %u-%u Hz over %u ms",
+				    tone_stream_waveform_name(config.waveform), config.frequency_hz,
+				    config.sweep_end_hz, config.sweep_ms);
+		} else if (config.waveform != TONE_WAVE_SINE) {
+			shell_print(shell, "Waveform %s",
+				    tone_stream_waveform_name(config.waveform));
+		}
+		if (config.transport == TONE_TRANSPORT_RAW) {
+			const uint8_t *da = config.dest_mac;
+
+			shell_print(shell,
+				    "Raw 802.11 frames to %02x:%02x:%02x:%02x:%02x:%02x from next start",
+				    da[0], da[1], da[2], da[3], da[4], da[5]);
+		}
 	}
 
 	return ret;
 }
 
 SHELL_STATIC_SUBCMD_SET_CREATE(
-	tone_cmds, SHELL_CMD(start, NULL, "Start tone streaming [<ipv4> <port>]", cmd_tone_start),
-	SHELL_CMD(stop, NULL, "Stop tone streaming", cmd_tone_stop),
+	tone_cmds,
+	SHELL_CMD(start, NULL, "Start tone streaming [<id>] [<ip> <port>]", cmd_tone_start),
+	SHELL_CMD(stop, NULL, "Stop one tone stream or all [<id>]", cmd_tone_stop),
 	SHELL_CMD(status, NULL, "Display tone status", cmd_tone_status),
+	SHELL_CMD(stats, NULL, "Display stream statistics [<id>] [reset]", cmd_tone_stats),
 	SHELL_CMD(config, NULL, "Configure tone parameters", cmd_tone_config),
+	SHELL_CMD(save, NULL, "Store stream settings, optionally auto-started [<id>] [auto]",
+		  cmd_tone_save),
+	SHELL_CMD(erase, NULL, "Remove stored stream settings [<id>]", cmd_tone_erase),
+	SHELL_CMD(echo, NULL, "Reflect tone datagrams [<port>|stop]", cmd_tone_echo),
+	SHELL_CMD(bench, NULL,
+		  "Time the synthesis kernels in CPU cycles, or compare network core "
+		  "synthesis [offload [<s>]]",
+		  cmd_tone_bench),
+	SHELL_CMD(mem, NULL, "Show PCM pool, buffer and stack usage", cmd_tone_mem),
+	SHELL_CMD(link, NULL, "Show Wi-Fi link telemetry samples", cmd_tone_link),
 	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(tone, &tone_cmds, "Tone streaming control", NULL);
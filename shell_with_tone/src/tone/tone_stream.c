@@ -3,478 +3,5319 @@
  */
 
 #include "tone_stream.h"
+#include "tone_codec.h"
+#include "tone_stream_internal.h"
 
 #include <errno.h>
 #include <math.h>
 #include <string.h>
-#include <tone.h>
 
+#include <arm_math.h>
+
+#include <zephyr/drivers/counter.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/net/net_if.h>
 #include <zephyr/net/net_ip.h>
 #include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/printk.h>
 #include <zephyr/sys/util.h>
 
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+#include <zephyr/net/net_context.h>
+#include <zephyr/net/net_core.h>
+#include <zephyr/net/net_pkt.h>
+
+#include "ipv4.h"
+#include "ipv6.h"
+#include "udp_internal.h"
+#endif
+
+#if defined(CONFIG_TONE_STREAM_TWT) || defined(CONFIG_TONE_STREAM_AUTOSTART) ||                   \
+	defined(CONFIG_TONE_STREAM_LINK)
+#include <zephyr/net/net_mgmt.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_TWT) || defined(CONFIG_TONE_STREAM_LINK)
+#include <zephyr/net/wifi_mgmt.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_LINK)
+#include <zephyr/net/net_stats.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_AUTOSTART)
+#include <zephyr/net/net_event.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_TRACING)
+#include <zephyr/tracing/tracing.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+#include <stdlib.h>
+
+#include <zephyr/settings/settings.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_BENCH)
+#include <zephyr/arch/arm/cortex_m/dwt.h>
+#endif
+
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+#include <zephyr/net/ethernet.h>
+
+#include "wifi_raw_tx_pkt.h"
+#endif
+
 LOG_MODULE_REGISTER(tone_stream, CONFIG_LOG_DEFAULT_LEVEL);
 
-#define LUT_POINTS 1024U
+/*
+ * Pipeline markers for the tracing backend, e.g. SystemView or CTF. Every
+ * event carries the stream id first; where a stage has an _enter and an
+ * _exit event, the pair brackets the stage on the capture's timeline.
+ */
+#if defined(CONFIG_TONE_STREAM_TRACING)
+#define TONE_TRACE(event, id, arg) sys_trace_named_event("tone_" event, (id), (arg))
+#else
+#define TONE_TRACE(event, id, arg) do { } while (false)
+#endif
+
+/* Quarter-wave sine table resolution; must be a power of two */
+#define LUT_POINTS     1024U
+#define LUT_INDEX_BITS 10U
+
+BUILD_ASSERT(BIT(LUT_INDEX_BITS) == LUT_POINTS, "LUT_POINTS must be 2^LUT_INDEX_BITS");
+
+/*
+ * The oscillator phase is an unsigned 32-bit turn (2^32 == 2*pi), which is
+ * the Q31 phase used by CMSIS-DSP extended by the wrap-around bit. The top
+ * two bits select the quadrant, the next LUT_INDEX_BITS index the quarter
+ * wave table and the remainder is the interpolation fraction.
+ */
+#define NCO_QUADRANT_SHIFT    30U
+#define NCO_INDEX_SHIFT       (NCO_QUADRANT_SHIFT - LUT_INDEX_BITS)
+#define NCO_FRAC_MASK         (BIT(NCO_INDEX_SHIFT) - 1U)
+#define NCO_FRAC_TO_Q15_SHIFT (NCO_INDEX_SHIFT - 15U)
+
+/* Samples interpolated per CMSIS-DSP vector call */
+#define NCO_BLOCK_SAMPLES 64U
+
+/* Ring of packets synthesized ahead of their deadline */
+#define TX_RING_SLOTS CONFIG_TONE_STREAM_TX_RING_PACKETS
+#define TX_RING_MASK  (TX_RING_SLOTS - 1U)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(TX_RING_SLOTS), "TX ring size must be a power of two");
+BUILD_ASSERT(TX_RING_SLOTS >= CONFIG_TONE_STREAM_MAX_BURST, "TX ring must hold a full burst");
+
+/* Retry delay when the TX stage finds no synthesized packet ready */
+#define TX_UNDERRUN_RETRY_US 200U
+
+/* Back-pressure free windows in a row before adaptive sizing shrinks packets */
+#define ADAPT_SHRINK_WINDOWS 4U
 
 K_THREAD_STACK_DEFINE(tone_stream_work_stack, CONFIG_TONE_STREAM_WORKQUEUE_STACK_SIZE);
 static struct k_work_q tone_stream_work_q;
 static bool tone_stream_work_q_started;
 
-struct tone_packet_header {
-	uint32_t seq;
-	uint32_t sample_count;
-	uint32_t timestamp_us;
+#if defined(CONFIG_TONE_STREAM_PACING_COUNTER)
+#define PACING_ALARM_CHANNEL 0U
+
+static const struct device *const pacing_counter = DEVICE_DT_GET(DT_ALIAS(tone_pacing_timer));
+
+K_SEM_DEFINE(tone_pacing_sem, 0, 1);
+K_THREAD_STACK_DEFINE(tone_pacing_stack, CONFIG_TONE_STREAM_WORKQUEUE_STACK_SIZE);
+static struct k_thread tone_pacing_thread;
+static bool tone_pacing_thread_started;
+
+/* Software extension of the hardware counter to 64 bits */
+static uint64_t pacing_epoch_ticks;
+static uint32_t pacing_last_ticks;
+#endif
+
+/*
+ * Versioned extension following the base header whenever the payload is not
+ * fixed-size mono 16-bit PCM, so legacy streams stay byte-identical on the
+ * wire. Receivers recognize it by magic, version and length. Versions 2 and
+ * 3 assigned the codec and adaptation epoch bytes, which version 1 left
+ * reserved as zero.
+ */
+#define TONE_HDR_EXT_MAGIC   0x5445U
+#define TONE_HDR_EXT_VERSION 3U
+
+struct tone_packet_header_ext {
+	uint16_t magic;
+	uint8_t version;
+	/* Extension length in bytes, including magic */
+	uint8_t length;
+	uint8_t channels;
+	uint8_t bits_per_sample;
+	/* enum tone_codec of this packet's payload */
+	uint8_t codec;
+	/* Bumped by every adaptive packet size change */
+	uint8_t adapt_epoch;
+} __packed;
+
+/*
+ * Parity packets carry this extension instead, with the base header
+ * holding the sequence number of the first data packet they cover. Their
+ * payload is the XOR of the covered datagrams, tone header included with a
+ * zero timestamp, each zero-padded to the longest of them.
+ */
+#define TONE_FEC_EXT_MAGIC   0x5446U
+#define TONE_FEC_EXT_VERSION 1U
+
+struct tone_fec_header_ext {
+	uint16_t magic;
+	uint8_t version;
+	/* Extension length in bytes, including magic */
+	uint8_t length;
+	/* Data packets covered, stride sequence numbers apart */
+	uint8_t group_packets;
+	uint8_t stride;
+	/* XOR of the covered datagram lengths */
+	uint16_t length_xor;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct tone_fec_header_ext) == sizeof(struct tone_packet_header_ext),
+	     "Parity and data extensions share the prefix");
+
+/*
+ * Link reports carry their own extension, with the base header holding the
+ * sequence number and sample count of the data packet that follows. The
+ * payload is a struct tone_link_report describing the data packets since
+ * the last report.
+ */
+#define TONE_LINK_EXT_MAGIC   0x544CU
+#define TONE_LINK_EXT_VERSION 2U
+
+struct tone_link_header_ext {
+	uint16_t magic;
+	uint8_t version;
+	/* Extension length in bytes, including magic */
+	uint8_t length;
+	uint8_t stream_id;
+	uint8_t reserved;
+	/* Sampling period of the link telemetry */
+	uint16_t period_ms;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct tone_link_header_ext) == sizeof(struct tone_packet_header_ext),
+	     "Link reports share the data packet prefix layout");
+
+/* Big-endian on the wire; counters are deltas since the previous sample */
+struct tone_link_report {
+	uint32_t uptime_ms;
+	/* The stream's data packets [first_seq, end_seq) went out in between */
+	uint32_t first_seq;
+	uint32_t end_seq;
+	uint32_t tx_packets;
+	uint32_t phy_rate_kbps;
+	uint16_t tx_errors;
+	uint16_t tx_overruns;
+	uint16_t beacons_missed;
+	int8_t rssi_dbm;
+	/* TONE_LINK_CONNECTED */
+	uint8_t flags;
+} __packed;
+
+#define TONE_LINK_CONNECTED BIT(0)
+
+/* Header bytes as they go on the wire, with the extension when present */
+struct tone_packet_prefix {
+	struct tone_packet_header header;
+	union {
+		struct tone_packet_header_ext ext;
+		struct tone_fec_header_ext fec;
+		struct tone_link_header_ext link;
+	};
+} __packed;
+
+struct tone_nco {
+	uint32_t phase;
+	uint32_t phase_inc;
+	q15_t amplitude_q15;
+};
+
+#if defined(CONFIG_TONE_STREAM_WAVEFORMS)
+/* One channel of the non-sine generators */
+struct tone_wave_channel {
+	uint32_t phase;
+	/* Triangle integrator, in full scale units */
+	float tri;
+	/* Pink noise filter sections and their white noise source */
+	float pink[3];
+	uint32_t rng;
+	struct tone_nco tones[TONE_MAX_TONES];
+};
+
+/*
+ * Generators run per packet from their own state, so memory stays bounded
+ * by the channel count whatever the sweep length.
+ */
+struct tone_wave {
+	enum tone_waveform waveform;
+	/* Sweep position and length in frames, phase steps at both ends */
+	uint32_t pos;
+	uint32_t length;
+	float inc_start;
+	float inc_end;
+	uint32_t phase_inc;
+	float amplitude;
+	uint8_t tone_count;
+	uint8_t ch_count;
+	struct tone_wave_channel ch[TONE_MAX_CHANNELS];
+};
+#endif
+
+/* Widens one channel of oscillator output into every stride-th wire sample */
+typedef void (*pcm_store_fn)(uint8_t *dst, const q15_t *src, uint32_t count, uint32_t stride);
+
+/* Renders frames of every channel, interleaved in the wire format, into dst */
+typedef void (*synth_kernel_fn)(struct tone_nco *nco, uint32_t channels,
+				enum tone_sample_format format, uint8_t *dst, uint32_t frames);
+
+/* One packet handed from the synthesis stage to the TX stage */
+struct tone_tx_slot {
+	struct tone_packet_prefix prefix;
+	uint8_t prefix_len;
+	uint16_t frame_bytes;
+	/* Frames, i.e. samples per channel; 0 for parity and link reports */
+	uint32_t samples;
+	/* Payload bytes after the prefix, PCM or encoded */
+	uint32_t payload_len;
+	uint32_t sample_rate_hz;
+	/* Access category, enum tone_qos */
+	uint8_t qos;
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	struct net_pkt *pkt;
+#else
+	uint8_t *pcm;
+#endif
+};
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+#define FEC_MAX_BYTES CONFIG_TONE_STREAM_FEC_MAX_BYTES
+
+/* Parity being accumulated for one interleaved group */
+struct tone_fec_lane {
+	uint32_t base_seq;
+	uint16_t length_xor;
+	/* Longest datagram so far; parity beyond it is not yet cleared */
+	uint16_t max_len;
+	uint8_t packets;
+	uint8_t parity[FEC_MAX_BYTES] __aligned(4);
+};
+#endif
+
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+/* IEEE 802 local experimental EtherType marking raw tone frames */
+#define RAW_TONE_ETHERTYPE 0x88B5U
+
+/*
+ * 802.11 data frame header (little-endian fields) and LLC/SNAP ahead of a
+ * raw tone datagram. Neither DS bit is set, so address 3 is the BSSID,
+ * which the sender fills with its own address like the raw_tx beacon.
+ */
+struct tone_raw_frame_header {
+	uint16_t frame_control;
+	uint16_t duration;
+	uint8_t da[6];
+	uint8_t sa[6];
+	uint8_t bssid[6];
+	uint16_t seq_ctrl;
+	uint8_t llc_snap[6];
+	uint16_t ethertype;
 } __packed;
 
-/* Buffer for one period of tone (max for 100Hz at 48kHz = 480 samples) */
-#define TONE_PERIOD_MAX_SAMPLES 480
+/* Raw transport state of a stream, set up at stream start */
+struct tone_raw_tx {
+	struct sockaddr_ll addr;
+	struct raw_tx_pkt_header tx_header;
+	struct tone_raw_frame_header frame;
+	uint16_t seq;
+};
+#endif
 
+/* One tone stream: destination, settings and its own synthesis/TX pipeline */
 struct tone_stream_context {
-	struct tone_stream_settings settings;
+	uint8_t id;
+	/*
+	 * Settings are double buffered behind a sequence count. Writers are
+	 * serialized by engine.lock; the data path only ever reads a snapshot.
+	 */
+	struct tone_stream_settings settings_buf[2];
+	atomic_t settings_seq;
+	atomic_t streaming;
 	int sock_fd;
-	bool streaming;
-	uint32_t seq_num;
-	uint32_t sample_counter;
-	uint16_t samples_per_packet;
+	/* Address family and access category the socket options are set for */
+	sa_family_t sock_family;
+	uint8_t sock_qos;
+	/* Transport sock_fd was opened for */
+	uint8_t sock_transport;
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+	struct tone_raw_tx raw;
+#endif
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	struct net_context *net_ctx;
+#endif
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+	/* A record is stored; it holds the settings published as saved_seq */
+	bool stored;
+	bool autostart;
+	atomic_val_t saved_seq;
+#endif
+#if defined(CONFIG_TONE_STREAM_LINK)
+	/* Set by every link sample for the synthesis stage to report it */
+	atomic_t link_pending;
+	/* Sequence number past the last data packet the TX stage handed on */
+	atomic_t link_seq;
+#endif
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	/*
+	 * Synthesized and paced by the network core, set while the stream is
+	 * stopped; the rest is TX stage state, only with engine.tx_lock held.
+	 */
+	struct {
+		bool active;
+		/* Settings the network core was last given */
+		atomic_val_t settings_seq;
+		/* Block number and sample count the next block should carry */
+		uint32_t next_seq;
+		uint32_t next_samples;
+	} offload;
+#endif
+
+	/* Synthesis stage state, only touched from engine.synth_work */
+	struct {
+		atomic_val_t settings_seq;
+		uint32_t seq_num;
+		uint32_t sample_counter;
+		uint32_t samples_per_packet;
+		uint32_t sample_rate_hz;
+		uint32_t burst_packets;
+		uint32_t pcm_write;
+		uint32_t channels;
+		uint32_t sample_bytes;
+		uint16_t adapt_min_ms;
+		uint16_t adapt_max_ms;
+		enum tone_sample_format format;
+		synth_kernel_fn kernel;
+		struct tone_packet_header_ext ext;
+		struct tone_nco nco[TONE_MAX_CHANNELS];
+#if defined(CONFIG_TONE_STREAM_WAVEFORMS)
+		struct tone_wave wave;
+#endif
+#if defined(CONFIG_TONE_STREAM_CODEC)
+		enum tone_codec codec;
+		struct tone_adpcm_state adpcm[TONE_MAX_CHANNELS];
+#endif
+#if defined(CONFIG_TONE_STREAM_FEC)
+		struct {
+			uint8_t group;
+			uint8_t depth;
+			/* Lane the next data packet joins */
+			uint8_t lane;
+			/* Lane whose parity waits for a ring slot, plus one; 0 when none */
+			uint8_t pending;
+			struct tone_fec_lane lanes[TONE_FEC_MAX_DEPTH];
+		} fec;
+#endif
+	} synth;
+
+	/* SPSC ring, head written by synthesis and tail by TX */
+	atomic_t ring_head;
+	atomic_t ring_tail;
+	struct tone_tx_slot tx_ring[TX_RING_SLOTS];
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	/*
+	 * PCM for the packets in tx_ring, each contiguous so one iovec covers
+	 * it. A block of tone_pcm_slab while streaming, NULL otherwise.
+	 */
+	uint8_t *pcm_ring;
+	/* Most ring bytes held by queued packets since the stream started */
+	uint32_t pcm_peak;
+#endif
+
+	/* TX stage state, only touched with engine.tx_lock held */
+	uint32_t tx_rate_hz;
 	uint32_t interval_us;
 	uint64_t next_deadline_us;
+	uint64_t deadline_base_us;
+	uint64_t deadline_samples;
 	uint32_t consecutive_send_failures;
-	int16_t tone_period[TONE_PERIOD_MAX_SAMPLES];
-	size_t tone_period_samples;
-	uint32_t tone_position;
-	struct k_work_delayable work;
+	/* Next TX wakeup the scheduler owes this stream, 0 when none */
+	uint64_t wakeup_us;
+	/* Packet size interval_us was derived from */
+	uint32_t interval_samples;
+	/* Wakeups wait for TWT service periods, from settings.twt_align */
+	bool twt_aligned;
+
+	/* Adaptive packet sizing, TX stage; bounds are 0 while disabled */
+	struct {
+		uint16_t min_ms;
+		uint16_t max_ms;
+		uint16_t packet_ms;
+		uint16_t window_packets;
+		uint8_t clean_windows;
+		uint8_t epoch;
+		bool congested;
+	} adapt;
+	/* Duration the TX stage asks synthesis for: epoch << 16 | ms, 0 when fixed */
+	atomic_t adapt_target;
+
+	/* Hot-path statistics; derived fields are filled in on snapshot */
+	struct k_spinlock stats_lock;
+	struct tone_stream_stats stats;
+	int64_t pacing_err_sum_us;
+	uint64_t synth_us_sum;
+	uint64_t twt_hold_sum_us;
+	uint64_t ac_send_sum_us[TONE_QOS_COUNT];
+	uint32_t ac_send_hist[TONE_QOS_COUNT][TONE_STATS_HIST_BUCKETS];
+	uint64_t stats_start_us;
+	uint64_t stats_last_us;
+};
+
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+#define PCM_RING_BYTES CONFIG_TONE_STREAM_PCM_RING_BYTES
+
+/* Streams only hold a ring while they run, so fewer rings than streams may do */
+K_MEM_SLAB_DEFINE_STATIC(tone_pcm_slab, PCM_RING_BYTES, CONFIG_TONE_STREAM_PCM_RINGS, 4);
+
+BUILD_ASSERT(PCM_RING_BYTES % 4U == 0U, "PCM ring blocks must stay word aligned");
+BUILD_ASSERT(CONFIG_TONE_STREAM_PCM_RING_BYTES >= TONE_MAX_SAMPLES_PER_PACKET * sizeof(int16_t),
+	     "PCM ring must hold the largest 16-bit packet");
+#if defined(CONFIG_TONE_STREAM_FEC)
+BUILD_ASSERT(CONFIG_TONE_STREAM_PCM_RING_BYTES >= FEC_MAX_BYTES,
+	     "PCM ring must hold the largest parity packet");
+#endif
+#endif
+
+static struct tone_stream_context streams[TONE_MAX_STREAMS];
+
+/* State shared by all streams */
+static struct {
+	/* Control path: settings writers, start and stop */
 	struct k_mutex lock;
-} static ctx;
+	/* Held by the TX stage while it serves streams */
+	struct k_mutex tx_lock;
+	/* One synthesis pass refills every active stream */
+	struct k_work synth_work;
+#if defined(CONFIG_TONE_STREAM_PACING_WORKQUEUE)
+	/* One delayable work paces all streams, earliest deadline first */
+	struct k_work_delayable work;
+#endif
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	/* Most tone_pcm_slab blocks held at once since boot */
+	uint32_t pcm_rings_peak;
+#endif
+	/* Uptime in ms when each boot milestone was first reached, 0 before */
+	struct {
+		uint32_t lease_ms;
+		uint32_t autostart_ms;
+		/* Written once by the TX stage */
+		uint32_t first_packet_ms;
+	} boot;
+} engine;
+
+#if defined(CONFIG_TONE_STREAM_TWT)
+/*
+ * The TWT agreement as reported by Wi-Fi management events. Service periods
+ * are predicted every interval_us from the last awake transition, so
+ * nothing is aligned until the driver reports the first one.
+ */
+static struct {
+	struct net_mgmt_event_callback cb;
+	bool cb_added;
+	/* Set by the event handler for the TX stage to release held streams */
+	atomic_t kick;
+	struct k_spinlock lock;
+	bool agreed;
+	bool awake;
+	uint8_t flow_id;
+	uint32_t wake_us;
+	uint64_t interval_us;
+	/* Start of the current or last service period, 0 before the first */
+	uint64_t sp_start_us;
+	/* Radio duty cycle since the agreement */
+	uint64_t since_us;
+	uint64_t awake_sum_us;
+	uint32_t service_periods;
+} twt;
+#endif
+
+#if defined(CONFIG_TONE_STREAM_LINK)
+#define LINK_SAMPLES CONFIG_TONE_STREAM_LINK_SAMPLES
+
+/* The Wi-Fi link over one sampling period; counters are deltas */
+struct tone_link_sample {
+	uint32_t uptime_ms;
+	/* Streams in active sent data packets [end_seq - packets, end_seq) in the period */
+	uint32_t end_seq[TONE_MAX_STREAMS];
+	uint16_t packets[TONE_MAX_STREAMS];
+	uint32_t tx_packets;
+	uint32_t phy_rate_kbps;
+	uint16_t tx_errors;
+	uint16_t tx_overruns;
+	uint16_t beacons_missed;
+	int8_t rssi_dbm;
+	bool connected;
+	uint8_t active;
+};
+
+BUILD_ASSERT(TONE_MAX_STREAMS <= 8U, "Link samples keep one active bit per stream");
+
+/*
+ * Link telemetry, sampled from the system workqueue while any stream runs:
+ * the Wi-Fi driver answers status requests synchronously and must not
+ * hold up the tone workqueue.
+ */
+static struct {
+	struct k_work_delayable work;
+	struct k_spinlock lock;
+	/* Samples taken since boot; the newest is ring[(taken - 1) % LINK_SAMPLES] */
+	uint32_t taken;
+	struct tone_link_sample ring[LINK_SAMPLES];
+	/* Streams sampled last time and where they were; a start clears its bit */
+	uint8_t last_active;
+	uint32_t last_seq[TONE_MAX_STREAMS];
+	/* Driver counters at the previous sample, only touched from link.work */
+	bool have_last;
+	struct net_stats_wifi last;
+} link;
+#endif
+
+/* First quadrant of sin(), LUT_POINTS + 1 entries so mirrored lookups stay in range */
+static q15_t sine_lut[LUT_POINTS + 1U];
+
+#if defined(CONFIG_TONE_STREAM_PACING_COUNTER)
+/*
+ * The pacing counter is also the stream time base so deadlines, timestamps
+ * and pacing error share its resolution. It is read at least once per packet
+ * while streaming, well within one counter wrap.
+ */
+static uint64_t pacing_now_ticks(void)
+{
+	uint32_t ticks;
+	unsigned int key = irq_lock();
+
+	(void)counter_get_value(pacing_counter, &ticks);
+	if (ticks < pacing_last_ticks) {
+		pacing_epoch_ticks += (uint64_t)counter_get_top_value(pacing_counter) + 1U;
+	}
+	pacing_last_ticks = ticks;
+
+	uint64_t now = pacing_epoch_ticks + ticks;
+
+	irq_unlock(key);
+
+	return now;
+}
+
+static inline uint64_t micros_now(void)
+{
+	const uint32_t freq = counter_get_frequency(pacing_counter);
+	uint64_t ticks = pacing_now_ticks();
+
+	return (ticks / freq) * USEC_PER_SEC + ((ticks % freq) * USEC_PER_SEC) / freq;
+}
+
+static uint64_t pacing_us_to_ticks(uint64_t us)
+{
+	const uint32_t freq = counter_get_frequency(pacing_counter);
+
+	return (us / USEC_PER_SEC) * freq + ((us % USEC_PER_SEC) * freq) / USEC_PER_SEC;
+}
+
+static void pacing_alarm_handler(const struct device *dev, uint8_t chan, uint32_t ticks,
+				 void *user_data)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+	ARG_UNUSED(ticks);
+	ARG_UNUSED(user_data);
+
+	k_sem_give(&tone_pacing_sem);
+}
+
+static void pacing_arm(uint64_t deadline_us, uint32_t delay_us)
+{
+	ARG_UNUSED(delay_us);
+
+	struct counter_alarm_cfg alarm = {
+		.callback = pacing_alarm_handler,
+		.ticks = (uint32_t)(pacing_us_to_ticks(deadline_us) %
+				    ((uint64_t)counter_get_top_value(pacing_counter) + 1U)),
+		.flags = COUNTER_ALARM_CFG_ABSOLUTE | COUNTER_ALARM_CFG_EXPIRE_WHEN_LATE,
+	};
+
+	/* A kick for another stream may have woken us with the alarm still set */
+	(void)counter_cancel_channel_alarm(pacing_counter, PACING_ALARM_CHANNEL);
+
+	int ret = counter_set_channel_alarm(pacing_counter, PACING_ALARM_CHANNEL, &alarm);
+	if (ret < 0 && ret != -ETIME) {
+		LOG_ERR("counter_set_channel_alarm() failed: %d", ret);
+		k_sem_give(&tone_pacing_sem);
+	}
+}
+
+static void pacing_kick(void)
+{
+	k_sem_give(&tone_pacing_sem);
+}
+
+static void pacing_cancel(void)
+{
+	(void)counter_cancel_channel_alarm(pacing_counter, PACING_ALARM_CHANNEL);
+	k_sem_reset(&tone_pacing_sem);
+}
+#else
+static inline uint64_t micros_now(void)
+{
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static void pacing_arm(uint64_t deadline_us, uint32_t delay_us)
+{
+	ARG_UNUSED(deadline_us);
+
+	k_work_reschedule_for_queue(&tone_stream_work_q, &engine.work, K_USEC(delay_us));
+}
+
+static void pacing_kick(void)
+{
+	k_work_reschedule_for_queue(&tone_stream_work_q, &engine.work, K_NO_WAIT);
+}
+
+static void pacing_cancel(void)
+{
+	k_work_cancel_delayable(&engine.work);
+}
+#endif /* CONFIG_TONE_STREAM_PACING_COUNTER */
+
+uint64_t tone_stream_micros(void)
+{
+	return micros_now();
+}
+
+void tone_stream_work_submit(struct k_work *work)
+{
+	k_work_submit_to_queue(&tone_stream_work_q, work);
+}
+
+static struct tone_stream_context *stream_get(uint8_t id)
+{
+	return (id < ARRAY_SIZE(streams)) ? &streams[id] : NULL;
+}
+
+/* Synthesized and paced by the network core, so neither local stage serves it */
+static inline bool stream_offloaded(const struct tone_stream_context *stream)
+{
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	return stream->offload.active;
+#else
+	ARG_UNUSED(stream);
+	return false;
+#endif
+}
+
+static atomic_val_t settings_snapshot(struct tone_stream_context *stream,
+				      struct tone_stream_settings *out)
+{
+	atomic_val_t seq;
+
+	do {
+		seq = atomic_get(&stream->settings_seq);
+		*out = stream->settings_buf[seq & 1];
+		barrier_dmem_fence_full();
+	} while (seq != atomic_get(&stream->settings_seq));
+
+	return seq;
+}
+
+/* Caller holds engine.lock, which serializes writers */
+static void settings_publish_locked(struct tone_stream_context *stream,
+				    const struct tone_stream_settings *settings)
+{
+	atomic_val_t seq = atomic_get(&stream->settings_seq);
+
+	stream->settings_buf[(seq + 1) & 1] = *settings;
+	atomic_inc(&stream->settings_seq);
+}
+
+static uint32_t samples_for_ms(const struct tone_stream_settings *settings, uint32_t ms)
+{
+	return DIV_ROUND_CLOSEST(settings->sample_rate_hz * ms, 1000U);
+}
+
+static uint32_t samples_for(const struct tone_stream_settings *settings)
+{
+	return samples_for_ms(settings, settings->packet_duration_ms);
+}
+
+static void store_s16(uint8_t *dst, const q15_t *src, uint32_t count, uint32_t stride)
+{
+	for (uint32_t i = 0; i < count; i++, dst += stride) {
+		sys_put_le16((uint16_t)src[i], dst);
+	}
+}
+
+/* Wider formats carry the oscillator output left-justified */
+static void store_s24(uint8_t *dst, const q15_t *src, uint32_t count, uint32_t stride)
+{
+	for (uint32_t i = 0; i < count; i++, dst += stride) {
+		sys_put_le24((uint32_t)(int32_t)src[i] << 8, dst);
+	}
+}
+
+static void store_s32(uint8_t *dst, const q15_t *src, uint32_t count, uint32_t stride)
+{
+	for (uint32_t i = 0; i < count; i++, dst += stride) {
+		sys_put_le32((uint32_t)(int32_t)src[i] << 16, dst);
+	}
+}
+
+static const struct {
+	uint8_t bytes;
+	uint8_t bits;
+	pcm_store_fn store;
+} sample_layouts[TONE_SAMPLE_FORMAT_COUNT] = {
+	[TONE_SAMPLE_S16] = {2U, 16U, store_s16},
+	[TONE_SAMPLE_S24] = {3U, 24U, store_s24},
+	[TONE_SAMPLE_S32] = {4U, 32U, store_s32},
+};
+
+static uint32_t frame_bytes_for(const struct tone_stream_settings *settings)
+{
+	return settings->channels * sample_layouts[settings->sample_format].bytes;
+}
+
+static const char *const waveform_names[TONE_WAVE_COUNT] = {
+	[TONE_WAVE_SINE] = "sine",
+	[TONE_WAVE_SWEEP_LIN] = "sweep",
+	[TONE_WAVE_SWEEP_LOG] = "logsweep",
+	[TONE_WAVE_MULTITONE] = "multi",
+	[TONE_WAVE_SQUARE] = "square",
+	[TONE_WAVE_TRIANGLE] = "triangle",
+	[TONE_WAVE_PINK_NOISE] = "pink",
+};
+
+static const char *const codec_names[TONE_CODEC_COUNT] = {
+	[TONE_CODEC_PCM] = "pcm",
+	[TONE_CODEC_IMA_ADPCM] = "adpcm",
+	[TONE_CODEC_RICE] = "rice",
+};
+
+/*
+ * DSCP and network stack priority per access category. The nRF70 derives
+ * the 802.11 user priority from the three DSCP precedence bits, so voice
+ * needs CS6: EF (46) would map to user priority 5 and land in AC_VI.
+ */
+static const struct {
+	const char *name;
+	uint8_t dscp;
+	uint8_t priority;
+} qos_classes[TONE_QOS_COUNT] = {
+	[TONE_QOS_BE] = {"be", 0U, NET_PRIORITY_BE},
+	[TONE_QOS_BK] = {"bk", 8U, NET_PRIORITY_BK},
+	[TONE_QOS_VI] = {"vi", 32U, NET_PRIORITY_VI},
+	[TONE_QOS_VO] = {"vo", 48U, NET_PRIORITY_VO},
+};
+
+static const char *const transport_names[TONE_TRANSPORT_COUNT] = {
+	[TONE_TRANSPORT_UDP] = "udp",
+	[TONE_TRANSPORT_RAW] = "raw",
+};
+
+/* Socket address of the destination in its own family, returning its length */
+static socklen_t dest_sockaddr(const struct tone_stream_settings *settings,
+			       struct sockaddr_storage *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+
+	if (settings->dest_family == AF_INET6) {
+		struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)addr;
+
+		sin6->sin6_family = AF_INET6;
+		sin6->sin6_port = htons(settings->dest_port);
+		sin6->sin6_addr = settings->dest_ipv6;
+		return sizeof(*sin6);
+	}
+
+	struct sockaddr_in *sin = (struct sockaddr_in *)addr;
+
+	sin->sin_family = AF_INET;
+	sin->sin_port = htons(settings->dest_port);
+	sin->sin_addr = settings->dest_ipv4;
+	return sizeof(*sin);
+}
+
+static bool dest_is_multicast(const struct tone_stream_settings *settings)
+{
+	return (settings->dest_family == AF_INET6) ? net_ipv6_is_addr_mcast(&settings->dest_ipv6)
+						   : net_ipv4_is_addr_mcast(&settings->dest_ipv4);
+}
+
+/* Payload bytes reserved for a packet: its PCM, or the codec bound when larger */
+static uint32_t payload_capacity(enum tone_codec codec, uint32_t frames, uint32_t channels,
+				 uint32_t frame_bytes)
+{
+	const uint32_t pcm_len = frames * frame_bytes;
+
+#if defined(CONFIG_TONE_STREAM_CODEC)
+	if (codec != TONE_CODEC_PCM) {
+		return MAX(pcm_len, (uint32_t)tone_codec_max_len(codec, frames, channels));
+	}
+#else
+	ARG_UNUSED(codec);
+	ARG_UNUSED(channels);
+#endif
+
+	return pcm_len;
+}
+
+/* Every frequency the waveform plays has to stay below Nyquist */
+static bool waveform_fits(const struct tone_stream_settings *settings)
+{
+	const uint32_t nyquist = settings->sample_rate_hz / 2U;
+
+	switch (settings->waveform) {
+	case TONE_WAVE_SWEEP_LIN:
+	case TONE_WAVE_SWEEP_LOG:
+		return settings->sweep_end_hz < nyquist;
+	case TONE_WAVE_MULTITONE:
+		for (uint32_t t = 0; t < settings->tone_count; t++) {
+			if (settings->tone_hz[t] >= nyquist) {
+				return false;
+			}
+		}
+		return settings->tone_count > 0U;
+	default:
+		return true;
+	}
+}
+
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+/*
+ * Frames never straddle fragments, so each fragment may leave one frame
+ * unused. The fragment count assumes the larger IPv6 header when enabled.
+ */
+static size_t pkt_alloc_len(size_t len, uint32_t frame_bytes)
+{
+#if defined(CONFIG_NET_BUF_FIXED_DATA_SIZE)
+	const size_t ip_hdr_len = IS_ENABLED(CONFIG_NET_IPV6) ? NET_IPV6H_LEN : NET_IPV4H_LEN;
+	size_t frags = DIV_ROUND_UP(len + ip_hdr_len + NET_UDPH_LEN, CONFIG_NET_BUF_DATA_SIZE);
+#else
+	size_t frags = 1U;
+#endif
+
+	return len + (frags + 1U) * frame_bytes;
+}
+
+/* Interface datagrams to the destination leave through, NULL without a route */
+static struct net_if *datagram_iface(const struct tone_stream_settings *settings)
+{
+	return (IS_ENABLED(CONFIG_NET_IPV6) && settings->dest_family == AF_INET6)
+		       ? net_if_ipv6_select_src_iface(&settings->dest_ipv6)
+		       : net_if_ipv4_select_src_iface(&settings->dest_ipv4);
+}
+
+/*
+ * Packets are allocated whole and never fragmented, and the allocation is
+ * clamped to the interface MTU, so a larger datagram could never be built.
+ */
+static bool datagram_fits_mtu(const struct tone_stream_settings *settings, uint32_t capacity)
+{
+	struct net_if *iface = datagram_iface(settings);
+	const size_t len = sizeof(struct tone_packet_prefix) + capacity;
+	const size_t hdr_len = (IS_ENABLED(CONFIG_NET_IPV6) && settings->dest_family == AF_INET6)
+				       ? NET_IPV6UDPH_LEN
+				       : NET_IPV4UDPH_LEN;
+
+	if (!iface) {
+		/* Checked again at start, once there is a route */
+		return true;
+	}
+
+	return hdr_len + ((settings->codec != TONE_CODEC_PCM)
+				  ? len
+				  : pkt_alloc_len(len, frame_bytes_for(settings))) <=
+	       net_if_get_mtu(iface);
+}
+#endif
+
+/* Check that a complete settings candidate yields a packet the engine can carry */
+static int validate_layout(const struct tone_stream_settings *settings)
+{
+	/* Adaptive sizing may take packets anywhere within its bounds */
+	const bool adaptive = settings->adapt_max_ms != 0U;
+	uint32_t samples = samples_for_ms(
+		settings, adaptive ? MAX(settings->packet_duration_ms, settings->adapt_max_ms)
+				   : settings->packet_duration_ms);
+	uint32_t min_samples = samples_for_ms(
+		settings, adaptive ? MIN(settings->packet_duration_ms, settings->adapt_min_ms)
+				   : settings->packet_duration_ms);
+
+	if (settings->codec != TONE_CODEC_PCM && settings->sample_format != TONE_SAMPLE_S16) {
+		return -ENOTSUP;
+	}
+
+	if (min_samples == 0U || samples * settings->channels > TONE_MAX_SAMPLES_PER_PACKET) {
+		return -ERANGE;
+	}
+
+	if (!waveform_fits(settings)) {
+		return -ERANGE;
+	}
+
+	const uint32_t capacity = payload_capacity(settings->codec, samples, settings->channels,
+						   frame_bytes_for(settings));
+
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	if (settings->transport == TONE_TRANSPORT_UDP && !datagram_fits_mtu(settings, capacity)) {
+		return -ERANGE;
+	}
+#else
+	if (capacity > CONFIG_TONE_STREAM_PCM_RING_BYTES) {
+		return -ERANGE;
+	}
+#endif
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+	/* Parity is accumulated in a fixed buffer per interleaved group */
+	if (settings->fec_group != 0U &&
+	    sizeof(struct tone_packet_prefix) + capacity > FEC_MAX_BYTES) {
+		return -ERANGE;
+	}
+#endif
+
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+	/* Raw frames are never fragmented; the driver takes them whole behind its header */
+	if (settings->transport == TONE_TRANSPORT_RAW &&
+	    sizeof(struct raw_tx_pkt_header) + sizeof(struct tone_raw_frame_header) +
+			    sizeof(struct tone_packet_prefix) + capacity >
+		    CONFIG_NRF70_TX_MAX_DATA_SIZE) {
+		return -ERANGE;
+	}
+#endif
+
+	return 0;
+}
+
+/*
+ * Give a whole settings candidate the checks each setter makes for its own
+ * fields, then validate the layout it yields. Stored records may come from
+ * another build, so they go through here too.
+ */
+static int settings_check(const struct tone_stream_settings *settings)
+{
+	if (settings->sample_rate_hz == 0U || settings->packet_duration_ms == 0U ||
+	    settings->amplitude_pct > 100U || settings->channel_phase_deg >= 360U ||
+	    settings->sample_format >= TONE_SAMPLE_FORMAT_COUNT ||
+	    settings->codec >= TONE_CODEC_COUNT || settings->qos >= TONE_QOS_COUNT ||
+	    settings->transport >= TONE_TRANSPORT_COUNT || settings->waveform >= TONE_WAVE_COUNT) {
+		return -EINVAL;
+	}
+
+	if (settings->dest_family != AF_UNSPEC && settings->dest_family != AF_INET &&
+	    settings->dest_family != AF_INET6) {
+		return -EINVAL;
+	}
+
+	if (settings->dest_family == AF_INET6 && !IS_ENABLED(CONFIG_NET_IPV6)) {
+		return -EAFNOSUPPORT;
+	}
+
+	if (settings->frequency_hz >= settings->sample_rate_hz / 2U ||
+	    settings->burst_packets == 0U || settings->burst_packets > TONE_MAX_BURST_PACKETS ||
+	    settings->channels == 0U || settings->channels > TONE_MAX_CHANNELS) {
+		return -ERANGE;
+	}
+
+	if (settings->adapt_min_ms > settings->adapt_max_ms ||
+	    (settings->adapt_min_ms == 0U && settings->adapt_max_ms != 0U) ||
+	    settings->fec_group > TONE_FEC_MAX_GROUP || settings->fec_depth == 0U ||
+	    settings->fec_depth > TONE_FEC_MAX_DEPTH || settings->sweep_end_hz == 0U ||
+	    settings->sweep_ms == 0U || settings->tone_count > TONE_MAX_TONES) {
+		return -EINVAL;
+	}
+
+	for (uint32_t t = 0; t < settings->tone_count; t++) {
+		if (settings->tone_pct[t] > 100U) {
+			return -EINVAL;
+		}
+	}
+
+	if ((settings->codec != TONE_CODEC_PCM && !IS_ENABLED(CONFIG_TONE_STREAM_CODEC)) ||
+	    (settings->twt_align && !IS_ENABLED(CONFIG_TONE_STREAM_TWT)) ||
+	    (settings->link_report && !IS_ENABLED(CONFIG_TONE_STREAM_LINK)) ||
+	    (settings->offload && !IS_ENABLED(CONFIG_TONE_STREAM_OFFLOAD)) ||
+	    (settings->fec_group != 0U && !IS_ENABLED(CONFIG_TONE_STREAM_FEC)) ||
+	    (settings->transport == TONE_TRANSPORT_RAW && !IS_ENABLED(CONFIG_TONE_STREAM_RAW_TX)) ||
+	    (settings->waveform != TONE_WAVE_SINE && !IS_ENABLED(CONFIG_TONE_STREAM_WAVEFORMS))) {
+		return -ENOTSUP;
+	}
+
+	return validate_layout(settings);
+}
+
+static void build_sine_lut(void)
+{
+	for (uint32_t i = 0; i <= LUT_POINTS; i++) {
+		float angle = (PI / 2.0f) * (float)i / (float)LUT_POINTS;
+
+		sine_lut[i] = (q15_t)lroundf(sinf(angle) * (float)INT16_MAX);
+	}
+}
+
+static void update_nco(struct tone_nco *nco, const struct tone_stream_settings *settings)
+{
+	nco->phase_inc = (uint32_t)DIV_ROUND_CLOSEST((uint64_t)settings->frequency_hz << 32,
+						     settings->sample_rate_hz);
+	nco->amplitude_q15 = (q15_t)((settings->amplitude_pct * INT16_MAX) / 100U);
+}
+
+/*
+ * Phase is kept, so a running stream changes pitch without a discontinuity.
+ * The other channels are re-derived from channel 0, which only moves them
+ * when the phase step changes.
+ */
+static void update_channel_ncos(struct tone_nco *nco, const struct tone_stream_settings *settings)
+{
+	const uint32_t phase_step =
+		(uint32_t)(((uint64_t)settings->channel_phase_deg << 32) / 360U);
+
+	update_nco(&nco[0], settings);
+	for (uint32_t ch = 1; ch < settings->channels; ch++) {
+		nco[ch] = nco[0];
+		nco[ch].phase = nco[0].phase + ch * phase_step;
+	}
+}
+
+/* Render one channel of q15 oscillator output */
+static void nco_render(struct tone_nco *nco, q15_t *pcm, uint32_t samples)
+{
+	static q15_t next[NCO_BLOCK_SAMPLES];
+	static q15_t frac[NCO_BLOCK_SAMPLES];
+	const uint32_t phase_inc = nco->phase_inc;
+	const q15_t amplitude = nco->amplitude_q15;
+	uint32_t phase = nco->phase;
+
+	if (amplitude == 0) {
+		/* Keep the phase running so unmuting does not click */
+		memset(pcm, 0, samples * sizeof(int16_t));
+		nco->phase = phase + phase_inc * samples;
+		return;
+	}
+
+	while (samples > 0U) {
+		uint32_t block = MIN(samples, NCO_BLOCK_SAMPLES);
+
+		/* Gather the two table points bracketing each phase */
+		for (uint32_t i = 0; i < block; i++) {
+			uint32_t quadrant = phase >> NCO_QUADRANT_SHIFT;
+			uint32_t index = (phase >> NCO_INDEX_SHIFT) & (LUT_POINTS - 1U);
+			q15_t a, b;
+
+			if (quadrant & 1U) {
+				a = sine_lut[LUT_POINTS - index];
+				b = sine_lut[LUT_POINTS - index - 1U];
+			} else {
+				a = sine_lut[index];
+				b = sine_lut[index + 1U];
+			}
+
+			if (quadrant & 2U) {
+				a = -a;
+				b = -b;
+			}
+
+			pcm[i] = a;
+			next[i] = b;
+			frac[i] = (q15_t)((phase & NCO_FRAC_MASK) >> NCO_FRAC_TO_Q15_SHIFT);
+			phase += phase_inc;
+		}
+
+		/* pcm = (a + (b - a) * frac) * amplitude */
+		arm_sub_q15(next, pcm, next, block);
+		arm_mult_q15(next, frac, next, block);
+		arm_add_q15(pcm, next, pcm, block);
+		arm_scale_q15(pcm, amplitude, 0, pcm, block);
+
+		pcm += block;
+		samples -= block;
+	}
+
+	nco->phase = phase;
+}
+
+/*
+ * Fallback for any layout: each channel is rendered a block at a time and
+ * strided into place by the store routine of the sample format.
+ */
+static void synth_generic(struct tone_nco *nco, uint32_t channels,
+			  enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	static q15_t block_pcm[NCO_BLOCK_SAMPLES];
+	const uint32_t sample_bytes = sample_layouts[format].bytes;
+	const uint32_t frame_bytes = channels * sample_bytes;
+	const pcm_store_fn store = sample_layouts[format].store;
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+
+		for (uint32_t ch = 0; ch < channels; ch++) {
+			nco_render(&nco[ch], block_pcm, block);
+			store(dst + ch * sample_bytes, block_pcm, block, frame_bytes);
+		}
+
+		dst += block * frame_bytes;
+		frames -= block;
+	}
+}
+
+/*
+ * The specialized kernels below write whole little-endian words with
+ * UNALIGNED_PUT, since zero-copy fragments put no alignment on dst.
+ */
+static inline void put_word(uint8_t *dst, uint32_t word)
+{
+	UNALIGNED_PUT(sys_cpu_to_le32(word), (uint32_t *)dst);
+}
+
+static inline uint32_t pack_s16x2(q15_t lo, q15_t hi)
+{
+	return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
+
+/* Four left-justified 24-bit samples fill exactly three words */
+static inline void put_s24x4(uint8_t *dst, const q15_t s[4])
+{
+	put_word(dst, (uint32_t)(uint16_t)s[0] << 8);
+	put_word(dst + 4, (uint16_t)s[1] | ((uint32_t)(uint8_t)s[2] << 24));
+	put_word(dst + 8, ((uint16_t)s[2] >> 8) | ((uint32_t)(uint16_t)s[3] << 16));
+}
+
+/* Mono 16-bit is the oscillator's native layout */
+static void synth_mono_s16(struct tone_nco *nco, uint32_t channels,
+			   enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	ARG_UNUSED(channels);
+	ARG_UNUSED(format);
+
+	nco_render(&nco[0], (q15_t *)dst, frames);
+}
+
+static void synth_stereo_s16(struct tone_nco *nco, uint32_t channels,
+			     enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	static q15_t left[NCO_BLOCK_SAMPLES];
+	static q15_t right[NCO_BLOCK_SAMPLES];
+
+	ARG_UNUSED(channels);
+	ARG_UNUSED(format);
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+		uint32_t i = 0U;
+
+		nco_render(&nco[0], left, block);
+		nco_render(&nco[1], right, block);
+
+		for (; i + 4U <= block; i += 4U, dst += 16) {
+			put_word(dst, pack_s16x2(left[i], right[i]));
+			put_word(dst + 4, pack_s16x2(left[i + 1U], right[i + 1U]));
+			put_word(dst + 8, pack_s16x2(left[i + 2U], right[i + 2U]));
+			put_word(dst + 12, pack_s16x2(left[i + 3U], right[i + 3U]));
+		}
+		for (; i < block; i++, dst += 4) {
+			put_word(dst, pack_s16x2(left[i], right[i]));
+		}
+
+		frames -= block;
+	}
+}
+
+static void synth_mono_s24(struct tone_nco *nco, uint32_t channels,
+			   enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	static q15_t block_pcm[NCO_BLOCK_SAMPLES];
+
+	ARG_UNUSED(channels);
+	ARG_UNUSED(format);
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+		uint32_t i = 0U;
+
+		nco_render(&nco[0], block_pcm, block);
+
+		for (; i + 4U <= block; i += 4U, dst += 12) {
+			put_s24x4(dst, &block_pcm[i]);
+		}
+		store_s24(dst, &block_pcm[i], block - i, 3U);
+		dst += (block - i) * 3U;
+
+		frames -= block;
+	}
+}
+
+static void synth_stereo_s24(struct tone_nco *nco, uint32_t channels,
+			     enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	static q15_t left[NCO_BLOCK_SAMPLES];
+	static q15_t right[NCO_BLOCK_SAMPLES];
+
+	ARG_UNUSED(channels);
+	ARG_UNUSED(format);
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+		uint32_t i = 0U;
+
+		nco_render(&nco[0], left, block);
+		nco_render(&nco[1], right, block);
+
+		/* Two frames per three words */
+		for (; i + 2U <= block; i += 2U, dst += 12) {
+			const q15_t s[4] = {left[i], right[i], left[i + 1U], right[i + 1U]};
+
+			put_s24x4(dst, s);
+		}
+		if (i < block) {
+			store_s24(dst, &left[i], 1U, 6U);
+			store_s24(dst + 3, &right[i], 1U, 6U);
+			dst += 6;
+		}
+
+		frames -= block;
+	}
+}
+
+static const struct synth_kernel {
+	uint8_t channels;
+	uint8_t format;
+	const char *name;
+	synth_kernel_fn render;
+} synth_kernels[] = {
+	{1U, TONE_SAMPLE_S16, "mono s16", synth_mono_s16},
+	{2U, TONE_SAMPLE_S16, "stereo s16", synth_stereo_s16},
+	{1U, TONE_SAMPLE_S24, "mono s24", synth_mono_s24},
+	{2U, TONE_SAMPLE_S24, "stereo s24", synth_stereo_s24},
+};
+
+static synth_kernel_fn synth_kernel_for(uint32_t channels, enum tone_sample_format format)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(synth_kernels); i++) {
+		if (synth_kernels[i].channels == channels && synth_kernels[i].format == format) {
+			return synth_kernels[i].render;
+		}
+	}
+
+	return synth_generic;
+}
+
+#if defined(CONFIG_TONE_STREAM_WAVEFORMS)
+/* Top 24 phase bits convert to float turns exactly */
+#define WAVE_TURN_SHIFT 8U
+#define WAVE_TURN_SCALE (1.0f / (float)BIT(32U - WAVE_TURN_SHIFT))
+
+/* Pink noise RMS of a quarter of the amplitude, leaving 12 dB for its peaks */
+#define PINK_NOISE_GAIN 0.145f
+
+/* Triangle integrator leak per sample as a fraction of the phase step */
+#define TRIANGLE_LEAK_SHIFT 8U
+
+typedef void (*wave_render_fn)(const struct tone_wave *wave, struct tone_wave_channel *ch,
+			       q15_t *pcm, uint32_t frames);
+
+static inline q15_t wave_q15(float value)
+{
+	return (q15_t)CLAMP(value * (float)INT16_MAX, (float)INT16_MIN, (float)INT16_MAX);
+}
+
+static inline float wave_turns(uint32_t phase)
+{
+	return (float)(phase >> WAVE_TURN_SHIFT) * WAVE_TURN_SCALE;
+}
+
+/* The scalar form of the table lookup nco_render does a block at a time */
+static q15_t lut_sine(uint32_t phase)
+{
+	uint32_t quadrant = phase >> NCO_QUADRANT_SHIFT;
+	uint32_t index = (phase >> NCO_INDEX_SHIFT) & (LUT_POINTS - 1U);
+	int32_t frac = (int32_t)((phase & NCO_FRAC_MASK) >> NCO_FRAC_TO_Q15_SHIFT);
+	int32_t a, b;
+
+	if (quadrant & 1U) {
+		a = sine_lut[LUT_POINTS - index];
+		b = sine_lut[LUT_POINTS - index - 1U];
+	} else {
+		a = sine_lut[index];
+		b = sine_lut[index + 1U];
+	}
+
+	int32_t value = a + (((b - a) * frac) >> 15);
+
+	return (q15_t)((quadrant & 2U) ? -value : value);
+}
+
+static float sweep_inc_at(const struct tone_wave *wave, uint32_t pos)
+{
+	float t = (float)pos / (float)wave->length;
+
+	if (wave->waveform == TONE_WAVE_SWEEP_LOG) {
+		return wave->inc_start * powf(wave->inc_end / wave->inc_start, t);
+	}
+
+	return wave->inc_start + (wave->inc_end - wave->inc_start) * t;
+}
+
+/*
+ * The phase step is evaluated at both ends of the run and ramps linearly in
+ * between, which is exact for linear sweeps and well within a cent for
+ * logarithmic ones at packet-sized runs.
+ */
+static void wave_render_sweep(const struct tone_wave *wave, struct tone_wave_channel *ch,
+			      q15_t *pcm, uint32_t frames)
+{
+	const int32_t amplitude = (int32_t)(wave->amplitude * (float)INT16_MAX);
+	uint32_t pos = wave->pos;
+	uint32_t phase = ch->phase;
+
+	while (frames > 0U) {
+		uint32_t run = MIN(frames, wave->length - pos);
+		float inc_start = sweep_inc_at(wave, pos);
+		float inc_end = sweep_inc_at(wave, pos + run);
+		/* Phase steps in Q8 so the ramp does not round to zero */
+		int64_t inc = (int64_t)(inc_start * 256.0f);
+		int64_t ramp = (int64_t)((inc_end - inc_start) * 256.0f / (float)run);
+
+		for (uint32_t i = 0; i < run; i++) {
+			pcm[i] = (q15_t)((lut_sine(phase) * amplitude) >> 15);
+			phase += (uint32_t)(inc >> 8);
+			inc += ramp;
+		}
+
+		pcm += run;
+		frames -= run;
+		pos = (pos + run == wave->length) ? 0U : pos + run;
+	}
+
+	ch->phase = phase;
+}
+
+static void wave_render_multitone(const struct tone_wave *wave, struct tone_wave_channel *ch,
+				  q15_t *pcm, uint32_t frames)
+{
+	static q15_t tone_pcm[NCO_BLOCK_SAMPLES];
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+
+		nco_render(&ch->tones[0], pcm, block);
+		for (uint32_t t = 1; t < wave->tone_count; t++) {
+			nco_render(&ch->tones[t], tone_pcm, block);
+			arm_add_q15(pcm, tone_pcm, pcm, block);
+		}
+
+		pcm += block;
+		frames -= block;
+	}
+}
+
+/* Polynomial band-limited step, the residual that smooths one edge */
+static inline float poly_blep(float t, float dt)
+{
+	if (t < dt) {
+		t /= dt;
+		return t + t - t * t - 1.0f;
+	}
+
+	if (t > 1.0f - dt) {
+		t = (t - 1.0f) / dt;
+		return t * t + t + t + 1.0f;
+	}
+
+	return 0.0f;
+}
+
+static float triangle_at(uint32_t phase)
+{
+	float t = wave_turns(phase);
+
+	return (t < 0.5f) ? 4.0f * t - 1.0f : 3.0f - 4.0f * t;
+}
+
+/* A triangle is the band-limited square integrated, with a slight leak against drift */
+static void wave_render_square(const struct tone_wave *wave, struct tone_wave_channel *ch,
+			       q15_t *pcm, uint32_t frames)
+{
+	const float dt = wave_turns(wave->phase_inc);
+	const bool triangle = wave->waveform == TONE_WAVE_TRIANGLE;
+	const float leak = 1.0f - dt / (float)BIT(TRIANGLE_LEAK_SHIFT);
+	uint32_t phase = ch->phase;
+	float tri = ch->tri;
+
+	for (uint32_t i = 0; i < frames; i++) {
+		float value = (phase & BIT(31)) ? -1.0f : 1.0f;
+
+		value += poly_blep(wave_turns(phase), dt);
+		value -= poly_blep(wave_turns(phase + BIT(31)), dt);
+
+		if (triangle) {
+			tri = tri * leak + 4.0f * dt * value;
+			value = tri;
+		}
+
+		pcm[i] = wave_q15(value * wave->amplitude);
+		phase += wave->phase_inc;
+	}
+
+	ch->phase = phase;
+	ch->tri = tri;
+}
+
+static inline float white_noise(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	/* xorshift32 */
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return (float)(int32_t)x * (1.0f / (float)BIT(31));
+}
+
+/* Paul Kellet's economy filter: -3 dB per octave within 0.5 dB above 10 Hz */
+static void wave_render_pink(const struct tone_wave *wave, struct tone_wave_channel *ch,
+			     q15_t *pcm, uint32_t frames)
+{
+	const float gain = wave->amplitude * PINK_NOISE_GAIN;
+	float b0 = ch->pink[0];
+	float b1 = ch->pink[1];
+	float b2 = ch->pink[2];
+
+	for (uint32_t i = 0; i < frames; i++) {
+		float white = white_noise(&ch->rng);
+
+		b0 = 0.99765f * b0 + white * 0.0990460f;
+		b1 = 0.96300f * b1 + white * 0.2965164f;
+		b2 = 0.57000f * b2 + white * 1.0526913f;
+		pcm[i] = wave_q15((b0 + b1 + b2 + white * 0.1848f) * gain);
+	}
+
+	ch->pink[0] = b0;
+	ch->pink[1] = b1;
+	ch->pink[2] = b2;
+}
+
+static const wave_render_fn wave_generators[TONE_WAVE_COUNT] = {
+	[TONE_WAVE_SWEEP_LIN] = wave_render_sweep,
+	[TONE_WAVE_SWEEP_LOG] = wave_render_sweep,
+	[TONE_WAVE_MULTITONE] = wave_render_multitone,
+	[TONE_WAVE_SQUARE] = wave_render_square,
+	[TONE_WAVE_TRIANGLE] = wave_render_square,
+	[TONE_WAVE_PINK_NOISE] = wave_render_pink,
+};
+
+/*
+ * Every channel renders the same span of the waveform from its own state;
+ * the shared sweep position moves on once all of them have.
+ */
+static void synth_waveform(struct tone_wave *wave, uint32_t channels,
+			   enum tone_sample_format format, uint8_t *dst, uint32_t frames)
+{
+	static q15_t block_pcm[NCO_BLOCK_SAMPLES];
+	const wave_render_fn render = wave_generators[wave->waveform];
+	const uint32_t sample_bytes = sample_layouts[format].bytes;
+	const uint32_t frame_bytes = channels * sample_bytes;
+	const pcm_store_fn store = sample_layouts[format].store;
+
+	while (frames > 0U) {
+		uint32_t block = MIN(frames, NCO_BLOCK_SAMPLES);
+
+		for (uint32_t ch = 0; ch < channels; ch++) {
+			render(wave, &wave->ch[ch], block_pcm, block);
+			store(dst + ch * sample_bytes, block_pcm, block, frame_bytes);
+		}
+
+		if (wave->length > 0U) {
+			wave->pos = (wave->pos + block) % wave->length;
+		}
+
+		dst += block * frame_bytes;
+		frames -= block;
+	}
+}
+
+/*
+ * Amplitude and tone changes apply in place; a new waveform, sweep or
+ * channel count restarts the generators with channel n leading channel 0
+ * by n phase steps, as for the sine.
+ */
+static void wave_configure(struct tone_wave *wave, const struct tone_stream_settings *settings)
+{
+	const bool sweep = settings->waveform == TONE_WAVE_SWEEP_LIN ||
+			   settings->waveform == TONE_WAVE_SWEEP_LOG;
+	const uint32_t length =
+		sweep ? MAX(1U, (uint32_t)((uint64_t)settings->sample_rate_hz *
+					   settings->sweep_ms / MSEC_PER_SEC))
+		      : 0U;
+	const float turn = (float)BIT64(32) / (float)settings->sample_rate_hz;
+	const float inc_start = sweep ? (float)settings->frequency_hz * turn : 0.0f;
+	const float inc_end = sweep ? (float)settings->sweep_end_hz * turn : 0.0f;
+	const uint32_t phase_step =
+		(uint32_t)(((uint64_t)settings->channel_phase_deg << 32) / 360U);
+	const bool restart = wave->waveform != settings->waveform || wave->length != length ||
+			     wave->inc_start != inc_start || wave->inc_end != inc_end ||
+			     wave->ch_count != settings->channels;
+
+	wave->waveform = settings->waveform;
+	wave->length = length;
+	wave->inc_start = inc_start;
+	wave->inc_end = inc_end;
+	wave->ch_count = settings->channels;
+	wave->phase_inc = (uint32_t)DIV_ROUND_CLOSEST((uint64_t)settings->frequency_hz << 32,
+						      settings->sample_rate_hz);
+	wave->amplitude = (float)settings->amplitude_pct / 100.0f;
+	wave->tone_count = settings->tone_count;
+
+	if (restart) {
+		wave->pos = 0U;
+	}
+
+	for (uint32_t ch = 0; ch < settings->channels; ch++) {
+		struct tone_wave_channel *c = &wave->ch[ch];
+
+		if (restart) {
+			c->phase = ch * phase_step;
+			c->tri = triangle_at(c->phase);
+			memset(c->pink, 0, sizeof(c->pink));
+			/* Odd multiplier: every channel gets its own non-zero seed */
+			c->rng = 0x9E3779B9U * (ch + 1U);
+		}
+
+		for (uint32_t t = 0; t < settings->tone_count; t++) {
+			if (restart) {
+				c->tones[t].phase = ch * phase_step;
+			}
+			c->tones[t].phase_inc = (uint32_t)DIV_ROUND_CLOSEST(
+				(uint64_t)settings->tone_hz[t] << 32, settings->sample_rate_hz);
+			const uint32_t pct = settings->amplitude_pct * settings->tone_pct[t];
+
+			c->tones[t].amplitude_q15 = (q15_t)((pct * INT16_MAX) / 10000U);
+		}
+	}
+}
+#endif /* CONFIG_TONE_STREAM_WAVEFORMS */
+
+/*
+ * Synthesize interleaved frames through the kernel picked for the stream's
+ * channel count and sample format when its settings were last refreshed,
+ * or through the waveform generators for anything but a sine.
+ */
+static inline void fill_pcm_frames(struct tone_stream_context *stream, uint8_t *dst,
+				   uint32_t frames)
+{
+#if defined(CONFIG_TONE_STREAM_WAVEFORMS)
+	if (stream->synth.wave.waveform != TONE_WAVE_SINE) {
+		synth_waveform(&stream->synth.wave, stream->synth.channels, stream->synth.format,
+			       dst, frames);
+		return;
+	}
+#endif
+	stream->synth.kernel(stream->synth.nco, stream->synth.channels, stream->synth.format, dst,
+			     frames);
+}
+
+#if defined(CONFIG_TONE_STREAM_CODEC)
+/*
+ * Codec stage: synthesize the packet as 16-bit PCM into a staging buffer and
+ * encode it into out, which holds at least payload_capacity() bytes. A packet
+ * the codec does not shrink goes out as PCM, flagged in its own extension.
+ */
+static uint32_t encode_payload(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			       uint8_t *out, size_t out_len)
+{
+	static int16_t codec_pcm[TONE_MAX_SAMPLES_PER_PACKET];
+	const uint32_t pcm_len = slot->samples * slot->frame_bytes;
+
+	fill_pcm_frames(stream, (uint8_t *)codec_pcm, slot->samples);
+
+	TONE_TRACE("encode_enter", stream->id, slot->samples);
+	int ret = tone_codec_encode(stream->synth.codec, stream->synth.adpcm, codec_pcm,
+				    slot->samples, stream->synth.channels, out, out_len);
+	TONE_TRACE("encode_exit", stream->id, (uint32_t)ret);
+	if (ret < 0) {
+		memcpy(out, codec_pcm, pcm_len);
+		slot->prefix.ext.codec = TONE_CODEC_PCM;
+		return pcm_len;
+	}
+
+	return (uint32_t)ret;
+}
+#endif
+
+static void build_prefix(struct tone_stream_context *stream, struct tone_tx_slot *slot)
+{
+	struct tone_packet_header *header = &slot->prefix.header;
+
+	header->seq = sys_cpu_to_be32(stream->synth.seq_num++);
+	header->sample_count = sys_cpu_to_be32(stream->synth.sample_counter);
+	header->timestamp_us = 0U;
+
+	slot->prefix.ext = stream->synth.ext;
+	slot->prefix_len = sizeof(*header) + stream->synth.ext.length;
+	slot->frame_bytes = stream->synth.channels * stream->synth.sample_bytes;
+
+	stream->synth.sample_counter += slot->samples;
+}
+
+/* Parity and link reports carry no audio */
+static inline bool slot_is_control(const struct tone_tx_slot *slot)
+{
+	return slot->samples == 0U;
+}
+
+static inline bool slot_is_link(const struct tone_tx_slot *slot)
+{
+#if defined(CONFIG_TONE_STREAM_LINK)
+	return slot_is_control(slot) &&
+	       slot->prefix.link.magic == sys_cpu_to_be16(TONE_LINK_EXT_MAGIC);
+#else
+	ARG_UNUSED(slot);
+	return false;
+#endif
+}
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+/* Word at a time when both sides allow it, which payloads always do */
+static void fec_xor(uint8_t *acc, const uint8_t *src, size_t len)
+{
+	if ((((uintptr_t)acc | (uintptr_t)src) & (sizeof(uint32_t) - 1U)) == 0U) {
+		uint32_t *acc_w = (uint32_t *)acc;
+		const uint32_t *src_w = (const uint32_t *)src;
+
+		for (; len >= sizeof(uint32_t); len -= sizeof(uint32_t)) {
+			*acc_w++ ^= *src_w++;
+		}
+
+		acc = (uint8_t *)acc_w;
+		src = (const uint8_t *)src_w;
+	}
+
+	while (len-- > 0U) {
+		*acc++ ^= *src++;
+	}
+}
+#endif
+
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+static int configure_destination_socket(struct tone_stream_context *stream,
+					const struct tone_stream_settings *settings)
+{
+	struct sockaddr_storage dest;
+	socklen_t dest_len = dest_sockaddr(settings, &dest);
+	struct net_context *net_ctx;
+
+	int ret = net_context_get(settings->dest_family, SOCK_DGRAM, IPPROTO_UDP, &net_ctx);
+	if (ret < 0) {
+		LOG_ERR("net_context_get() failed: %d", ret);
+		return ret;
+	}
+
+	/* Connecting binds an ephemeral local port used as the UDP source port */
+	ret = net_context_connect(net_ctx, (struct sockaddr *)&dest, dest_len, NULL, K_NO_WAIT,
+				  NULL);
+	if (ret < 0) {
+		LOG_ERR("net_context_connect() failed: %d", ret);
+		net_context_put(net_ctx);
+		return ret;
+	}
+
+	stream->net_ctx = net_ctx;
+	return 0;
+}
+
+static bool destination_socket_open(const struct tone_stream_context *stream)
+{
+	return stream->net_ctx != NULL;
+}
+
+static void close_destination_socket(struct tone_stream_context *stream)
+{
+	net_context_put(stream->net_ctx);
+	stream->net_ctx = NULL;
+}
+
+/* Synthesize whole frames straight into the fragments backing the packet */
+static int fill_pkt_samples(struct tone_stream_context *stream, struct net_pkt *pkt,
+			    uint32_t frames, uint32_t frame_bytes)
+{
+	struct net_buf *frag = pkt->cursor.buf;
+
+	while (frames > 0U && frag) {
+		uint32_t room = net_buf_tailroom(frag) / frame_bytes;
+		uint32_t count = MIN(room, frames);
+
+		if (count > 0U) {
+			fill_pcm_frames(stream, net_buf_tail(frag), count);
+			net_buf_add(frag, count * frame_bytes);
+			frames -= count;
+		}
+
+		frag = frag->frags;
+	}
+
+	return (frames == 0U) ? 0 : -ENOBUFS;
+}
+
+/* Write prefix and payload, synthesizing PCM in place or encoding it via staging */
+static int write_payload(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			 struct net_pkt *pkt)
+{
+	int ret;
+
+#if defined(CONFIG_TONE_STREAM_CODEC)
+	if (slot->prefix.ext.codec != TONE_CODEC_PCM) {
+		/* Encoded payloads are small; one copy in beats packing bits across fragments */
+		static uint8_t codec_out[TONE_CODEC_MAX_PAYLOAD_BYTES];
+
+		slot->payload_len = encode_payload(stream, slot, codec_out, slot->payload_len);
+
+		/* The prefix goes in last as a packet may have fallen back to PCM */
+		ret = net_pkt_write(pkt, &slot->prefix, slot->prefix_len);
+		if (ret == 0) {
+			ret = net_pkt_write(pkt, codec_out, slot->payload_len);
+		}
+		if (ret == 0) {
+			/* Release fragments reserved for a payload that compressed further */
+			net_pkt_trim_buffer(pkt);
+		}
+
+		return ret;
+	}
+#endif
+
+	ret = net_pkt_write(pkt, &slot->prefix, slot->prefix_len);
+	if (ret == 0) {
+		ret = fill_pkt_samples(stream, pkt, slot->samples, slot->frame_bytes);
+	}
+
+	return ret;
+}
+
+/* IP header towards the destination, multicast groups get the configured hop limit */
+static int create_ip_header(struct net_pkt *pkt, const struct tone_stream_settings *settings)
+{
+	const bool mcast = dest_is_multicast(settings);
+
+	if (IS_ENABLED(CONFIG_NET_IPV6) && settings->dest_family == AF_INET6) {
+		const struct in6_addr *dst = &settings->dest_ipv6;
+
+		if (mcast) {
+			net_pkt_set_ipv6_hop_limit(pkt, CONFIG_TONE_STREAM_MULTICAST_HOPS);
+		}
+
+		return net_ipv6_create(pkt, net_if_ipv6_select_src_addr(net_pkt_iface(pkt), dst),
+				       dst);
+	}
+
+	const struct in_addr *dst = &settings->dest_ipv4;
+
+	if (mcast) {
+		net_pkt_set_ipv4_ttl(pkt, CONFIG_TONE_STREAM_MULTICAST_HOPS);
+	}
+
+	return net_ipv4_create(pkt, net_if_ipv4_select_src_addr(net_pkt_iface(pkt), dst), dst);
+}
+
+/* Packet for len bytes of tone datagram, with its IP and UDP headers in place */
+static int alloc_datagram(struct tone_stream_context *stream, const struct tone_tx_slot *slot,
+			  const struct tone_stream_settings *settings, size_t len,
+			  struct net_pkt **out)
+{
+	struct net_if *iface = datagram_iface(settings);
+
+	if (!iface) {
+		return -ENETUNREACH;
+	}
+
+	struct net_pkt *pkt = net_pkt_alloc_with_buffer(iface, len, settings->dest_family,
+							IPPROTO_UDP, K_NO_WAIT);
+	if (!pkt) {
+		return -ENOMEM;
+	}
+
+	net_pkt_set_context(pkt, stream->net_ctx);
+	net_pkt_set_ip_dscp(pkt, qos_classes[slot->qos].dscp);
+	net_pkt_set_priority(pkt, qos_classes[slot->qos].priority);
+
+	if (create_ip_header(pkt, settings) < 0 ||
+	    net_udp_create(pkt, net_sin_ptr(&stream->net_ctx->local)->sin_port,
+			   htons(settings->dest_port)) < 0) {
+		net_pkt_unref(pkt);
+		return -ENOMEM;
+	}
+
+	*out = pkt;
+	return 0;
+}
+
+static int produce_packet(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			  const struct tone_stream_settings *settings)
+{
+	/* PCM is synthesized into the fragments in place, encoded payloads are copied */
+	const size_t datagram_len = slot->prefix_len + slot->payload_len;
+	size_t len = (slot->prefix.ext.codec != TONE_CODEC_PCM)
+			     ? datagram_len
+			     : pkt_alloc_len(datagram_len, slot->frame_bytes);
+
+	struct net_pkt *pkt;
+	int ret = alloc_datagram(stream, slot, settings, len, &pkt);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	ret = write_payload(stream, slot, pkt);
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+		return ret;
+	}
+
+	slot->pkt = pkt;
+	return 0;
+}
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+/* Fold a built datagram into parity, reading it back from the packet fragments */
+static void fec_xor_slot(uint8_t *acc, const struct tone_tx_slot *slot)
+{
+	size_t skip = net_pkt_ip_hdr_len(slot->pkt) + NET_UDPH_LEN;
+
+	for (struct net_buf *frag = slot->pkt->buffer; frag; frag = frag->frags) {
+		if (skip >= frag->len) {
+			skip -= frag->len;
+			continue;
+		}
+
+		fec_xor(acc, frag->data + skip, frag->len - skip);
+		acc += frag->len - skip;
+		skip = 0U;
+	}
+}
+#endif
+
+#if defined(CONFIG_TONE_STREAM_FEC) || defined(CONFIG_TONE_STREAM_LINK)
+/* Parity and link reports: a payload built elsewhere behind the slot's prefix */
+static int produce_control(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			   const uint8_t *payload, atomic_val_t head,
+			   const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(head);
+
+	struct net_pkt *pkt;
+	int ret = alloc_datagram(stream, slot, settings, slot->prefix_len + slot->payload_len,
+				 &pkt);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (net_pkt_write(pkt, &slot->prefix, slot->prefix_len) < 0 ||
+	    net_pkt_write(pkt, payload, slot->payload_len) < 0) {
+		net_pkt_unref(pkt);
+		return -ENOBUFS;
+	}
+
+	slot->pkt = pkt;
+	return 0;
+}
+#endif
+
+static int transmit_slot(struct tone_stream_context *stream, struct tone_tx_slot *slot)
+{
+	ARG_UNUSED(stream);
+
+	struct net_pkt *pkt = slot->pkt;
+	int ret;
+
+	slot->pkt = NULL;
+
+	/* Stamp the send time into the tone header already in the packet */
+	net_pkt_cursor_init(pkt);
+	net_pkt_set_overwrite(pkt, true);
+	ret = net_pkt_skip(pkt, net_pkt_ip_hdr_len(pkt) + NET_UDPH_LEN +
+					offsetof(struct tone_packet_header, timestamp_us));
+	if (ret == 0) {
+		ret = net_pkt_write_be32(pkt, (uint32_t)(micros_now() & 0xFFFFFFFFU));
+	}
+	if (ret == 0) {
+		net_pkt_cursor_init(pkt);
+		ret = (net_pkt_family(pkt) == AF_INET6) ? net_ipv6_finalize(pkt, IPPROTO_UDP)
+							: net_ipv4_finalize(pkt, IPPROTO_UDP);
+	}
+	if (ret == 0) {
+		ret = net_send_data(pkt);
+	}
+
+	if (ret < 0) {
+		net_pkt_unref(pkt);
+	}
+
+	return ret;
+}
+
+static void release_slot(struct tone_tx_slot *slot)
+{
+	if (slot->pkt) {
+		net_pkt_unref(slot->pkt);
+		slot->pkt = NULL;
+	}
+}
+#else
+/* Zephyr takes the DSCP, as IP_TOS or IPV6_TCLASS, and the priority as a single byte */
+static int set_socket_qos(int fd, sa_family_t family, enum tone_qos qos)
+{
+	uint8_t tos = qos_classes[qos].dscp << 2;
+	uint8_t priority = qos_classes[qos].priority;
+	int ret = (family == AF_INET6)
+			  ? setsockopt(fd, IPPROTO_IPV6, IPV6_TCLASS, &tos, sizeof(tos))
+			  : setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+
+	if (ret < 0 || setsockopt(fd, SOL_SOCKET, SO_PRIORITY, &priority, sizeof(priority)) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+static int set_socket_multicast_hops(int fd, sa_family_t family)
+{
+	int hops = CONFIG_TONE_STREAM_MULTICAST_HOPS;
+	int ret = (family == AF_INET6)
+			  ? setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, &hops, sizeof(hops))
+			  : setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &hops, sizeof(hops));
+
+	return (ret < 0) ? -errno : 0;
+}
+
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+/* Packet socket on the Wi-Fi interface and the frame header every datagram reuses */
+static int configure_raw_socket(struct tone_stream_context *stream,
+				const struct tone_stream_settings *settings)
+{
+	struct tone_raw_tx *raw = &stream->raw;
+	struct net_if *iface = net_if_get_first_wifi();
+
+	int ret = wifi_raw_tx_get_header(&raw->tx_header);
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (!iface) {
+		LOG_ERR("No Wi-Fi interface for raw TX");
+		return -ENODEV;
+	}
+
+	int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (fd < 0) {
+		LOG_ERR("socket() failed: %d", errno);
+		return -errno;
+	}
+
+	memset(&raw->addr, 0, sizeof(raw->addr));
+	raw->addr.sll_family = AF_PACKET;
+	raw->addr.sll_ifindex = net_if_get_by_iface(iface);
+
+	if (bind(fd, (struct sockaddr *)&raw->addr, sizeof(raw->addr)) < 0) {
+		int err = -errno;
+		LOG_ERR("bind() failed: %d", errno);
+		close(fd);
+		return err;
+	}
+
+	static const uint8_t llc_snap[] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00};
+	const struct net_linkaddr *own = net_if_get_link_addr(iface);
+
+	memset(&raw->frame, 0, sizeof(raw->frame));
+	raw->frame.frame_control = sys_cpu_to_le16(0x0008U);
+	memcpy(raw->frame.da, settings->dest_mac, sizeof(raw->frame.da));
+	memcpy(raw->frame.sa, own->addr, sizeof(raw->frame.sa));
+	memcpy(raw->frame.bssid, own->addr, sizeof(raw->frame.bssid));
+	memcpy(raw->frame.llc_snap, llc_snap, sizeof(llc_snap));
+	raw->frame.ethertype = sys_cpu_to_be16(RAW_TONE_ETHERTYPE);
+	raw->seq = 0U;
+
+	stream->sock_transport = TONE_TRANSPORT_RAW;
+	stream->sock_fd = fd;
+	return 0;
+}
+
+/* Header and frame go out ahead of the datagram, patched in place per frame */
+static int transmit_raw(struct tone_stream_context *stream, struct tone_tx_slot *slot)
+{
+	struct tone_raw_tx *raw = &stream->raw;
+
+	/* Fragment number stays 0, the sequence number is in the upper 12 bits */
+	raw->frame.seq_ctrl = sys_cpu_to_le16(raw->seq << 4);
+	raw->seq = (raw->seq + 1U) & 0x0FFFU;
+	raw->tx_header.packet_length =
+		sizeof(raw->frame) + slot->prefix_len + slot->payload_len;
+
+	slot->prefix.header.timestamp_us =
+		sys_cpu_to_be32((uint32_t)(micros_now() & 0xFFFFFFFFU));
+
+	struct iovec iov[] = {
+		{
+			.iov_base = &raw->tx_header,
+			.iov_len = sizeof(raw->tx_header),
+		},
+		{
+			.iov_base = &raw->frame,
+			.iov_len = sizeof(raw->frame),
+		},
+		{
+			.iov_base = &slot->prefix,
+			.iov_len = slot->prefix_len,
+		},
+		{
+			.iov_base = slot->pcm,
+			.iov_len = slot->payload_len,
+		},
+	};
+	struct msghdr msg = {
+		.msg_name = &raw->addr,
+		.msg_namelen = sizeof(raw->addr),
+		.msg_iov = iov,
+		.msg_iovlen = ARRAY_SIZE(iov),
+	};
+
+	return (sendmsg(stream->sock_fd, &msg, 0) < 0) ? -errno : 0;
+}
+#endif
+
+static int configure_destination_socket(struct tone_stream_context *stream,
+					const struct tone_stream_settings *settings)
+{
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+	if (settings->transport == TONE_TRANSPORT_RAW) {
+		return configure_raw_socket(stream, settings);
+	}
+#endif
+
+	struct sockaddr_storage dest;
+	socklen_t dest_len = dest_sockaddr(settings, &dest);
+
+	int fd = socket(settings->dest_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd < 0) {
+		LOG_ERR("socket() failed: %d", errno);
+		return -errno;
+	}
+
+	int buf = 64 * 1024;
+	(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+
+	int ret = set_socket_qos(fd, settings->dest_family, settings->qos);
+	if (ret < 0) {
+		LOG_WRN("Stream %u QoS %s not applied: %d", stream->id,
+			qos_classes[settings->qos].name, ret);
+	}
+	stream->sock_family = settings->dest_family;
+	stream->sock_qos = settings->qos;
+	stream->sock_transport = TONE_TRANSPORT_UDP;
+
+	if (dest_is_multicast(settings)) {
+		ret = set_socket_multicast_hops(fd, settings->dest_family);
+		if (ret < 0) {
+			LOG_WRN("Stream %u multicast hop limit not applied: %d", stream->id, ret);
+		}
+	}
+
+	if (connect(fd, (struct sockaddr *)&dest, dest_len) < 0) {
+		int err = -errno;
+		LOG_ERR("connect() failed: %d", errno);
+		close(fd);
+		return err;
+	}
+
+	stream->sock_fd = fd;
+	return 0;
+}
+
+static bool destination_socket_open(const struct tone_stream_context *stream)
+{
+	return stream->sock_fd >= 0;
+}
+
+static void close_destination_socket(struct tone_stream_context *stream)
+{
+	close(stream->sock_fd);
+	stream->sock_fd = -1;
+}
+
+/*
+ * Reserve contiguous PCM for the next packet. Packets are released in order,
+ * so the ring is a single region from the oldest queued packet to pcm_write,
+ * wrapping to the start when the tail end is too short. Reservations are
+ * word aligned so mono 16-bit packets can be rendered in place.
+ */
+static uint8_t *pcm_alloc(struct tone_stream_context *stream, uint32_t bytes, atomic_val_t head,
+			  atomic_val_t tail)
+{
+	const uint32_t size = PCM_RING_BYTES;
+	const uint32_t len = ROUND_UP(bytes, sizeof(uint32_t));
+	uint32_t write = stream->synth.pcm_write;
+	uint32_t offset;
+	uint32_t used;
+
+	if (head == tail) {
+		offset = 0U;
+		used = len;
+	} else {
+		uint32_t oldest = stream->tx_ring[tail & TX_RING_MASK].pcm - stream->pcm_ring;
+
+		if (write > oldest && write + len <= size) {
+			offset = write;
+			used = offset + len - oldest;
+		} else if (write > oldest && len < oldest) {
+			/* The tail end past write stays unused until the ring wraps */
+			offset = 0U;
+			used = size - oldest + len;
+		} else if (write < oldest && write + len < oldest) {
+			offset = write;
+			used = size - oldest + offset + len;
+		} else {
+			return NULL;
+		}
+	}
+
+	stream->synth.pcm_write = offset + len;
+	stream->pcm_peak = MAX(stream->pcm_peak, used);
+	return &stream->pcm_ring[offset];
+}
+
+static int pcm_ring_acquire(struct tone_stream_context *stream)
+{
+	void *block;
+
+	if (k_mem_slab_alloc(&tone_pcm_slab, &block, K_NO_WAIT) != 0) {
+		return -ENOMEM;
+	}
+
+	stream->pcm_ring = block;
+	stream->pcm_peak = 0U;
+	engine.pcm_rings_peak = MAX(engine.pcm_rings_peak, k_mem_slab_num_used_get(&tone_pcm_slab));
+
+	return 0;
+}
+
+static void pcm_ring_release(struct tone_stream_context *stream)
+{
+	if (stream->pcm_ring) {
+		k_mem_slab_free(&tone_pcm_slab, stream->pcm_ring);
+		stream->pcm_ring = NULL;
+	}
+}
+
+/*
+ * Ring bytes the settings need for a full lookahead of their largest
+ * packets, plus one packet the wrap at the end of the ring may leave unused.
+ */
+static uint32_t pcm_ring_need(const struct tone_stream_settings *settings)
+{
+	const uint16_t packet_ms = MAX(settings->packet_duration_ms, settings->adapt_max_ms);
+	uint32_t packet = payload_capacity(settings->codec, samples_for_ms(settings, packet_ms),
+					   settings->channels, frame_bytes_for(settings));
+	const uint32_t lookahead = settings->burst_packets + CONFIG_TONE_STREAM_LOOKAHEAD_PACKETS;
+	uint32_t packets = settings->twt_align ? TX_RING_SLOTS : MIN(TX_RING_SLOTS, lookahead);
+
+	if (settings->fec_group != 0U) {
+		/* Parity covers whole datagrams, prefix included */
+		packet += sizeof(struct tone_packet_prefix);
+	}
+
+	return (packets + 1U) * ROUND_UP(packet, sizeof(uint32_t));
+}
+
+static int produce_packet(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			  const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(settings);
+
+#if defined(CONFIG_TONE_STREAM_CODEC)
+	if (slot->prefix.ext.codec != TONE_CODEC_PCM) {
+		slot->payload_len = encode_payload(stream, slot, slot->pcm, slot->payload_len);
+		/* Return the unused end of the reservation, which is the newest */
+		stream->synth.pcm_write = (slot->pcm - stream->pcm_ring) +
+					  ROUND_UP(slot->payload_len, sizeof(uint32_t));
+		return 0;
+	}
+#endif
+
+	fill_pcm_frames(stream, slot->pcm, slot->samples);
+	return 0;
+}
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+static void fec_xor_slot(uint8_t *acc, const struct tone_tx_slot *slot)
+{
+	fec_xor(acc, (const uint8_t *)&slot->prefix, slot->prefix_len);
+	fec_xor(acc + slot->prefix_len, slot->pcm, slot->payload_len);
+}
+#endif
+
+#if defined(CONFIG_TONE_STREAM_FEC) || defined(CONFIG_TONE_STREAM_LINK)
+static int produce_control(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			   const uint8_t *payload, atomic_val_t head,
+			   const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(settings);
+
+	slot->pcm = pcm_alloc(stream, slot->payload_len, head, atomic_get(&stream->ring_tail));
+	if (!slot->pcm) {
+		return -ENOBUFS;
+	}
+
+	memcpy(slot->pcm, payload, slot->payload_len);
+	return 0;
+}
+#endif
+
+static int transmit_slot(struct tone_stream_context *stream, struct tone_tx_slot *slot)
+{
+#if defined(CONFIG_TONE_STREAM_RAW_TX)
+	/* The raw TX header selects the queue, so QoS does not apply */
+	if (stream->sock_transport == TONE_TRANSPORT_RAW) {
+		return transmit_raw(stream, slot);
+	}
+#endif
+
+	if (slot->qos != stream->sock_qos) {
+		/* A failure is reported once; the stream keeps sending in the old class */
+		int ret = set_socket_qos(stream->sock_fd, stream->sock_family, slot->qos);
+
+		if (ret < 0) {
+			LOG_WRN("Stream %u QoS %s not applied: %d", stream->id,
+				qos_classes[slot->qos].name, ret);
+		}
+		stream->sock_qos = slot->qos;
+	}
+
+	slot->prefix.header.timestamp_us =
+		sys_cpu_to_be32((uint32_t)(micros_now() & 0xFFFFFFFFU));
+
+	struct iovec iov[] = {
+		{
+			.iov_base = &slot->prefix,
+			.iov_len = slot->prefix_len,
+		},
+		{
+			.iov_base = slot->pcm,
+			.iov_len = slot->payload_len,
+		},
+	};
+	struct msghdr msg = {
+		.msg_iov = iov,
+		.msg_iovlen = ARRAY_SIZE(iov),
+	};
+
+	return (sendmsg(stream->sock_fd, &msg, 0) < 0) ? -errno : 0;
+}
+
+static void release_slot(struct tone_tx_slot *slot)
+{
+	ARG_UNUSED(slot);
+}
+#endif /* CONFIG_TONE_STREAM_ZEROCOPY */
+
+/* Histogram bucket holding a value: floor(log2(us)), 0 and 1 us share bucket 0 */
+static inline uint32_t stats_bucket(uint32_t us)
+{
+	uint32_t bucket = (us > 1U) ? (31U - (uint32_t)__builtin_clz(us)) : 0U;
+
+	return MIN(bucket, TONE_STATS_HIST_BUCKETS - 1U);
+}
+
+/* Upper bound of the bucket holding the pct-th percentile, UINT32_MAX when open ended */
+static uint32_t hist_percentile_bound(const uint32_t *hist, uint32_t count, uint32_t pct)
+{
+	const uint64_t rank = DIV_ROUND_UP((uint64_t)count * pct, 100U);
+	uint64_t seen = 0U;
+
+	for (uint32_t i = 0; i < TONE_STATS_HIST_BUCKETS - 1U; i++) {
+		seen += hist[i];
+		if (seen >= rank) {
+			return BIT(i + 1U) - 1U;
+		}
+	}
+
+	return UINT32_MAX;
+}
+
+static void stats_reset(struct tone_stream_context *stream)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	memset(&stream->stats, 0, sizeof(stream->stats));
+	stream->pacing_err_sum_us = 0;
+	stream->synth_us_sum = 0U;
+	stream->twt_hold_sum_us = 0U;
+	memset(stream->ac_send_sum_us, 0, sizeof(stream->ac_send_sum_us));
+	memset(stream->ac_send_hist, 0, sizeof(stream->ac_send_hist));
+	stream->stats_start_us = micros_now();
+	stream->stats_last_us = stream->stats_start_us;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_alloc_failure(struct tone_stream_context *stream)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	stream->stats.synth_alloc_failures++;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_packet(struct tone_stream_context *stream,
+				const struct tone_tx_slot *slot, uint32_t synth_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+	struct tone_stream_stats *stats = &stream->stats;
+
+	stats->packets_built++;
+	stats->pcm_bytes += slot->samples * slot->frame_bytes;
+	stats->payload_bytes += slot->payload_len;
+	if (slot->prefix.ext.codec != stream->synth.ext.codec) {
+		stats->codec_fallbacks++;
+	}
+	stats->max_synth_us = MAX(stats->max_synth_us, synth_us);
+	stream->synth_us_sum += synth_us;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_parity(struct tone_stream_context *stream, uint32_t bytes)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	stream->stats.fec_bytes += bytes;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_adaptation(struct tone_stream_context *stream)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	stream->stats.adaptations++;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_underruns(struct tone_stream_context *stream, uint32_t count)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	stream->stats.tx_underruns += count;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void stats_record_twt_hold(struct tone_stream_context *stream, uint32_t held_us)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	stream->stats.twt_packets++;
+	stream->stats.twt_hold_max_us = MAX(stream->stats.twt_hold_max_us, held_us);
+	stream->twt_hold_sum_us += held_us;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+/*
+ * Pacing error is measured against the wakeup time the scheduler armed for
+ * the stream, lateness against the stream deadline the wakeup serves.
+ */
+static void stats_record_wakeup(struct tone_stream_context *stream, uint64_t now)
+{
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+	struct tone_stream_stats *stats = &stream->stats;
+	uint32_t late_us =
+		(now > stream->next_deadline_us)
+			? (uint32_t)MIN(now - stream->next_deadline_us, (uint64_t)UINT32_MAX)
+			: 0U;
+
+	stats->wakeups++;
+	stats->lateness_hist[stats_bucket(late_us)]++;
+	stats->max_lateness_us = MAX(stats->max_lateness_us, late_us);
+	if (late_us > CONFIG_TONE_STREAM_LATE_THRESHOLD_US) {
+		stats->late_wakeups++;
+	}
+
+	int32_t err_us = (int32_t)CLAMP((int64_t)(now - stream->wakeup_us), INT32_MIN, INT32_MAX);
+
+	if (stats->pacing_err_count == 0U) {
+		stats->pacing_err_min_us = err_us;
+		stats->pacing_err_max_us = err_us;
+	} else {
+		stats->pacing_err_min_us = MIN(stats->pacing_err_min_us, err_us);
+		stats->pacing_err_max_us = MAX(stats->pacing_err_max_us, err_us);
+	}
+	stream->pacing_err_sum_us += err_us;
+	stats->pacing_err_count++;
+
+	stream->stats_last_us = now;
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+static void record_send_result(struct tone_stream_context *stream, const struct tone_tx_slot *slot,
+			       int err, uint32_t duration_us)
+{
+	const enum tone_qos qos = slot->qos;
+
+	if (err == 0 && engine.boot.first_packet_ms == 0U) {
+		engine.boot.first_packet_ms = k_uptime_get_32();
+	}
+
+#if defined(CONFIG_TONE_STREAM_LINK)
+	if (!slot_is_control(slot)) {
+		uint32_t seq = sys_be32_to_cpu(slot->prefix.header.seq);
+
+		atomic_set(&stream->link_seq, (atomic_val_t)(seq + 1U));
+	}
+#endif
+
+	if (err < 0) {
+		stream->consecutive_send_failures++;
+		if (stream->consecutive_send_failures <= 3) {
+			LOG_DBG("Stream %u send() failed: %d (attempt %u)", stream->id, err,
+				stream->consecutive_send_failures);
+		}
+		if (stream->consecutive_send_failures == 3) {
+			LOG_WRN("Stream %u UDP send failing repeatedly (err %d). Retrying...",
+				stream->id, err);
+		}
+	} else {
+		stream->consecutive_send_failures = 0;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+	struct tone_stream_stats *stats = &stream->stats;
+
+	stats->send_hist[stats_bucket(duration_us)]++;
+	stats->max_send_us = MAX(stats->max_send_us, duration_us);
+	stats->ac[qos].sends++;
+	stats->ac[qos].max_us = MAX(stats->ac[qos].max_us, duration_us);
+	stream->ac_send_sum_us[qos] += duration_us;
+	stream->ac_send_hist[qos][stats_bucket(duration_us)]++;
+	stats->consecutive_send_failures = stream->consecutive_send_failures;
+	if (err == 0 && slot_is_link(slot)) {
+		stats->link_packets++;
+	} else if (err == 0 && slot_is_control(slot)) {
+		stats->fec_packets++;
+	} else if (err == 0) {
+		stats->packets_sent++;
+	} else if (err == -ENOMEM || err == -ENOBUFS) {
+		stats->send_err_nomem++;
+	} else if (err == -EAGAIN) {
+		stats->send_err_again++;
+	} else {
+		stats->send_err_other++;
+	}
+
+	k_spin_unlock(&stream->stats_lock, key);
+}
+
+#if defined(CONFIG_TONE_STREAM_FEC)
+/* New group parameters drop the partial groups; their losses go unprotected */
+static void fec_sync_settings(struct tone_stream_context *stream,
+			      const struct tone_stream_settings *settings)
+{
+	if (settings->fec_group == stream->synth.fec.group &&
+	    settings->fec_depth == stream->synth.fec.depth) {
+		return;
+	}
+
+	stream->synth.fec.group = settings->fec_group;
+	stream->synth.fec.depth = settings->fec_depth;
+	stream->synth.fec.lane = 0U;
+	stream->synth.fec.pending = 0U;
+	for (uint32_t i = 0; i < ARRAY_SIZE(stream->synth.fec.lanes); i++) {
+		stream->synth.fec.lanes[i].packets = 0U;
+		stream->synth.fec.lanes[i].max_len = 0U;
+		stream->synth.fec.lanes[i].length_xor = 0U;
+	}
+}
+
+/* Fold a data packet into its lane; a full group queues its parity next */
+static void fec_add(struct tone_stream_context *stream, const struct tone_tx_slot *slot)
+{
+	if (stream->synth.fec.group == 0U) {
+		return;
+	}
+
+	struct tone_fec_lane *lane = &stream->synth.fec.lanes[stream->synth.fec.lane];
+	const uint16_t len = slot->prefix_len + slot->payload_len;
+
+	if (lane->packets == 0U) {
+		lane->base_seq = sys_be32_to_cpu(slot->prefix.header.seq);
+	}
+	if (len > lane->max_len) {
+		memset(&lane->parity[lane->max_len], 0, len - lane->max_len);
+		lane->max_len = len;
+	}
+
+	fec_xor_slot(lane->parity, slot);
+	lane->length_xor ^= len;
+
+	if (++lane->packets == stream->synth.fec.group) {
+		stream->synth.fec.pending = stream->synth.fec.lane + 1U;
+	}
+	stream->synth.fec.lane = (stream->synth.fec.lane + 1U) % stream->synth.fec.depth;
+}
+
+static bool fec_parity_pending(const struct tone_stream_context *stream)
+{
+	return stream->synth.fec.pending != 0U;
+}
+
+/* Turn the completed group into a parity packet in slot */
+static int fec_emit(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+		    atomic_val_t head, const struct tone_stream_settings *settings)
+{
+	struct tone_fec_lane *lane = &stream->synth.fec.lanes[stream->synth.fec.pending - 1U];
+
+	slot->samples = 0U;
+	slot->sample_rate_hz = stream->synth.sample_rate_hz;
+	slot->qos = settings->qos;
+	slot->frame_bytes = 0U;
+	slot->prefix.header = (struct tone_packet_header){
+		.seq = sys_cpu_to_be32(lane->base_seq),
+	};
+	slot->prefix.fec = (struct tone_fec_header_ext){
+		.magic = sys_cpu_to_be16(TONE_FEC_EXT_MAGIC),
+		.version = TONE_FEC_EXT_VERSION,
+		.length = sizeof(struct tone_fec_header_ext),
+		.group_packets = lane->packets,
+		.stride = stream->synth.fec.depth,
+		.length_xor = sys_cpu_to_be16(lane->length_xor),
+	};
+	slot->prefix_len = sizeof(slot->prefix);
+	slot->payload_len = lane->max_len;
+
+	int ret = produce_control(stream, slot, lane->parity, head, settings);
+	if (ret < 0) {
+		return ret;
+	}
+
+	stats_record_parity(stream, slot->payload_len);
+	lane->packets = 0U;
+	lane->max_len = 0U;
+	lane->length_xor = 0U;
+	stream->synth.fec.pending = 0U;
+
+	return 0;
+}
+#else
+static inline void fec_sync_settings(struct tone_stream_context *stream,
+				     const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(stream);
+	ARG_UNUSED(settings);
+}
+
+static inline void fec_add(struct tone_stream_context *stream, const struct tone_tx_slot *slot)
+{
+	ARG_UNUSED(stream);
+	ARG_UNUSED(slot);
+}
+
+static inline bool fec_parity_pending(const struct tone_stream_context *stream)
+{
+	ARG_UNUSED(stream);
+	return false;
+}
+
+static inline int fec_emit(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			   atomic_val_t head, const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(stream);
+	ARG_UNUSED(slot);
+	ARG_UNUSED(head);
+	ARG_UNUSED(settings);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_TONE_STREAM_FEC */
+
+#if defined(CONFIG_TONE_STREAM_LINK)
+/* Cleared either way, so turning reports on never sends a stale sample */
+static bool link_report_pending(struct tone_stream_context *stream,
+				const struct tone_stream_settings *settings)
+{
+	return atomic_clear(&stream->link_pending) != 0 && settings->link_report != 0U;
+}
+
+/* Turn the newest link sample into a report of this stream's packets in it */
+static int link_emit(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+		     atomic_val_t head, const struct tone_stream_settings *settings)
+{
+	struct tone_link_sample sample;
+	k_spinlock_key_t key = k_spin_lock(&link.lock);
+
+	/* Pending is only ever set after a sample is stored */
+	sample = link.ring[(link.taken - 1U) % LINK_SAMPLES];
+	k_spin_unlock(&link.lock, key);
+
+	const struct tone_link_report report = {
+		.uptime_ms = sys_cpu_to_be32(sample.uptime_ms),
+		.first_seq = sys_cpu_to_be32(sample.end_seq[stream->id] -
+					     sample.packets[stream->id]),
+		.end_seq = sys_cpu_to_be32(sample.end_seq[stream->id]),
+		.tx_packets = sys_cpu_to_be32(sample.tx_packets),
+		.phy_rate_kbps = sys_cpu_to_be32(sample.phy_rate_kbps),
+		.tx_errors = sys_cpu_to_be16(sample.tx_errors),
+		.tx_overruns = sys_cpu_to_be16(sample.tx_overruns),
+		.beacons_missed = sys_cpu_to_be16(sample.beacons_missed),
+		.rssi_dbm = sample.rssi_dbm,
+		.flags = sample.connected ? TONE_LINK_CONNECTED : 0U,
+	};
+
+	slot->samples = 0U;
+	slot->sample_rate_hz = stream->synth.sample_rate_hz;
+	slot->qos = settings->qos;
+	slot->frame_bytes = 0U;
+	slot->prefix.header = (struct tone_packet_header){
+		.seq = sys_cpu_to_be32(stream->synth.seq_num),
+		.sample_count = sys_cpu_to_be32(stream->synth.sample_counter),
+	};
+	slot->prefix.link = (struct tone_link_header_ext){
+		.magic = sys_cpu_to_be16(TONE_LINK_EXT_MAGIC),
+		.version = TONE_LINK_EXT_VERSION,
+		.length = sizeof(struct tone_link_header_ext),
+		.stream_id = stream->id,
+		.period_ms = sys_cpu_to_be16(CONFIG_TONE_STREAM_LINK_PERIOD_MS),
+	};
+	slot->prefix_len = sizeof(slot->prefix);
+	slot->payload_len = sizeof(report);
+
+	return produce_control(stream, slot, (const uint8_t *)&report, head, settings);
+}
+#else
+static inline bool link_report_pending(struct tone_stream_context *stream,
+				       const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(stream);
+	ARG_UNUSED(settings);
+	return false;
+}
+
+static inline int link_emit(struct tone_stream_context *stream, struct tone_tx_slot *slot,
+			    atomic_val_t head, const struct tone_stream_settings *settings)
+{
+	ARG_UNUSED(stream);
+	ARG_UNUSED(slot);
+	ARG_UNUSED(head);
+	ARG_UNUSED(settings);
+	return -ENOTSUP;
+}
+#endif /* CONFIG_TONE_STREAM_LINK */
+
+/* Extension of the settings' data packets; zero length for legacy mono 16-bit PCM */
+static struct tone_packet_header_ext header_ext_for(const struct tone_stream_settings *settings)
+{
+	if (settings->channels == 1U && settings->sample_format == TONE_SAMPLE_S16 &&
+	    settings->codec == TONE_CODEC_PCM && settings->adapt_max_ms == 0U) {
+		return (struct tone_packet_header_ext){0};
+	}
+
+	return (struct tone_packet_header_ext){
+		.magic = sys_cpu_to_be16(TONE_HDR_EXT_MAGIC),
+		.version = TONE_HDR_EXT_VERSION,
+		.length = sizeof(struct tone_packet_header_ext),
+		.channels = settings->channels,
+		.bits_per_sample = sample_layouts[settings->sample_format].bits,
+		.codec = settings->codec,
+	};
+}
+
+static void synth_refresh_settings(struct tone_stream_context *stream,
+				   struct tone_stream_settings *settings)
+{
+	atomic_val_t seq = settings_snapshot(stream, settings);
+
+	if (seq == stream->synth.settings_seq) {
+		return;
+	}
+
+	update_channel_ncos(stream->synth.nco, settings);
+
+	stream->synth.channels = settings->channels;
+	stream->synth.sample_bytes = sample_layouts[settings->sample_format].bytes;
+	stream->synth.format = settings->sample_format;
+	stream->synth.kernel = synth_kernel_for(settings->channels, settings->sample_format);
+#if defined(CONFIG_TONE_STREAM_WAVEFORMS)
+	wave_configure(&stream->synth.wave, settings);
+#endif
+	stream->synth.adapt_min_ms = settings->adapt_min_ms;
+	stream->synth.adapt_max_ms = settings->adapt_max_ms;
+
+#if defined(CONFIG_TONE_STREAM_CODEC)
+	stream->synth.codec = settings->codec;
+#endif
+	fec_sync_settings(stream, settings);
+	stream->synth.ext = header_ext_for(settings);
+
+	stream->synth.samples_per_packet = samples_for(settings);
+	stream->synth.sample_rate_hz = settings->sample_rate_hz;
+	stream->synth.burst_packets = settings->burst_packets;
+	stream->synth.settings_seq = seq;
+}
+
+/* Frames for the next packet: the configured duration, or the adaptive target */
+static uint32_t synth_packet_frames(struct tone_stream_context *stream)
+{
+	atomic_val_t target = atomic_get(&stream->adapt_target);
+
+	if (target == 0 || stream->synth.adapt_max_ms == 0U) {
+		return stream->synth.samples_per_packet;
+	}
+
+	/* The bounds may have moved under a target the TX stage has yet to revise */
+	uint32_t packet_ms = CLAMP((uint32_t)target & 0xFFFFU, stream->synth.adapt_min_ms,
+				   stream->synth.adapt_max_ms);
+
+	stream->synth.ext.adapt_epoch = (uint8_t)(target >> 16);
+
+	return DIV_ROUND_CLOSEST(stream->synth.sample_rate_hz * packet_ms, 1000U);
+}
+
+/* Keep one stream's TX ring filled a few packets ahead */
+static void synth_fill_stream(struct tone_stream_context *stream)
+{
+	struct tone_stream_settings settings;
+
+	synth_refresh_settings(stream, &settings);
+
+	uint32_t target = MIN(TX_RING_SLOTS,
+			      stream->synth.burst_packets + CONFIG_TONE_STREAM_LOOKAHEAD_PACKETS);
+
+	if (settings.twt_align) {
+		/* Audio accrues over a whole TWT interval before it is sent */
+		target = TX_RING_SLOTS;
+	}
+
+	atomic_val_t head = atomic_get(&stream->ring_head);
+
+	while ((uint32_t)(head - atomic_get(&stream->ring_tail)) < target) {
+		struct tone_tx_slot *slot = &stream->tx_ring[head & TX_RING_MASK];
+
+		if (fec_parity_pending(stream)) {
+			/* Parity directly follows its group; no data joins a lane before it */
+			if (fec_emit(stream, slot, head, &settings) < 0) {
+				stats_record_alloc_failure(stream);
+				break;
+			}
+			head++;
+			atomic_set(&stream->ring_head, head);
+			continue;
+		}
+
+		if (link_report_pending(stream, &settings)) {
+			/* Without a buffer the report is skipped; the next sample sends one */
+			if (link_emit(stream, slot, head, &settings) < 0) {
+				stats_record_alloc_failure(stream);
+				break;
+			}
+			head++;
+			atomic_set(&stream->ring_head, head);
+			continue;
+		}
+
+		const uint32_t samples = synth_packet_frames(stream);
+
+		slot->samples = samples;
+		slot->sample_rate_hz = stream->synth.sample_rate_hz;
+		slot->qos = settings.qos;
+		build_prefix(stream, slot);
+		slot->payload_len = payload_capacity(slot->prefix.ext.codec, samples,
+						     stream->synth.channels, slot->frame_bytes);
+
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+		slot->pcm = pcm_alloc(stream, slot->payload_len, head,
+				      atomic_get(&stream->ring_tail));
+		if (!slot->pcm) {
+			stream->synth.seq_num--;
+			stream->synth.sample_counter -= samples;
+			break;
+		}
+#endif
+
+		uint64_t synth_start_us = micros_now();
+
+		TONE_TRACE("synth_enter", stream->id, sys_be32_to_cpu(slot->prefix.header.seq));
+		int ret = produce_packet(stream, slot, &settings);
+		TONE_TRACE("synth_exit", stream->id, slot->payload_len);
+		if (ret < 0) {
+			/* Out of buffers or without a route; the next TX wakeup retries */
+			stats_record_alloc_failure(stream);
+			stream->synth.seq_num--;
+			stream->synth.sample_counter -= samples;
+			break;
+		}
+
+		stats_record_packet(stream, slot, (uint32_t)(micros_now() - synth_start_us));
+		fec_add(stream, slot);
+
+		head++;
+		atomic_set(&stream->ring_head, head);
+	}
+}
+
+/* Synthesis stage: refill every active stream, off the deadline path */
+static void synth_work_handler(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (atomic_get(&streams[i].streaming) && !stream_offloaded(&streams[i])) {
+			synth_fill_stream(&streams[i]);
+		}
+	}
+}
+
+static void flush_tx_ring(struct tone_stream_context *stream)
+{
+	atomic_val_t tail = atomic_get(&stream->ring_tail);
+	atomic_val_t head = atomic_get(&stream->ring_head);
+
+	for (; tail != head; tail++) {
+		release_slot(&stream->tx_ring[tail & TX_RING_MASK]);
+	}
+
+	atomic_set(&stream->ring_head, 0);
+	atomic_set(&stream->ring_tail, 0);
+	stream->synth.pcm_write = 0U;
+}
+
+/*
+ * Deadline of the packet starting at samples into the current rate. Derived
+ * from the total sample count rather than by adding interval_us, so its
+ * truncation never accumulates into rate drift.
+ */
+static uint64_t deadline_at(const struct tone_stream_context *stream, uint64_t samples)
+{
+	return stream->deadline_base_us + (samples * USEC_PER_SEC) / stream->tx_rate_hz;
+}
+
+static void reschedule_next_packet(struct tone_stream_context *stream, uint32_t samples_sent)
+{
+	uint64_t now = micros_now();
+
+	stream->deadline_samples += samples_sent;
+	stream->next_deadline_us = deadline_at(stream, stream->deadline_samples);
+
+	stream->wakeup_us = (stream->next_deadline_us > now) ? stream->next_deadline_us
+							     : now + stream->interval_us;
+}
+
+static void rebase_deadline(struct tone_stream_context *stream, const struct tone_tx_slot *slot)
+{
+	stream->deadline_base_us =
+		(stream->next_deadline_us != 0U) ? stream->next_deadline_us : micros_now();
+	stream->deadline_samples = 0U;
+	stream->tx_rate_hz = slot->sample_rate_hz;
+	stream->interval_samples = 0U;
+}
+
+/* Packets may change size at any time; deadlines follow the sample count regardless */
+static void track_interval(struct tone_stream_context *stream, const struct tone_tx_slot *slot)
+{
+	if (slot->samples != stream->interval_samples) {
+		stream->interval_samples = slot->samples;
+		stream->interval_us =
+			(uint32_t)(((uint64_t)slot->samples * USEC_PER_SEC) / slot->sample_rate_hz);
+	}
+}
+
+static void adapt_publish(struct tone_stream_context *stream)
+{
+	atomic_set(&stream->adapt_target,
+		   ((atomic_val_t)stream->adapt.epoch << 16) | stream->adapt.packet_ms);
+}
+
+/* Follow the configured bounds; new bounds restart from the configured duration */
+static void adapt_sync_settings(struct tone_stream_context *stream,
+				const struct tone_stream_settings *settings)
+{
+	if (settings->adapt_min_ms == stream->adapt.min_ms &&
+	    settings->adapt_max_ms == stream->adapt.max_ms) {
+		return;
+	}
+
+	stream->adapt.min_ms = settings->adapt_min_ms;
+	stream->adapt.max_ms = settings->adapt_max_ms;
+	stream->adapt.window_packets = 0U;
+	stream->adapt.clean_windows = 0U;
+	stream->adapt.congested = false;
+
+	if (stream->adapt.max_ms == 0U) {
+		atomic_set(&stream->adapt_target, 0);
+		return;
+	}
+
+	stream->adapt.packet_ms =
+		CLAMP(settings->packet_duration_ms, stream->adapt.min_ms, stream->adapt.max_ms);
+	stream->adapt.epoch++;
+	adapt_publish(stream);
+}
+
+/*
+ * Adaptive sizing controller, fed every send. A window with errors or with a
+ * send blocking for a sizeable part of the packet interval grows packets by
+ * half, trading latency for fewer per-packet channel accesses; sustained
+ * clean windows shrink them back 1 ms at a time. The synthesis stage applies
+ * the new size from its next packet, and the ring smooths the transition
+ * since deadlines derive from the sample count.
+ */
+static void adapt_record_send(struct tone_stream_context *stream, int err, uint32_t duration_us)
+{
+	if (stream->adapt.max_ms == 0U) {
+		return;
+	}
+
+	if (err == -ENOMEM || err == -ENOBUFS || err == -EAGAIN ||
+	    (uint64_t)duration_us * 100U >
+		    (uint64_t)stream->interval_us * CONFIG_TONE_STREAM_ADAPT_LATENCY_PCT) {
+		stream->adapt.congested = true;
+	}
+
+	if (++stream->adapt.window_packets < CONFIG_TONE_STREAM_ADAPT_WINDOW_PACKETS) {
+		return;
+	}
+
+	uint16_t packet_ms = stream->adapt.packet_ms;
+
+	if (stream->adapt.congested) {
+		packet_ms = MIN(stream->adapt.max_ms, MAX(packet_ms + 1U, packet_ms * 3U / 2U));
+		stream->adapt.clean_windows = 0U;
+	} else if (++stream->adapt.clean_windows >= ADAPT_SHRINK_WINDOWS) {
+		packet_ms = MAX(stream->adapt.min_ms, packet_ms - 1U);
+		stream->adapt.clean_windows = 0U;
+	}
+
+	stream->adapt.window_packets = 0U;
+	stream->adapt.congested = false;
+
+	if (packet_ms != stream->adapt.packet_ms) {
+		LOG_INF("Stream %u packet duration %u -> %u ms", stream->id,
+			stream->adapt.packet_ms, packet_ms);
+		stream->adapt.packet_ms = packet_ms;
+		stream->adapt.epoch++;
+		adapt_publish(stream);
+		stats_record_adaptation(stream);
+	}
+}
+
+#if defined(CONFIG_TONE_STREAM_TWT)
+static void twt_update_agreement(const struct wifi_twt_params *params, uint64_t now)
+{
+	k_spinlock_key_t key;
+
+	if (params->operation == WIFI_TWT_SETUP) {
+		if (params->resp_status != WIFI_TWT_RESP_RECEIVED ||
+		    params->setup_cmd != WIFI_TWT_SETUP_CMD_ACCEPT ||
+		    params->setup.twt_interval == 0U) {
+			return;
+		}
+
+		key = k_spin_lock(&twt.lock);
+		twt.agreed = true;
+		twt.awake = false;
+		twt.flow_id = params->flow_id;
+		twt.wake_us = params->setup.twt_wake_interval;
+		twt.interval_us = params->setup.twt_interval;
+		twt.sp_start_us = 0U;
+		twt.since_us = now;
+		twt.awake_sum_us = 0U;
+		twt.service_periods = 0U;
+		k_spin_unlock(&twt.lock, key);
+
+		LOG_INF("TWT flow %u: %u us service period every %llu us", params->flow_id,
+			params->setup.twt_wake_interval,
+			(unsigned long long)params->setup.twt_interval);
+	} else if (params->operation == WIFI_TWT_TEARDOWN) {
+		key = k_spin_lock(&twt.lock);
+		bool ours = twt.agreed &&
+			    (params->teardown.teardown_all || params->flow_id == twt.flow_id);
+
+		if (ours) {
+			twt.agreed = false;
+			twt.awake = false;
+		}
+		k_spin_unlock(&twt.lock, key);
+
+		if (!ours) {
+			return;
+		}
+
+		LOG_INF("TWT flow %u torn down, aligned streams pace normally", params->flow_id);
+	} else {
+		return;
+	}
+
+	/* Held streams re-evaluate their wakeup against the new schedule */
+	atomic_set(&twt.kick, 1);
+	pacing_kick();
+}
+
+static void twt_update_sleep_state(int state, uint64_t now)
+{
+	bool woke = false;
+	k_spinlock_key_t key = k_spin_lock(&twt.lock);
+
+	if (twt.agreed && state == WIFI_TWT_STATE_AWAKE && !twt.awake) {
+		twt.awake = true;
+		twt.sp_start_us = now;
+		twt.service_periods++;
+		woke = true;
+	} else if (twt.agreed && state == WIFI_TWT_STATE_SLEEP && twt.awake) {
+		twt.awake = false;
+		twt.awake_sum_us += now - twt.sp_start_us;
+	}
+
+	k_spin_unlock(&twt.lock, key);
+
+	if (woke) {
+		atomic_set(&twt.kick, 1);
+		pacing_kick();
+	}
+}
+
+static void twt_event_handler(struct net_mgmt_event_callback *cb, uint64_t mgmt_event,
+			      struct net_if *iface)
+{
+	ARG_UNUSED(iface);
+
+	uint64_t now = micros_now();
+
+	if (mgmt_event == NET_EVENT_WIFI_TWT &&
+	    cb->info_length >= sizeof(struct wifi_twt_params)) {
+		twt_update_agreement(cb->info, now);
+	} else if (mgmt_event == NET_EVENT_WIFI_TWT_SLEEP_STATE &&
+		   cb->info_length >= sizeof(int)) {
+		twt_update_sleep_state(*(const int *)cb->info, now);
+	}
+}
+
+static void twt_init(void)
+{
+	if (twt.cb_added) {
+		return;
+	}
+
+	net_mgmt_init_event_callback(&twt.cb, twt_event_handler,
+				     NET_EVENT_WIFI_TWT | NET_EVENT_WIFI_TWT_SLEEP_STATE);
+	net_mgmt_add_event_callback(&twt.cb);
+	twt.cb_added = true;
+}
+
+/*
+ * Earliest time at or after at_us inside a service period: at_us itself
+ * while the radio is awake for it or without a known schedule, else the
+ * start of the next predicted service period.
+ */
+static uint64_t twt_align(uint64_t at_us)
+{
+	uint64_t now = micros_now();
+	uint64_t aligned = at_us;
+	k_spinlock_key_t key = k_spin_lock(&twt.lock);
+
+	if (twt.agreed && twt.sp_start_us != 0U && at_us > twt.sp_start_us &&
+	    !(twt.awake && at_us <= now)) {
+		uint64_t phase = (at_us - twt.sp_start_us) % twt.interval_us;
+
+		if (phase >= twt.wake_us) {
+			aligned = at_us + (twt.interval_us - phase);
+		}
+	}
+
+	k_spin_unlock(&twt.lock, key);
+
+	return aligned;
+}
+
+/* A service period started or the schedule changed: wake streams holding due packets */
+static void twt_release_held(uint64_t now)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		struct tone_stream_context *stream = &streams[i];
+
+		if (atomic_get(&stream->streaming) && stream->twt_aligned &&
+		    stream->wakeup_us > now && stream->next_deadline_us <= now) {
+			stream->wakeup_us = now;
+		}
+	}
+}
+
+static void twt_status(const struct shell *shell)
+{
+	k_spinlock_key_t key = k_spin_lock(&twt.lock);
+	bool agreed = twt.agreed;
+	uint8_t flow_id = twt.flow_id;
+	uint32_t wake_us = twt.wake_us;
+	uint64_t interval_us = twt.interval_us;
+	uint32_t service_periods = twt.service_periods;
+	uint64_t now = micros_now();
+	uint64_t awake_us = twt.awake_sum_us + (twt.awake ? now - twt.sp_start_us : 0U);
+	uint64_t span_us = now - twt.since_us;
+
+	k_spin_unlock(&twt.lock, key);
+
+	if (!agreed) {
+		shell_print(shell, "TWT: no agreement, aligned streams pace normally");
+		return;
+	}
+
+	uint32_t nominal_pm = (uint32_t)(((uint64_t)wake_us * 1000U) / interval_us);
+
+	if (service_periods == 0U) {
+		shell_print(shell,
+			    "TWT: flow %u, %u us every %llu us (%u.%u%% awake), "
+			    "no service period reported yet",
+			    flow_id, wake_us, (unsigned long long)interval_us, nominal_pm / 10U,
+			    nominal_pm % 10U);
+		return;
+	}
+
+	uint32_t duty_pm = (span_us > 0U) ? (uint32_t)((awake_us * 1000U) / span_us) : 0U;
+
+	shell_print(shell,
+		    "TWT: flow %u, %u us every %llu us, radio awake %u.%u%% (negotiated %u.%u%%) "
+		    "over %u service periods",
+		    flow_id, wake_us, (unsigned long long)interval_us, duty_pm / 10U,
+		    duty_pm % 10U, nominal_pm / 10U, nominal_pm % 10U, service_periods);
+}
+#else
+static inline uint64_t twt_align(uint64_t at_us)
+{
+	return at_us;
+}
+#endif /* CONFIG_TONE_STREAM_TWT */
+
+/*
+ * Drain up to one burst of ready packets from a stream whose wakeup is due.
+ * A TWT-aligned stream instead drains every packet that has fallen due and
+ * pushes its next wakeup into a service period, so audio accrues in the
+ * ring while the radio sleeps. Parity packets go out right behind the data
+ * they protect and, like link reports, count neither towards the burst nor
+ * the deadlines.
+ */
+static void serve_stream(struct tone_stream_context *stream, uint64_t now)
+{
+	struct tone_stream_settings settings;
+
+	TONE_TRACE("wakeup", stream->id,
+		   (uint32_t)MIN(now - stream->wakeup_us, (uint64_t)UINT32_MAX));
+	stats_record_wakeup(stream, now);
+	(void)settings_snapshot(stream, &settings);
+	adapt_sync_settings(stream, &settings);
+	stream->twt_aligned = settings.twt_align != 0U;
+
+	const bool aligned = stream->twt_aligned;
+	const uint32_t burst = aligned ? TX_RING_SLOTS : settings.burst_packets;
+	atomic_val_t tail = atomic_get(&stream->ring_tail);
+	atomic_val_t head = atomic_get(&stream->ring_head);
+	uint32_t samples_sent = 0U;
+	uint32_t packets = 0U;
+
+	while (tail != head) {
+		struct tone_tx_slot *slot = &stream->tx_ring[tail & TX_RING_MASK];
+		const bool control = slot_is_control(slot);
+
+		if (!control) {
+			if (packets >= burst) {
+				break;
+			}
+			if (slot->sample_rate_hz != stream->tx_rate_hz) {
+				/* Rate changed: finish this burst, restart deadline accounting */
+				if (packets > 0U) {
+					break;
+				}
+				rebase_deadline(stream, slot);
+			}
+			track_interval(stream, slot);
+		}
+
+		uint64_t send_start_us = micros_now();
+
+		if (aligned && !control) {
+			uint64_t due_us =
+				deadline_at(stream, stream->deadline_samples + samples_sent);
+
+			if (due_us > send_start_us) {
+				/* Not accrued yet */
+				break;
+			}
+			stats_record_twt_hold(stream, (uint32_t)MIN(send_start_us - due_us,
+								    (uint64_t)UINT32_MAX));
+		}
+
+		TONE_TRACE("send_enter", stream->id, sys_be32_to_cpu(slot->prefix.header.seq));
+		int err = transmit_slot(stream, slot);
+		uint32_t send_us = (uint32_t)(micros_now() - send_start_us);
+
+		TONE_TRACE("send_exit", stream->id, (uint32_t)err);
+
+		record_send_result(stream, slot, err, send_us);
+		adapt_record_send(stream, err, send_us);
+		if (!control) {
+			samples_sent += slot->samples;
+			packets++;
+		}
+		tail++;
+		atomic_set(&stream->ring_tail, tail);
+	}
+
+	if (packets == 0U && tail == head) {
+		stats_record_underruns(stream, 1U);
+		stream->wakeup_us = micros_now() + TX_UNDERRUN_RETRY_US;
+	} else if (packets == 0U) {
+		/* Aligned stream woken before its next packet fell due */
+		stream->wakeup_us = stream->next_deadline_us;
+	} else {
+		reschedule_next_packet(stream, samples_sent);
+	}
+
+	if (aligned) {
+		if (packets > 0U && tail == head && stream->next_deadline_us <= micros_now()) {
+			/* More fell due than the ring holds: drain as synthesis refills it */
+			stats_record_underruns(stream, 1U);
+			stream->wakeup_us = micros_now() + TX_UNDERRUN_RETRY_US;
+		}
+		stream->wakeup_us = twt_align(stream->wakeup_us);
+	}
+}
+
+/* Active stream with the earliest pending wakeup, NULL when none is pending */
+static struct tone_stream_context *earliest_wakeup(void)
+{
+	struct tone_stream_context *earliest = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		struct tone_stream_context *stream = &streams[i];
+
+		if (!atomic_get(&stream->streaming) || stream->wakeup_us == 0U ||
+		    stream_offloaded(stream)) {
+			continue;
+		}
+
+		if (!earliest || stream->wakeup_us < earliest->wakeup_us) {
+			earliest = stream;
+		}
+	}
+
+	return earliest;
+}
+
+/*
+ * TX stage: serve every stream whose wakeup is due in earliest-deadline-first
+ * order, then arm the pacing backend once for the earliest remaining wakeup.
+ */
+static void send_work_handler(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	struct tone_stream_context *stream;
+	bool served = false;
+
+	k_mutex_lock(&engine.tx_lock, K_FOREVER);
+
+#if defined(CONFIG_TONE_STREAM_TWT)
+	if (atomic_cas(&twt.kick, 1, 0)) {
+		twt_release_held(micros_now());
+	}
+#endif
+
+	while ((stream = earliest_wakeup()) != NULL) {
+		uint64_t now = micros_now();
+
+		if (stream->wakeup_us > now) {
+			break;
+		}
+
+		if (destination_socket_open(stream)) {
+			serve_stream(stream, now);
+			served = true;
+		} else {
+			stream->wakeup_us = 0U;
+		}
+	}
+
+	if (served) {
+		/* Refill behind the packets just sent, off the deadline path */
+		k_work_submit_to_queue(&tone_stream_work_q, &engine.synth_work);
+	}
+
+	if (stream) {
+		uint64_t now = micros_now();
+		uint64_t delay_us = (stream->wakeup_us > now) ? (stream->wakeup_us - now) : 0U;
+
+		TONE_TRACE("reschedule", stream->id, (uint32_t)MIN(delay_us, (uint64_t)UINT32_MAX));
+		pacing_arm(stream->wakeup_us, (uint32_t)CLAMP(delay_us, 1U, (uint64_t)UINT32_MAX));
+	}
+
+	k_mutex_unlock(&engine.tx_lock);
+}
+
+#if defined(CONFIG_TONE_STREAM_PACING_COUNTER)
+static void tone_pacing_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		k_sem_take(&tone_pacing_sem, K_FOREVER);
+		send_work_handler(NULL);
+	}
+}
+
+static int pacing_init(void)
+{
+	if (tone_pacing_thread_started) {
+		return 0;
+	}
+
+	if (!device_is_ready(pacing_counter)) {
+		LOG_ERR("Pacing counter %s not ready", pacing_counter->name);
+		return -ENODEV;
+	}
+
+	int ret = counter_start(pacing_counter);
+	if (ret < 0 && ret != -EALREADY) {
+		LOG_ERR("counter_start() failed: %d", ret);
+		return ret;
+	}
+
+	k_thread_create(&tone_pacing_thread, tone_pacing_stack,
+			K_THREAD_STACK_SIZEOF(tone_pacing_stack), tone_pacing_thread_fn, NULL, NULL,
+			NULL, K_PRIO_PREEMPT(CONFIG_TONE_STREAM_PACING_THREAD_PRIORITY), 0,
+			K_NO_WAIT);
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&tone_pacing_thread, "tone_pacing");
+	}
+	tone_pacing_thread_started = true;
+
+	return 0;
+}
+#else
+static int pacing_init(void)
+{
+	k_work_init_delayable(&engine.work, send_work_handler);
+	return 0;
+}
+#endif /* CONFIG_TONE_STREAM_PACING_COUNTER */
+
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+#define PERSIST_SUBTREE "tone"
+/* Bumped whenever struct tone_stream_settings changes meaning */
+#define PERSIST_VERSION 3U
+
+/* Value of tone/<id> in the settings storage */
+struct tone_persist_record {
+	uint8_t version;
+	/* Start the stream whenever the Wi-Fi interface gets a DHCPv4 lease */
+	uint8_t autostart;
+	uint16_t settings_size;
+	struct tone_stream_settings settings;
+};
+
+/* Records are only applied while tone_stream_init() loads them */
+static bool persist_loading;
+
+static int persist_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	struct tone_persist_record record;
+	char *end;
+	unsigned long id = strtoul(name, &end, 10);
+	struct tone_stream_context *stream = (end != name && (*end == '\0' || *end == '/'))
+						     ? stream_get((uint8_t)MIN(id, UINT8_MAX))
+						     : NULL;
+
+	if (!persist_loading || !stream) {
+		return 0;
+	}
+
+	if (len != sizeof(record)) {
+		LOG_WRN("Stored settings of tone stream %lu have %zu bytes, ignored", id, len);
+		return 0;
+	}
+
+	ssize_t got = read_cb(cb_arg, &record, sizeof(record));
+	if (got != sizeof(record)) {
+		return (got < 0) ? (int)got : -EIO;
+	}
+
+	if (record.version != PERSIST_VERSION || record.settings_size != sizeof(record.settings)) {
+		LOG_WRN("Stored settings of tone stream %lu are version %u, ignored", id,
+			record.version);
+		return 0;
+	}
+
+	int ret = settings_check(&record.settings);
+	if (ret < 0) {
+		LOG_WRN("Stored settings of tone stream %lu rejected: %d", id, ret);
+		return 0;
+	}
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	settings_publish_locked(stream, &record.settings);
+	stream->stored = true;
+	stream->autostart = record.autostart != 0U;
+	stream->saved_seq = atomic_get(&stream->settings_seq);
+	k_mutex_unlock(&engine.lock);
+
+	LOG_INF("Tone stream %lu settings restored%s", id,
+		record.autostart ? ", auto-start on DHCP lease" : "");
+
+	return 0;
+}
+
+static struct settings_handler persist_handler = {
+	.name = PERSIST_SUBTREE,
+	.h_set = persist_set,
+};
+
+static void persist_key(uint8_t id, char *buf, size_t len)
+{
+	snprintk(buf, len, PERSIST_SUBTREE "/%u", id);
+}
+
+/* Streams keep their defaults when storage is unusable */
+static void persist_init(void)
+{
+	static bool registered;
+	int ret = settings_subsys_init();
+
+	if (ret < 0) {
+		LOG_ERR("settings_subsys_init() failed: %d", ret);
+		return;
+	}
+
+	if (!registered) {
+		ret = settings_register(&persist_handler);
+		if (ret < 0) {
+			LOG_ERR("settings_register() failed: %d", ret);
+			return;
+		}
+		registered = true;
+	}
+
+	persist_loading = true;
+	ret = settings_load_subtree(PERSIST_SUBTREE);
+	persist_loading = false;
+
+	if (ret < 0) {
+		LOG_WRN("Loading stored tone settings failed: %d", ret);
+	}
+}
+#endif /* CONFIG_TONE_STREAM_PERSIST */
+
+#if defined(CONFIG_TONE_STREAM_AUTOSTART)
+/*
+ * Streams saved with auto-start run from the first DHCPv4 lease on. The
+ * start runs on the tone workqueue so the net_mgmt thread never waits on
+ * socket setup, and a lease after a reconnect restarts streams that
+ * stopped in between.
+ */
+static struct {
+	struct net_mgmt_event_callback cb;
+	bool cb_added;
+	struct k_work work;
+} autostart;
+
+static void autostart_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	for (uint8_t id = 0; id < TONE_MAX_STREAMS; id++) {
+		struct tone_stream_context *stream = &streams[id];
+
+		k_mutex_lock(&engine.lock, K_FOREVER);
+		bool wanted = stream->stored && stream->autostart;
+		k_mutex_unlock(&engine.lock);
+
+		if (!wanted || tone_stream_is_active(id)) {
+			continue;
+		}
+
+		int ret = tone_stream_start(id, NULL);
+
+		if (ret < 0) {
+			LOG_WRN("Auto-start of tone stream %u failed: %d", id, ret);
+			continue;
+		}
+
+		if (engine.boot.autostart_ms == 0U) {
+			engine.boot.autostart_ms = k_uptime_get_32();
+		}
+		LOG_INF("Tone stream %u auto-started", id);
+	}
+}
+
+static void autostart_event_handler(struct net_mgmt_event_callback *cb, uint64_t mgmt_event,
+				    struct net_if *iface)
+{
+	ARG_UNUSED(cb);
+	ARG_UNUSED(iface);
+
+	if (mgmt_event != NET_EVENT_IPV4_DHCP_BOUND) {
+		return;
+	}
+
+	if (engine.boot.lease_ms == 0U) {
+		engine.boot.lease_ms = k_uptime_get_32();
+	}
+
+	k_work_submit_to_queue(&tone_stream_work_q, &autostart.work);
+}
+
+static void autostart_init(void)
+{
+	k_work_init(&autostart.work, autostart_work_handler);
+
+	if (autostart.cb_added) {
+		return;
+	}
+
+	net_mgmt_init_event_callback(&autostart.cb, autostart_event_handler,
+				     NET_EVENT_IPV4_DHCP_BOUND);
+	net_mgmt_add_event_callback(&autostart.cb);
+	autostart.cb_added = true;
+}
+#endif /* CONFIG_TONE_STREAM_AUTOSTART */
+
+#if defined(CONFIG_TONE_STREAM_LINK)
+static uint16_t link_delta(net_stats_t now, net_stats_t then)
+{
+	return (uint16_t)MIN(now - then, (net_stats_t)UINT16_MAX);
+}
+
+/*
+ * The generic Wi-Fi API has no MCS index or retry counter, so the PHY TX
+ * rate stands in for the former and the driver's TX errors and queue
+ * overruns for the latter. Sampling stops once no stream runs; the next
+ * start takes a baseline sample right away.
+ */
+static void link_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	struct net_if *iface = net_if_get_first_wifi();
+	struct wifi_iface_status status = {0};
+	struct net_stats_wifi counters;
+	struct tone_link_sample sample = {
+		.uptime_ms = k_uptime_get_32(),
+	};
+
+	if (iface && net_mgmt(NET_REQUEST_WIFI_IFACE_STATUS, iface, &status, sizeof(status)) == 0) {
+		sample.connected = status.state == WIFI_STATE_COMPLETED;
+		sample.rssi_dbm = (int8_t)CLAMP(status.rssi, INT8_MIN, INT8_MAX);
+		sample.phy_rate_kbps = (uint32_t)CLAMP(status.current_phy_tx_rate * 1000.0f,
+							0.0f, 4.0e9f);
+	}
+
+	if (iface &&
+	    net_mgmt(NET_REQUEST_STATS_GET_WIFI, iface, &counters, sizeof(counters)) == 0) {
+		if (link.have_last) {
+			sample.tx_packets = counters.pkts.tx - link.last.pkts.tx;
+			sample.tx_errors = link_delta(counters.errors.tx, link.last.errors.tx);
+			sample.tx_overruns =
+				link_delta(counters.overrun_count, link.last.overrun_count);
+			sample.beacons_missed = link_delta(counters.sta_mgmt.beacons_miss,
+							   link.last.sta_mgmt.beacons_miss);
+		}
+		link.last = counters;
+		link.have_last = true;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&link.lock);
+
+	for (uint8_t id = 0; id < TONE_MAX_STREAMS; id++) {
+		if (!atomic_get(&streams[id].streaming)) {
+			continue;
+		}
+
+		uint32_t end = (uint32_t)atomic_get(&streams[id].link_seq);
+		uint32_t start = (link.last_active & BIT(id)) ? link.last_seq[id] : 0U;
+
+		sample.active |= BIT(id);
+		sample.end_seq[id] = end;
+		sample.packets[id] = (uint16_t)MIN(end - start, (uint32_t)UINT16_MAX);
+		link.last_seq[id] = end;
+	}
+	link.last_active = sample.active;
+	link.ring[link.taken % LINK_SAMPLES] = sample;
+	link.taken++;
+
+	k_spin_unlock(&link.lock, key);
+
+	for (uint8_t id = 0; id < TONE_MAX_STREAMS; id++) {
+		if (sample.active & BIT(id)) {
+			atomic_set(&streams[id].link_pending, 1);
+		}
+	}
+
+	if (sample.active != 0U) {
+		k_work_schedule(&link.work, K_MSEC(CONFIG_TONE_STREAM_LINK_PERIOD_MS));
+	} else {
+		/* Deltas across the idle time would only blur the next session */
+		link.have_last = false;
+	}
+}
+
+/* Before the stream is marked active: its packets count from sequence 0 again */
+static void link_stream_reset(struct tone_stream_context *stream)
+{
+	atomic_set(&stream->link_seq, 0);
+	atomic_set(&stream->link_pending, 0);
+
+	k_spinlock_key_t key = k_spin_lock(&link.lock);
+
+	link.last_active &= ~BIT(stream->id);
+	k_spin_unlock(&link.lock, key);
+}
+#endif /* CONFIG_TONE_STREAM_LINK */
+
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+/* Layouts the network core renders: a sine as PCM, one packet per deadline */
+static int offload_check(const struct tone_stream_context *stream,
+			 const struct tone_stream_settings *settings)
+{
+	if (settings->waveform != TONE_WAVE_SINE || settings->codec != TONE_CODEC_PCM ||
+	    settings->fec_group != 0U || settings->adapt_max_ms != 0U || settings->twt_align ||
+	    settings->link_report || settings->burst_packets != 1U) {
+		return -ENOTSUP;
+	}
+
+	uint8_t max_streams;
+	uint16_t max_block_bytes;
+	int ret = tone_offload_limits(&max_streams, &max_block_bytes);
+
+	if (ret < 0) {
+		return ret;
+	}
+
+	if (stream->id >= max_streams || settings->channels > TONE_OFFLOAD_MAX_CHANNELS ||
+	    samples_for(settings) * frame_bytes_for(settings) > max_block_bytes) {
+		return -ERANGE;
+	}
+
+	return 0;
+}
+
+static int offload_send_params(const struct tone_stream_context *stream,
+			       const struct tone_stream_settings *settings, uint8_t type)
+{
+	const struct tone_offload_params msg = {
+		.hdr = {.type = type, .stream_id = stream->id},
+		.sample_rate_hz = settings->sample_rate_hz,
+		.frames = samples_for(settings),
+		.frequency_hz = settings->frequency_hz,
+		.amplitude_pct = settings->amplitude_pct,
+		.channels = settings->channels,
+		.channel_phase_deg = settings->channel_phase_deg,
+		.sample_bytes = sample_layouts[settings->sample_format].bytes,
+	};
+
+	return tone_offload_send(&msg, sizeof(msg));
+}
+
+static void offload_send_stop(const struct tone_stream_context *stream)
+{
+	const struct tone_offload_stop msg = {
+		.hdr = {.type = TONE_OFFLOAD_MSG_STOP, .stream_id = stream->id},
+	};
+	int ret = tone_offload_send(&msg, sizeof(msg));
+
+	if (ret < 0) {
+		LOG_WRN("Stream %u: network core not told to stop: %d", stream->id, ret);
+	}
+}
+
+static bool offload_sample_format(uint8_t bytes, enum tone_sample_format *format)
+{
+	for (int f = 0; f < TONE_SAMPLE_FORMAT_COUNT; f++) {
+		if (sample_layouts[f].bytes == bytes) {
+			*format = f;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * The TX stage of an offloaded stream, run once per block. Deadlines are
+ * kept on a local timeline which starts when the first block arrives and
+ * follows the sample count of the blocks, so blocks the network core had to
+ * skip do not shift the ones after them. Pacing error is then the arrival
+ * of each block against that timeline: the network core's wakeup jitter
+ * plus the IPC latency. Both kernels count the same 32 kHz clock, so the
+ * timeline stays in step unless the counter pacing backend is built.
+ */
+void tone_stream_offload_serve(const struct tone_offload_block *block, size_t len)
+{
+	struct tone_stream_context *stream = stream_get(block->hdr.stream_id);
+	const uint32_t pcm_len = block->frames * block->channels * block->sample_bytes;
+	enum tone_sample_format format;
+	struct tone_stream_settings settings;
+	uint64_t now = micros_now();
+
+	if (!stream || len < sizeof(*block) + pcm_len || block->frames == 0U ||
+	    block->sample_rate_hz == 0U || !offload_sample_format(block->sample_bytes, &format)) {
+		return;
+	}
+
+	k_mutex_lock(&engine.tx_lock, K_FOREVER);
+
+	if (!atomic_get(&stream->streaming) || !stream_offloaded(stream) ||
+	    !destination_socket_open(stream)) {
+		k_mutex_unlock(&engine.tx_lock);
+		return;
+	}
+
+	atomic_val_t seq = settings_snapshot(stream, &settings);
+	struct tone_tx_slot slot = {
+		.frame_bytes = block->channels * block->sample_bytes,
+		.samples = block->frames,
+		.payload_len = pcm_len,
+		.sample_rate_hz = block->sample_rate_hz,
+		.qos = settings.qos,
+		/* Sent from the IPC buffer, held until the block is served */
+		.pcm = (uint8_t *)block->pcm,
+	};
+
+	slot.prefix.header.seq = sys_cpu_to_be32(block->seq);
+	slot.prefix.header.sample_count = sys_cpu_to_be32(block->sample_count);
+
+	/* The extension describes the block, which may lag behind the settings */
+	struct tone_stream_settings layout = settings;
+
+	layout.channels = block->channels;
+	layout.sample_format = format;
+	layout.codec = TONE_CODEC_PCM;
+	layout.adapt_max_ms = 0U;
+	slot.prefix.ext = header_ext_for(&layout);
+	slot.prefix_len = sizeof(slot.prefix.header) + slot.prefix.ext.length;
+
+	if (block->seq != stream->offload.next_seq) {
+		/* The network core skipped every block in the gap for want of an IPC buffer */
+		stats_record_underruns(stream, block->seq - stream->offload.next_seq);
+	}
+
+	if (slot.sample_rate_hz != stream->tx_rate_hz) {
+		if (stream->next_deadline_us == 0U) {
+			/* First block: the timeline starts at its arrival */
+			stream->next_deadline_us = now;
+		}
+		rebase_deadline(stream, &slot);
+		stream->offload.next_samples = block->sample_count;
+	}
+	track_interval(stream, &slot);
+	stream->deadline_samples += block->sample_count - stream->offload.next_samples;
+	stream->next_deadline_us = deadline_at(stream, stream->deadline_samples);
+	stream->wakeup_us = stream->next_deadline_us;
+
+	TONE_TRACE("wakeup", stream->id,
+		   (now > stream->wakeup_us)
+			   ? (uint32_t)MIN(now - stream->wakeup_us, (uint64_t)UINT32_MAX)
+			   : 0U);
+	stats_record_wakeup(stream, now);
+
+	uint64_t send_start_us = micros_now();
+
+	TONE_TRACE("send_enter", stream->id, block->seq);
+	int err = transmit_slot(stream, &slot);
+	uint32_t send_us = (uint32_t)(micros_now() - send_start_us);
+
+	TONE_TRACE("send_exit", stream->id, (uint32_t)err);
+	record_send_result(stream, &slot, err, send_us);
+
+	stream->offload.next_seq = block->seq + 1U;
+	stream->offload.next_samples = block->sample_count + block->frames;
+	stream->deadline_samples += block->frames;
+	stream->next_deadline_us = deadline_at(stream, stream->deadline_samples);
+
+	const bool changed = seq != stream->offload.settings_seq;
+
+	stream->offload.settings_seq = seq;
+	k_mutex_unlock(&engine.tx_lock);
+
+	/* Forward new settings the network core can take up while running */
+	if (changed) {
+		if (offload_check(stream, &settings) < 0) {
+			LOG_WRN("Stream %u: new settings wait for the next start", stream->id);
+		} else if (offload_send_params(stream, &settings, TONE_OFFLOAD_MSG_UPDATE) < 0) {
+			LOG_WRN("Stream %u: network core update not sent", stream->id);
+		}
+	}
+}
+#endif /* CONFIG_TONE_STREAM_OFFLOAD */
+
+static bool any_stream_active(void)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		if (atomic_get(&streams[i].streaming)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Caller holds engine.lock */
+static void stop_locked(struct tone_stream_context *stream)
+{
+	if (!atomic_cas(&stream->streaming, 1, 0)) {
+		return;
+	}
+
+	/* Wait for an in-flight TX wakeup; later ones skip this stream */
+	k_mutex_lock(&engine.tx_lock, K_FOREVER);
+
+	bool others_active = any_stream_active();
+
+	if (!others_active) {
+		pacing_cancel();
+	}
+
+	stream->wakeup_us = 0U;
+	stream->next_deadline_us = 0U;
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	if (stream->offload.active) {
+		offload_send_stop(stream);
+		stream->offload.active = false;
+	}
+#endif
+
+	struct k_work_sync sync;
+
+	(void)k_work_cancel_sync(&engine.synth_work, &sync);
+	flush_tx_ring(stream);
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	pcm_ring_release(stream);
+#endif
+
+	if (destination_socket_open(stream)) {
+		close_destination_socket(stream);
+	}
+
+	k_mutex_unlock(&engine.tx_lock);
+
+	/* The cancelled pass may have owed the remaining streams a refill */
+	if (others_active) {
+		k_work_submit_to_queue(&tone_stream_work_q, &engine.synth_work);
+	}
+}
+
+int tone_stream_init(void)
+{
+	struct tone_stream_settings defaults = {
+		.sample_rate_hz = TONE_DEFAULT_SAMPLE_RATE_HZ,
+		.packet_duration_ms = TONE_DEFAULT_PACKET_DURATION_MS,
+		.frequency_hz = TONE_DEFAULT_FREQUENCY_HZ,
+		.amplitude_pct = TONE_DEFAULT_AMPLITUDE_PCT,
+		.burst_packets = TONE_DEFAULT_BURST_PACKETS,
+		.channels = TONE_DEFAULT_CHANNELS,
+		.sample_format = TONE_DEFAULT_SAMPLE_FORMAT,
+		.channel_phase_deg = TONE_DEFAULT_CHANNEL_PHASE_DEG,
+		.codec = TONE_DEFAULT_CODEC,
+		.qos = TONE_DEFAULT_QOS,
+		.fec_group = TONE_DEFAULT_FEC_GROUP,
+		.fec_depth = TONE_DEFAULT_FEC_DEPTH,
+		.transport = TONE_DEFAULT_TRANSPORT,
+		.dest_mac = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+		.waveform = TONE_DEFAULT_WAVEFORM,
+		.sweep_end_hz = TONE_DEFAULT_SWEEP_END_HZ,
+		.sweep_ms = TONE_DEFAULT_SWEEP_MS,
+	};
+
+	memset(streams, 0, sizeof(streams));
+	memset(&engine, 0, sizeof(engine));
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		streams[i].id = (uint8_t)i;
+		streams[i].sock_fd = -1;
+		streams[i].settings_buf[0] = defaults;
+	}
+
+	k_mutex_init(&engine.lock);
+	k_mutex_init(&engine.tx_lock);
+	k_work_init(&engine.synth_work, synth_work_handler);
+#if defined(CONFIG_TONE_STREAM_LINK)
+	k_work_init_delayable(&link.work, link_work_handler);
+#endif
+
+	build_sine_lut();
+
+	if (!tone_stream_work_q_started) {
+		k_work_queue_init(&tone_stream_work_q);
+		k_work_queue_start(&tone_stream_work_q, tone_stream_work_stack,
+				   K_THREAD_STACK_SIZEOF(tone_stream_work_stack),
+				   K_PRIO_PREEMPT(CONFIG_TONE_STREAM_WORKQUEUE_PRIORITY), NULL);
+		if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+			k_thread_name_set(&tone_stream_work_q.thread, "tone_stream");
+		}
+		tone_stream_work_q_started = true;
+	}
+
+	int ret = pacing_init();
+
+	if (ret < 0) {
+		return ret;
+	}
+
+#if defined(CONFIG_TONE_STREAM_TIMESYNC)
+	/* Started after pacing so micros_now() runs on the final time base */
+	tone_timesync_init();
+#endif
+#if defined(CONFIG_TONE_STREAM_TWT)
+	twt_init();
+#endif
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+	/* Restored now, so a lease arriving early already finds them in place */
+	persist_init();
+#endif
+#if defined(CONFIG_TONE_STREAM_AUTOSTART)
+	autostart_init();
+#endif
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	tone_offload_init();
+#endif
+
+	return 0;
+}
+
+bool tone_stream_is_active(uint8_t id)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	return stream && atomic_get(&stream->streaming) != 0;
+}
+
+int tone_stream_get_settings(uint8_t id, struct tone_stream_settings *out)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || !out) {
+		return -EINVAL;
+	}
+
+	(void)settings_snapshot(stream, out);
+
+	return 0;
+}
+
+int tone_stream_save(uint8_t id, bool autostart)
+{
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+	struct tone_stream_context *stream = stream_get(id);
+	struct tone_persist_record record = {
+		.version = PERSIST_VERSION,
+		.autostart = autostart ? 1U : 0U,
+		.settings_size = sizeof(record.settings),
+	};
+	char key[sizeof(PERSIST_SUBTREE "/255")];
+
+	if (!stream) {
+		return -EINVAL;
+	}
+
+	if (autostart && !IS_ENABLED(CONFIG_TONE_STREAM_AUTOSTART)) {
+		return -ENOTSUP;
+	}
+
+	persist_key(id, key, sizeof(key));
+
+	/* Padding is stored too; keep it zero so later fields never read it */
+	memset(&record.settings, 0, sizeof(record.settings));
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	atomic_val_t seq = settings_snapshot(stream, &record.settings);
+
+	/* Auto-start needs somewhere to send; raw frames always have dest_mac */
+	int ret = (autostart && record.settings.transport == TONE_TRANSPORT_UDP &&
+		   record.settings.dest_family == AF_UNSPEC)
+			  ? -ENOTCONN
+			  : settings_save_one(key, &record, sizeof(record));
+	if (ret == 0) {
+		stream->stored = true;
+		stream->autostart = autostart;
+		stream->saved_seq = seq;
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+#else
+	ARG_UNUSED(id);
+	ARG_UNUSED(autostart);
+	return -ENOTSUP;
+#endif
+}
+
+int tone_stream_erase(uint8_t id)
+{
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+	struct tone_stream_context *stream = stream_get(id);
+	char key[sizeof(PERSIST_SUBTREE "/255")];
+
+	if (!stream) {
+		return -EINVAL;
+	}
+
+	persist_key(id, key, sizeof(key));
+
+	/* The running settings stay; only the next boot falls back to defaults */
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	int ret = settings_delete(key);
+	if (ret == 0) {
+		stream->stored = false;
+		stream->autostart = false;
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+#else
+	ARG_UNUSED(id);
+	return -ENOTSUP;
+#endif
+}
+
+int tone_stream_set_target(uint8_t id, const char *ip_str, uint16_t port)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || !ip_str || port == 0) {
+		return -EINVAL;
+	}
+
+	union {
+		struct in_addr v4;
+		struct in6_addr v6;
+	} addr;
+	sa_family_t family;
+
+	/* The unspecified address is refused, it would leave the stream without a target */
+	if (zsock_inet_pton(AF_INET, ip_str, &addr.v4) == 1) {
+		if (net_ipv4_is_addr_unspecified(&addr.v4)) {
+			return -EINVAL;
+		}
+		family = AF_INET;
+	} else if (zsock_inet_pton(AF_INET6, ip_str, &addr.v6) == 1) {
+		if (!IS_ENABLED(CONFIG_NET_IPV6)) {
+			return -EAFNOSUPPORT;
+		}
+		if (net_ipv6_is_addr_unspecified(&addr.v6)) {
+			return -EINVAL;
+		}
+		family = AF_INET6;
+	} else {
+		return -EINVAL;
+	}
+
+	struct tone_stream_settings settings;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.dest_family = family;
+	if (family == AF_INET6) {
+		settings.dest_ipv6 = addr.v6;
+	} else {
+		settings.dest_ipv4 = addr.v4;
+	}
+	settings.dest_port = port;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
+
+	return 0;
+}
+
+int tone_stream_set_params(uint8_t id, uint16_t freq_hz, uint8_t amplitude_pct,
+			   uint32_t sample_rate_hz, uint16_t packet_ms)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || sample_rate_hz == 0U || packet_ms == 0U) {
+		return -EINVAL;
+	}
+
+	if (freq_hz >= sample_rate_hz / 2U) {
+		return -ERANGE;
+	}
+
+	uint16_t amp = MIN(amplitude_pct, 100U);
+	struct tone_stream_settings settings;
+	int ret;
+
+	/* A running stream picks the new settings up at its next packet */
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.frequency_hz = freq_hz;
+	settings.amplitude_pct = amp;
+	settings.sample_rate_hz = sample_rate_hz;
+	settings.packet_duration_ms = packet_ms;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_burst(uint8_t id, uint8_t packets)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream) {
+		return -EINVAL;
+	}
+
+	if (packets == 0U || packets > TONE_MAX_BURST_PACKETS) {
+		return -ERANGE;
+	}
+
+	struct tone_stream_settings settings;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.burst_packets = packets;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
+
+	return 0;
+}
+
+int tone_stream_set_format(uint8_t id, uint8_t channels, enum tone_sample_format format,
+			   uint16_t channel_phase_deg)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || format >= TONE_SAMPLE_FORMAT_COUNT || channel_phase_deg >= 360U) {
+		return -EINVAL;
+	}
+
+	if (channels == 0U || channels > TONE_MAX_CHANNELS) {
+		return -ERANGE;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.channels = channels;
+	settings.sample_format = format;
+	settings.channel_phase_deg = channel_phase_deg;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+uint8_t tone_stream_sample_bits(enum tone_sample_format format)
+{
+	return (format < TONE_SAMPLE_FORMAT_COUNT) ? sample_layouts[format].bits : 0U;
+}
+
+int tone_stream_set_codec(uint8_t id, enum tone_codec codec)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || codec >= TONE_CODEC_COUNT) {
+		return -EINVAL;
+	}
+
+	if (codec != TONE_CODEC_PCM && !IS_ENABLED(CONFIG_TONE_STREAM_CODEC)) {
+		return -ENOTSUP;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.codec = codec;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_qos(uint8_t id, enum tone_qos qos)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || qos >= TONE_QOS_COUNT) {
+		return -EINVAL;
+	}
+
+	struct tone_stream_settings settings;
+
+	/* Picked up per packet, so a running stream moves on its next one */
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.qos = qos;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
+
+	return 0;
+}
+
+int tone_stream_set_fec(uint8_t id, uint8_t group, uint8_t depth)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || group > TONE_FEC_MAX_GROUP || depth == 0U) {
+		return -EINVAL;
+	}
+
+	if (group != 0U && !IS_ENABLED(CONFIG_TONE_STREAM_FEC)) {
+		return -ENOTSUP;
+	}
+
+	if (depth > TONE_FEC_MAX_DEPTH) {
+		return -EINVAL;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.fec_group = group;
+	settings.fec_depth = depth;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_transport(uint8_t id, enum tone_transport transport, const uint8_t *dest_mac)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || transport >= TONE_TRANSPORT_COUNT) {
+		return -EINVAL;
+	}
+
+	if (transport == TONE_TRANSPORT_RAW && !IS_ENABLED(CONFIG_TONE_STREAM_RAW_TX)) {
+		return -ENOTSUP;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	/* The socket is opened at start, so a running stream changes on its next start */
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.transport = transport;
+	if (dest_mac) {
+		memcpy(settings.dest_mac, dest_mac, sizeof(settings.dest_mac));
+	}
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_waveform(uint8_t id, enum tone_waveform waveform)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || waveform >= TONE_WAVE_COUNT) {
+		return -EINVAL;
+	}
+
+	if (waveform != TONE_WAVE_SINE && !IS_ENABLED(CONFIG_TONE_STREAM_WAVEFORMS)) {
+		return -ENOTSUP;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.waveform = waveform;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_sweep(uint8_t id, uint16_t end_hz, uint32_t duration_ms)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || end_hz == 0U || duration_ms == 0U) {
+		return -EINVAL;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.sweep_end_hz = end_hz;
+	settings.sweep_ms = duration_ms;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_multitone(uint8_t id, uint8_t count, const uint16_t *freq_hz,
+			      const uint8_t *amplitude_pct)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || count > TONE_MAX_TONES || (count > 0U && (!freq_hz || !amplitude_pct))) {
+		return -EINVAL;
+	}
+
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.tone_count = count;
+	memset(settings.tone_hz, 0, sizeof(settings.tone_hz));
+	memset(settings.tone_pct, 0, sizeof(settings.tone_pct));
+	for (uint8_t t = 0; t < count; t++) {
+		settings.tone_hz[t] = freq_hz[t];
+		settings.tone_pct[t] = MIN(amplitude_pct[t], 100U);
+	}
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
+}
+
+int tone_stream_set_twt_align(uint8_t id, bool enable)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream) {
+		return -EINVAL;
+	}
+
+	if (enable && !IS_ENABLED(CONFIG_TONE_STREAM_TWT)) {
+		return -ENOTSUP;
+	}
+
+	struct tone_stream_settings settings;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.twt_align = enable ? 1U : 0U;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
+
+	return 0;
+}
+
+int tone_stream_set_link_report(uint8_t id, bool enable)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream) {
+		return -EINVAL;
+	}
+
+	if (enable && !IS_ENABLED(CONFIG_TONE_STREAM_LINK)) {
+		return -ENOTSUP;
+	}
 
-static uint8_t tx_buffer[sizeof(struct tone_packet_header) + TONE_MAX_PAYLOAD_BYTES];
+	struct tone_stream_settings settings;
 
-static inline uint64_t micros_now(void)
-{
-	return k_ticks_to_us_floor64(k_uptime_ticks());
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.link_report = enable ? 1U : 0U;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
+
+	return 0;
 }
 
-static int generate_tone_period(void)
+int tone_stream_set_offload(uint8_t id, bool enable)
 {
-	size_t tone_size_bytes;
-	float amplitude = ctx.settings.amplitude_pct / 100.0f;
+	struct tone_stream_context *stream = stream_get(id);
 
-	if (ctx.settings.amplitude_pct == 0U || amplitude <= 0.0f) {
-		ctx.tone_period_samples = 0;
-		ctx.tone_position = 0;
-		return 0;
+	if (!stream) {
+		return -EINVAL;
 	}
 
-	int ret = tone_gen(ctx.tone_period, &tone_size_bytes, ctx.settings.frequency_hz,
-			   ctx.settings.sample_rate_hz, amplitude);
-	if (ret != 0) {
-		LOG_ERR("tone_gen failed: %d", ret);
-		return ret;
+	if (enable && !IS_ENABLED(CONFIG_TONE_STREAM_OFFLOAD)) {
+		return -ENOTSUP;
 	}
 
-	ctx.tone_period_samples = tone_size_bytes / sizeof(int16_t);
-	ctx.tone_position = 0;
+	struct tone_stream_settings settings;
 
-	LOG_INF("Generated tone period: %u samples for %u Hz", ctx.tone_period_samples,
-		ctx.settings.frequency_hz);
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.offload = enable ? 1U : 0U;
+	settings_publish_locked(stream, &settings);
+	k_mutex_unlock(&engine.lock);
 
 	return 0;
 }
 
-static void fill_pcm_samples(int16_t *pcm, uint32_t samples)
+int tone_stream_set_adaptive(uint8_t id, uint16_t min_ms, uint16_t max_ms)
 {
-	if (ctx.tone_period_samples == 0) {
-		/* No tone generated yet, fill with silence */
-		memset(pcm, 0, samples * sizeof(int16_t));
-		return;
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || min_ms > max_ms || (min_ms == 0U && max_ms != 0U)) {
+		return -EINVAL;
 	}
 
-	for (uint32_t i = 0; i < samples; i++) {
-		pcm[i] = ctx.tone_period[ctx.tone_position];
-		ctx.tone_position++;
-		if (ctx.tone_position >= ctx.tone_period_samples) {
-			ctx.tone_position = 0; /* Loop back to start of period */
-		}
+	struct tone_stream_settings settings;
+	int ret;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	settings.adapt_min_ms = min_ms;
+	settings.adapt_max_ms = max_ms;
+
+	ret = validate_layout(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
 	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
 }
 
-static int configure_destination_socket(void)
+/* Replace every setting of a stream but its destination in one validated update */
+int tone_stream_set_config(uint8_t id, const struct tone_stream_settings *config)
 {
-	struct sockaddr_in dest = {
-		.sin_family = AF_INET,
-		.sin_port = htons(ctx.settings.dest_port),
-		.sin_addr.s_addr = ctx.settings.dest_ipv4,
-	};
+	struct tone_stream_context *stream = stream_get(id);
 
-	int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-	if (fd < 0) {
-		LOG_ERR("socket() failed: %d", errno);
-		return -errno;
+	if (!stream || !config) {
+		return -EINVAL;
 	}
 
-	int buf = 64 * 1024;
-	(void)setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf));
+	struct tone_stream_settings settings;
+	int ret;
 
-	if (connect(fd, (struct sockaddr *)&dest, sizeof(dest)) < 0) {
-		int err = -errno;
-		LOG_ERR("connect() failed: %d", errno);
-		close(fd);
-		return err;
+	/* Checked and published whole, so the data path never sees it half applied */
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+	const sa_family_t dest_family = settings.dest_family;
+	const struct in6_addr dest_addr = settings.dest_ipv6;
+	const uint16_t dest_port = settings.dest_port;
+
+	settings = *config;
+	settings.dest_family = dest_family;
+	settings.dest_ipv6 = dest_addr;
+	settings.dest_port = dest_port;
+	if (settings.tone_count <= TONE_MAX_TONES) {
+		memset(&settings.tone_hz[settings.tone_count], 0,
+		       (TONE_MAX_TONES - settings.tone_count) * sizeof(settings.tone_hz[0]));
+		memset(&settings.tone_pct[settings.tone_count], 0,
+		       (TONE_MAX_TONES - settings.tone_count) * sizeof(settings.tone_pct[0]));
 	}
 
-	ctx.sock_fd = fd;
-	return 0;
+	ret = settings_check(&settings);
+	if (ret == 0) {
+		settings_publish_locked(stream, &settings);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	return ret;
 }
 
-static void reschedule_next_packet(void)
+const char *tone_stream_codec_name(enum tone_codec codec)
 {
-	const uint32_t interval_us = ctx.interval_us;
-	if (interval_us == 0U) {
-		k_work_reschedule_for_queue(&tone_stream_work_q, &ctx.work, K_NO_WAIT);
-		return;
+	return (codec < TONE_CODEC_COUNT) ? codec_names[codec] : "unknown";
+}
+
+const char *tone_stream_waveform_name(enum tone_waveform waveform)
+{
+	return (waveform < TONE_WAVE_COUNT) ? waveform_names[waveform] : "unknown";
+}
+
+const char *tone_stream_qos_name(enum tone_qos qos)
+{
+	return (qos < TONE_QOS_COUNT) ? qos_classes[qos].name : "unknown";
+}
+
+const char *tone_stream_transport_name(enum tone_transport transport)
+{
+	return (transport < TONE_TRANSPORT_COUNT) ? transport_names[transport] : "unknown";
+}
+
+int tone_stream_adjust_amplitude(uint8_t id, int delta_pct)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream) {
+		return -EINVAL;
 	}
 
-	uint64_t now = micros_now();
-	if (ctx.next_deadline_us == 0U) {
-		ctx.next_deadline_us = now + interval_us;
-	} else {
-		ctx.next_deadline_us += interval_us;
+	struct tone_stream_settings settings;
+
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	(void)settings_snapshot(stream, &settings);
+
+	int new_val = CLAMP((int)settings.amplitude_pct + delta_pct, 0, 100);
+
+	if (new_val != settings.amplitude_pct) {
+		settings.amplitude_pct = (uint8_t)new_val;
+		settings_publish_locked(stream, &settings);
+		LOG_INF("Stream %u tone amplitude set to %u%%", id, settings.amplitude_pct);
 	}
 
-	uint64_t delay_us =
-		(ctx.next_deadline_us > now) ? (ctx.next_deadline_us - now) : interval_us;
-	uint32_t delay_clamped = (uint32_t)CLAMP(delay_us, 1U, (uint64_t)UINT32_MAX);
+	k_mutex_unlock(&engine.lock);
 
-	k_work_reschedule_for_queue(&tone_stream_work_q, &ctx.work, K_USEC(delay_clamped));
+	return 0;
 }
 
-static void send_work_handler(struct k_work *item)
+int tone_stream_start(uint8_t id, const struct shell *shell)
 {
-	ARG_UNUSED(item);
-
-	k_mutex_lock(&ctx.lock, K_FOREVER);
+	struct tone_stream_context *stream = stream_get(id);
+	struct tone_stream_settings settings;
 
-	if (!ctx.streaming || ctx.sock_fd < 0) {
-		k_mutex_unlock(&ctx.lock);
-		return;
+	if (!stream) {
+		return -EINVAL;
 	}
 
-	const uint32_t samples = ctx.samples_per_packet;
+	k_mutex_lock(&engine.lock, K_FOREVER);
 
-	uint32_t seq = ctx.seq_num++;
-	uint32_t sample_count = ctx.sample_counter;
-	uint32_t timestamp = (uint32_t)(micros_now() & 0xFFFFFFFFU);
+	if (atomic_get(&stream->streaming)) {
+		k_mutex_unlock(&engine.lock);
+		return -EALREADY;
+	}
 
-	struct tone_packet_header header = {
-		.seq = sys_cpu_to_be32(seq),
-		.sample_count = sys_cpu_to_be32(sample_count),
-		.timestamp_us = sys_cpu_to_be32(timestamp),
-	};
+	(void)settings_snapshot(stream, &settings);
 
-	ctx.sample_counter += samples;
+	/* Raw frames go to dest_mac, which always has a value */
+	if (settings.transport == TONE_TRANSPORT_UDP &&
+	    (settings.dest_port == 0U || settings.dest_family == AF_UNSPEC)) {
+		k_mutex_unlock(&engine.lock);
+		return -ENOTCONN;
+	}
 
-	size_t payload_bytes = samples * sizeof(int16_t);
-	if (payload_bytes > TONE_MAX_PAYLOAD_BYTES) {
-		LOG_ERR("Payload too large (%u bytes)", payload_bytes);
-		ctx.streaming = false;
-		k_mutex_unlock(&ctx.lock);
-		return;
+	int ret = validate_layout(&settings);
+	if (ret < 0) {
+		k_mutex_unlock(&engine.lock);
+		return ret;
 	}
 
-	memcpy(tx_buffer, &header, sizeof(header));
-	int16_t *pcm = (int16_t *)(tx_buffer + sizeof(header));
-	fill_pcm_samples(pcm, samples);
+	const bool offloaded = settings.offload != 0U;
 
-	ssize_t sent = send(ctx.sock_fd, tx_buffer, sizeof(header) + payload_bytes, 0);
-	if (sent < 0) {
-		ctx.consecutive_send_failures++;
-		int err = errno;
-		if (ctx.consecutive_send_failures <= 3) {
-			LOG_DBG("send() failed: %d (attempt %u)", err,
-				ctx.consecutive_send_failures);
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	if (offloaded) {
+		ret = offload_check(stream, &settings);
+		if (ret < 0) {
+			k_mutex_unlock(&engine.lock);
+			return ret;
 		}
-		if (ctx.consecutive_send_failures == 3) {
-			LOG_WRN("UDP send failing repeatedly (err %d). Retrying...", err);
+	}
+#endif
+
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	/* The network core's PCM arrives in IPC buffers instead */
+	ret = offloaded ? 0 : pcm_ring_acquire(stream);
+	if (ret < 0) {
+		k_mutex_unlock(&engine.lock);
+		return ret;
+	}
+#endif
+
+	ret = configure_destination_socket(stream, &settings);
+	if (ret < 0) {
+#if !defined(CONFIG_TONE_STREAM_ZEROCOPY)
+		pcm_ring_release(stream);
+#endif
+		k_mutex_unlock(&engine.lock);
+		return ret;
+	}
+
+	/* Neither stage touches a stopped stream, so its state is reset directly */
+	memset(&stream->synth, 0, sizeof(stream->synth));
+	stream->synth.settings_seq = atomic_get(&stream->settings_seq) - 1;
+	flush_tx_ring(stream);
+
+	stream->tx_rate_hz = 0U;
+	stream->interval_samples = 0U;
+	memset(&stream->adapt, 0, sizeof(stream->adapt));
+	atomic_set(&stream->adapt_target, 0);
+	/* An offloaded stream's timeline starts with its first block */
+	stream->next_deadline_us = offloaded ? 0U : micros_now();
+	stream->wakeup_us = stream->next_deadline_us;
+	stream->consecutive_send_failures = 0;
+	stats_reset(stream);
+#if defined(CONFIG_TONE_STREAM_LINK)
+	link_stream_reset(stream);
+#endif
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	stream->offload.active = offloaded;
+	stream->offload.settings_seq = atomic_get(&stream->settings_seq);
+	stream->offload.next_seq = 0U;
+	stream->offload.next_samples = 0U;
+#endif
+
+	atomic_set(&stream->streaming, 1);
+
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+	if (offloaded) {
+		ret = offload_send_params(stream, &settings, TONE_OFFLOAD_MSG_START);
+		if (ret < 0) {
+			stop_locked(stream);
+			k_mutex_unlock(&engine.lock);
+			return ret;
 		}
-	} else {
-		ctx.consecutive_send_failures = 0;
 	}
+#endif
 
-	reschedule_next_packet();
-	k_mutex_unlock(&ctx.lock);
-}
+	k_mutex_unlock(&engine.lock);
 
-static void stop_locked(void)
-{
-	if (ctx.streaming) {
-		ctx.streaming = false;
-		ctx.next_deadline_us = 0U;
-		k_work_cancel_delayable(&ctx.work);
+	if (!offloaded) {
+		/* Prime the ring before the first deadline */
+		k_work_submit_to_queue(&tone_stream_work_q, &engine.synth_work);
+		pacing_kick();
 	}
+#if defined(CONFIG_TONE_STREAM_LINK)
+	/* Already scheduled while another stream runs */
+	k_work_schedule(&link.work, K_NO_WAIT);
+#endif
 
-	if (ctx.sock_fd >= 0) {
-		close(ctx.sock_fd);
-		ctx.sock_fd = -1;
+	if (shell) {
+		shell_print(shell, "Tone stream %u started: %u Hz, %u%%, %u ms packets%s", id,
+			    settings.frequency_hz, settings.amplitude_pct,
+			    settings.packet_duration_ms,
+			    offloaded ? ", synthesized on the network core" : "");
 	}
+
+	return 0;
 }
 
-int tone_stream_init(void)
+int tone_stream_stop(uint8_t id, const struct shell *shell)
 {
-	memset(&ctx, 0, sizeof(ctx));
-	ctx.sock_fd = -1;
-	ctx.settings.sample_rate_hz = TONE_DEFAULT_SAMPLE_RATE_HZ;
-	ctx.settings.packet_duration_ms = TONE_DEFAULT_PACKET_DURATION_MS;
-	ctx.settings.frequency_hz = TONE_DEFAULT_FREQUENCY_HZ;
-	ctx.settings.amplitude_pct = TONE_DEFAULT_AMPLITUDE_PCT;
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream) {
+		return -EINVAL;
+	}
 
-	k_mutex_init(&ctx.lock);
-	k_work_init_delayable(&ctx.work, send_work_handler);
-	ctx.tone_period_samples = 0;
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	stop_locked(stream);
+	k_mutex_unlock(&engine.lock);
 
-	if (!tone_stream_work_q_started) {
-		k_work_queue_init(&tone_stream_work_q);
-		k_work_queue_start(&tone_stream_work_q, tone_stream_work_stack,
-				   K_THREAD_STACK_SIZEOF(tone_stream_work_stack),
-				   K_PRIO_PREEMPT(CONFIG_TONE_STREAM_WORKQUEUE_PRIORITY), NULL);
-		if (IS_ENABLED(CONFIG_THREAD_NAME)) {
-			k_thread_name_set(&tone_stream_work_q.thread, "tone_stream");
-		}
-		tone_stream_work_q_started = true;
+	if (shell) {
+		shell_print(shell, "Tone stream %u stopped", id);
 	}
 
 	return 0;
 }
 
-bool tone_stream_is_active(void)
+void tone_stream_stop_all(const struct shell *shell)
 {
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	bool active = ctx.streaming;
-	k_mutex_unlock(&ctx.lock);
-	return active;
+	k_mutex_lock(&engine.lock, K_FOREVER);
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		stop_locked(&streams[i]);
+	}
+	k_mutex_unlock(&engine.lock);
+
+	if (shell) {
+		shell_print(shell, "All tone streams stopped");
+	}
 }
 
-int tone_stream_get_settings(struct tone_stream_settings *out)
+static void stream_status(const struct shell *shell, struct tone_stream_context *stream)
 {
-	if (!out) {
-		return -EINVAL;
+	struct tone_stream_settings settings;
+	struct tone_stream_stats stats;
+
+	/* Status never waits on the data path */
+	atomic_val_t seq = settings_snapshot(stream, &settings);
+	(void)tone_stream_get_stats(stream->id, &stats);
+	bool active = atomic_get(&stream->streaming) != 0;
+
+	const bool ipv6 = settings.dest_family == AF_INET6;
+	char ip_buf[NET_IPV6_ADDR_LEN];
+
+	if (ipv6) {
+		zsock_inet_ntop(AF_INET6, &settings.dest_ipv6, ip_buf, sizeof(ip_buf));
+	} else if (settings.dest_family == AF_INET) {
+		zsock_inet_ntop(AF_INET, &settings.dest_ipv4, ip_buf, sizeof(ip_buf));
+	} else {
+		strcpy(ip_buf, "unset");
 	}
 
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	*out = ctx.settings;
-	k_mutex_unlock(&ctx.lock);
+	const bool mcast = settings.dest_family != AF_UNSPEC && dest_is_multicast(&settings);
 
-	return 0;
+	shell_print(shell, "Tone stream %u: %s", stream->id, active ? "streaming" : "stopped");
+#if defined(CONFIG_TONE_STREAM_PERSIST)
+	if (stream->stored) {
+		shell_print(shell, "  Stored: %s%s",
+			    (seq == stream->saved_seq) ? "current settings" : "changed since saved",
+			    stream->autostart ? ", auto-start on DHCP lease" : "");
+	}
+#else
+	ARG_UNUSED(seq);
+#endif
+	if (settings.transport == TONE_TRANSPORT_RAW) {
+		const uint8_t *da = settings.dest_mac;
+
+		shell_print(shell, "  Destination: raw 802.11 to %02x:%02x:%02x:%02x:%02x:%02x",
+			    da[0], da[1], da[2], da[3], da[4], da[5]);
+	} else {
+		shell_print(shell, "  Destination: %s%s%s:%u%s", ipv6 ? "[" : "", ip_buf,
+			    ipv6 ? "]" : "", settings.dest_port, mcast ? " (multicast)" : "");
+	}
+	shell_print(shell, "  Tone: %u Hz @ %u%%", settings.frequency_hz, settings.amplitude_pct);
+	if (settings.waveform == TONE_WAVE_SWEEP_LIN || settings.waveform == TONE_WAVE_SWEEP_LOG) {
+		shell_print(shell, "  Waveform: %s %u-%u Hz over %u ms",
+			    waveform_names[settings.waveform], settings.frequency_hz,
+			    settings.sweep_end_hz, settings.sweep_ms);
+	} else if (settings.waveform == TONE_WAVE_MULTITONE) {
+		shell_print(shell, "  Waveform: %u tones", settings.tone_count);
+		for (uint32_t t = 0; t < settings.tone_count; t++) {
+			shell_print(shell, "    %u Hz @ %u%%", settings.tone_hz[t],
+				    settings.tone_pct[t]);
+		}
+	} else if (settings.waveform != TONE_WAVE_SINE) {
+		shell_print(shell, "  Waveform: %s", waveform_names[settings.waveform]);
+	}
+	shell_print(shell, "  Sample rate: %u Hz, packet %u ms, burst %u", settings.sample_rate_hz,
+		    settings.packet_duration_ms, settings.burst_packets);
+	if (settings.adapt_max_ms != 0U) {
+		shell_print(shell, "  Adaptive packets: %u ms now, bounds %u-%u ms, %u changes",
+			    stats.adapt_packet_ms, settings.adapt_min_ms, settings.adapt_max_ms,
+			    stats.adaptations);
+	}
+	shell_print(shell, "  Format: %u ch, %u-bit %s, channel phase step %u deg",
+		    settings.channels, sample_layouts[settings.sample_format].bits,
+		    codec_names[settings.codec], settings.channel_phase_deg);
+	shell_print(shell, "  QoS: %s (DSCP %u, priority %u)", qos_classes[settings.qos].name,
+		    qos_classes[settings.qos].dscp, qos_classes[settings.qos].priority);
+	shell_print(shell, "  Packets sent: %u (TX underruns %u)", stats.packets_sent,
+		    stats.tx_underruns);
+	if (settings.fec_group != 0U) {
+		shell_print(shell, "  FEC: 1 parity per %u packets, depth %u, %u parity sent",
+			    settings.fec_group, settings.fec_depth, stats.fec_packets);
+	}
+	if (settings.twt_align) {
+		shell_print(shell, "  TWT aligned: added latency avg %u max %u us over %u packets",
+			    stats.twt_hold_avg_us, stats.twt_hold_max_us, stats.twt_packets);
+	}
+	if (settings.link_report) {
+		shell_print(shell, "  Link reports: %u sent", stats.link_packets);
+	}
+	if (settings.offload) {
+		shell_print(shell, "  Synthesis: network core%s",
+			    (active && !stream_offloaded(stream)) ? " from next start" : "");
+	}
+	if (stats.pacing_err_count > 0U) {
+		shell_print(shell, "  Pacing error: min %d avg %d max %d us over %u wakeups",
+			    stats.pacing_err_min_us, stats.pacing_err_avg_us,
+			    stats.pacing_err_max_us, stats.pacing_err_count);
+	}
 }
 
-int tone_stream_set_target(const char *ip_str, uint16_t port)
+void tone_stream_status(const struct shell *shell)
 {
-	if (!ip_str || port == 0) {
-		return -EINVAL;
+	if (!shell) {
+		return;
 	}
 
-	struct in_addr addr;
-	if (zsock_inet_pton(AF_INET, ip_str, &addr) != 1) {
-		return -EINVAL;
+	shell_print(shell, "Tone pacing: %s, %u stream(s)",
+		    IS_ENABLED(CONFIG_TONE_STREAM_PACING_COUNTER) ? "counter" : "workqueue",
+		    TONE_MAX_STREAMS);
+#if defined(CONFIG_TONE_STREAM_TIMESYNC)
+	tone_timesync_status(shell);
+#endif
+	struct tone_echo_stats echo;
+
+	if (tone_stream_echo_get_stats(&echo) == 0 && echo.active) {
+		shell_print(shell, "Echo: UDP port %u, %u reflected", echo.port, echo.reflected);
+	}
+#if defined(CONFIG_TONE_STREAM_TWT)
+	twt_status(shell);
+#endif
+#if defined(CONFIG_TONE_STREAM_AUTOSTART)
+	if (engine.boot.lease_ms != 0U) {
+		shell_print(shell, "Boot: DHCP lease at %u ms, auto-start at %u ms",
+			    engine.boot.lease_ms, engine.boot.autostart_ms);
+	}
+#endif
+	if (engine.boot.first_packet_ms != 0U) {
+		shell_print(shell, "Boot to first packet: %u ms", engine.boot.first_packet_ms);
 	}
 
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	ctx.settings.dest_ipv4 = addr.s_addr;
-	ctx.settings.dest_port = port;
-	k_mutex_unlock(&ctx.lock);
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		struct tone_stream_context *stream = &streams[i];
+		struct tone_stream_settings settings;
 
-	return 0;
+		(void)settings_snapshot(stream, &settings);
+
+		/* Stream 0 is always listed; others once they have a destination */
+		if (i > 0U && settings.dest_family == AF_UNSPEC &&
+		    settings.transport == TONE_TRANSPORT_UDP) {
+			continue;
+		}
+
+		stream_status(shell, stream);
+	}
 }
 
-int tone_stream_set_params(uint16_t freq_hz, uint8_t amplitude_pct, uint32_t sample_rate_hz,
-			   uint16_t packet_ms)
+#if defined(CONFIG_TONE_STREAM_BENCH)
+/* One 10 ms packet at 48 kHz, the largest the benchmark renders */
+#define BENCH_PACKET_MS  10U
+#define BENCH_MAX_FRAMES 480U
+#define BENCH_RUNS       8U
+
+static uint8_t bench_out[BENCH_MAX_FRAMES * 2U * 3U];
+static uint8_t bench_ref[BENCH_MAX_FRAMES * 2U * 3U];
+
+static int bench_cycle_counter_enable(void)
 {
-	if (sample_rate_hz == 0U || packet_ms == 0U) {
-		return -EINVAL;
+	/* Sets TRCENA through DCB or CoreDebug, whichever the CMSIS version has */
+	int err = z_arm_dwt_init();
+
+	if (err) {
+		return err;
 	}
 
-	uint16_t amp = MIN(amplitude_pct, 100U);
-	uint32_t samples = DIV_ROUND_CLOSEST(sample_rate_hz * packet_ms, 1000U);
-	if (samples == 0U || samples > TONE_MAX_SAMPLES_PER_PACKET) {
-		return -ERANGE;
+	if (DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) {
+		return -ENOTSUP;
+	}
+
+	return z_arm_dwt_init_cycle_counter();
+}
+
+/* Fewest cycles over BENCH_RUNS renders, with interrupts held off */
+static uint32_t bench_cycles(const struct synth_kernel *kernel, synth_kernel_fn render,
+			     const struct tone_nco *nco, uint8_t *dst, uint32_t frames)
+{
+	struct tone_nco state[2];
+	uint32_t best = UINT32_MAX;
+
+	memcpy(state, nco, kernel->channels * sizeof(state[0]));
+
+	for (uint32_t run = 0; run < BENCH_RUNS; run++) {
+		unsigned int key = irq_lock();
+		uint32_t start = z_arm_dwt_get_cycles();
+
+		render(state, kernel->channels, kernel->format, dst, frames);
+		uint32_t cycles = z_arm_dwt_get_cycles() - start;
+
+		irq_unlock(key);
+		best = MIN(best, cycles);
+	}
+
+	return best;
+}
+#endif /* CONFIG_TONE_STREAM_BENCH */
+
+int tone_stream_bench(const struct shell *shell)
+{
+#if defined(CONFIG_TONE_STREAM_BENCH)
+	static const uint32_t rates_hz[] = {44100U, 48000U};
+	int ret;
+
+	if (!shell) {
+		return -EINVAL;
 	}
 
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	ctx.settings.frequency_hz = freq_hz;
-	ctx.settings.amplitude_pct = amp;
-	ctx.settings.sample_rate_hz = sample_rate_hz;
-	ctx.settings.packet_duration_ms = packet_ms;
-	ctx.samples_per_packet = samples;
-	ctx.interval_us = (uint32_t)(((uint64_t)samples * 1000000U) / ctx.settings.sample_rate_hz);
+	/* The oscillator's block buffers are shared with the synthesis stage */
+	for (uint8_t id = 0; id < TONE_MAX_STREAMS; id++) {
+		if (tone_stream_is_active(id)) {
+			return -EBUSY;
+		}
+	}
 
-	/* Generate new tone period with updated parameters */
-	int ret = generate_tone_period();
-	if (ret != 0) {
-		k_mutex_unlock(&ctx.lock);
+	ret = bench_cycle_counter_enable();
+	if (ret) {
 		return ret;
 	}
 
-	k_mutex_unlock(&ctx.lock);
+	shell_print(shell, "Kernel      Rate  Frames  Cycles/frame  Generic  Speedup  Output");
+
+	for (size_t k = 0; k < ARRAY_SIZE(synth_kernels); k++) {
+		const struct synth_kernel *kernel = &synth_kernels[k];
+
+		for (size_t r = 0; r < ARRAY_SIZE(rates_hz); r++) {
+			struct tone_stream_settings settings = {
+				.sample_rate_hz = rates_hz[r],
+				.frequency_hz = TONE_DEFAULT_FREQUENCY_HZ,
+				.amplitude_pct = TONE_DEFAULT_AMPLITUDE_PCT,
+				.channels = kernel->channels,
+				.channel_phase_deg = TONE_DEFAULT_CHANNEL_PHASE_DEG,
+			};
+			const uint32_t frames = samples_for_ms(&settings, BENCH_PACKET_MS);
+			const size_t len = frames * kernel->channels *
+					   sample_layouts[kernel->format].bytes;
+			struct tone_nco nco[2] = {0};
+			struct tone_nco state[2];
+
+			update_channel_ncos(nco, &settings);
+
+			/* Both renders start from the same phase, so the bytes must agree */
+			memcpy(state, nco, sizeof(state));
+			synth_generic(state, kernel->channels, kernel->format, bench_ref, frames);
+			memcpy(state, nco, sizeof(state));
+			kernel->render(state, kernel->channels, kernel->format, bench_out, frames);
+			bool match = memcmp(bench_out, bench_ref, len) == 0;
+
+			uint32_t fast =
+				bench_cycles(kernel, kernel->render, nco, bench_out, frames);
+			uint32_t slow = bench_cycles(kernel, synth_generic, nco, bench_ref, frames);
+			uint32_t fast_c = (uint32_t)((uint64_t)fast * 100U / frames);
+			uint32_t slow_c = (uint32_t)((uint64_t)slow * 100U / frames);
+			uint32_t speedup =
+				(fast > 0U) ? (uint32_t)((uint64_t)slow * 100U / fast) : 0U;
+
+			shell_print(shell, "%-10s %5u  %6u  %9u.%02u %5u.%02u  %4u.%02ux  %s",
+				    kernel->name, rates_hz[r], frames, fast_c / 100U, fast_c % 100U,
+				    slow_c / 100U, slow_c % 100U, speedup / 100U, speedup % 100U,
+				    match ? "match" : "MISMATCH");
+		}
+	}
+
+	shell_print(shell, "Core clock: %u Hz, fewest of %u runs, interrupts locked",
+		    SystemCoreClock, BENCH_RUNS);
 
 	return 0;
+#else
+	ARG_UNUSED(shell);
+	return -ENOTSUP;
+#endif
+}
+
+#if !defined(CONFIG_TONE_STREAM_OFFLOAD)
+int tone_stream_bench_offload(const struct shell *shell, uint32_t seconds)
+{
+	ARG_UNUSED(shell);
+	ARG_UNUSED(seconds);
+	return -ENOTSUP;
 }
+#endif
 
-int tone_stream_adjust_amplitude(int delta_pct)
+#if defined(CONFIG_TONE_STREAM_LINK)
+/* Data packets of every stream sampled, as <id>:<first>-<last> */
+static void link_ranges_format(const struct tone_link_sample *sample, char *buf, size_t size)
 {
-	int ret = 0;
+	size_t len = 0U;
 
-	k_mutex_lock(&ctx.lock, K_FOREVER);
+	buf[0] = '\0';
+	for (uint8_t id = 0; id < TONE_MAX_STREAMS && len < size; id++) {
+		if (!(sample->active & BIT(id))) {
+			continue;
+		}
+
+		uint32_t end = sample->end_seq[id];
+		int n = (sample->packets[id] == 0U)
+				? snprintk(buf + len, size - len, " %u:none", id)
+				: snprintk(buf + len, size - len, " %u:%u-%u", id,
+					   end - sample->packets[id], end - 1U);
 
-	uint8_t new_amp = ctx.settings.amplitude_pct;
-	int new_val = (int)new_amp + delta_pct;
-	new_val = CLAMP(new_val, 0, 100);
-	new_amp = (uint8_t)new_val;
+		len += (n > 0) ? (size_t)n : 0U;
+	}
+}
+#endif
 
-	if (new_amp == ctx.settings.amplitude_pct) {
-		ret = 0;
-		goto exit;
+int tone_stream_link(const struct shell *shell)
+{
+#if defined(CONFIG_TONE_STREAM_LINK)
+	if (!shell) {
+		return -EINVAL;
 	}
 
-	uint8_t old_amp = ctx.settings.amplitude_pct;
-	ctx.settings.amplitude_pct = new_amp;
+	k_spinlock_key_t key = k_spin_lock(&link.lock);
+	const uint32_t taken = link.taken;
+
+	k_spin_unlock(&link.lock, key);
 
-	ret = generate_tone_period();
-	if (ret != 0) {
-		/* Restore previous amplitude on failure */
-		ctx.settings.amplitude_pct = old_amp;
-		(void)generate_tone_period();
-		goto exit;
+	const uint32_t count = MIN(taken, (uint32_t)LINK_SAMPLES);
+
+	shell_print(shell, "Link telemetry: every %u ms while streaming, %u of %u samples",
+		    CONFIG_TONE_STREAM_LINK_PERIOD_MS, count, LINK_SAMPLES);
+	if (count == 0U) {
+		return 0;
 	}
 
-	ctx.tone_position = 0;
-	LOG_INF("Tone amplitude set to %u%%", ctx.settings.amplitude_pct);
+	shell_print(shell, " Uptime ms  RSSI  PHY Mbps  TX pkts  TX err  Overrun  Bcn miss  "
+			   "Packets");
 
-exit:
-	k_mutex_unlock(&ctx.lock);
+	for (uint32_t n = taken - count; n < taken; n++) {
+		struct tone_link_sample sample;
+		char ranges[TONE_MAX_STREAMS * 24U + 1U];
 
-	return ret;
+		/* Copied one at a time; samples overwritten meanwhile are skipped */
+		key = k_spin_lock(&link.lock);
+		const bool current = link.taken - n <= LINK_SAMPLES;
+
+		if (current) {
+			sample = link.ring[n % LINK_SAMPLES];
+		}
+		k_spin_unlock(&link.lock, key);
+
+		if (!current) {
+			continue;
+		}
+
+		link_ranges_format(&sample, ranges, sizeof(ranges));
+		shell_print(shell, "%10u %5d %7u.%u %8u %7u %8u %9u %s%s", sample.uptime_ms,
+			    sample.rssi_dbm, sample.phy_rate_kbps / 1000U,
+			    (sample.phy_rate_kbps % 1000U) / 100U,
+			    sample.tx_packets, sample.tx_errors, sample.tx_overruns,
+			    sample.beacons_missed, sample.connected ? "" : " disconnected",
+			    ranges);
+	}
+
+	return 0;
+#else
+	ARG_UNUSED(shell);
+	return -ENOTSUP;
+#endif
 }
 
-int tone_stream_start(const struct shell *shell)
+void tone_stream_stack_usage_print(const struct shell *shell, const char *name,
+				   struct k_thread *thread, size_t size)
 {
-	k_mutex_lock(&ctx.lock, K_FOREVER);
+#if defined(CONFIG_THREAD_STACK_INFO)
+	size_t unused;
 
-	if (ctx.streaming) {
-		k_mutex_unlock(&ctx.lock);
-		return -EALREADY;
+	if (k_thread_stack_space_get(thread, &unused) == 0) {
+		shell_print(shell, "  %-10s %5zu bytes, %5zu never used", name, size, unused);
+		return;
 	}
+#else
+	ARG_UNUSED(thread);
+#endif
+	shell_print(shell, "  %-10s %5zu bytes", name, size);
+}
 
-	if (ctx.settings.dest_port == 0U || ctx.settings.dest_ipv4 == 0U) {
-		k_mutex_unlock(&ctx.lock);
-		return -ENOTCONN;
+int tone_stream_mem(const struct shell *shell)
+{
+	if (!shell) {
+		return -EINVAL;
 	}
 
-	if (ctx.samples_per_packet == 0U) {
-		ctx.samples_per_packet = DIV_ROUND_CLOSEST(
-			ctx.settings.sample_rate_hz * ctx.settings.packet_duration_ms, 1000U);
-		if (ctx.samples_per_packet == 0U ||
-		    ctx.samples_per_packet > TONE_MAX_SAMPLES_PER_PACKET) {
-			k_mutex_unlock(&ctx.lock);
-			return -ERANGE;
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+	shell_print(shell, "PCM: rendered into network buffers (zero-copy)");
+#else
+	shell_print(shell, "PCM ring slab: %u x %u bytes, %u in use, peak %u",
+		    CONFIG_TONE_STREAM_PCM_RINGS, PCM_RING_BYTES,
+		    k_mem_slab_num_used_get(&tone_pcm_slab), engine.pcm_rings_peak);
+#endif
+
+	for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+		struct tone_stream_context *stream = &streams[i];
+		struct tone_stream_settings settings;
+
+		(void)settings_snapshot(stream, &settings);
+
+		if (i > 0U && settings.dest_family == AF_UNSPEC &&
+		    settings.transport == TONE_TRANSPORT_UDP) {
+			continue;
 		}
+
+#if defined(CONFIG_TONE_STREAM_ZEROCOPY)
+		shell_print(shell, "Stream %u: %s", i,
+			    atomic_get(&stream->streaming) ? "streaming" : "stopped");
+#else
+		/* pcm_peak is written by the synthesis stage; a torn read only skews the report */
+		uint32_t need = pcm_ring_need(&settings);
+
+		shell_print(shell, "Stream %u: %s, ring needs %u of %u bytes%s, peak %u", i,
+			    stream->pcm_ring ? "holds ring" : "no ring", need, PCM_RING_BYTES,
+			    (need > PCM_RING_BYTES) ? " (lookahead limited)" : "",
+			    stream->pcm_peak);
+#endif
 	}
 
-	if (ctx.interval_us == 0U) {
-		ctx.interval_us = (uint32_t)(((uint64_t)ctx.samples_per_packet * 1000000U) /
-					     ctx.settings.sample_rate_hz);
+	shell_print(shell, "Stream state: %u x %zu bytes", TONE_MAX_STREAMS,
+		    sizeof(struct tone_stream_context));
+#if defined(CONFIG_TONE_STREAM_FEC)
+	shell_print(shell, "  FEC parity: %zu bytes of each", sizeof(streams[0].synth.fec.lanes));
+#endif
+#if defined(CONFIG_TONE_STREAM_BENCH)
+	shell_print(shell, "Bench buffers: %zu bytes", sizeof(bench_out) + sizeof(bench_ref));
+#endif
+#if defined(CONFIG_TONE_STREAM_LINK)
+	shell_print(shell, "Link telemetry ring: %u x %zu bytes", LINK_SAMPLES,
+		    sizeof(link.ring[0]));
+#endif
+
+	shell_print(shell, "Stacks:");
+	if (tone_stream_work_q_started) {
+		tone_stream_stack_usage_print(shell, "workqueue", &tone_stream_work_q.thread,
+				  K_THREAD_STACK_SIZEOF(tone_stream_work_stack));
 	}
+#if defined(CONFIG_TONE_STREAM_PACING_COUNTER)
+	if (tone_pacing_thread_started) {
+		tone_stream_stack_usage_print(shell, "pacing", &tone_pacing_thread,
+				  K_THREAD_STACK_SIZEOF(tone_pacing_stack));
+	}
+#endif
+#if defined(CONFIG_TONE_STREAM_TIMESYNC)
+	tone_timesync_mem(shell);
+#endif
 
-	int ret = configure_destination_socket();
-	if (ret < 0) {
-		k_mutex_unlock(&ctx.lock);
-		return ret;
+	return 0;
+}
+
+int tone_stream_get_stats(uint8_t id, struct tone_stream_stats *out)
+{
+	struct tone_stream_context *stream = stream_get(id);
+
+	if (!stream || !out) {
+		return -EINVAL;
 	}
 
-	ctx.seq_num = 0;
-	ctx.sample_counter = 0;
-	ctx.tone_position = 0;
-	ctx.next_deadline_us = 0U;
+	struct tone_stream_settings settings;
+	int64_t pacing_sum;
+	uint64_t synth_sum;
+	uint64_t twt_hold_sum;
+	uint64_t ac_sum[TONE_QOS_COUNT];
+	uint32_t ac_hist[TONE_QOS_COUNT][TONE_STATS_HIST_BUCKETS];
+	uint64_t elapsed_us;
+
+	(void)settings_snapshot(stream, &settings);
 
-	/* Generate tone period if not already done */
-	if (ctx.tone_period_samples == 0) {
-		ret = generate_tone_period();
-		if (ret != 0) {
-			k_mutex_unlock(&ctx.lock);
-			return ret;
+	k_spinlock_key_t key = k_spin_lock(&stream->stats_lock);
+
+	*out = stream->stats;
+	pacing_sum = stream->pacing_err_sum_us;
+	synth_sum = stream->synth_us_sum;
+	twt_hold_sum = stream->twt_hold_sum_us;
+	memcpy(ac_sum, stream->ac_send_sum_us, sizeof(ac_sum));
+	memcpy(ac_hist, stream->ac_send_hist, sizeof(ac_hist));
+	elapsed_us = stream->stats_last_us - stream->stats_start_us;
+
+	k_spin_unlock(&stream->stats_lock, key);
+
+	out->elapsed_us = elapsed_us;
+	out->pacing_err_avg_us =
+		(out->pacing_err_count > 0U) ? (int32_t)(pacing_sum / out->pacing_err_count) : 0;
+	out->synth_avg_us =
+		(out->packets_built > 0U) ? (uint32_t)(synth_sum / out->packets_built) : 0U;
+	out->twt_hold_avg_us =
+		(out->twt_packets > 0U) ? (uint32_t)(twt_hold_sum / out->twt_packets) : 0U;
+
+	for (uint32_t qos = 0; qos < TONE_QOS_COUNT; qos++) {
+		struct tone_ac_stats *ac = &out->ac[qos];
+
+		if (ac->sends == 0U) {
+			continue;
 		}
+
+		ac->avg_us = (uint32_t)(ac_sum[qos] / ac->sends);
+		ac->p99_us = hist_percentile_bound(ac_hist[qos], ac->sends, 99U);
 	}
+	const uint64_t mpackets = (uint64_t)out->packets_sent * 1000U * USEC_PER_SEC;
 
-	ctx.streaming = true;
-	ctx.next_deadline_us = micros_now();
-	ctx.consecutive_send_failures = 0;
+	out->achieved_mpps = (elapsed_us > 0U) ? (uint32_t)(mpackets / elapsed_us) : 0U;
 
-	k_mutex_unlock(&ctx.lock);
+	atomic_val_t target = atomic_get(&stream->adapt_target);
 
-	k_work_schedule_for_queue(&tone_stream_work_q, &ctx.work, K_NO_WAIT);
+	out->adapt_packet_ms = (settings.adapt_max_ms != 0U) ? ((uint32_t)target & 0xFFFFU) : 0U;
 
-	if (shell) {
-		shell_print(shell, "Tone stream started: %u Hz, %u%%, %u ms packets",
-			    ctx.settings.frequency_hz, ctx.settings.amplitude_pct,
-			    ctx.settings.packet_duration_ms);
-	}
+	uint32_t samples = samples_for_ms(&settings, (out->adapt_packet_ms != 0U)
+							     ? out->adapt_packet_ms
+							     : settings.packet_duration_ms);
+
+	out->configured_mpps =
+		(samples > 0U) ? (uint32_t)(((uint64_t)settings.sample_rate_hz * 1000U) / samples)
+			       : 0U;
 
 	return 0;
 }
 
-void tone_stream_stop(const struct shell *shell)
+int tone_stream_reset_stats(uint8_t id)
 {
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	stop_locked();
-	k_mutex_unlock(&ctx.lock);
+	struct tone_stream_context *stream = stream_get(id);
 
-	if (shell) {
-		shell_print(shell, "Tone stream stopped");
+	if (!stream) {
+		return -EINVAL;
 	}
+
+	stats_reset(stream);
+
+	return 0;
 }
 
-void tone_stream_status(const struct shell *shell)
+uint8_t tone_stream_get_current_amplitude(uint8_t id)
 {
-	if (!shell) {
-		return;
-	}
-
+	struct tone_stream_context *stream = stream_get(id);
 	struct tone_stream_settings settings;
-	bool active;
-	uint32_t packets;
-
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	settings = ctx.settings;
-	active = ctx.streaming;
-	packets = ctx.seq_num;
-	k_mutex_unlock(&ctx.lock);
-
-	char ip_buf[NET_IPV4_ADDR_LEN];
-
-	if (settings.dest_ipv4 != 0U) {
-		struct in_addr addr = {
-			.s_addr = settings.dest_ipv4,
-		};
-		zsock_inet_ntop(AF_INET, &addr, ip_buf, sizeof(ip_buf));
-	} else {
-		strcpy(ip_buf, "unset");
+
+	if (!stream) {
+		return 0U;
 	}
 
-	shell_print(shell, "Tone state: %s", active ? "streaming" : "stopped");
-	shell_print(shell, "  Destination: %s:%u", ip_buf, settings.dest_port);
-	shell_print(shell, "  Tone: %u Hz @ %u%%", settings.frequency_hz, settings.amplitude_pct);
-	shell_print(shell, "  Sample rate: %u Hz, packet %u ms", settings.sample_rate_hz,
-		    settings.packet_duration_ms);
-	shell_print(shell, "  Packets sent: %u", packets);
+	(void)settings_snapshot(stream, &settings);
+
+	return settings.amplitude_pct;
 }
 
-uint8_t tone_stream_get_current_amplitude(void)
+#if !defined(CONFIG_TONE_STREAM_ECHO)
+int tone_stream_echo_start(uint16_t port)
 {
-	uint8_t amp;
+	ARG_UNUSED(port);
+	return -ENOTSUP;
+}
 
-	k_mutex_lock(&ctx.lock, K_FOREVER);
-	amp = ctx.settings.amplitude_pct;
-	k_mutex_unlock(&ctx.lock);
+int tone_stream_echo_stop(void)
+{
+	return -ENOTSUP;
+}
 
-	return amp;
+int tone_stream_echo_get_stats(struct tone_echo_stats *out)
+{
+	ARG_UNUSED(out);
+	return -ENOTSUP;
 }
+#endif
@@ -19,31 +19,261 @@ extern "C" {
 #define TONE_DEFAULT_PACKET_DURATION_MS 10U
 #define TONE_DEFAULT_FREQUENCY_HZ       1000U
 #define TONE_DEFAULT_AMPLITUDE_PCT      50U
+#define TONE_DEFAULT_BURST_PACKETS      1U
+#define TONE_DEFAULT_CHANNELS           1U
+#define TONE_DEFAULT_SAMPLE_FORMAT      TONE_SAMPLE_S16
+#define TONE_DEFAULT_CHANNEL_PHASE_DEG  90U
+#define TONE_DEFAULT_CODEC              TONE_CODEC_PCM
+#define TONE_DEFAULT_QOS                TONE_QOS_BE
+#define TONE_DEFAULT_FEC_GROUP          0U
+#define TONE_DEFAULT_FEC_DEPTH          1U
+#define TONE_DEFAULT_TRANSPORT          TONE_TRANSPORT_UDP
+#define TONE_DEFAULT_WAVEFORM           TONE_WAVE_SINE
+#define TONE_DEFAULT_SWEEP_END_HZ       20000U
+#define TONE_DEFAULT_SWEEP_MS           10000U
 
+/* Samples per packet across all channels, i.e. frames * channels */
 #define TONE_MAX_SAMPLES_PER_PACKET CONFIG_TONE_MAX_SAMPLES_PER_PACKET
-#define TONE_MAX_PAYLOAD_BYTES      (TONE_MAX_SAMPLES_PER_PACKET * sizeof(int16_t))
+#define TONE_MAX_SAMPLE_BYTES       4U
+#define TONE_MAX_PAYLOAD_BYTES      (TONE_MAX_SAMPLES_PER_PACKET * TONE_MAX_SAMPLE_BYTES)
+#define TONE_MAX_CHANNELS           CONFIG_TONE_MAX_CHANNELS
+#define TONE_MAX_BURST_PACKETS      CONFIG_TONE_STREAM_MAX_BURST
+#define TONE_MAX_STREAMS            CONFIG_TONE_MAX_STREAMS
+/* Sines summed by the multitone waveform */
+#define TONE_MAX_TONES              8U
+
+/* FEC parity groups: data packets per parity packet and interleaving depth */
+#define TONE_FEC_MAX_GROUP 32U
+#if defined(CONFIG_TONE_STREAM_FEC)
+#define TONE_FEC_MAX_DEPTH CONFIG_TONE_STREAM_FEC_MAX_DEPTH
+#else
+#define TONE_FEC_MAX_DEPTH 1U
+#endif
+
+/* Stream driven by the legacy single-stream commands and the board buttons */
+#define TONE_DEFAULT_STREAM_ID 0U
+
+/* Histogram bucket i counts values in [2^i, 2^(i+1)) us; bucket 0 also holds 0 */
+#define TONE_STATS_HIST_BUCKETS 16U
+
+/* PCM sample encodings, little-endian signed integers on the wire */
+enum tone_sample_format {
+	TONE_SAMPLE_S16,
+	/* Packed 3-byte samples */
+	TONE_SAMPLE_S24,
+	TONE_SAMPLE_S32,
+	TONE_SAMPLE_FORMAT_COUNT,
+};
+
+/* Payload encodings; the codecs take 16-bit samples only */
+enum tone_codec {
+	TONE_CODEC_PCM,
+	/* 4 bits per sample, lossy */
+	TONE_CODEC_IMA_ADPCM,
+	/* Frame-to-frame deltas, Rice coded, lossless */
+	TONE_CODEC_RICE,
+	TONE_CODEC_COUNT,
+};
+
+/* WMM access categories, selected through the DSCP of every datagram */
+enum tone_qos {
+	TONE_QOS_BE,
+	TONE_QOS_BK,
+	TONE_QOS_VI,
+	TONE_QOS_VO,
+	TONE_QOS_COUNT,
+};
+
+/* How datagrams leave the device */
+enum tone_transport {
+	/* UDP through the IP stack and the Wi-Fi connection */
+	TONE_TRANSPORT_UDP,
+	/* 802.11 data frames injected through the nRF70 raw TX path */
+	TONE_TRANSPORT_RAW,
+	TONE_TRANSPORT_COUNT,
+};
+
+/* Signal the oscillator generates; only sine works without CONFIG_TONE_STREAM_WAVEFORMS */
+enum tone_waveform {
+	TONE_WAVE_SINE,
+	/* Chirps from frequency_hz to sweep_end_hz, restarting when they get there */
+	TONE_WAVE_SWEEP_LIN,
+	TONE_WAVE_SWEEP_LOG,
+	/* Sum of tone_count sines */
+	TONE_WAVE_MULTITONE,
+	/* Band-limited, at frequency_hz */
+	TONE_WAVE_SQUARE,
+	TONE_WAVE_TRIANGLE,
+	TONE_WAVE_PINK_NOISE,
+	TONE_WAVE_COUNT,
+};
 
 struct tone_stream_settings {
 	uint32_t sample_rate_hz;
 	uint16_t packet_duration_ms;
 	uint16_t frequency_hz;
 	uint8_t amplitude_pct;
-	uint32_t dest_ipv4;
+	/* Unicast or multicast destination; AF_UNSPEC until a target is set */
+	sa_family_t dest_family;
+	union {
+		struct in_addr dest_ipv4;
+		struct in6_addr dest_ipv6;
+	};
 	uint16_t dest_port;
+	uint8_t burst_packets;
+	uint8_t channels;
+	uint8_t sample_format;
+	/* Phase of channel n leads channel 0 by n * channel_phase_deg */
+	uint16_t channel_phase_deg;
+	uint8_t codec;
+	/*
+	 * Adaptive packet duration bounds; both 0 keeps packet_duration_ms
+	 * fixed. Otherwise the TX stage moves the duration within them.
+	 */
+	uint16_t adapt_min_ms;
+	uint16_t adapt_max_ms;
+	/* Non-zero holds packets for Wi-Fi TWT service periods */
+	uint8_t twt_align;
+	uint8_t qos;
+	/*
+	 * One XOR parity packet per fec_group data packets, 0 disables FEC.
+	 * fec_depth groups are interleaved, each taking every fec_depth-th
+	 * packet, so a burst of up to fec_depth losses stays recoverable.
+	 */
+	uint8_t fec_group;
+	uint8_t fec_depth;
+	uint8_t transport;
+	/* Receiver address of raw frames, broadcast by default */
+	uint8_t dest_mac[6];
+	uint8_t waveform;
+	uint16_t sweep_end_hz;
+	uint32_t sweep_ms;
+	/* Multitone components; each amplitude is a percentage of amplitude_pct */
+	uint8_t tone_count;
+	uint16_t tone_hz[TONE_MAX_TONES];
+	uint8_t tone_pct[TONE_MAX_TONES];
+	/* Non-zero sends a Wi-Fi link report after every link telemetry sample */
+	uint8_t link_report;
+	/* Non-zero has the network core synthesize and pace the stream from its next start */
+	uint8_t offload;
+};
+
+/* Send durations of the packets one access category carried */
+struct tone_ac_stats {
+	uint32_t sends;
+	uint32_t avg_us;
+	/* Upper bound of the histogram bucket holding the 99th percentile */
+	uint32_t p99_us;
+	uint32_t max_us;
+};
+
+/* Snapshot of the TX hot-path counters since stream start or the last reset */
+struct tone_stream_stats {
+	uint32_t packets_sent;
+	uint32_t send_err_nomem;
+	uint32_t send_err_again;
+	uint32_t send_err_other;
+	uint32_t consecutive_send_failures;
+	uint32_t synth_alloc_failures;
+	uint32_t tx_underruns;
+	uint32_t wakeups;
+	uint32_t late_wakeups;
+	uint32_t max_lateness_us;
+	uint32_t max_send_us;
+	int32_t pacing_err_min_us;
+	int32_t pacing_err_max_us;
+	int32_t pacing_err_avg_us;
+	uint32_t pacing_err_count;
+	uint64_t elapsed_us;
+	/* Packet rates in packets per 1000 s */
+	uint32_t achieved_mpps;
+	uint32_t configured_mpps;
+	/* Synthesis stage: payload put on the wire against the PCM it carries */
+	uint32_t packets_built;
+	uint32_t codec_fallbacks;
+	uint32_t synth_avg_us;
+	uint32_t max_synth_us;
+	uint64_t pcm_bytes;
+	uint64_t payload_bytes;
+	/* Adaptive packet sizing: changes made and current duration, 0 when fixed */
+	uint32_t adaptations;
+	uint32_t adapt_packet_ms;
+	/* TWT alignment: packets it sent and how long they waited past their deadline */
+	uint32_t twt_packets;
+	uint32_t twt_hold_avg_us;
+	uint32_t twt_hold_max_us;
+	/* FEC: parity packets sent and the parity bytes built */
+	uint32_t fec_packets;
+	uint64_t fec_bytes;
+	/* Link telemetry reports sent in-band */
+	uint32_t link_packets;
+	struct tone_ac_stats ac[TONE_QOS_COUNT];
+	uint32_t send_hist[TONE_STATS_HIST_BUCKETS];
+	uint32_t lateness_hist[TONE_STATS_HIST_BUCKETS];
+};
+
+/* Counters of the 'tone echo' reflector since it was started */
+struct tone_echo_stats {
+	bool active;
+	uint16_t port;
+	uint32_t received;
+	uint32_t reflected;
+	/* Send failures */
+	uint32_t dropped;
+	/* Datagrams too short to carry a tone header */
+	uint32_t malformed;
+	/* Sequence gaps on arrival: lost between sender and device */
+	uint32_t forward_lost;
+	uint32_t reordered;
+	/* Arrival stamp to hand-off of the reflected datagram */
+	uint32_t turnaround_avg_us;
+	uint32_t turnaround_max_us;
 };
 
 int tone_stream_init(void);
-bool tone_stream_is_active(void);
-int tone_stream_get_settings(struct tone_stream_settings *out);
-int tone_stream_start(const struct shell *shell);
-void tone_stream_stop(const struct shell *shell);
+bool tone_stream_is_active(uint8_t id);
+int tone_stream_get_settings(uint8_t id, struct tone_stream_settings *out);
+int tone_stream_save(uint8_t id, bool autostart);
+int tone_stream_erase(uint8_t id);
+int tone_stream_start(uint8_t id, const struct shell *shell);
+int tone_stream_stop(uint8_t id, const struct shell *shell);
+void tone_stream_stop_all(const struct shell *shell);
 void tone_stream_status(const struct shell *shell);
-int tone_stream_set_target(const char *ip_str, uint16_t port);
-int tone_stream_set_params(uint16_t freq_hz, uint8_t amplitude_pct, uint32_t sample_rate_hz,
-			   uint16_t packet_ms);
-int tone_stream_adjust_amplitude(int delta_pct);
-uint8_t tone_stream_get_current_amplitude(void);
-int tone_stream_adjust_amplitude(int delta_pct);
+int tone_stream_bench(const struct shell *shell);
+int tone_stream_bench_offload(const struct shell *shell, uint32_t seconds);
+int tone_stream_mem(const struct shell *shell);
+int tone_stream_link(const struct shell *shell);
+int tone_stream_get_stats(uint8_t id, struct tone_stream_stats *out);
+int tone_stream_reset_stats(uint8_t id);
+int tone_stream_set_target(uint8_t id, const char *ip_str, uint16_t port);
+int tone_stream_set_config(uint8_t id, const struct tone_stream_settings *config);
+int tone_stream_set_params(uint8_t id, uint16_t freq_hz, uint8_t amplitude_pct,
+			   uint32_t sample_rate_hz, uint16_t packet_ms);
+int tone_stream_set_burst(uint8_t id, uint8_t packets);
+int tone_stream_set_format(uint8_t id, uint8_t channels, enum tone_sample_format format,
+			   uint16_t channel_phase_deg);
+uint8_t tone_stream_sample_bits(enum tone_sample_format format);
+int tone_stream_set_codec(uint8_t id, enum tone_codec codec);
+int tone_stream_set_adaptive(uint8_t id, uint16_t min_ms, uint16_t max_ms);
+int tone_stream_set_twt_align(uint8_t id, bool enable);
+int tone_stream_set_qos(uint8_t id, enum tone_qos qos);
+int tone_stream_set_fec(uint8_t id, uint8_t group, uint8_t depth);
+int tone_stream_set_link_report(uint8_t id, bool enable);
+int tone_stream_set_offload(uint8_t id, bool enable);
+int tone_stream_set_transport(uint8_t id, enum tone_transport transport, const uint8_t *dest_mac);
+const char *tone_stream_transport_name(enum tone_transport transport);
+int tone_stream_set_waveform(uint8_t id, enum tone_waveform waveform);
+int tone_stream_set_sweep(uint8_t id, uint16_t end_hz, uint32_t duration_ms);
+int tone_stream_set_multitone(uint8_t id, uint8_t count, const uint16_t *freq_hz,
+			      const uint8_t *amplitude_pct);
+const char *tone_stream_waveform_name(enum tone_waveform waveform);
+const char *tone_stream_qos_name(enum tone_qos qos);
+const char *tone_stream_codec_name(enum tone_codec codec);
+int tone_stream_adjust_amplitude(uint8_t id, int delta_pct);
+uint8_t tone_stream_get_current_amplitude(uint8_t id);
+int tone_stream_echo_start(uint16_t port);
+int tone_stream_echo_stop(void);
+int tone_stream_echo_get_stats(struct tone_echo_stats *out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,59 @@
+/*
+ * Wi-Fi Audio Tone Test - interfaces between the tone engine units
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+#include "tone_offload_proto.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Base header of every tone datagram, big-endian on the wire */
+struct tone_packet_header {
+	uint32_t seq;
+	uint32_t sample_count;
+	uint32_t timestamp_us;
+} __packed;
+
+/* Stream time base in us, the clock of deadlines and packet timestamps */
+uint64_t tone_stream_micros(void);
+
+void tone_stream_work_submit(struct k_work *work);
+
+/* One 'tone mem' line for a thread stack of size bytes */
+void tone_stream_stack_usage_print(const struct shell *shell, const char *name,
+				   struct k_thread *thread, size_t size);
+
+#if defined(CONFIG_TONE_STREAM_TIMESYNC)
+/* Started once the time base is final */
+void tone_timesync_init(void);
+void tone_timesync_status(const struct shell *shell);
+void tone_timesync_mem(const struct shell *shell);
+#endif
+
+#if defined(CONFIG_TONE_STREAM_OFFLOAD)
+/* The network core boots on its own; its HELLO marks it ready for streams */
+void tone_offload_init(void);
+
+/* Limits the network core announced, or -ENODEV until its HELLO arrived */
+int tone_offload_limits(uint8_t *max_streams, uint16_t *max_block_bytes);
+
+int tone_offload_send(const void *msg, size_t len);
+
+/* TX stage of one offloaded block, run from the tone workqueue */
+void tone_stream_offload_serve(const struct tone_offload_block *block, size_t len);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
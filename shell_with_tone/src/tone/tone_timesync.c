@@ -0,0 +1,134 @@
+/*
+ * Wi-Fi Audio Tone Test - time-sync responder
+ */
+
+#include "tone_stream_internal.h"
+
+#include <errno.h>
+
+#include <zephyr/logging/log.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+LOG_MODULE_DECLARE(tone_stream, CONFIG_LOG_DEFAULT_LEVEL);
+
+/*
+ * Time-sync probe exchanged with the receiver, big-endian like the stream
+ * header. The receiver sends a request carrying its own clock; the
+ * responder returns it with the stream time base at arrival and departure,
+ * the four timestamps of an NTP exchange.
+ */
+#define TIMESYNC_MAGIC         0x5453U
+#define TIMESYNC_VERSION       1U
+#define TIMESYNC_TYPE_REQUEST  0U
+#define TIMESYNC_TYPE_RESPONSE 1U
+
+/* Back-off after a socket error so a dead interface does not spin */
+#define TIMESYNC_ERROR_BACKOFF_MS 100
+
+struct tone_timesync_msg {
+	uint16_t magic;
+	uint8_t version;
+	uint8_t type;
+	uint32_t seq;
+	/* Receiver clock when the request left, echoed unchanged */
+	uint64_t origin_us;
+	/* tone_stream_micros() when the request arrived and when the response left */
+	uint64_t receive_us;
+	uint64_t transmit_us;
+} __packed;
+
+K_THREAD_STACK_DEFINE(tone_timesync_stack, CONFIG_TONE_STREAM_TIMESYNC_STACK_SIZE);
+static struct k_thread tone_timesync_thread;
+static bool tone_timesync_thread_started;
+static atomic_t timesync_answered;
+
+static void tone_timesync_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	struct sockaddr_in local = {
+		.sin_family = AF_INET,
+		.sin_port = htons(CONFIG_TONE_STREAM_TIMESYNC_PORT),
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+
+	int fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd < 0) {
+		LOG_ERR("Time-sync socket() failed: %d", errno);
+		return;
+	}
+
+	if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+		LOG_ERR("Time-sync bind() failed: %d", errno);
+		close(fd);
+		return;
+	}
+
+	LOG_INF("Time-sync responder on UDP port %d", CONFIG_TONE_STREAM_TIMESYNC_PORT);
+
+	for (;;) {
+		struct tone_timesync_msg msg;
+		struct sockaddr_in peer;
+		socklen_t peer_len = sizeof(peer);
+
+		ssize_t len = recvfrom(fd, &msg, sizeof(msg), 0, (struct sockaddr *)&peer,
+				       &peer_len);
+		uint64_t receive_us = tone_stream_micros();
+
+		if (len < 0) {
+			LOG_ERR("Time-sync recvfrom() failed: %d", errno);
+			k_sleep(K_MSEC(TIMESYNC_ERROR_BACKOFF_MS));
+			continue;
+		}
+
+		if (len != sizeof(msg) || sys_be16_to_cpu(msg.magic) != TIMESYNC_MAGIC ||
+		    msg.version != TIMESYNC_VERSION || msg.type != TIMESYNC_TYPE_REQUEST) {
+			continue;
+		}
+
+		msg.type = TIMESYNC_TYPE_RESPONSE;
+		msg.receive_us = sys_cpu_to_be64(receive_us);
+		msg.transmit_us = sys_cpu_to_be64(tone_stream_micros());
+
+		if (sendto(fd, &msg, sizeof(msg), 0, (struct sockaddr *)&peer, peer_len) < 0) {
+			LOG_DBG("Time-sync sendto() failed: %d", errno);
+			continue;
+		}
+
+		atomic_inc(&timesync_answered);
+	}
+}
+
+void tone_timesync_init(void)
+{
+	if (tone_timesync_thread_started) {
+		return;
+	}
+
+	k_thread_create(&tone_timesync_thread, tone_timesync_stack,
+			K_THREAD_STACK_SIZEOF(tone_timesync_stack), tone_timesync_thread_fn, NULL,
+			NULL, NULL, K_PRIO_PREEMPT(CONFIG_TONE_STREAM_TIMESYNC_PRIORITY), 0,
+			K_NO_WAIT);
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&tone_timesync_thread, "tone_timesync");
+	}
+	tone_timesync_thread_started = true;
+}
+
+void tone_timesync_status(const struct shell *shell)
+{
+	shell_print(shell, "Time sync: UDP port %d, %ld probes answered",
+		    CONFIG_TONE_STREAM_TIMESYNC_PORT, (long)atomic_get(&timesync_answered));
+}
+
+void tone_timesync_mem(const struct shell *shell)
+{
+	if (tone_timesync_thread_started) {
+		tone_stream_stack_usage_print(shell, "timesync", &tone_timesync_thread,
+					      K_THREAD_STACK_SIZEOF(tone_timesync_stack));
+	}
+}
@@ -15,6 +15,7 @@
 LOG_MODULE_REGISTER(promiscuous_mode, CONFIG_LOG_DEFAULT_LEVEL);
 
 #include "net_private.h"
+#include "wifi_promiscuous_stats.h"
 
 static int cmd_wifi_promisc(const struct shell *sh, size_t argc, char *argv[])
 {
@@ -49,6 +50,44 @@ static int cmd_wifi_promisc(const struct shell *sh, size_t argc, char *argv[])
 	return 0;
 }
 
+#if defined(CONFIG_PROMISC_STATS)
+static int cmd_wifi_promisc_stats(const struct shell *sh, size_t argc, char *argv[])
+{
+	int ret;
+
+	if (argc == 1) {
+		promisc_stats_print(sh);
+		return 0;
+	}
+
+	if (strcmp(argv[1], "start") == 0) {
+		ret = promisc_stats_start();
+		if (ret == -EALREADY) {
+			shell_warn(sh, "Capture already running");
+		} else if (ret) {
+			LOG_ERR("Capture start failed: %d", ret);
+			return -ENOEXEC;
+		} else {
+			shell_print(sh, "Capture started");
+		}
+	} else if (strcmp(argv[1], "stop") == 0) {
+		if (promisc_stats_stop() == -EALREADY) {
+			shell_warn(sh, "Capture not running");
+		} else {
+			shell_print(sh, "Capture stopped");
+		}
+	} else if (strcmp(argv[1], "reset") == 0) {
+		promisc_stats_reset();
+		shell_print(sh, "Capture counters reset");
+	} else {
+		shell_help(sh);
+		return -ENOEXEC;
+	}
+
+	return 0;
+}
+#endif
+
 SHELL_STATIC_SUBCMD_SET_CREATE(
 	promisc_cmd,
 	SHELL_CMD_ARG(mode, NULL,
@@ -57,6 +96,15 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 		      "[-h, --help] : Print out the help for the mode command\n"
 		      "Usage: promiscuous_set mode 1 or 0\n",
 		      cmd_wifi_promisc, 2, 0),
+#if defined(CONFIG_PROMISC_STATS)
+	SHELL_CMD_ARG(stats, NULL,
+		      "Capture frames and report per-flow airtime, retries and tone loss\n"
+		      "[start] : Clear the counters and start capturing\n"
+		      "[stop] : Stop capturing, keeping the counters\n"
+		      "[reset] : Clear the counters\n"
+		      "Usage: promiscuous_set stats [start|stop|reset]\n",
+		      cmd_wifi_promisc_stats, 1, 1),
+#endif
 	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(promiscuous_set, &promisc_cmd,
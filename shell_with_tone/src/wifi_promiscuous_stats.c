@@ -0,0 +1,755 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Per-flow airtime analyzer of frames captured in promiscuous mode
+ *
+ * A capture thread reads every frame the Wi-Fi interface passes up on a
+ * packet socket, groups data frames into flows by transmitter, receiver,
+ * EtherType and UDP port, and follows the sequence numbers of tone
+ * datagrams. All state lives in fixed tables: a flow table that evicts the
+ * least recently seen flow and a ring of airtime windows.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/ethernet.h>
+#include <zephyr/net/net_if.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+LOG_MODULE_REGISTER(promisc_stats, CONFIG_LOG_DEFAULT_LEVEL);
+
+#include "wifi_promiscuous_stats.h"
+#include "wifi_raw_tx_pkt.h"
+
+#define PROMISC_FRAME_BYTES 2048U
+#define PROMISC_POLL_MS     200
+#define PROMISC_BACKOFF_MS  100
+#define PROMISC_MAX_FLOWS   CONFIG_PROMISC_STATS_MAX_FLOWS
+#define PROMISC_WINDOWS     CONFIG_PROMISC_STATS_WINDOWS
+#define PROMISC_WINDOW_MS   CONFIG_PROMISC_STATS_WINDOW_MS
+
+/* Tone datagram layout, as sent by src/tone */
+#define TONE_HDR_LEN         12U
+#define TONE_HDR_EXT_MAGIC   0x5445U
+#define TONE_FEC_EXT_MAGIC   0x5446U
+#define TONE_LINK_EXT_MAGIC  0x544CU
+#define TONE_RAW_ETHERTYPE   0x88B5U
+/* Sequence numbers remembered per flow to tell duplicates from late packets */
+#define TONE_SEQ_WINDOW      32
+/* A forward jump this large is a restarted stream rather than loss */
+#define TONE_SEQ_RESYNC      65536
+
+#define WLAN_FC_TYPE_DATA    2U
+#define WLAN_FC_RETRY        0x0800U
+#define WLAN_FC_PROTECTED    0x4000U
+#define WLAN_FC_ORDER        0x8000U
+#define WLAN_FC_TO_FROM_DS   0x0300U
+#define WLAN_HDR_LEN         24U
+#define WLAN_QOS_HDR_LEN     26U
+#define WLAN_FCS_LEN         4U
+#define LLC_SNAP_LEN         8U
+
+static const uint8_t llc_snap_prefix[] = {0xAA, 0xAA, 0x03, 0x00, 0x00, 0x00};
+
+/* PHY of a received frame, as the nRF70 raw RX header reports it */
+enum promisc_rate_mode {
+	PROMISC_RATE_LEGACY,
+	PROMISC_RATE_HT,
+	PROMISC_RATE_VHT,
+	PROMISC_RATE_HE_SU,
+	PROMISC_RATE_HE_ER_SU,
+};
+
+/* Data bits per symbol, 20 MHz and one spatial stream, by MCS */
+static const uint16_t ht_ndbps[] = {26, 52, 78, 104, 156, 208, 234, 260, 312, 347};
+static const uint16_t he_ndbps[] = {117, 234, 351, 468, 702, 936, 1053, 1170, 1404, 1560, 1755,
+				    1950};
+
+/* What one captured frame contributes, with pointers into the receive buffer */
+struct promisc_frame {
+	const uint8_t *ta;
+	const uint8_t *ra;
+	bool data;
+	bool retry;
+	bool has_signal;
+	int16_t signal;
+	uint32_t airtime_us;
+	/* 0 for protected frames and frames without LLC/SNAP */
+	uint16_t ethertype;
+	const uint8_t *payload;
+	size_t payload_len;
+};
+
+struct promisc_flow {
+	bool in_use;
+	bool tone;
+	uint8_t ta[6];
+	uint8_t ra[6];
+	uint16_t ethertype;
+	uint16_t port;
+	uint32_t last_seen_ms;
+	uint32_t frames;
+	uint32_t retries;
+	uint64_t bytes;
+	uint64_t airtime_us;
+	int32_t signal_sum;
+	uint32_t signal_count;
+	/* Tone sequence tracking; bit i of seen_mask is next_seq - 1 - i */
+	bool seq_valid;
+	uint32_t next_seq;
+	uint32_t seen_mask;
+	uint32_t tone_packets;
+	uint32_t parity_packets;
+	uint32_t link_reports;
+	uint32_t lost;
+	uint32_t duplicates;
+	uint32_t reordered;
+	uint32_t resyncs;
+};
+
+struct promisc_window {
+	uint32_t frames;
+	uint32_t tone_frames;
+	uint32_t airtime_us;
+	uint32_t tone_airtime_us;
+};
+
+struct promisc_counters {
+	int64_t start_ms;
+	int64_t stop_ms;
+	uint32_t frames;
+	uint32_t non_data;
+	uint32_t malformed;
+	uint32_t recv_errors;
+	uint32_t evictions;
+	uint64_t airtime_us;
+	uint32_t window_start_ms;
+	uint8_t window_idx;
+	/* Windows completed since the reset, capped at the ring size */
+	uint8_t windows_done;
+	struct promisc_window windows[PROMISC_WINDOWS];
+	struct promisc_flow flows[PROMISC_MAX_FLOWS];
+};
+
+static struct {
+	/* Serializes the capture thread and the shell over counters */
+	struct k_mutex lock;
+	atomic_t capturing;
+	bool thread_started;
+	struct net_if *iface;
+	struct promisc_counters counters;
+} analyzer;
+
+K_SEM_DEFINE(promisc_capture_sem, 0, 1);
+K_THREAD_STACK_DEFINE(promisc_capture_stack, CONFIG_PROMISC_STATS_STACK_SIZE);
+static struct k_thread promisc_capture_thread;
+
+/* Capture thread only */
+static uint8_t frame_buf[PROMISC_FRAME_BYTES];
+/* Shell thread only: printed from a copy so capture never waits on the shell */
+static struct promisc_counters print_snapshot;
+
+static uint32_t legacy_airtime_us(uint8_t rate, size_t len)
+{
+	/* DSSS/CCK with the long preamble; 55 stands for 5.5 Mbit/s as in raw_tx */
+	if (rate == 1U || rate == 2U || rate == 11U) {
+		return 192U + DIV_ROUND_UP(8U * len, rate);
+	} else if (rate == 55U) {
+		return 192U + DIV_ROUND_UP(80U * len, 55U);
+	}
+
+	/* OFDM: 16 SERVICE and 6 tail bits, 4 us symbols of 4 * rate bits */
+	uint32_t bits_per_symbol = 4U * ((rate >= 6U && rate <= 54U) ? rate : 6U);
+
+	return 20U + 4U * DIV_ROUND_UP(22U + 8U * len, bits_per_symbol);
+}
+
+/* On-air time of an MPDU of len bytes, including the FCS */
+static uint32_t frame_airtime_us(uint8_t rate_flags, uint8_t rate, size_t len)
+{
+	uint32_t bits = 22U + 8U * len;
+
+	switch (rate_flags) {
+	case PROMISC_RATE_HT:
+	case PROMISC_RATE_VHT: {
+		uint32_t ndbps = ht_ndbps[MIN(rate, ARRAY_SIZE(ht_ndbps) - 1U)];
+
+		return ((rate_flags == PROMISC_RATE_HT) ? 36U : 40U) +
+		       4U * DIV_ROUND_UP(bits, ndbps);
+	}
+	case PROMISC_RATE_HE_SU:
+	case PROMISC_RATE_HE_ER_SU: {
+		uint32_t ndbps = he_ndbps[MIN(rate, ARRAY_SIZE(he_ndbps) - 1U)];
+
+		/* 13.6 us symbols: 12.8 us plus the 0.8 us guard interval */
+		return ((rate_flags == PROMISC_RATE_HE_SU) ? 44U : 52U) +
+		       DIV_ROUND_UP(136U * DIV_ROUND_UP(bits, ndbps), 10U);
+	}
+	default:
+		return legacy_airtime_us(rate, len);
+	}
+}
+
+#if defined(CONFIG_NRF70_RAW_DATA_RX)
+/* Raw RX header followed by the 802.11 frame, FCS already stripped */
+static int parse_frame(const uint8_t *buf, size_t len, struct promisc_frame *frame)
+{
+	struct raw_rx_pkt_header rx;
+
+	if (len < sizeof(rx) + 10U) {
+		return -EINVAL;
+	}
+
+	memcpy(&rx, buf, sizeof(rx));
+	buf += sizeof(rx);
+	len -= sizeof(rx);
+
+	uint16_t fc = sys_get_le16(buf);
+
+	memset(frame, 0, sizeof(*frame));
+	frame->airtime_us = frame_airtime_us(rx.rate_flags, rx.rate, len + WLAN_FCS_LEN);
+	frame->has_signal = true;
+	frame->signal = rx.signal;
+	frame->retry = (fc & WLAN_FC_RETRY) != 0U;
+	frame->ra = buf + 4;
+
+	if (((fc >> 2) & 0x3U) != WLAN_FC_TYPE_DATA) {
+		return 0;
+	}
+
+	size_t hdr_len = WLAN_HDR_LEN;
+
+	if ((fc & WLAN_FC_TO_FROM_DS) == WLAN_FC_TO_FROM_DS) {
+		hdr_len += 6U;
+	}
+	if ((fc >> 4) & 0x8U) {
+		hdr_len += 2U;
+		if (fc & WLAN_FC_ORDER) {
+			hdr_len += 4U;
+		}
+	}
+	if (len < hdr_len) {
+		return -EINVAL;
+	}
+
+	frame->data = true;
+	frame->ta = buf + 10;
+
+	if (!(fc & WLAN_FC_PROTECTED) && len >= hdr_len + LLC_SNAP_LEN &&
+	    memcmp(buf + hdr_len, llc_snap_prefix, sizeof(llc_snap_prefix)) == 0) {
+		frame->ethertype = sys_get_be16(buf + hdr_len + sizeof(llc_snap_prefix));
+		frame->payload = buf + hdr_len + LLC_SNAP_LEN;
+		frame->payload_len = len - hdr_len - LLC_SNAP_LEN;
+	}
+
+	return 0;
+}
+#else
+/*
+ * Promiscuous mode hands up data frames already converted to Ethernet, so
+ * retries and the PHY rate are unknown. Airtime assumes a QoS data frame
+ * at CONFIG_PROMISC_STATS_PHY_RATE_MBPS.
+ */
+static int parse_frame(const uint8_t *buf, size_t len, struct promisc_frame *frame)
+{
+	size_t hdr_len = sizeof(struct net_eth_hdr);
+
+	if (len < hdr_len) {
+		return -EINVAL;
+	}
+
+	memset(frame, 0, sizeof(*frame));
+	frame->data = true;
+	frame->ra = buf;
+	frame->ta = buf + 6;
+	frame->ethertype = sys_get_be16(buf + 12);
+	if (frame->ethertype == NET_ETH_PTYPE_VLAN && len >= hdr_len + 4U) {
+		frame->ethertype = sys_get_be16(buf + 16);
+		hdr_len += 4U;
+	}
+	frame->payload = buf + hdr_len;
+	frame->payload_len = len - hdr_len;
+	frame->airtime_us =
+		frame_airtime_us(PROMISC_RATE_LEGACY, CONFIG_PROMISC_STATS_PHY_RATE_MBPS,
+				 WLAN_QOS_HDR_LEN + LLC_SNAP_LEN + frame->payload_len +
+					 WLAN_FCS_LEN);
+
+	return 0;
+}
+#endif
+
+/* UDP destination port and the datagram carried, if the payload is unfragmented UDP */
+static const uint8_t *udp_datagram(const struct promisc_frame *frame, uint16_t *port,
+				   size_t *len)
+{
+	const uint8_t *ip = frame->payload;
+	size_t ip_len = frame->payload_len;
+	size_t hdr_len;
+
+	if (frame->ethertype == NET_ETH_PTYPE_IP && ip_len >= 20U) {
+		hdr_len = (ip[0] & 0x0FU) * 4U;
+		/* Later fragments carry no UDP header */
+		if (ip[9] != IPPROTO_UDP || (sys_get_be16(ip + 6) & 0x1FFFU) != 0U) {
+			return NULL;
+		}
+	} else if (frame->ethertype == NET_ETH_PTYPE_IPV6 && ip_len >= 40U) {
+		hdr_len = 40U;
+		if (ip[6] != IPPROTO_UDP) {
+			return NULL;
+		}
+	} else {
+		return NULL;
+	}
+
+	if (ip_len < hdr_len + 8U) {
+		return NULL;
+	}
+
+	*port = sys_get_be16(ip + hdr_len + 2);
+	*len = ip_len - hdr_len - 8U;
+	return ip + hdr_len + 8U;
+}
+
+static bool tone_ext_magic(const uint8_t *datagram, size_t len, uint16_t magic)
+{
+	return len >= TONE_HDR_LEN + 2U && sys_get_be16(datagram + TONE_HDR_LEN) == magic;
+}
+
+static struct promisc_flow *flow_get(struct promisc_counters *c,
+				     const struct promisc_frame *frame, uint16_t port,
+				     uint32_t now_ms)
+{
+	struct promisc_flow *victim = &c->flows[0];
+
+	for (int i = 0; i < PROMISC_MAX_FLOWS; i++) {
+		struct promisc_flow *flow = &c->flows[i];
+
+		if (!flow->in_use) {
+			victim = flow;
+			continue;
+		}
+
+		if (flow->ethertype == frame->ethertype && flow->port == port &&
+		    memcmp(flow->ta, frame->ta, sizeof(flow->ta)) == 0 &&
+		    memcmp(flow->ra, frame->ra, sizeof(flow->ra)) == 0) {
+			return flow;
+		}
+
+		if (victim->in_use && now_ms - flow->last_seen_ms > now_ms - victim->last_seen_ms) {
+			victim = flow;
+		}
+	}
+
+	if (victim->in_use) {
+		c->evictions++;
+	}
+
+	memset(victim, 0, sizeof(*victim));
+	victim->in_use = true;
+	memcpy(victim->ta, frame->ta, sizeof(victim->ta));
+	memcpy(victim->ra, frame->ra, sizeof(victim->ra));
+	victim->ethertype = frame->ethertype;
+	victim->port = port;
+	return victim;
+}
+
+static void flow_track_seq(struct promisc_flow *flow, uint32_t seq)
+{
+	flow->tone_packets++;
+
+	if (!flow->seq_valid) {
+		flow->seq_valid = true;
+		flow->next_seq = seq + 1U;
+		flow->seen_mask = 1U;
+		return;
+	}
+
+	int32_t delta = (int32_t)(seq - flow->next_seq);
+
+	if (delta >= 0 && delta < TONE_SEQ_RESYNC) {
+		flow->lost += delta;
+		flow->seen_mask = (delta + 1 < TONE_SEQ_WINDOW) ? (flow->seen_mask << (delta + 1)) | 1U
+								: 1U;
+		flow->next_seq = seq + 1U;
+	} else if (delta < 0 && delta >= -TONE_SEQ_WINDOW) {
+		uint32_t bit = BIT(-delta - 1);
+
+		if (flow->seen_mask & bit) {
+			flow->duplicates++;
+		} else {
+			/* Counted lost when a later packet overtook it */
+			flow->seen_mask |= bit;
+			flow->lost -= MIN(flow->lost, 1U);
+			flow->reordered++;
+		}
+	} else {
+		flow->resyncs++;
+		flow->next_seq = seq + 1U;
+		flow->seen_mask = 1U;
+	}
+}
+
+/* Window of now_ms, rolling the ring forward over idle windows */
+static struct promisc_window *window_current(struct promisc_counters *c, uint32_t now_ms)
+{
+	uint32_t elapsed = now_ms - c->window_start_ms;
+
+	if (elapsed >= PROMISC_WINDOW_MS) {
+		uint32_t steps = MIN(elapsed / PROMISC_WINDOW_MS, PROMISC_WINDOWS);
+
+		for (uint32_t i = 0; i < steps; i++) {
+			c->window_idx = (c->window_idx + 1U) % PROMISC_WINDOWS;
+			memset(&c->windows[c->window_idx], 0, sizeof(c->windows[0]));
+			c->windows_done = MIN(c->windows_done + 1U, PROMISC_WINDOWS);
+		}
+		c->window_start_ms += (elapsed / PROMISC_WINDOW_MS) * PROMISC_WINDOW_MS;
+	}
+
+	return &c->windows[c->window_idx];
+}
+
+static void analyze_frame(const uint8_t *buf, size_t len)
+{
+	struct promisc_counters *c = &analyzer.counters;
+	struct promisc_frame frame;
+	uint32_t now_ms = k_uptime_get_32();
+	int ret = parse_frame(buf, len, &frame);
+
+	k_mutex_lock(&analyzer.lock, K_FOREVER);
+
+	if (ret < 0) {
+		c->malformed++;
+		k_mutex_unlock(&analyzer.lock);
+		return;
+	}
+
+	struct promisc_window *window = window_current(c, now_ms);
+
+	c->frames++;
+	c->airtime_us += frame.airtime_us;
+	window->frames++;
+	window->airtime_us += frame.airtime_us;
+
+	if (!frame.data) {
+		c->non_data++;
+		k_mutex_unlock(&analyzer.lock);
+		return;
+	}
+
+	uint16_t port = 0U;
+	size_t datagram_len = frame.payload_len;
+	const uint8_t *datagram = frame.payload;
+	bool tone = false;
+
+	if (frame.ethertype == TONE_RAW_ETHERTYPE) {
+		tone = datagram_len >= TONE_HDR_LEN;
+	} else {
+		datagram = udp_datagram(&frame, &port, &datagram_len);
+		tone = datagram && datagram_len >= TONE_HDR_LEN &&
+		       (port == CONFIG_PROMISC_STATS_TONE_PORT ||
+			tone_ext_magic(datagram, datagram_len, TONE_HDR_EXT_MAGIC) ||
+			tone_ext_magic(datagram, datagram_len, TONE_FEC_EXT_MAGIC) ||
+			tone_ext_magic(datagram, datagram_len, TONE_LINK_EXT_MAGIC));
+	}
+
+	struct promisc_flow *flow = flow_get(c, &frame, port, now_ms);
+
+	flow->last_seen_ms = now_ms;
+	flow->frames++;
+	flow->bytes += len;
+	flow->airtime_us += frame.airtime_us;
+	flow->retries += frame.retry ? 1U : 0U;
+	if (frame.has_signal) {
+		flow->signal_sum += frame.signal;
+		flow->signal_count++;
+	}
+
+	if (tone) {
+		flow->tone = true;
+		window->tone_frames++;
+		window->tone_airtime_us += frame.airtime_us;
+
+		/*
+		 * Parity packets repeat the sequence number of their group and
+		 * link reports that of the next data packet. A retry seen after
+		 * its original counts as a duplicate.
+		 */
+		if (tone_ext_magic(datagram, datagram_len, TONE_FEC_EXT_MAGIC)) {
+			flow->parity_packets++;
+		} else if (tone_ext_magic(datagram, datagram_len, TONE_LINK_EXT_MAGIC)) {
+			flow->link_reports++;
+		} else {
+			flow_track_seq(flow, sys_get_be32(datagram));
+		}
+	}
+
+	k_mutex_unlock(&analyzer.lock);
+}
+
+static int open_capture_socket(void)
+{
+	struct sockaddr_ll addr = {
+		.sll_family = AF_PACKET,
+		.sll_ifindex = net_if_get_by_iface(analyzer.iface),
+	};
+
+	int fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (fd < 0) {
+		LOG_ERR("Capture socket() failed: %d", errno);
+		return -errno;
+	}
+
+	if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+		int err = -errno;
+
+		LOG_ERR("Capture bind() failed: %d", errno);
+		close(fd);
+		return err;
+	}
+
+	return fd;
+}
+
+static void promisc_capture_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	for (;;) {
+		k_sem_take(&promisc_capture_sem, K_FOREVER);
+
+		int fd = open_capture_socket();
+		if (fd < 0) {
+			atomic_set(&analyzer.capturing, 0);
+			continue;
+		}
+
+		struct pollfd pfd = {
+			.fd = fd,
+			.events = POLLIN,
+		};
+
+		/* Polled with a timeout so a stop is noticed on an idle channel */
+		while (atomic_get(&analyzer.capturing)) {
+			int ret = poll(&pfd, 1, PROMISC_POLL_MS);
+			ssize_t len = (ret > 0) ? recv(fd, frame_buf, sizeof(frame_buf), 0) : 0;
+
+			if (ret < 0 || len < 0) {
+				k_mutex_lock(&analyzer.lock, K_FOREVER);
+				analyzer.counters.recv_errors++;
+				k_mutex_unlock(&analyzer.lock);
+				k_sleep(K_MSEC(PROMISC_BACKOFF_MS));
+			} else if (len > 0) {
+				analyze_frame(frame_buf, len);
+			}
+		}
+
+		close(fd);
+	}
+}
+
+static void counters_reset_locked(void)
+{
+	memset(&analyzer.counters, 0, sizeof(analyzer.counters));
+	analyzer.counters.start_ms = k_uptime_get();
+	analyzer.counters.window_start_ms = (uint32_t)analyzer.counters.start_ms;
+}
+
+static int promisc_stats_init(void)
+{
+	k_mutex_init(&analyzer.lock);
+	return 0;
+}
+
+SYS_INIT(promisc_stats_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+int promisc_stats_start(void)
+{
+	struct net_if *iface = net_if_get_first_wifi();
+
+	if (!iface) {
+		return -ENODEV;
+	}
+
+	if (!atomic_cas(&analyzer.capturing, 0, 1)) {
+		return -EALREADY;
+	}
+
+	k_mutex_lock(&analyzer.lock, K_FOREVER);
+	analyzer.iface = iface;
+	counters_reset_locked();
+	k_mutex_unlock(&analyzer.lock);
+
+	if (!analyzer.thread_started) {
+		k_thread_create(&promisc_capture_thread, promisc_capture_stack,
+				K_THREAD_STACK_SIZEOF(promisc_capture_stack),
+				promisc_capture_thread_fn, NULL, NULL, NULL,
+				K_PRIO_PREEMPT(CONFIG_PROMISC_STATS_PRIORITY), 0, K_NO_WAIT);
+		if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+			k_thread_name_set(&promisc_capture_thread, "promisc_stats");
+		}
+		analyzer.thread_started = true;
+	}
+
+	k_sem_give(&promisc_capture_sem);
+	LOG_INF("Capturing %s frames", IS_ENABLED(CONFIG_NRF70_RAW_DATA_RX) ? "802.11" : "802.3");
+	return 0;
+}
+
+int promisc_stats_stop(void)
+{
+	if (!atomic_cas(&analyzer.capturing, 1, 0)) {
+		return -EALREADY;
+	}
+
+	k_mutex_lock(&analyzer.lock, K_FOREVER);
+	analyzer.counters.stop_ms = k_uptime_get();
+	k_mutex_unlock(&analyzer.lock);
+
+	return 0;
+}
+
+void promisc_stats_reset(void)
+{
+	k_mutex_lock(&analyzer.lock, K_FOREVER);
+	counters_reset_locked();
+	k_mutex_unlock(&analyzer.lock);
+}
+
+static uint32_t permille(uint64_t part, uint64_t whole)
+{
+	return (whole > 0U) ? (uint32_t)((part * 1000U) / whole) : 0U;
+}
+
+static void print_flow(const struct shell *sh, const struct promisc_flow *flow,
+		       uint64_t elapsed_us)
+{
+	const uint8_t *ta = flow->ta;
+	const uint8_t *ra = flow->ra;
+	uint32_t air = permille(flow->airtime_us, elapsed_us);
+
+	shell_print(sh,
+		    "  %02x:%02x:%02x:%02x:%02x:%02x -> %02x:%02x:%02x:%02x:%02x:%02x "
+		    "type 0x%04x port %u%s",
+		    ta[0], ta[1], ta[2], ta[3], ta[4], ta[5], ra[0], ra[1], ra[2], ra[3], ra[4],
+		    ra[5], flow->ethertype, flow->port, flow->tone ? " (tone)" : "");
+
+	if (flow->signal_count > 0U) {
+		shell_print(sh,
+			    "    %u frames, %llu bytes, %u retries, airtime %llu ms (%u.%u%%), "
+			    "signal %d dBm",
+			    flow->frames, flow->bytes, flow->retries, flow->airtime_us / 1000U,
+			    air / 10U, air % 10U, flow->signal_sum / (int32_t)flow->signal_count);
+	} else {
+		shell_print(sh, "    %u frames, %llu bytes, airtime %llu ms (%u.%u%%)", flow->frames,
+			    flow->bytes, flow->airtime_us / 1000U, air / 10U, air % 10U);
+	}
+
+	if (flow->tone_packets > 0U) {
+		uint32_t loss = permille(flow->lost, flow->tone_packets + flow->lost);
+
+		shell_print(sh,
+			    "    tone: %u packets, %u lost (%u.%u%%), %u duplicate, %u reordered, "
+			    "%u parity, %u link reports, %u restarts",
+			    flow->tone_packets, flow->lost, loss / 10U, loss % 10U,
+			    flow->duplicates, flow->reordered, flow->parity_packets,
+			    flow->link_reports, flow->resyncs);
+	}
+}
+
+void promisc_stats_print(const struct shell *sh)
+{
+	struct promisc_counters *c = &print_snapshot;
+	bool capturing = atomic_get(&analyzer.capturing);
+
+	k_mutex_lock(&analyzer.lock, K_FOREVER);
+	if (capturing) {
+		(void)window_current(&analyzer.counters, k_uptime_get_32());
+	}
+	*c = analyzer.counters;
+	k_mutex_unlock(&analyzer.lock);
+
+	if (c->start_ms == 0) {
+		shell_print(sh, "Capture: never started. Use 'promiscuous_set stats start'");
+		return;
+	}
+
+	int64_t end_ms = capturing ? k_uptime_get() : c->stop_ms;
+	uint64_t elapsed_us = (uint64_t)(end_ms - c->start_ms) * 1000U;
+	uint32_t util = permille(c->airtime_us, elapsed_us);
+
+	shell_print(sh, "Capture: %s, %s frames, %lld ms", capturing ? "running" : "stopped",
+		    IS_ENABLED(CONFIG_NRF70_RAW_DATA_RX) ? "802.11" : "802.3",
+		    end_ms - c->start_ms);
+	shell_print(sh, "  Frames: %u (%u non-data), malformed %u, receive errors %u", c->frames,
+		    c->non_data, c->malformed, c->recv_errors);
+	shell_print(sh, "  Airtime: %llu ms, %u.%u%% of the capture", c->airtime_us / 1000U,
+		    util / 10U, util % 10U);
+
+	/* The current window is still filling, so only completed ones are reported */
+	uint32_t completed = MIN(c->windows_done, PROMISC_WINDOWS - 1U);
+
+	if (completed > 0U) {
+		const struct promisc_window *last =
+			&c->windows[(c->window_idx + PROMISC_WINDOWS - 1U) % PROMISC_WINDOWS];
+		uint64_t window_us = (uint64_t)PROMISC_WINDOW_MS * 1000U;
+		uint64_t sum_us = 0U;
+		uint32_t peak_us = 0U;
+
+		for (uint32_t i = 1; i <= completed; i++) {
+			const struct promisc_window *w =
+				&c->windows[(c->window_idx + PROMISC_WINDOWS - i) % PROMISC_WINDOWS];
+
+			sum_us += w->airtime_us;
+			peak_us = MAX(peak_us, w->airtime_us);
+		}
+
+		uint32_t last_util = permille(last->airtime_us, window_us);
+		uint32_t tone_util = permille(last->tone_airtime_us, window_us);
+		uint32_t avg_util = permille(sum_us, window_us * completed);
+		uint32_t peak_util = permille(peak_us, window_us);
+
+		shell_print(sh,
+			    "  Utilization per %u ms: last %u.%u%% (tone %u.%u%%, %u of %u frames), "
+			    "avg %u.%u%%, peak %u.%u%% over %u windows",
+			    PROMISC_WINDOW_MS, last_util / 10U, last_util % 10U, tone_util / 10U,
+			    tone_util % 10U, last->tone_frames, last->frames, avg_util / 10U,
+			    avg_util % 10U, peak_util / 10U, peak_util % 10U, completed);
+	}
+
+	if (c->evictions > 0U) {
+		shell_print(sh, "  Flows evicted: %u (table holds %u)", c->evictions,
+			    PROMISC_MAX_FLOWS);
+	}
+
+	/* Busiest flows first */
+	bool printed[PROMISC_MAX_FLOWS] = {false};
+
+	for (int n = 0; n < PROMISC_MAX_FLOWS; n++) {
+		int best = -1;
+
+		for (int i = 0; i < PROMISC_MAX_FLOWS; i++) {
+			if (c->flows[i].in_use && !printed[i] &&
+			    (best < 0 || c->flows[i].airtime_us > c->flows[best].airtime_us)) {
+				best = i;
+			}
+		}
+
+		if (best < 0) {
+			break;
+		}
+
+		printed[best] = true;
+		print_flow(sh, &c->flows[best], elapsed_us);
+	}
+}
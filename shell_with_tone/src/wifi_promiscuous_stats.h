@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Per-flow airtime analyzer of frames captured in promiscuous mode
+ */
+
+#pragma once
+
+#include <zephyr/shell/shell.h>
+
+/**
+ * @brief Start classifying the frames received on the Wi-Fi interface.
+ *
+ * @return 0 on success, -EALREADY if already capturing.
+ */
+int promisc_stats_start(void);
+
+/**
+ * @brief Stop capturing; the counters stay readable.
+ *
+ * @return 0 on success, -EALREADY if not capturing.
+ */
+int promisc_stats_stop(void);
+
+/** @brief Clear flows, airtime windows and counters. */
+void promisc_stats_reset(void);
+
+/** @brief Print capture totals, airtime utilization and the flow table. */
+void promisc_stats_print(const struct shell *sh);
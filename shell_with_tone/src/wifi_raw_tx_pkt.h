@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/** @file
+ * @brief Wi-Fi Raw Tx and Rx Packet headers, shared by the raw_tx shell, the tone raw
+ * transport and the promiscuous analyzer
+ */
+
+#pragma once
+
+#define NRF_WIFI_MAGIC_NUM_RAWTX 0x12345678
+
+/* TODO: Copied from nRF70 Wi-Fi driver, need to be moved to a common place */
+
+/**
+ * @brief Transmit modes for raw packets.
+ *
+ */
+enum nrf_wifi_fmac_rawtx_mode {
+	/** Legacy mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_LEGACY,
+	/** HT mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_HT,
+	/** VHT mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_VHT,
+	/** HE SU mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_HE_SU,
+	/** HE ER SU mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_HE_ER_SU,
+	/** HE TB mode. */
+	NRF_WIFI_FMAC_RAWTX_MODE_HE_TB,
+	/** Throughput max. */
+	NRF_WIFI_FMAC_RAWTX_MODE_MAX
+};
+
+struct raw_tx_pkt_header {
+	unsigned int magic_num;
+	unsigned char data_rate;
+	unsigned short packet_length;
+	unsigned char tx_mode;
+	unsigned char queue;
+	unsigned char raw_tx_flag;
+};
+
+/* Prepended to every frame received in monitor mode */
+struct raw_rx_pkt_header {
+	unsigned short frequency;
+	signed short signal;
+	unsigned char rate_flags;
+	unsigned char rate;
+};
+
+/**
+ * @brief Copy the header set by 'raw_tx configure'.
+ *
+ * @return 0 on success, -ENODATA if 'raw_tx configure' has not run.
+ */
+int wifi_raw_tx_get_header(struct raw_tx_pkt_header *hdr);
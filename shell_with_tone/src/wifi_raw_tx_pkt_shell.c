@@ -14,46 +14,24 @@
 #include <zephyr/posix/unistd.h>
 #include <zephyr/posix/sys/socket.h>
 #include <zephyr/logging/log.h>
+#if defined(CONFIG_RAW_TX_TRACING)
+#include <zephyr/tracing/tracing.h>
+#endif
 LOG_MODULE_REGISTER(raw_tx_pkt, CONFIG_LOG_DEFAULT_LEVEL);
 
 #include "net_private.h"
+#include "wifi_raw_tx_pkt.h"
+
+/* Sender markers for the tracing backend: frame number, then result or lag */
+#if defined(CONFIG_RAW_TX_TRACING)
+#define RAW_TX_TRACE(event, frame, arg) sys_trace_named_event("raw_tx_" event, (frame), (arg))
+#else
+#define RAW_TX_TRACE(event, frame, arg) do { } while (false)
+#endif
 
 #define BEACON_PAYLOAD_LENGTH           256
 #define IEEE80211_SEQ_CTRL_SEQ_NUM_MASK 0xFFF0
 #define IEEE80211_SEQ_NUMBER_INC        BIT(4) /* 0-3 is fragment number */
-#define NRF_WIFI_MAGIC_NUM_RAWTX        0x12345678
-
-/* TODO: Copied from nRF70 Wi-Fi driver, need to be moved to a common place */
-
-/**
- * @brief Transmit modes for raw packets.
- *
- */
-enum nrf_wifi_fmac_rawtx_mode {
-	/** Legacy mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_LEGACY,
-	/** HT mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_HT,
-	/** VHT mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_VHT,
-	/** HE SU mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_HE_SU,
-	/** HE ER SU mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_HE_ER_SU,
-	/** HE TB mode. */
-	NRF_WIFI_FMAC_RAWTX_MODE_HE_TB,
-	/** Throughput max. */
-	NRF_WIFI_FMAC_RAWTX_MODE_MAX
-};
-
-struct raw_tx_pkt_header {
-	unsigned int magic_num;
-	unsigned char data_rate;
-	unsigned short packet_length;
-	unsigned char tx_mode;
-	unsigned char queue;
-	unsigned char raw_tx_flag;
-};
 
 struct raw_tx_pkt_header raw_tx_pkt;
 
@@ -93,6 +71,16 @@ static struct beacon test_beacon_frame = {
 		0XFF, 0XDD, 0X18, 0X00, 0X50, 0XF2, 0X02, 0X01, 0X01, 0X01, 0X00, 0X03, 0XA4, 0X00,
 		0X00, 0X27, 0XA4, 0X00, 0X00, 0X42, 0X43, 0X5E, 0X00, 0X62, 0X32, 0X2F, 0X00}};
 
+int wifi_raw_tx_get_header(struct raw_tx_pkt_header *hdr)
+{
+	if (raw_tx_pkt.magic_num != NRF_WIFI_MAGIC_NUM_RAWTX) {
+		return -ENODATA;
+	}
+
+	*hdr = raw_tx_pkt;
+	return 0;
+}
+
 void fill_raw_tx_pkt_hdr(int rate_flags, int data_rate, int queue_num)
 {
 	raw_tx_pkt.magic_num = NRF_WIFI_MAGIC_NUM_RAWTX;
@@ -171,46 +159,201 @@ static void increment_seq_control(void)
 	}
 }
 
-static void send_packet(const char *transmission_mode, unsigned int num_pkts, unsigned int delay)
-{
+/* Left to the busy-wait before a frame deadline; sleeps end on tick boundaries */
+#define RAW_TX_SPIN_US 100U
+/* Rate window of the live frames/s figure */
+#define RAW_TX_WINDOW_US 1000000U
+
+/* Background sender: paces frames against absolute deadlines, off the shell thread */
+static struct raw_tx_engine {
+	struct k_thread thread;
+	bool thread_created;
+	atomic_t running;
+	int sockfd;
 	struct sockaddr_ll sa;
-	int sockfd, ret;
-	char *test_frame = NULL;
-	int buf_length, num_failures = 0;
+	/* Header snapshot taken at start, sent ahead of test_beacon_frame */
+	struct raw_tx_pkt_header hdr;
+	/* 0 sends until 'raw_tx stop' */
+	uint32_t num_pkts;
+	uint32_t interval_us;
+	uint64_t start_us;
+	uint64_t end_us;
+	atomic_t sent;
+	atomic_t failures;
+	atomic_t late;
+	atomic_t last_error;
+	/* Frames per second over the last complete window, in mHz */
+	atomic_t window_mfps;
+} engine;
+
+K_THREAD_STACK_DEFINE(raw_tx_stack, CONFIG_RAW_TX_THREAD_STACK_SIZE);
+
+static inline uint64_t raw_tx_now_us(void)
+{
+#if defined(CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER)
+	return k_cyc_to_us_floor64(k_cycle_get_64());
+#else
+	return k_ticks_to_us_floor64(k_uptime_ticks());
+#endif
+}
 
-	ret = setup_raw_pkt_socket(&sockfd, &sa);
-	if (ret < 0) {
-		LOG_ERR("Setting socket for raw pkt transmission failed %d", errno);
-		return;
+/* Frames handed to the driver so far, sent or failed */
+static inline uint32_t raw_tx_frames(void)
+{
+	return atomic_get(&engine.sent) + atomic_get(&engine.failures);
+}
+
+static void raw_tx_wait_until(uint64_t deadline_us)
+{
+	uint64_t now = raw_tx_now_us();
+
+	if (deadline_us > now + RAW_TX_SPIN_US) {
+		k_sleep(K_USEC(deadline_us - now - RAW_TX_SPIN_US));
+		now = raw_tx_now_us();
 	}
 
-	test_frame = malloc(sizeof(struct raw_tx_pkt_header) + sizeof(test_beacon_frame));
-	if (!test_frame) {
-		LOG_ERR("Malloc failed for send buffer %d", errno);
-		return;
+	if (deadline_us > now && atomic_get(&engine.running)) {
+		k_busy_wait((uint32_t)(deadline_us - now));
 	}
+}
 
-	buf_length = sizeof(struct raw_tx_pkt_header) + sizeof(test_beacon_frame);
-	memcpy(test_frame, &raw_tx_pkt, sizeof(struct raw_tx_pkt_header));
+static void raw_tx_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	/* Header and frame go out from where they live; only seq_ctrl changes per frame */
+	struct iovec iov[] = {
+		{
+			.iov_base = &engine.hdr,
+			.iov_len = sizeof(engine.hdr),
+		},
+		{
+			.iov_base = &test_beacon_frame,
+			.iov_len = sizeof(test_beacon_frame),
+		},
+	};
+	struct msghdr msg = {
+		.msg_name = &engine.sa,
+		.msg_namelen = sizeof(engine.sa),
+		.msg_iov = iov,
+		.msg_iovlen = ARRAY_SIZE(iov),
+	};
+	uint64_t deadline = raw_tx_now_us();
+	uint64_t window_start = deadline;
+	uint32_t window_sent = 0U;
+
+	while (atomic_get(&engine.running)) {
+		RAW_TX_TRACE("send_enter", raw_tx_frames(), 0U);
+		if (sendmsg(engine.sockfd, &msg, 0) < 0) {
+			RAW_TX_TRACE("send_exit", raw_tx_frames(), (uint32_t)errno);
+			atomic_inc(&engine.failures);
+			atomic_set(&engine.last_error, errno);
+		} else {
+			RAW_TX_TRACE("send_exit", raw_tx_frames(), 0U);
+			atomic_inc(&engine.sent);
+			window_sent++;
+		}
 
-	for (int i = 0; i < num_pkts; i++) {
-		memcpy(test_frame + sizeof(struct raw_tx_pkt_header), &test_beacon_frame,
-		       sizeof(test_beacon_frame));
+		increment_seq_control();
 
-		ret = sendto(sockfd, test_frame, buf_length, 0, (struct sockaddr *)&sa, sizeof(sa));
-		if (ret < 0) {
-			LOG_ERR("Unable to send beacon frame: %s", strerror(errno));
-			num_failures++;
+		if (engine.num_pkts != 0U && raw_tx_frames() >= engine.num_pkts) {
+			break;
 		}
 
-		increment_seq_control();
+		uint64_t now = raw_tx_now_us();
 
-		k_msleep(delay);
+		if (now - window_start >= RAW_TX_WINDOW_US) {
+			atomic_set(&engine.window_mfps,
+				   (atomic_val_t)(((uint64_t)window_sent * 1000000000ULL) /
+						  (now - window_start)));
+			window_start = now;
+			window_sent = 0U;
+		}
+
+		if (engine.interval_us == 0U) {
+			/* Saturating: the driver queue paces us; let equal-priority threads run */
+			k_yield();
+			continue;
+		}
+
+		deadline += engine.interval_us;
+		if (now > deadline + engine.interval_us) {
+			/* More than a frame behind: drop the missed slots rather than burst */
+			RAW_TX_TRACE("late", raw_tx_frames(),
+				     (uint32_t)MIN(now - deadline, (uint64_t)UINT32_MAX));
+			atomic_inc(&engine.late);
+			deadline = now;
+			continue;
+		}
+		raw_tx_wait_until(deadline);
 	}
 
-	LOG_INF("Sent %d packets with %d failures on socket", num_pkts, num_failures);
-	close(sockfd);
-	free(test_frame);
+	engine.end_us = raw_tx_now_us();
+	close(engine.sockfd);
+	atomic_set(&engine.running, 0);
+	LOG_INF("Sent %u packets with %u failures on socket", (uint32_t)atomic_get(&engine.sent),
+		(uint32_t)atomic_get(&engine.failures));
+}
+
+static int raw_tx_engine_start(unsigned int num_pkts, unsigned int interval_us)
+{
+	if (!atomic_cas(&engine.running, 0, 1)) {
+		return -EBUSY;
+	}
+
+	if (engine.thread_created) {
+		(void)k_thread_join(&engine.thread, K_FOREVER);
+		engine.thread_created = false;
+	}
+
+	int ret = wifi_raw_tx_get_header(&engine.hdr);
+	if (ret == 0 && setup_raw_pkt_socket(&engine.sockfd, &engine.sa) < 0) {
+		LOG_ERR("Setting socket for raw pkt transmission failed %d", errno);
+		ret = -EIO;
+	}
+	if (ret < 0) {
+		atomic_set(&engine.running, 0);
+		return ret;
+	}
+
+	engine.hdr.packet_length = sizeof(test_beacon_frame);
+	engine.num_pkts = num_pkts;
+	engine.interval_us = interval_us;
+	atomic_set(&engine.sent, 0);
+	atomic_set(&engine.failures, 0);
+	atomic_set(&engine.late, 0);
+	atomic_set(&engine.last_error, 0);
+	atomic_set(&engine.window_mfps, 0);
+	engine.start_us = raw_tx_now_us();
+	engine.end_us = 0U;
+
+	k_thread_create(&engine.thread, raw_tx_stack, K_THREAD_STACK_SIZEOF(raw_tx_stack),
+			raw_tx_thread_fn, NULL, NULL, NULL,
+			K_PRIO_PREEMPT(CONFIG_RAW_TX_THREAD_PRIORITY), 0, K_NO_WAIT);
+	if (IS_ENABLED(CONFIG_THREAD_NAME)) {
+		k_thread_name_set(&engine.thread, "raw_tx");
+	}
+	engine.thread_created = true;
+
+	return 0;
+}
+
+static int raw_tx_engine_stop(void)
+{
+	if (!engine.thread_created) {
+		return -EALREADY;
+	}
+
+	bool was_running = atomic_cas(&engine.running, 1, 0);
+
+	/* Cut a sleep towards the next deadline short */
+	k_wakeup(&engine.thread);
+	(void)k_thread_join(&engine.thread, K_FOREVER);
+	engine.thread_created = false;
+
+	return was_running ? 0 : -EALREADY;
 }
 
 static int parse_raw_tx_configure_args(const struct shell *sh, size_t argc, char *argv[],
@@ -289,19 +432,20 @@ static int cmd_configure_raw_tx_pkt(const struct shell *sh, size_t argc, char *a
 }
 
 static int parse_raw_tx_send_args(const struct shell *sh, size_t argc, char *argv[], char **tx_mode,
-				  int *pkt_num, int *time_delay)
+				  int *pkt_num, int *time_delay_us)
 {
 	struct getopt_state *state;
 	int opt;
 	static struct option long_options[] = {{"mode", required_argument, 0, 'm'},
 					       {"num-pkts", required_argument, 0, 'n'},
 					       {"inter-frame-delay", required_argument, 0, 't'},
+					       {"inter-frame-delay-us", required_argument, 0, 'u'},
 					       {"help", no_argument, 0, 'h'},
 					       {0, 0, 0, 0}};
 	int opt_index = 0;
 	int opt_num = 0;
 
-	while ((opt = getopt_long(argc, argv, "m:n:t:h", long_options, &opt_index)) != -1) {
+	while ((opt = getopt_long(argc, argv, "m:n:t:u:h", long_options, &opt_index)) != -1) {
 		state = getopt_state_get();
 		switch (opt) {
 		case 'm':
@@ -314,15 +458,24 @@ static int parse_raw_tx_send_args(const struct shell *sh, size_t argc, char *arg
 			opt_num++;
 			break;
 		case 't':
-			*time_delay = atoi(optarg);
-			if (*time_delay < 0) {
+			*time_delay_us = atoi(optarg);
+			if (*time_delay_us < 0 || *time_delay_us > INT_MAX / USEC_PER_MSEC) {
+				LOG_ERR("Invalid delay %d", atoi(optarg));
+				return -ENOEXEC;
+			}
+			*time_delay_us *= USEC_PER_MSEC;
+			opt_num++;
+			break;
+		case 'u':
+			*time_delay_us = atoi(optarg);
+			if (*time_delay_us < 0) {
 				LOG_ERR("Invalid delay %d", atoi(optarg));
 				return -ENOEXEC;
 			}
 			opt_num++;
 			break;
 		case 'n':
-			*pkt_num = (strcmp(*tx_mode, "continuous") == 0) ? INT_MAX : atoi(optarg);
+			*pkt_num = atoi(optarg);
 			if (*pkt_num <= 0) {
 				LOG_ERR("Invalid num of packets %d", atoi(optarg));
 				return -ENOEXEC;
@@ -340,8 +493,12 @@ static int parse_raw_tx_send_args(const struct shell *sh, size_t argc, char *arg
 		}
 	}
 
-	if (strcmp(*tx_mode, "continuous") == 0) {
-		*pkt_num = INT_MAX;
+	if (!*tx_mode) {
+		LOG_ERR("Please provide the mode of transmission");
+		return -ENOEXEC;
+	} else if (strcmp(*tx_mode, "continuous") == 0) {
+		/* Runs until 'raw_tx stop' */
+		*pkt_num = 0;
 	} else if ((strcmp(*tx_mode, "fixed") == 0) && (*pkt_num == 0)) {
 		LOG_ERR("Please provide number of packets to be transmitted");
 		return -ENOEXEC;
@@ -371,8 +528,60 @@ static int cmd_send_raw_tx_pkt(const struct shell *sh, size_t argc, char *argv[]
 		return -ENOEXEC;
 	}
 
-	LOG_INF("Selected Mode: %s Num-Packets:%u Delay:%d", mode, num_packets, delay);
-	send_packet(mode, num_packets, delay);
+	LOG_INF("Selected Mode: %s Num-Packets:%u Delay:%d us", mode, num_packets, delay);
+
+	int ret = raw_tx_engine_start(num_packets, delay);
+	if (ret == -EBUSY) {
+		shell_error(sh, "Raw TX already running. Use 'raw_tx stop' first");
+		return -ENOEXEC;
+	} else if (ret == -ENODATA) {
+		shell_error(sh, "Raw TX header not set. Use 'raw_tx configure' first");
+		return -ENOEXEC;
+	} else if (ret < 0) {
+		return -ENOEXEC;
+	}
+
+	shell_print(sh, "Raw TX started; 'raw_tx status' reports progress, 'raw_tx stop' ends it");
+	return 0;
+}
+
+static int cmd_stop_raw_tx_pkt(const struct shell *sh, size_t argc, char *argv[])
+{
+	if (raw_tx_engine_stop() == -EALREADY) {
+		shell_warn(sh, "Raw TX not running");
+		return 0;
+	}
+
+	shell_print(sh, "Raw TX stopped after %u packets", (uint32_t)atomic_get(&engine.sent));
+	return 0;
+}
+
+static int cmd_status_raw_tx_pkt(const struct shell *sh, size_t argc, char *argv[])
+{
+	bool running = atomic_get(&engine.running);
+	uint32_t sent = atomic_get(&engine.sent);
+	uint32_t failures = atomic_get(&engine.failures);
+	uint64_t elapsed_us = (running ? raw_tx_now_us() : engine.end_us) - engine.start_us;
+
+	if (!running && engine.start_us == 0U) {
+		shell_print(sh, "Raw TX: idle");
+		return 0;
+	}
+
+	uint64_t avg_mfps = (elapsed_us > 0U) ? ((uint64_t)sent * 1000000000ULL) / elapsed_us : 0U;
+	uint32_t window_mfps = atomic_get(&engine.window_mfps);
+
+	shell_print(sh, "Raw TX: %s, %u frames over %llu ms", running ? "running" : "stopped",
+		    sent, elapsed_us / 1000U);
+	if (engine.num_pkts != 0U) {
+		shell_print(sh, "  Target: %u frames", engine.num_pkts);
+	}
+	shell_print(sh, "  Interval: %u us%s", engine.interval_us,
+		    (engine.interval_us == 0U) ? " (saturating)" : "");
+	shell_print(sh, "  Rate: %llu.%03llu frames/s average, %u.%03u frames/s last second",
+		    avg_mfps / 1000U, avg_mfps % 1000U, window_mfps / 1000U, window_mfps % 1000U);
+	shell_print(sh, "  Failures: %u (last errno %d), late slots skipped: %u", failures,
+		    (int)atomic_get(&engine.last_error), (uint32_t)atomic_get(&engine.late));
 
 	return 0;
 }
@@ -438,11 +647,20 @@ SHELL_STATIC_SUBCMD_SET_CREATE(
 		      "[-m, --mode] : Mode of transmission (either continuous or fixed).\n"
 		      "[-n, --number-of-pkts] : Number of packets to be transmitted.\n"
 		      "[-t, --inter-frame-delay] : Delay between frames or packets in ms.\n"
+		      "[-u, --inter-frame-delay-us] : Delay between frames in us, 0 saturates.\n"
 		      "[-h, --help] : Print out the help for the send command\n"
+		      "Frames are sent in the background until done or 'raw_tx stop'.\n"
 		      "Usage:\n"
 		      "raw_tx send -m fixed -n 9 -t 10 (For fixed mode)\n"
-		      "raw_tx send -m continuous -t 10 (For continuous mode)\n",
+		      "raw_tx send -m continuous -t 10 (For continuous mode)\n"
+		      "raw_tx send -m continuous -u 0 (Saturate the channel)\n",
 		      cmd_send_raw_tx_pkt, 5, 2),
+	SHELL_CMD_ARG(stop, NULL, "Stop a background raw TX run\n"
+		      "Usage: raw_tx stop\n",
+		      cmd_stop_raw_tx_pkt, 1, 0),
+	SHELL_CMD_ARG(status, NULL, "Show frames sent, achieved frames/s and failures\n"
+		      "Usage: raw_tx status\n",
+		      cmd_status_raw_tx_pkt, 1, 0),
 	SHELL_SUBCMD_SET_END);
 
 SHELL_CMD_REGISTER(raw_tx, &raw_tx_cmds, "raw_tx_cmds (To configure and send raw TX packets)",
@@ -0,0 +1,22 @@
+#
+# Copyright (c) 2024 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+if(SB_CONFIG_TONE_NETCORE)
+	ExternalZephyrProject_Add(
+		APPLICATION tone_netcore
+		SOURCE_DIR ${APP_DIR}/tone_netcore
+		BOARD ${SB_CONFIG_TONE_NETCORE_BOARD}
+	)
+
+	# The application only offloads streams when the image is there to take them
+	set_config_bool(${DEFAULT_IMAGE} CONFIG_TONE_STREAM_OFFLOAD y)
+
+	# Partitioned and flashed as the network core image
+	set_property(GLOBAL APPEND PROPERTY PM_DOMAINS CPUNET)
+	set_property(GLOBAL APPEND PROPERTY PM_CPUNET_IMAGES tone_netcore)
+	set_property(GLOBAL PROPERTY DOMAIN_APP_CPUNET tone_netcore)
+	set(CPUNET_PM_DOMAIN_DYNAMIC_PARTITION tone_netcore CACHE INTERNAL "")
+endif()
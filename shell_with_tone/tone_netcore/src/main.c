@@ -0,0 +1,363 @@
+/*
+ * Wi-Fi Audio Tone Test - network core tone synthesis
+ *
+ * Renders the sine blocks of the streams the application core offloads and
+ * hands each one over at its deadline, so the application core's only work
+ * per packet is stamping the tone header and sending the datagram.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/ipc/ipc_service.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "tone_offload_proto.h"
+
+LOG_MODULE_REGISTER(tone_netcore, CONFIG_LOG_DEFAULT_LEVEL);
+
+/* Same oscillator as the application core: 2^32 phase turn, quarter-wave table */
+#define LUT_POINTS            1024U
+#define LUT_INDEX_BITS        10U
+#define NCO_QUADRANT_SHIFT    30U
+#define NCO_INDEX_SHIFT       (NCO_QUADRANT_SHIFT - LUT_INDEX_BITS)
+#define NCO_FRAC_MASK         (BIT(NCO_INDEX_SHIFT) - 1U)
+#define NCO_FRAC_TO_Q15_SHIFT (NCO_INDEX_SHIFT - 15U)
+
+#define PACING_STACK_SIZE 1024
+#define PACING_PRIORITY   K_PRIO_COOP(2)
+
+BUILD_ASSERT(BIT(LUT_INDEX_BITS) == LUT_POINTS, "LUT_POINTS must be 2^LUT_INDEX_BITS");
+
+struct netcore_stream {
+	bool running;
+	/* Parameters of the next block, and an UPDATE waiting to replace them */
+	struct tone_offload_params params;
+	struct tone_offload_params update;
+	bool update_pending;
+	uint32_t phase;
+	uint32_t phase_inc;
+	uint32_t phase_step;
+	int16_t amplitude_q15;
+	uint32_t seq;
+	uint32_t sample_count;
+	uint32_t dropped;
+	/*
+	 * Deadlines follow the frame count since the last rate change, so the
+	 * tick rounding of one block never accumulates into rate drift.
+	 */
+	int64_t base_ticks;
+	uint64_t deadline_frames;
+	/* Rendered block waiting for its deadline, in an IPC TX buffer; NULL when none */
+	struct tone_offload_block *block;
+	uint32_t block_len;
+};
+
+static int16_t sine_lut[LUT_POINTS + 1U];
+static struct netcore_stream streams[TONE_OFFLOAD_MAX_STREAMS];
+static struct ipc_ept ept;
+static K_MUTEX_DEFINE(streams_lock);
+/* Given whenever the earliest deadline may have moved */
+static K_SEM_DEFINE(kick, 0, 1);
+
+static void build_sine_lut(void)
+{
+	for (uint32_t i = 0; i <= LUT_POINTS; i++) {
+		float angle = (3.14159265f / 2.0f) * (float)i / (float)LUT_POINTS;
+
+		sine_lut[i] = (int16_t)lroundf(sinf(angle) * (float)INT16_MAX);
+	}
+}
+
+static int16_t lut_sine(uint32_t phase)
+{
+	uint32_t quadrant = phase >> NCO_QUADRANT_SHIFT;
+	uint32_t index = (phase >> NCO_INDEX_SHIFT) & (LUT_POINTS - 1U);
+	int32_t frac = (int32_t)((phase & NCO_FRAC_MASK) >> NCO_FRAC_TO_Q15_SHIFT);
+	int32_t a, b;
+
+	if (quadrant & 1U) {
+		a = sine_lut[LUT_POINTS - index];
+		b = sine_lut[LUT_POINTS - index - 1U];
+	} else {
+		a = sine_lut[index];
+		b = sine_lut[index + 1U];
+	}
+
+	int32_t s = a + (((b - a) * frac) >> 15);
+
+	return (int16_t)((quadrant & 2U) ? -s : s);
+}
+
+/* Phase is kept, so an UPDATE changes pitch without a discontinuity */
+static void configure(struct netcore_stream *stream, const struct tone_offload_params *params)
+{
+	stream->params = *params;
+	stream->phase_inc = (uint32_t)DIV_ROUND_CLOSEST((uint64_t)params->frequency_hz << 32,
+							params->sample_rate_hz);
+	stream->phase_step = (uint32_t)(((uint64_t)params->channel_phase_deg << 32) / 360U);
+	stream->amplitude_q15 = (int16_t)((params->amplitude_pct * INT16_MAX) / 100U);
+}
+
+static bool params_valid(const struct tone_offload_params *params)
+{
+	uint32_t bytes = params->frames * params->channels * params->sample_bytes;
+
+	return params->sample_rate_hz != 0U && params->frames != 0U &&
+	       params->frames <= UINT16_MAX && params->channels != 0U &&
+	       params->channels <= TONE_OFFLOAD_MAX_CHANNELS && params->sample_bytes >= 2U &&
+	       params->sample_bytes <= 4U && params->amplitude_pct <= 100U &&
+	       params->frequency_hz < params->sample_rate_hz / 2U &&
+	       bytes <= TONE_OFFLOAD_MAX_BLOCK_BYTES;
+}
+
+static int64_t deadline_ticks(const struct netcore_stream *stream)
+{
+	return stream->base_ticks +
+	       (int64_t)((stream->deadline_frames * CONFIG_SYS_CLOCK_TICKS_PER_SEC) /
+			 stream->params.sample_rate_hz);
+}
+
+/* Interleaved little-endian frames, wider formats left-justified like the app core's */
+static void render(struct netcore_stream *stream, uint8_t *dst)
+{
+	const struct tone_offload_params *p = &stream->params;
+	uint32_t phase = stream->phase;
+
+	for (uint32_t f = 0; f < p->frames; f++) {
+		for (uint32_t ch = 0; ch < p->channels; ch++, dst += p->sample_bytes) {
+			int32_t s = (lut_sine(phase + ch * stream->phase_step) *
+				     (int32_t)stream->amplitude_q15) >> 15;
+
+			if (p->sample_bytes == 2U) {
+				sys_put_le16((uint16_t)s, dst);
+			} else if (p->sample_bytes == 3U) {
+				sys_put_le24((uint32_t)s << 8, dst);
+			} else {
+				sys_put_le32((uint32_t)s << 16, dst);
+			}
+		}
+		phase += stream->phase_inc;
+	}
+}
+
+static void release_block(struct netcore_stream *stream)
+{
+	if (stream->block) {
+		(void)ipc_service_drop_tx_buffer(&ept, stream->block);
+		stream->block = NULL;
+	}
+}
+
+/*
+ * Apply a pending UPDATE and render the next block ahead of its deadline.
+ * Without a free IPC buffer the block is skipped at its deadline; its
+ * phase, sequence number and frames are used up all the same.
+ */
+static void prepare(struct netcore_stream *stream)
+{
+	if (stream->update_pending) {
+		if (stream->update.sample_rate_hz != stream->params.sample_rate_hz) {
+			/* The new rate runs from the current deadline */
+			stream->base_ticks = deadline_ticks(stream);
+			stream->deadline_frames = 0U;
+		}
+		configure(stream, &stream->update);
+		stream->update_pending = false;
+	}
+
+	const struct tone_offload_params *p = &stream->params;
+	uint32_t pcm_len = p->frames * p->channels * p->sample_bytes;
+	uint32_t size = sizeof(struct tone_offload_block) + pcm_len;
+	void *buf;
+
+	if (ipc_service_get_tx_buffer(&ept, &buf, &size, K_NO_WAIT) == 0) {
+		struct tone_offload_block *block = buf;
+
+		*block = (struct tone_offload_block){
+			.hdr = {.type = TONE_OFFLOAD_MSG_BLOCK, .stream_id = p->hdr.stream_id},
+			.seq = stream->seq,
+			.sample_count = stream->sample_count,
+			.sample_rate_hz = p->sample_rate_hz,
+			.frames = (uint16_t)p->frames,
+			.channels = p->channels,
+			.sample_bytes = p->sample_bytes,
+		};
+		render(stream, block->pcm);
+		stream->block = block;
+		stream->block_len = sizeof(*block) + pcm_len;
+	}
+
+	stream->phase += stream->phase_inc * p->frames;
+}
+
+static void serve(struct netcore_stream *stream)
+{
+	if (!stream->block) {
+		stream->dropped++;
+	} else if (ipc_service_send_nocopy(&ept, stream->block, stream->block_len) < 0) {
+		release_block(stream);
+		stream->dropped++;
+	}
+	stream->block = NULL;
+
+	stream->seq++;
+	stream->sample_count += stream->params.frames;
+	stream->deadline_frames += stream->params.frames;
+	prepare(stream);
+}
+
+/* Earliest deadline first across the running streams, one block per stream per pass */
+static void pacing_thread_fn(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	for (;;) {
+		int64_t earliest = INT64_MAX;
+
+		k_mutex_lock(&streams_lock, K_FOREVER);
+		for (size_t i = 0; i < ARRAY_SIZE(streams); i++) {
+			struct netcore_stream *stream = &streams[i];
+
+			if (!stream->running) {
+				continue;
+			}
+			if (deadline_ticks(stream) <= k_uptime_ticks()) {
+				serve(stream);
+			}
+			earliest = MIN(earliest, deadline_ticks(stream));
+		}
+		k_mutex_unlock(&streams_lock);
+
+		(void)k_sem_take(&kick, (earliest == INT64_MAX) ? K_FOREVER
+								: K_TIMEOUT_ABS_TICKS(earliest));
+	}
+}
+
+K_THREAD_DEFINE(tone_pacing, PACING_STACK_SIZE, pacing_thread_fn, NULL, NULL, NULL,
+		PACING_PRIORITY, 0, 0);
+
+static void handle_params(const struct tone_offload_params *params)
+{
+	struct netcore_stream *stream = &streams[params->hdr.stream_id];
+
+	if (!params_valid(params)) {
+		LOG_WRN("Stream %u: parameters rejected", params->hdr.stream_id);
+		return;
+	}
+
+	k_mutex_lock(&streams_lock, K_FOREVER);
+	if (params->hdr.type == TONE_OFFLOAD_MSG_UPDATE) {
+		if (stream->running) {
+			stream->update = *params;
+			stream->update_pending = true;
+		}
+	} else {
+		release_block(stream);
+		*stream = (struct netcore_stream){
+			.running = true,
+			.base_ticks = k_uptime_ticks(),
+		};
+		configure(stream, params);
+		prepare(stream);
+		LOG_INF("Stream %u: %u Hz, %u frames x %u ch x %u bytes", params->hdr.stream_id,
+			params->sample_rate_hz, params->frames, params->channels,
+			params->sample_bytes);
+	}
+	k_mutex_unlock(&streams_lock);
+
+	k_sem_give(&kick);
+}
+
+static void handle_stop(uint8_t id)
+{
+	k_mutex_lock(&streams_lock, K_FOREVER);
+	if (streams[id].running) {
+		release_block(&streams[id]);
+		streams[id].running = false;
+		LOG_INF("Stream %u: stopped, %u blocks dropped", id, streams[id].dropped);
+	}
+	k_mutex_unlock(&streams_lock);
+}
+
+static void ept_bound(void *priv)
+{
+	ARG_UNUSED(priv);
+
+	struct tone_offload_hello hello = {
+		.hdr = {.type = TONE_OFFLOAD_MSG_HELLO},
+		.version = TONE_OFFLOAD_VERSION,
+		.max_block_bytes = TONE_OFFLOAD_MAX_BLOCK_BYTES,
+		.max_streams = TONE_OFFLOAD_MAX_STREAMS,
+	};
+	int ret = ipc_service_send(&ept, &hello, sizeof(hello));
+
+	if (ret < 0) {
+		LOG_ERR("HELLO not sent: %d", ret);
+	}
+}
+
+static void ept_received(const void *data, size_t len, void *priv)
+{
+	ARG_UNUSED(priv);
+
+	const struct tone_offload_hdr *hdr = data;
+
+	if (len < sizeof(*hdr) || hdr->stream_id >= TONE_OFFLOAD_MAX_STREAMS) {
+		return;
+	}
+
+	switch (hdr->type) {
+	case TONE_OFFLOAD_MSG_START:
+	case TONE_OFFLOAD_MSG_UPDATE:
+		if (len >= sizeof(struct tone_offload_params)) {
+			handle_params(data);
+		}
+		break;
+	case TONE_OFFLOAD_MSG_STOP:
+		handle_stop(hdr->stream_id);
+		break;
+	default:
+		LOG_WRN("Unexpected message type %u", hdr->type);
+		break;
+	}
+}
+
+static const struct ipc_ept_cfg ept_cfg = {
+	.name = TONE_OFFLOAD_EPT_NAME,
+	.cb = {
+		.bound = ept_bound,
+		.received = ept_received,
+	},
+};
+
+int main(void)
+{
+	const struct device *ipc = DEVICE_DT_GET(DT_NODELABEL(ipc0));
+	int ret;
+
+	build_sine_lut();
+
+	ret = ipc_service_open_instance(ipc);
+	if (ret < 0 && ret != -EALREADY) {
+		LOG_ERR("IPC instance not opened: %d", ret);
+		return ret;
+	}
+
+	ret = ipc_service_register_endpoint(ipc, &ept, &ept_cfg);
+	if (ret < 0) {
+		LOG_ERR("IPC endpoint not registered: %d", ret);
+		return ret;
+	}
+
+	LOG_INF("Tone synthesis ready, protocol version %u", TONE_OFFLOAD_VERSION);
+
+	return 0;
+}